@@ -2,6 +2,7 @@
 #pragma once
 
 #include "cuda_compat.h"
+#include "rng_philox.hxx"
 
 #include <cmath>
 
@@ -11,10 +12,17 @@
 
 // ======================================================================
 // RngC
+//
+// one per (patch, step, cell), drawing from the RNG_COLLISION stream with
+// the given seed
 
 template <typename real_t>
 struct RngC
 {
+  RngC(uint32_t id, uint32_t seed, uint32_t step, uint32_t cell)
+    : stream_{RNG_COLLISION, id, seed, step, cell}
+  {}
+
   // ----------------------------------------------------------------------
   // uniform
   //
@@ -22,13 +30,12 @@ struct RngC
 
   real_t uniform()
   {
-    real_t ran;
-    do {
-      ran = real_t(random()) / RAND_MAX;
-    } while (ran == real_t(0.f));
-
-    return ran;
+    return sizeof(real_t) > sizeof(float) ? real_t(stream_.uniform_double())
+                                          : real_t(stream_.uniform());
   }
+
+private:
+  RngStream stream_;
 };
 
 // ======================================================================
@@ -40,6 +47,9 @@ struct RngFake
 {
   using real_t = double;
 
+  RngFake() = default;
+  RngFake(uint32_t id, uint32_t seed, uint32_t step, uint32_t cell) {}
+
   __host__ __device__ real_t uniform() { return .5; }
 };
 
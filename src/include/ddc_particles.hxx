@@ -5,6 +5,7 @@
 #include <mrc_ddc.h>
 #include <mrc_domain.h>
 #include <mpi_dtype_traits.hxx>
+#include <psc_telemetry.h>
 
 // ======================================================================
 // ddc_particles
@@ -305,6 +306,8 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
       cinfo_[r].send_cnts[i] = n_send;
       cinfo_[r].n_send += n_send;
     }
+    psc_telemetry_neighbor_send(cinfo_[r].rank, cinfo_[r].n_send,
+                                cinfo_[r].n_send * sizeof(Particle));
     MPI_Isend(cinfo_[r].send_cnts.data(), cinfo_[r].n_send_entries, MPI_INT,
               cinfo_[r].rank, 222, comm, &send_reqs_[r]);
   }
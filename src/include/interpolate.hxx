@@ -6,6 +6,10 @@
 
 #include "cuda_compat.h"
 
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
 struct opt_ip_1st;
 struct opt_ip_1st_ec;
 struct opt_ip_2nd;
@@ -54,6 +58,16 @@ struct ip_coeff_1st
     v1 = h;
   }
 
+  // stencil is l .. l + 1
+  static const int N = 2;
+  static const int OFF = 0;
+
+  void weights(R w[N]) const
+  {
+    w[0] = v0;
+    w[1] = v1;
+  }
+
   R v0, v1;
   int l;
 };
@@ -72,6 +86,17 @@ struct ip_coeff_2nd
     vp = .5f * (.5f - h) * (.5f - h);
   }
 
+  // stencil is l - 1 .. l + 1
+  static const int N = 3;
+  static const int OFF = -1;
+
+  void weights(R w[N]) const
+  {
+    w[0] = vm;
+    w[1] = v0;
+    w[2] = vp;
+  }
+
   R vm, v0, vp, h;
   int l;
 };
@@ -695,6 +720,155 @@ struct InterpolateEM_Helper<F, IP, opt_ip_2nd, dim_xyz>
   }
 };
 
+// ======================================================================
+// EMCache
+//
+// Copy of E, H of a box of cells, interleaved as [k][j][i][EX..HZ], so that
+// the six components at a stencil point share a cache line, rather than
+// coming from six separate arrays. The box is usually a tile plus the reach
+// of the interpolation stencil, which is small enough to stay in cache while
+// the tile's particles are pushed. The strides are compile-time zero in
+// invariant directions.
+
+template <typename R, typename D>
+class EMCache
+{
+public:
+  using real_t = R;
+  using dim = D;
+
+  static const int N_COMP = 6;
+  static const int sx = D::InvarX::value ? 0 : N_COMP;
+
+  // cells [lo, lo + n) of flds, as far as flds reaches
+  template <typename FE>
+  void load(const FE& flds, const int lo[3], const int n[3])
+  {
+    for (int d = 0; d < 3; d++) {
+      ib_[d] = std::max(lo[d], int(flds.ib()[d]));
+      im_[d] = std::min(lo[d] + n[d], int(flds.ib()[d] + flds.im()[d])) -
+               ib_[d];
+      assert(im_[d] > 0);
+    }
+    sy_ = D::InvarY::value ? 0 : N_COMP * im_[0];
+    sz_ = D::InvarZ::value ? 0 : N_COMP * im_[0] * im_[1];
+    data_.resize(N_COMP * im_[0] * im_[1] * im_[2]);
+
+    real_t* p = data_.data();
+    for (int k = ib_[2]; k < ib_[2] + im_[2]; k++) {
+      for (int j = ib_[1]; j < ib_[1] + im_[1]; j++) {
+        for (int i = ib_[0]; i < ib_[0] + im_[0]; i++) {
+          for (int m = 0; m < N_COMP; m++) {
+            *p++ = flds(EX + m, i, j, k);
+          }
+        }
+      }
+    }
+  }
+
+  // all of flds, ghosts included
+  template <typename FE>
+  void load(const FE& flds)
+  {
+    int lo[3], n[3];
+    for (int d = 0; d < 3; d++) {
+      lo[d] = flds.ib()[d];
+      n[d] = flds.im()[d];
+    }
+    load(flds, lo, n);
+  }
+
+  int sy() const { return sy_; }
+  int sz() const { return sz_; }
+
+  // EX at (i, j, k), the other components follow
+  const real_t* at(int i, int j, int k) const
+  {
+#ifdef BOUNDS_CHECK
+    assert(D::InvarX::value || (i >= ib_[0] && i < ib_[0] + im_[0]));
+    assert(D::InvarY::value || (j >= ib_[1] && j < ib_[1] + im_[1]));
+    assert(D::InvarZ::value || (k >= ib_[2] && k < ib_[2] + im_[2]));
+#endif
+    return &data_[(i - ib_[0]) * sx + (j - ib_[1]) * sy_ + (k - ib_[2]) * sz_];
+  }
+
+private:
+  std::vector<real_t> data_;
+  int ib_[3], im_[3];
+  int sy_, sz_;
+};
+
+// ======================================================================
+// InterpolateEM_Gather
+//
+// All six components in one go, for the staggered (g / h) coefficients of
+// ip_coeffs_std, from an EMCache. The 1-d weights of each direction are
+// formed once per particle and shared by all components. The stencils are
+// evaluated in the same order as InterpolateEM_Helper does, but the stencil
+// shape and strides are fixed at compile time for each dim, so there's no
+// per-point index computation.
+
+template <typename R, typename C, typename D>
+struct InterpolateEM_Gather
+{
+  static const int nx = D::InvarX::value ? 1 : C::N;
+  static const int ny = D::InvarY::value ? 1 : C::N;
+  static const int nz = D::InvarZ::value ? 1 : C::N;
+
+  // weights and first index for one direction, [0] for g, [1] for h
+  struct Weights
+  {
+    R w[2][C::N];
+    int l[2];
+
+    Weights(const ip_coeffs_std<R, C>& c, bool invar)
+    {
+      c.g.weights(w[0]);
+      c.h.weights(w[1]);
+      l[0] = invar ? 0 : c.g.l + C::OFF;
+      l[1] = invar ? 0 : c.h.l + C::OFF;
+    }
+  };
+
+  template <int SX, int SY, int SZ>
+  static R gather(const Weights& wx, const Weights& wy, const Weights& wz,
+                  const EMCache<R, D>& EM, int m)
+  {
+    using Cache = EMCache<R, D>;
+    const R* p = EM.at(wx.l[SX], wy.l[SY], wz.l[SZ]) + m;
+    const int sy = EM.sy(), sz = EM.sz();
+    R vz = 0;
+    for (int k = 0; k < nz; k++) {
+      R vy = 0;
+      for (int j = 0; j < ny; j++) {
+        const R* pp = p + k * sz + j * sy;
+        R vx = 0;
+        for (int i = 0; i < nx; i++) {
+          vx += nx == 1 ? pp[0] : wx.w[SX][i] * pp[i * Cache::sx];
+        }
+        vy += ny == 1 ? vx : wy.w[SY][j] * vx;
+      }
+      vz += nz == 1 ? vy : wz.w[SZ][k] * vy;
+    }
+    return vz;
+  }
+
+  static void eh(const ip_coeffs_std<R, C>& cx, const ip_coeffs_std<R, C>& cy,
+                 const ip_coeffs_std<R, C>& cz, const EMCache<R, D>& EM,
+                 R E[3], R H[3])
+  {
+    Weights wx(cx, D::InvarX::value), wy(cy, D::InvarY::value),
+      wz(cz, D::InvarZ::value);
+
+    E[0] = gather<1, 0, 0>(wx, wy, wz, EM, 0);
+    E[1] = gather<0, 1, 0>(wx, wy, wz, EM, 1);
+    E[2] = gather<0, 0, 1>(wx, wy, wz, EM, 2);
+    H[0] = gather<0, 1, 1>(wx, wy, wz, EM, 3);
+    H[1] = gather<1, 0, 1>(wx, wy, wz, EM, 4);
+    H[2] = gather<1, 1, 0>(wx, wy, wz, EM, 5);
+  }
+};
+
 // ======================================================================
 // InterpolateEM
 
@@ -722,6 +896,14 @@ struct InterpolateEM
   __host__ __device__ real_t hy(const F& EM) { return Helper::hy(*this, EM); }
   __host__ __device__ real_t hz(const F& EM) { return Helper::hz(*this, EM); }
 
+  // all of E, H at once from a patch's EMCache (1st / 2nd std only)
+  using Cache = EMCache<real_t, OPT_DIM>;
+  void eh(const Cache& EM, real_t E[3], real_t H[3]) const
+  {
+    InterpolateEM_Gather<real_t, ip_coeff_t, OPT_DIM>::eh(cx, cy, cz, EM, E,
+                                                          H);
+  }
+
   ip_coeffs_t cx, cy, cz;
 };
 
@@ -2,8 +2,11 @@
 #pragma once
 
 #include <mrc_profile.h>
+#include <psc_telemetry.h>
 #include <DiagEnergies.h>
 
+#include <string>
+
 #include <particles.hxx>
 
 #include "../libpsc/vpic/fields_item_vpic.hxx"
@@ -71,6 +74,19 @@ struct PscParams
   int balance_interval = 0;
   int sort_interval = 0;
   int marder_interval = 0;
+
+  // do the H-E-H field update as one temporally blocked sweep with a single
+  // E, H ghost exchange per step (only used with periodic field bcs)
+  bool fields_temporal_blocking = false;
+
+  // hierarchical profiling output at the end of the run, if set
+  std::string profiling_json;  // region tree, min / avg / max across ranks
+  std::string profiling_trace; // Chrome trace of individual region events
+  int profiling_trace_max_events = 100000; // per thread
+
+  // per-step telemetry (CSV, min / avg / max across ranks), if set
+  std::string telemetry_filename;
+  bool telemetry_per_rank = false; // also write one CSV file per rank
 };
 
 // ----------------------------------------------------------------------
@@ -192,12 +208,20 @@ struct Psc
       pr = prof_register("psc_step", 1., 0, 0);
     }
 
+    if (!p_.profiling_trace.empty()) {
+      prof_trace_enable(p_.profiling_trace_max_events);
+    }
+    if (!p_.telemetry_filename.empty()) {
+      psc_telemetry_open(p_.telemetry_filename, p_.telemetry_per_rank);
+    }
+
     mpi_printf(grid().comm(), "*** Advancing\n");
     double elapsed = MPI_Wtime();
 
     while (grid().timestep() < p_.nmax) {
       prof_start(pr);
       psc_stats_start(st_time_step);
+      double time_step = MPI_Wtime();
 
       checkpointing_(grid(), mprts_, mflds_);
 
@@ -221,9 +245,16 @@ struct Psc
 
       psc_stats_stop(st_time_step);
       prof_stop(pr);
+      prof_step_end();
 
       psc_stats_val[st_nr_particles] = mprts_.size();
 
+      if (psc_telemetry_enabled()) {
+        psc_telemetry_add(TELEMETRY_TIME_STEP, MPI_Wtime() - time_step);
+        psc_telemetry_add(TELEMETRY_PRTS, psc_stats_val[st_nr_particles]);
+        psc_telemetry_step(grid().timestep());
+      }
+
       if (grid().timestep() % p_.stats_every == 0) {
         print_status();
       }
@@ -243,6 +274,14 @@ struct Psc
 
     checkpointing_.final(grid(), mprts_, mflds_);
 
+    if (!p_.profiling_json.empty()) {
+      prof_write_json(grid().comm(), p_.profiling_json.c_str());
+    }
+    if (!p_.profiling_trace.empty()) {
+      prof_write_chrome_trace(grid().comm(), p_.profiling_trace.c_str());
+    }
+    psc_telemetry_close();
+
     // FIXME, merge with existing handling of wallclock time
     elapsed = MPI_Wtime() - elapsed;
 
@@ -309,8 +348,13 @@ struct Psc
 
     // === particle propagation p^{n} -> p^{n+1}, x^{n+1/2} -> x^{n+3/2}
     prof_start(pr_push_prts);
+    double time_push = MPI_Wtime();
     pushp_.push_mprts(mprts_, mflds_, *interpolator, *accumulator,
                       particle_bc_list, num_comm_round);
+    if (psc_telemetry_enabled()) {
+      psc_telemetry_add(TELEMETRY_TIME_PUSH, MPI_Wtime() - time_push);
+      psc_telemetry_add(TELEMETRY_PRTS_PUSHED, mprts_.size());
+    }
     prof_stop(pr_push_prts);
     // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1/2}, j^{n+1}
 
@@ -435,56 +479,84 @@ struct Psc
 
     // === particle propagation p^{n} -> p^{n+1}, x^{n+1/2} -> x^{n+3/2}
     prof_start(pr_push_prts);
+    double time_push = MPI_Wtime();
     pushp_.push_mprts(mprts_, mflds_);
+    if (psc_telemetry_enabled()) {
+      psc_telemetry_add(TELEMETRY_TIME_PUSH, MPI_Wtime() - time_push);
+      psc_telemetry_add(TELEMETRY_PRTS_PUSHED, mprts_.size());
+    }
     prof_stop(pr_push_prts);
     // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1/2}, j^{n+1}
 
-    // === field propagation B^{n+1/2} -> B^{n+1}
-    prof_start(pr_push_flds);
-    pushf_.push_H(mflds_, .5, Dim{});
-    prof_stop(pr_push_flds);
-    // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1}, j^{n+1}
-
-    prof_start(pr_bndp);
-    bndp_(mprts_);
-    prof_stop(pr_bndp);
-
-    // === field propagation E^{n+1/2} -> E^{n+3/2}
-    prof_start(pr_bndf);
+    if (use_fields_temporal_blocking()) {
+      prof_start(pr_bndp);
+      bndp_(mprts_);
+      prof_stop(pr_bndp);
+
+      prof_start(pr_bndf);
+      bndf_.add_ghosts_J(mflds_);
+      bnd_.add_ghosts(mflds_, JXI, JXI + 3);
+      bnd_.fill_ghosts(mflds_, JXI, JXI + 3);
+      prof_stop(pr_bndf);
+
+      // === field propagation B^{n+1/2} -> B^{n+1}, E^{n+1/2} -> E^{n+3/2},
+      //                       B^{n+1} -> B^{n+3/2} in one blocked sweep
+      prof_start(pr_push_flds);
+      push_HEH(std::integral_constant<bool, PushFields::has_push_HEH>{});
+      prof_stop(pr_push_flds);
+
+      prof_restart(pr_bndf);
+      bnd_.fill_ghosts(mflds_, EX, HX + 3);
+      prof_stop(pr_bndf);
+      // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+3/2}
+    } else {
+      // === field propagation B^{n+1/2} -> B^{n+1}
+      prof_start(pr_push_flds);
+      pushf_.push_H(mflds_, .5, Dim{});
+      prof_stop(pr_push_flds);
+      // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1}, j^{n+1}
+
+      prof_start(pr_bndp);
+      bndp_(mprts_);
+      prof_stop(pr_bndp);
+
+      // === field propagation E^{n+1/2} -> E^{n+3/2}
+      prof_start(pr_bndf);
 #if 1
-    bndf_.fill_ghosts_H(mflds_);
-    bnd_.fill_ghosts(mflds_, HX, HX + 3);
+      bndf_.fill_ghosts_H(mflds_);
+      bnd_.fill_ghosts(mflds_, HX, HX + 3);
 #endif
 
-    bndf_.add_ghosts_J(mflds_);
-    bnd_.add_ghosts(mflds_, JXI, JXI + 3);
-    bnd_.fill_ghosts(mflds_, JXI, JXI + 3);
-    prof_stop(pr_bndf);
+      bndf_.add_ghosts_J(mflds_);
+      bnd_.add_ghosts(mflds_, JXI, JXI + 3);
+      bnd_.fill_ghosts(mflds_, JXI, JXI + 3);
+      prof_stop(pr_bndf);
 
-    prof_restart(pr_push_flds);
-    pushf_.push_E(mflds_, 1., Dim{});
-    prof_stop(pr_push_flds);
+      prof_restart(pr_push_flds);
+      pushf_.push_E(mflds_, 1., Dim{});
+      prof_stop(pr_push_flds);
 
 #if 1
-    prof_restart(pr_bndf);
-    bndf_.fill_ghosts_E(mflds_);
-    bnd_.fill_ghosts(mflds_, EX, EX + 3);
-    prof_stop(pr_bndf);
+      prof_restart(pr_bndf);
+      bndf_.fill_ghosts_E(mflds_);
+      bnd_.fill_ghosts(mflds_, EX, EX + 3);
+      prof_stop(pr_bndf);
 #endif
-    // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+1}
+      // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+1}
 
-    // === field propagation B^{n+1} -> B^{n+3/2}
-    prof_restart(pr_push_flds);
-    pushf_.push_H(mflds_, .5, Dim{});
-    prof_stop(pr_push_flds);
+      // === field propagation B^{n+1} -> B^{n+3/2}
+      prof_restart(pr_push_flds);
+      pushf_.push_H(mflds_, .5, Dim{});
+      prof_stop(pr_push_flds);
 
 #if 1
-    prof_start(pr_bndf);
-    bndf_.fill_ghosts_H(mflds_);
-    bnd_.fill_ghosts(mflds_, HX, HX + 3);
-    prof_stop(pr_bndf);
-    // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+3/2}
+      prof_start(pr_bndf);
+      bndf_.fill_ghosts_H(mflds_);
+      bnd_.fill_ghosts(mflds_, HX, HX + 3);
+      prof_stop(pr_bndf);
+      // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+3/2}
 #endif
+    }
 
     if (checks_.continuity_every_step > 0 &&
         timestep % checks_.continuity_every_step == 0) {
@@ -513,6 +585,31 @@ struct Psc
     // psc_push_particles_prep(psc->push_particles, psc->particles, psc->flds);
   }
 
+  // ----------------------------------------------------------------------
+  // use_fields_temporal_blocking
+
+  bool use_fields_temporal_blocking()
+  {
+    if (!PushFields::has_push_HEH || !p_.fields_temporal_blocking) {
+      return false;
+    }
+    // the redundant ghost cell update in push_HEH is only valid for periodic
+    // boundaries, and needs at least two ghost points
+    for (int d = 0; d < 3; d++) {
+      if (grid().isInvar(d)) {
+        continue;
+      }
+      if (grid().bc.fld_lo[d] != BND_FLD_PERIODIC ||
+          grid().bc.fld_hi[d] != BND_FLD_PERIODIC || grid().ibn[d] < 2) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void push_HEH(std::true_type) { pushf_.push_HEH(mflds_, Dim{}); }
+  void push_HEH(std::false_type) { assert(0); }
+
   void step()
   {
 #ifdef VPIC
@@ -578,10 +675,8 @@ private:
     mpi_printf(comm, "Error = %g (arb units)\n", err);
 
     mpi_printf(comm, "Checking magnetic field divergence\n");
-    marder_.compute_div_b_err(mflds_);
-    err = marder_.compute_rms_div_b_err(mflds_);
+    err = marder_.clean_div_b_pass(mflds_, true);
     mpi_printf(comm, "RMS error = %e (charge/volume)\n", err);
-    marder_.clean_div_b(mflds_);
 
     // Load fields not initialized by the user
 
@@ -599,10 +694,8 @@ private:
     // Internal sanity checks
 
     mpi_printf(comm, "Checking electric field divergence\n");
-    marder_.compute_div_e_err(mflds_);
-    err = marder_.compute_rms_div_e_err(mflds_);
+    err = marder_.clean_div_e_pass(mflds_, true);
     mpi_printf(comm, "RMS error = %e (charge/volume)\n", err);
-    marder_.clean_div_e(mflds_);
 
     mpi_printf(comm, "Rechecking interdomain synchronization\n");
     err = marder_.synchronize_tang_e_norm_b(mflds_);
@@ -931,10 +1024,10 @@ void vpic_define_fields(const Grid_t& grid)
 // ----------------------------------------------------------------------
 // vpic_create_diagnotics
 
-void vpic_create_diagnostics(int interval)
+void vpic_create_diagnostics(int interval, int io_group_size = 0)
 {
 #ifdef VPIC
-  diag_mixin.diagnostics_init(interval);
+  diag_mixin.diagnostics_init(interval, io_group_size);
 #endif
 }
 
@@ -21,6 +21,26 @@ static void Foreach_3d(const Grid_t& grid, F f, int l, int r)
   });
 }
 
+// ----------------------------------------------------------------------
+// Foreach_3d_plane
+//
+// like Foreach_3d, but only for the single plane at z index k
+
+template <class F>
+static void Foreach_3d_plane(const Grid_t& grid, F& f, int l, int r, int k)
+{
+  int ilo[2] = {grid.isInvar(0) ? 0 : -l, grid.isInvar(1) ? 0 : -l};
+  int ihi[2] = {grid.ldims[0] + (grid.isInvar(0) ? 0 : r),
+                grid.ldims[1] + (grid.isInvar(1) ? 0 : r)};
+  for (int j = ilo[1]; j < ihi[1]; j++) {
+    for (int i = ilo[0]; i < ihi[0]; i++) {
+      f.x(i, j, k);
+      f.y(i, j, k);
+      f.z(i, j, k);
+    }
+  }
+}
+
 // ----------------------------------------------------------------------
 
 template <typename Fields>
@@ -135,6 +155,8 @@ class PushFields : public PushFieldsBase
   using MfieldsState = _MfieldsState;
 
 public:
+  static const bool has_push_HEH = true;
+
   // ----------------------------------------------------------------------
   // push_E
   //
@@ -173,6 +195,65 @@ public:
       Foreach_3d(mflds.grid(), push_H, 2, 1);
     }
   }
+
+  // ----------------------------------------------------------------------
+  // push_HEH
+  //
+  // Temporally blocked equivalent of
+  //   push_H(.5), fill_ghosts(H), push_E(1.), fill_ghosts(E),
+  //   push_H(.5), fill_ghosts(H)
+  // for periodic field boundaries. Rather than exchanging ghosts between the
+  // sub-steps, the update is carried out redundantly in the ghost layers
+  // (which requires ibn >= 2 and valid E, H, J ghosts on entry). The interior
+  // comes out bit-for-bit identical, while E, H ghosts are left stale and need
+  // a single fill_ghosts(EX, HX + 3) afterwards.
+  //
+  // The three sub-steps are swept as a wavefront through z planes, lagging
+  // by one plane each, so that every plane is updated while it is still in
+  // cache: push_H at k needs E(k+1) not yet advanced, push_E at k needs
+  // the first push_H done at k, k-1, the second push_H at k-1 needs E
+  // advanced at k-1, k.
+
+  template <typename dim>
+  void push_HEH(MfieldsState& mflds, dim tag)
+  {
+    using Fields = Fields3d<typename MfieldsState::fields_view_t, dim>;
+    const auto& grid = mflds.grid();
+
+    for (int d = 0; d < 3; d++) {
+      assert(grid.isInvar(d) || grid.ibn[d] >= 2);
+    }
+
+    if (dim::InvarZ::value) {
+      // no wavefront possible, but still no ghost exchange needed in between
+      for (int p = 0; p < mflds.n_patches(); p++) {
+        PushH<Fields> push_H(grid, mflds[p], .5);
+        PushE<Fields> push_E(grid, mflds[p], 1.);
+        Foreach_3d(grid, push_H, 2, 1);
+        Foreach_3d(grid, push_E, 1, 2);
+        Foreach_3d(grid, push_H, 2, 1);
+      }
+      return;
+    }
+
+    int kb_H = -2, ke_H = grid.ldims[2] + 1;
+    int kb_E = -1, ke_E = grid.ldims[2] + 2;
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      PushH<Fields> push_H(grid, mflds[p], .5);
+      PushE<Fields> push_E(grid, mflds[p], 1.);
+      for (int k = kb_H; k < ke_E; k++) {
+        if (k < ke_H) {
+          Foreach_3d_plane(grid, push_H, 2, 1, k);
+        }
+        if (k >= kb_E) {
+          Foreach_3d_plane(grid, push_E, 1, 2, k);
+        }
+        if (k - 1 >= kb_H && k - 1 < ke_H) {
+          Foreach_3d_plane(grid, push_H, 2, 1, k - 1);
+        }
+      }
+    }
+  }
 };
 
 #endif
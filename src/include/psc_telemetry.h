@@ -0,0 +1,40 @@
+
+#pragma once
+
+#include <string>
+
+// ----------------------------------------------------------------------
+// psc_telemetry: per-step performance telemetry
+//
+// Counters are accumulated on every rank during a step and written out by
+// psc_telemetry_step(). Rank 0 appends one CSV line per step with min / avg /
+// max across ranks of each quantity; optionally, every rank also appends its
+// own values (including particles / bytes sent per neighbor rank) to a
+// separate per-rank CSV file. Lines are flushed right away, so the files
+// can be followed with "tail -f".
+
+enum
+{
+  TELEMETRY_PRTS,              //< particles on this rank
+  TELEMETRY_PRTS_PUSHED,       //< particles pushed
+  TELEMETRY_TIME_PUSH,         //< time spent in particle push [s]
+  TELEMETRY_PUSH_RATE,         //< particles pushed / s (derived)
+  TELEMETRY_TIME_STEP,         //< time for the entire step [s]
+  TELEMETRY_BNDP_PRTS_SENT,    //< particles sent to other ranks
+  TELEMETRY_BNDP_BYTES_SENT,   //< bytes of particles sent to other ranks
+  TELEMETRY_BNDP_NEIGHBORS,    //< number of ranks particles were sent to
+  TELEMETRY_BNDP_MAX_PRTS_NEI, //< most particles sent to a single rank
+  TELEMETRY_GHOST_BYTES_SENT,  //< bytes sent in field ghost point exchanges
+  TELEMETRY_PEAK_RSS,          //< peak resident memory [MiB]
+  NR_TELEMETRY,
+};
+
+void psc_telemetry_open(const std::string& filename, bool per_rank);
+void psc_telemetry_close();
+bool psc_telemetry_enabled();
+
+void psc_telemetry_add(int n, double val);
+void psc_telemetry_neighbor_send(int rank, size_t n_prts, size_t n_bytes);
+
+// reduce across ranks, write this step's line(s) and reset the counters
+void psc_telemetry_step(int timestep);
@@ -9,4 +9,8 @@ extern int pr_time_step_no_comm; // FIXME
 // class PushFieldsBase
 
 class PushFieldsBase
-{};
+{
+public:
+  // whether push_HEH() (temporally blocked H-E-H update) is available
+  static const bool has_push_HEH = false;
+};
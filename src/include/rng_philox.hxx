@@ -0,0 +1,201 @@
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// ======================================================================
+// Philox4x32
+//
+// Counter-based random number generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3", SC'11), 10 rounds.
+// There is no state other than the (counter, key) pair, so independent
+// streams can be generated by any thread in any order, and results do not
+// depend on how the work was decomposed.
+
+struct Philox4x32
+{
+  struct Ctr
+  {
+    uint32_t v[4];
+  };
+
+  struct Key
+  {
+    uint32_t v[2];
+  };
+
+  static Ctr generate(Ctr ctr, Key key)
+  {
+    for (int r = 0; r < 10; r++) {
+      ctr = round(ctr, key);
+      key.v[0] += 0x9E3779B9u;
+      key.v[1] += 0xBB67AE85u;
+    }
+    return ctr;
+  }
+
+  // uniform in (0, 1], i.e., safe to take the log of
+  static float to_uniform(uint32_t x)
+  {
+    return ((x >> 8) + 1) * (1.f / 16777216.f);
+  }
+
+  static double to_uniform_double(uint32_t x)
+  {
+    return (x + 1.) * (1. / 4294967296.);
+  }
+
+  // four standard normal deviates from one counter (Box-Muller)
+  static void normal4(Ctr ctr, Key key, float r[4])
+  {
+    Ctr u = generate(ctr, key);
+    for (int i = 0; i < 4; i += 2) {
+      float rad = std::sqrt(-2.f * std::log(to_uniform(u.v[i])));
+      float phi = 2.f * float(M_PI) * to_uniform(u.v[i + 1]);
+      r[i] = rad * std::cos(phi);
+      r[i + 1] = rad * std::sin(phi);
+    }
+  }
+
+private:
+  static Ctr round(Ctr ctr, Key key)
+  {
+    uint64_t p0 = uint64_t(0xD2511F53u) * ctr.v[0];
+    uint64_t p1 = uint64_t(0xCD9E8D57u) * ctr.v[2];
+    uint32_t hi0 = p0 >> 32, lo0 = uint32_t(p0);
+    uint32_t hi1 = p1 >> 32, lo1 = uint32_t(p1);
+    return {{hi1 ^ ctr.v[1] ^ key.v[0], lo1, hi0 ^ ctr.v[3] ^ key.v[1], lo0}};
+  }
+};
+
+// ======================================================================
+// RngStream
+//
+// Random numbers for one well-defined purpose, built on Philox4x32.
+// A stream is named by (purpose, id, seed), where id is usually the global
+// patch (or the rank), and within a stream (step, cell) select a substream,
+// whose draws are numbered consecutively. This gives
+//   key = {id, seed}, ctr = {n, step, cell, purpose}.
+// A stream is a small value with no shared state, so every thread makes its
+// own, nothing takes a lock, and the numbers don't depend on the number of
+// threads / ranks or the order in which cells are processed.
+
+enum RngPurpose : uint32_t
+{
+  RNG_HEATING = 0,
+  RNG_COLLISION,
+  RNG_SETUP_PARTICLES,
+  RNG_PSC_RNG,
+};
+
+class RngStream
+{
+public:
+  RngStream(uint32_t purpose, uint32_t id, uint32_t seed = 0,
+            uint32_t step = 0, uint32_t cell = 0)
+    : ctr_{{0, step, cell, purpose}}, key_{{id, seed}}
+  {}
+
+  // move to the start of another substream of the same stream
+  void reset(uint32_t step, uint32_t cell)
+  {
+    ctr_.v[0] = 0;
+    ctr_.v[1] = step;
+    ctr_.v[2] = cell;
+    n_ubuf_ = n_nbuf_ = 4;
+  }
+
+  // ----------------------------------------------------------------------
+  // random access by draw index: these don't advance the stream
+
+  Philox4x32::Ctr at(uint32_t n) const
+  {
+    Philox4x32::Ctr ctr = ctr_;
+    ctr.v[0] = n;
+    return Philox4x32::generate(ctr, key_);
+  }
+
+  void normal4(uint32_t n, float r[4]) const
+  {
+    Philox4x32::Ctr ctr = ctr_;
+    ctr.v[0] = n;
+    Philox4x32::normal4(ctr, key_, r);
+  }
+
+  // ----------------------------------------------------------------------
+  // sequential draws
+  //
+  // uniform numbers are in (0, 1]. The batched versions give the same
+  // numbers as calling the single versions n times.
+
+  uint32_t bits()
+  {
+    if (n_ubuf_ == 4) {
+      ubuf_ = next();
+      n_ubuf_ = 0;
+    }
+    return ubuf_.v[n_ubuf_++];
+  }
+
+  float uniform() { return Philox4x32::to_uniform(bits()); }
+
+  double uniform_double() { return Philox4x32::to_uniform_double(bits()); }
+
+  float normal()
+  {
+    if (n_nbuf_ == 4) {
+      Philox4x32::normal4(ctr_, key_, nbuf_);
+      ctr_.v[0]++;
+      n_nbuf_ = 0;
+    }
+    return nbuf_[n_nbuf_++];
+  }
+
+  void uniform(float* r, int n)
+  {
+    int i = 0;
+    for (; i < n && n_ubuf_ < 4; i++) {
+      r[i] = uniform();
+    }
+    for (; i + 4 <= n; i += 4) {
+      Philox4x32::Ctr u = next();
+      for (int m = 0; m < 4; m++) {
+        r[i + m] = Philox4x32::to_uniform(u.v[m]);
+      }
+    }
+    for (; i < n; i++) {
+      r[i] = uniform();
+    }
+  }
+
+  void normal(float* r, int n)
+  {
+    int i = 0;
+    for (; i < n && n_nbuf_ < 4; i++) {
+      r[i] = normal();
+    }
+    for (; i + 4 <= n; i += 4) {
+      Philox4x32::normal4(ctr_, key_, &r[i]);
+      ctr_.v[0]++;
+    }
+    for (; i < n; i++) {
+      r[i] = normal();
+    }
+  }
+
+private:
+  Philox4x32::Ctr next()
+  {
+    Philox4x32::Ctr u = Philox4x32::generate(ctr_, key_);
+    ctr_.v[0]++;
+    return u;
+  }
+
+  Philox4x32::Ctr ctr_;
+  Philox4x32::Key key_;
+  Philox4x32::Ctr ubuf_;
+  float nbuf_[4];
+  int n_ubuf_ = 4;
+  int n_nbuf_ = 4;
+};
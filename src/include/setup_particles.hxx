@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "rng_philox.hxx"
+
 struct psc_particle_npt
 {
   int kind;    ///< particle kind
@@ -12,6 +14,11 @@ struct psc_particle_npt
 
 // ======================================================================
 // SetupParticles
+//
+// Random numbers come from the RNG_SETUP_PARTICLES stream, with a substream
+// for each (global patch, cell, population), so partition() and
+// setupParticles() agree on the number of particles in each cell, and the
+// particles don't depend on the decomposition or on the order of setup.
 
 template <typename MP>
 struct SetupParticles
@@ -32,7 +39,7 @@ struct SetupParticles
   //
   // helper function for partition / particle setup
 
-  int get_n_in_cell(const psc_particle_npt& npt)
+  int get_n_in_cell(const psc_particle_npt& npt, RngStream& rng)
   {
     if (npt.n == 0) {
       return 0;
@@ -40,7 +47,7 @@ struct SetupParticles
     if (fractional_n_particles_per_cell) {
       int n_prts = npt.n / norm_.cori;
       float rmndr = npt.n / norm_.cori - n_prts;
-      float ran = random() / ((float)RAND_MAX + 1);
+      float ran = 1.f - rng.uniform();
       if (ran < rmndr) {
         n_prts++;
       }
@@ -53,33 +60,19 @@ struct SetupParticles
   // setupParticle
 
   psc::particle::Inject setupParticle(const psc_particle_npt& npt, Double3 pos,
-                                      double wni)
+                                      double wni, RngStream& rng)
   {
     double beta = norm_.beta;
 
     assert(npt.kind >= 0 && npt.kind < kinds_.size());
     double m = kinds_[npt.kind].m;
 
-    float ran1, ran2, ran3, ran4, ran5, ran6;
-    do {
-      ran1 = random() / ((float)RAND_MAX + 1);
-      ran2 = random() / ((float)RAND_MAX + 1);
-      ran3 = random() / ((float)RAND_MAX + 1);
-      ran4 = random() / ((float)RAND_MAX + 1);
-      ran5 = random() / ((float)RAND_MAX + 1);
-      ran6 = random() / ((float)RAND_MAX + 1);
-    } while (ran1 >= 1.f || ran2 >= 1.f || ran3 >= 1.f || ran4 >= 1.f ||
-             ran5 >= 1.f || ran6 >= 1.f);
-
-    double pxi =
-      npt.p[0] + sqrtf(-2.f * npt.T[0] / m * sqr(beta) * logf(1.0 - ran1)) *
-                   cosf(2.f * M_PI * ran2);
-    double pyi =
-      npt.p[1] + sqrtf(-2.f * npt.T[1] / m * sqr(beta) * logf(1.0 - ran3)) *
-                   cosf(2.f * M_PI * ran4);
-    double pzi =
-      npt.p[2] + sqrtf(-2.f * npt.T[2] / m * sqr(beta) * logf(1.0 - ran5)) *
-                   cosf(2.f * M_PI * ran6);
+    float ran[3];
+    rng.normal(ran, 3);
+
+    double pxi = npt.p[0] + sqrtf(npt.T[0] / m * sqr(beta)) * ran[0];
+    double pyi = npt.p[1] + sqrtf(npt.T[1] / m * sqr(beta)) * ran[1];
+    double pzi = npt.p[2] + sqrtf(npt.T[2] / m * sqr(beta)) * ran[2];
 
     if (initial_momentum_gamma_correction) {
       double gam;
@@ -126,6 +119,8 @@ struct SetupParticles
     for (int p = 0; p < mprts.n_patches(); ++p) {
       auto ldims = grid.ldims;
       auto injector = inj[p];
+      RngStream rng{RNG_SETUP_PARTICLES,
+                    uint32_t(grid.localPatchInfo(p).global_patch), seed};
 
       for (int jz = 0; jz < ldims[2]; jz++) {
         for (int jy = 0; jy < ldims[1]; jy++) {
@@ -148,10 +143,11 @@ struct SetupParticles
                 npt.kind = pop;
               }
               init_npt(pop, pos, p, {jx, jy, jz}, npt);
+              rng.reset(pop, (jz * ldims[1] + jy) * ldims[0] + jx);
 
               int n_in_cell;
               if (pop != neutralizing_population) {
-                n_in_cell = get_n_in_cell(npt);
+                n_in_cell = get_n_in_cell(npt, rng);
                 n_q_in_cell += kinds_[npt.kind].q * n_in_cell;
               } else {
                 // FIXME, should handle the case where not the last population
@@ -166,7 +162,7 @@ struct SetupParticles
                 } else {
                   wni = npt.n / (n_in_cell * norm_.cori);
                 }
-                auto prt = setupParticle(npt, pos, wni);
+                auto prt = setupParticle(npt, pos, wni, rng);
                 injector(prt);
               }
             }
@@ -188,6 +184,8 @@ struct SetupParticles
 
     for (int p = 0; p < grid.n_patches(); ++p) {
       auto ilo = Int3{}, ihi = grid.ldims;
+      RngStream rng{RNG_SETUP_PARTICLES,
+                    uint32_t(grid.localPatchInfo(p).global_patch), seed};
 
       for (int jz = ilo[2]; jz < ihi[2]; jz++) {
         for (int jy = ilo[1]; jy < ihi[1]; jy++) {
@@ -210,10 +208,11 @@ struct SetupParticles
                 npt.kind = pop;
               };
               init_npt(pop, pos, npt);
+              rng.reset(pop, (jz * ihi[1] + jy) * ihi[0] + jx);
 
               int n_in_cell;
               if (pop != neutralizing_population) {
-                n_in_cell = get_n_in_cell(npt);
+                n_in_cell = get_n_in_cell(npt, rng);
                 n_q_in_cell += kinds_[npt.kind].q * n_in_cell;
               } else {
                 // FIXME, should handle the case where not the last population
@@ -236,6 +235,8 @@ struct SetupParticles
   int neutralizing_population = {-1};
   bool fractional_n_particles_per_cell = {false};
   bool initial_momentum_gamma_correction = {false};
+  // selects a different, but still reproducible, set of random particles
+  uint32_t seed = {0};
 
 private:
   const Grid_t::Kinds kinds_;
@@ -76,6 +76,10 @@ void mrc_ddc_amr_set_by_stencil(struct mrc_ddc *ddc, int m, int bnd, int ext[3],
 
 extern struct mrc_ddc_funcs mrc_ddc_funcs_fld;
 
+// running total of bytes sent to other ranks by ghost point exchanges,
+// for performance monitoring
+extern unsigned long long mrc_ddc_bytes_sent;
+
 static inline int
 mrc_ddc_dir2idx(int dir[3])
 {
@@ -130,8 +130,14 @@ const char *__mrc_io_obj_path(struct mrc_io *io, struct mrc_obj *obj);
 
 // ----------------------------------------------------------------------
 // mrc_io_server
+//
+// mrc_io_servers() runs on all ranks of comm, which have to be consecutive
+// ranks in MPI_COMM_WORLD, starting at the clients' "rank_diagsrv", with
+// "nr_diagsrvs" set to the size of comm.
 
 void mrc_io_server(const char *format, const char *ds_srv, int nproc_domain);
+void mrc_io_servers(MPI_Comm comm, const char *format, const char *ds_srv,
+		    int nproc_domain);
 
 END_C_DECLS
 
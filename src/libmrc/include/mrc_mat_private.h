@@ -61,10 +61,23 @@ struct mrc_mat_csr {
   bool verbose;
   int nr_initial_cols;  // how much initial space to allocate for each new row
   float growth_factor;  // fraction of current # of cols to add when a row needs to grow
+
+  // SELL-C-sigma copy of the matrix, made on first (out-of-place) apply,
+  // since csr_mpi still renumbers the columns of B after assemble
+  int sell_c; // rows per chunk, 0 means plain csr
+  int sell_sigma; // rows within a window of sigma are sorted by length
+  int _nr_chunks;
+  int *_chunk_off; // length == _nr_chunks + 1
+  int *_sell_rows; // length == _nr_chunks * sell_c, -1 for padding
+  int *_sell_cols;
+  double *_sell_vals;
 };
 
 #define mrc_mat_csr(mat) mrc_to_subobj(mat, struct mrc_mat_csr)
 
+// call when vals / cols change after the SELL copy may have been made
+void mrc_mat_csr_sell_invalidate(struct mrc_mat *mat);
+
 // ======================================================================
 // mrc_mat "mcsr"
 //
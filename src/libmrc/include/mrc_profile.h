@@ -31,27 +31,68 @@ struct prof_data
   int bytes;
 };
 
-#define MAX_PROF (100)
+#define MAX_PROF (1000)
+
+// the flat per-region totals are kept per thread, so prof_print*() report
+// the calling (usually the main) thread. The hierarchical per-thread region
+// trees below see all threads.
+#define PROF_TLS __thread
 
 extern struct prof_data prof_data[MAX_PROF];
 
-extern struct prof_globals
+extern PROF_TLS struct prof_globals
 {
   int event_set;
   struct prof_info info[MAX_PROF];
 } prof_globals;
 
 #include <stdlib.h>
-#include <sys/time.h>
+#include <time.h>
+
+#ifdef __cplusplus
+#define EXTERN_C extern "C"
+#else
+#define EXTERN_C
+#endif
+
+// ----------------------------------------------------------------------
+// hierarchical profiling
+//
+// Every prof_start() / prof_stop() pair also enters / leaves a node in a
+// per-thread tree of nested regions, keyed by the chain of enclosing
+// regions. Times are measured in ns using CLOCK_MONOTONIC.
+
+EXTERN_C void prof_enter(int pr, long long t, int restart);
+EXTERN_C void prof_leave(int pr, long long t);
+
+// to be called at the end of every time step, to collect per-step timing
+// histograms
+EXTERN_C void prof_step_end(void);
+
+// start recording individual region events (up to max_events per thread)
+// for output as a Chrome trace
+EXTERN_C void prof_trace_enable(int max_events);
+
+// collective, region tree with min / avg / max across ranks
+EXTERN_C void prof_write_json(MPI_Comm comm, const char* filename);
+// collective, all ranks' events in Chrome trace event format
+EXTERN_C void prof_write_chrome_trace(MPI_Comm comm, const char* filename);
+
+static inline long long prof_time_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
 
 static inline void prof_start(int pr)
 {
   pr--;
   assert(pr < MAX_PROF);
 
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  prof_globals.info[pr].time -= tv.tv_sec * 1000000ll + tv.tv_usec;
+  long long t = prof_time_ns();
+  prof_globals.info[pr].time -= t / 1000;
+  prof_enter(pr + 1, t, 0);
 #ifdef HAVE_NVTX
   nvtxRangePush(prof_data[pr].name);
 #endif
@@ -62,10 +103,10 @@ static inline void prof_restart(int pr)
   pr--;
   assert(pr < MAX_PROF);
 
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  prof_globals.info[pr].time -= tv.tv_sec * 1000000ll + tv.tv_usec;
+  long long t = prof_time_ns();
+  prof_globals.info[pr].time -= t / 1000;
   prof_globals.info[pr].cnt--;
+  prof_enter(pr + 1, t, 1);
 #ifdef HAVE_NVTX
   nvtxRangePush(prof_data[pr].name);
 #endif
@@ -76,21 +117,15 @@ static inline void prof_stop(int pr)
   pr--;
   assert(pr < MAX_PROF);
 
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  prof_globals.info[pr].time += tv.tv_sec * 1000000ll + tv.tv_usec;
+  long long t = prof_time_ns();
+  prof_globals.info[pr].time += t / 1000;
   prof_globals.info[pr].cnt++;
+  prof_leave(pr + 1, t);
 #ifdef HAVE_NVTX
   nvtxRangePop();
 #endif
 }
 
-#ifdef __cplusplus
-#define EXTERN_C extern "C"
-#else
-#define EXTERN_C
-#endif
-
 EXTERN_C void prof_init(void);
 EXTERN_C int prof_register(const char* name, float simd, int flops, int bytes);
 EXTERN_C void prof_print(void);
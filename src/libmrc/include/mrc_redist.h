@@ -26,6 +26,7 @@ struct mrc_redist_write_recv {
   MPI_Request *reqs;
   void *buf;
   size_t buf_size;
+  size_t buf_cap; // bytes allocated for buf
   int *cnts;
   int *disps;
 
@@ -38,6 +39,7 @@ struct mrc_redist_write_send {
   MPI_Request *reqs;
   void *buf;
   size_t buf_size;
+  size_t buf_cap; // bytes allocated for buf
   int *cnts;
   int *disps;
 };
@@ -60,6 +62,17 @@ struct mrc_redist {
   int slow_indices_per_writer;
   int slow_indices_rmndr;
 
+  // the communication plan (write_send / write_recv, minus the buffers) only
+  // depends on the patch layout and on the slab, so it's built once and kept
+  // until mrc_redist_update() finds that the layout has changed
+  int slab_offs_req[3]; // slab as passed to mrc_redist_init()
+  int slab_dims_req[3];
+  int gdims[3];
+  int nr_patches;
+  struct mrc_patch *patches; // local patches the plan was built for
+  bool plan_valid;
+  struct mrc_ndarray *nd; // writer's ndarray, kept across calls
+
   struct mrc_redist_write_send write_send;
   struct mrc_redist_write_recv write_recv;
 };
@@ -67,6 +80,8 @@ struct mrc_redist {
 void mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
 		     int slab_offs[3], int slab_dims[3], int nr_writers);
 void mrc_redist_destroy(struct mrc_redist *redist);
+void mrc_redist_update(struct mrc_redist *redist, struct mrc_domain *domain);
+void mrc_redist_invalidate(struct mrc_redist *redist);
 struct mrc_ndarray *mrc_redist_get_ndarray(struct mrc_redist *redist, struct mrc_fld *m3);
 void mrc_redist_put_ndarray(struct mrc_redist *redist, struct mrc_ndarray *nd);
 void mrc_redist_run(struct mrc_redist *redist, struct mrc_ndarray *nd,
@@ -5,6 +5,7 @@
 #include <mrc_ts.h>
 
 #include <stdio.h>
+#include <assert.h>
 
 struct mrc_ts {
   struct mrc_obj obj;
@@ -35,6 +36,9 @@ struct mrc_ts {
   void (*vec_copy)(struct mrc_obj *, struct mrc_obj *);
   void (*vec_axpy)(struct mrc_obj *, float, struct mrc_obj *);
   void (*vec_waxpy)(struct mrc_obj *, float, struct mrc_obj *, struct mrc_obj *);
+  // optional, NULL if the state vector doesn't have them
+  void (*vec_axpby)(struct mrc_obj *, double, struct mrc_obj *, double);
+  void (*vec_maxpy)(struct mrc_obj *, int, const double *, struct mrc_obj **);
   float (*vec_norm)(struct mrc_obj *);
   void (*vec_set)(struct mrc_obj *, float);
 
@@ -80,6 +84,35 @@ mrc_ts_vec_waxpy(struct mrc_ts *ts, struct mrc_obj *vecw, float alpha,
   ts->vec_waxpy(vecw, alpha, vecx, vecy);
 }
 
+// y = alpha * x + beta * y
+static inline void
+mrc_ts_vec_axpby(struct mrc_ts *ts, struct mrc_obj *vecy, double alpha,
+		 struct mrc_obj *vecx, double beta)
+{
+  assert(ts->vec_axpby);
+  ts->vec_axpby(vecy, alpha, vecx, beta);
+}
+
+// y += sum_k alpha[k] * x[k]
+// alpha is float, like for mrc_ts_vec_axpy(), so that it makes no difference
+// whether or not the vector type can do this in a single pass
+static inline void
+mrc_ts_vec_maxpy(struct mrc_ts *ts, struct mrc_obj *vecy, int n,
+		 const float *alpha, struct mrc_obj **vecx)
+{
+  if (!ts->vec_maxpy) {
+    for (int k = 0; k < n; k++) {
+      ts->vec_axpy(vecy, alpha[k], vecx[k]);
+    }
+    return;
+  }
+  double dalpha[n];
+  for (int k = 0; k < n; k++) {
+    dalpha[k] = alpha[k];
+  }
+  ts->vec_maxpy(vecy, n, dalpha, vecx);
+}
+
 static inline float
 mrc_ts_vec_norm(struct mrc_ts *ts, struct mrc_obj *vec)
 {
@@ -146,6 +179,8 @@ extern struct mrc_ts_ops mrc_ts_rk2_ops;
 extern struct mrc_ts_ops mrc_ts_rk4_ops;
 extern struct mrc_ts_ops mrc_ts_rkf45_ops;
 extern struct mrc_ts_ops mrc_ts_ode45_ops;
+extern struct mrc_ts_ops mrc_ts_lsrk3_ops;
+extern struct mrc_ts_ops mrc_ts_lsrk4_ops;
 
 
 #endif
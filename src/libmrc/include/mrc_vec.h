@@ -32,6 +32,8 @@ void mrc_vec_put_array(struct mrc_vec *vec, void *arr);
 void mrc_vec_axpy(struct mrc_vec *y, double alpha, struct mrc_vec *x);
 void mrc_vec_waxpy(struct mrc_vec *w, double alpha, struct mrc_vec *x, struct mrc_vec *y);
 void mrc_vec_axpby(struct mrc_vec *y, double alpha, struct mrc_vec *x, double beta);
+// y += sum_k alpha[k] * x[k], in a single pass over y
+void mrc_vec_maxpy(struct mrc_vec *y, int n, const double *alpha, struct mrc_vec **x);
 // Data management operations
 void mrc_vec_set(struct mrc_vec *x, double alpha);
 void mrc_vec_copy(struct mrc_vec *vec_to, struct mrc_vec *vec_from);
@@ -24,6 +24,7 @@ struct mrc_vec_ops {
   void (*axpy)(struct mrc_vec *y, double alpha, struct mrc_vec *x);
   void (*waxpy)(struct mrc_vec *w, double alpha, struct mrc_vec *x, struct mrc_vec *y);
   void (*axpby)(struct mrc_vec *y, double alpha, struct mrc_vec *x, double beta);
+  void (*maxpy)(struct mrc_vec *y, int n, const double *alpha, struct mrc_vec **x);
   void (*set)(struct mrc_vec *x, double val);
   void (*copy)(struct mrc_vec *vec_to, struct mrc_vec *vec_from);
 };
@@ -33,6 +33,7 @@ struct mrctest_domain_params {
   int gdims[3];
   int nproc[3];
   bool use_diagsrv;
+  int nr_diagsrvs;
 };
 
 void mrctest_domain_init(struct mrctest_domain_params *par);
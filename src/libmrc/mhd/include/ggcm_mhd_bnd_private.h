@@ -63,6 +63,21 @@ struct ggcm_mhd_bnd_sphere_map {
   // for managing face-centered boundary
   int fc_n_map[3];
   struct mrc_fld *fc_imap[3];
+
+  // the maps are ordered by patch, the entries for patch p being
+  // [*_patch_off[p], *_patch_off[p+1])
+  int nr_patches;
+  int *cc_patch_off;
+  int *fc_patch_off[3];
+
+  // stencils for filling cc ghost points from their real (ymask > 0)
+  // neighbors: ghost point i averages over the neighbors
+  // cc_stencil_nb[cc_stencil_off[i]..cc_stencil_off[i+1]), given as
+  // (jx+1) + 3 * ((jy+1) + 3 * (jz+1)) for offsets jx,jy,jz in [-1,1]
+  int *cc_stencil_off;
+  unsigned char *cc_stencil_nb;
+  int cc_stencil_ghost_offs[3]; // ghost region of the fld they were made for
+  int cc_stencil_ghost_dims[3];
 };
 
 void ggcm_mhd_bnd_sphere_map_setup(struct ggcm_mhd_bnd_sphere_map *map,
@@ -72,6 +87,9 @@ void ggcm_mhd_bnd_sphere_map_setup_flds(struct ggcm_mhd_bnd_sphere_map *map);
 void ggcm_mhd_bnd_sphere_map_setup_cc(struct ggcm_mhd_bnd_sphere_map *map);
 void ggcm_mhd_bnd_sphere_map_setup_ec(struct ggcm_mhd_bnd_sphere_map *map);
 void ggcm_mhd_bnd_sphere_map_setup_fc(struct ggcm_mhd_bnd_sphere_map *map);
+void ggcm_mhd_bnd_sphere_map_setup_stencils(struct ggcm_mhd_bnd_sphere_map *map,
+					    struct mrc_fld *fld);
+void ggcm_mhd_bnd_sphere_map_destroy(struct ggcm_mhd_bnd_sphere_map *map);
 
 
 #endif
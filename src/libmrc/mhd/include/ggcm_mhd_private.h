@@ -84,6 +84,28 @@ struct ggcm_mhd_params {
   bool monitor_conservation;
 };
 
+// ----------------------------------------------------------------------
+// ggcm_mhd_fld_pool
+//
+// temporary fields handed out by ggcm_mhd_get_3d_fld() are returned here by
+// ggcm_mhd_put_3d_fld(), and recycled by later requests for the same
+// (nr_comps, nr_ghosts, layout), rather than being reallocated every step
+
+struct ggcm_mhd_fld_pool {
+  struct mrc_fld **free; // fields available for reuse
+  int nr_free;
+  int nr_free_alloced;
+  bool closed; // ggcm_mhd is being destroyed, don't keep returned fields
+  bool advise_hugepages; // madvise() new fields to be backed by huge pages,
+                         // which the kernel may or may not do
+  bool stats; // print memory usage when destroyed
+  size_t bytes_in_use; // currently handed out
+  size_t bytes_high_water; // max of bytes_in_use
+  size_t bytes_total; // in use + free
+  int nr_allocs; // fields actually created
+  int nr_gets; // requests served
+};
+
 struct ggcm_mhd {
   struct mrc_obj obj;
   struct ggcm_mhd_params par;
@@ -126,6 +148,8 @@ struct ggcm_mhd {
   // for easy access, cached from ::domain
   int im[3];  // local domain excl ghost points
   int img[3]; // local domain incl ghost points
+
+  struct ggcm_mhd_fld_pool fld_pool;
 };
 
 struct ggcm_mhd_ops {
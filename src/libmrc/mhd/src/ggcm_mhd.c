@@ -17,10 +17,15 @@
 #include <mrc_io.h>
 #include <mrc_profile.h>
 #include <mrc_physics.h>
+#include <mrc_bits.h>
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #define ggcm_mhd_ops(mhd) ((struct ggcm_mhd_ops *) mhd->obj.ops)
 
@@ -367,24 +372,118 @@ ggcm_mhd_ntot(struct ggcm_mhd *mhd)
   return ghost_dims[0] * ghost_dims[1] * ghost_dims[2];
 }
 
+// ----------------------------------------------------------------------
+// ggcm_mhd_fld_pool_bytes
+
+static size_t
+ggcm_mhd_fld_pool_bytes(struct mrc_fld *f)
+{
+  return (size_t) mrc_fld_len(f) * f->_nd->size_of_type;
+}
+
+// ----------------------------------------------------------------------
+// ggcm_mhd_fld_pool_advise_hugepages
+//
+// transparent huge pages cut down on TLB misses when sweeping through
+// large fields. The storage has just been calloc()'d and not touched yet,
+// so the advice applies to all of it that's page-aligned.
+
+static void
+ggcm_mhd_fld_pool_advise_hugepages(struct ggcm_mhd *mhd, struct mrc_fld *f)
+{
+#ifdef MADV_HUGEPAGE
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t beg = ((uintptr_t) f->_nd->arr + page - 1) & ~(page - 1);
+  uintptr_t end = ((uintptr_t) f->_nd->arr + ggcm_mhd_fld_pool_bytes(f)) & ~(page - 1);
+  if (end > beg) {
+    madvise((void *) beg, end - beg, MADV_HUGEPAGE);
+  }
+#else
+  static bool warned;
+  if (!warned) {
+    mpi_printf(ggcm_mhd_comm(mhd), "WARNING: fld_pool_advise_hugepages: "
+	       "MADV_HUGEPAGE not available\n");
+    warned = true;
+  }
+#endif
+}
+
+// ----------------------------------------------------------------------
+// ggcm_mhd_fld_pool_destroy
+
+static void
+ggcm_mhd_fld_pool_destroy(struct ggcm_mhd *mhd)
+{
+  struct ggcm_mhd_fld_pool *pool = &mhd->fld_pool;
+
+  if (pool->stats) {
+    unsigned long local[2] = { pool->bytes_high_water, pool->bytes_total };
+    unsigned long global[2];
+    MPI_Reduce(local, global, 2, MPI_UNSIGNED_LONG, MPI_MAX, 0, ggcm_mhd_comm(mhd));
+    mpi_printf(ggcm_mhd_comm(mhd), "ggcm_mhd fld_pool: %d gets, %d allocs, "
+	       "high water %g MB in use, %g MB held (max over procs)\n",
+	       pool->nr_gets, pool->nr_allocs, global[0] / 1e6, global[1] / 1e6);
+  }
+
+  for (int i = 0; i < pool->nr_free; i++) {
+    mrc_fld_destroy(pool->free[i]);
+  }
+  free(pool->free);
+  pool->free = NULL;
+  pool->nr_free = 0;
+  pool->nr_free_alloced = 0;
+  // sub-objects may still return their fields while being destroyed
+  pool->closed = true;
+}
+
 // ----------------------------------------------------------------------
 // ggcm_mhd_get_3d_fld
 //
-// FIXME, this should cache the fields, rather than creating/destroying
-// all the time
+// returns a scratch field matching mhd->fld's type, ghosts and layout, with
+// nr_comps components, zeroed. Hand it back with ggcm_mhd_put_3d_fld().
 
 struct mrc_fld *
 ggcm_mhd_get_3d_fld(struct ggcm_mhd *mhd, int nr_comps)
 {
-  struct mrc_fld *f = mrc_fld_create(ggcm_mhd_comm(mhd));
-  mrc_fld_set_type(f , mrc_fld_type(mhd->fld));
-  mrc_fld_set_param_obj(f, "domain", mhd->fld->_domain);
-  mrc_fld_set_param_int(f, "nr_spatial_dims", 3);
-  mrc_fld_set_param_int(f, "nr_comps", nr_comps);
-  mrc_fld_set_param_int(f, "nr_ghosts", mhd->fld->_nr_ghosts);
-  mrc_fld_set_param_bool(f, "aos", mhd->fld->_aos);
-  mrc_fld_set_param_bool(f, "c_order", mhd->fld->_c_order);
-  mrc_fld_setup(f);
+  struct ggcm_mhd_fld_pool *pool = &mhd->fld_pool;
+  struct mrc_fld *fld = mhd->fld;
+  struct mrc_fld *f = NULL;
+
+  pool->nr_gets++;
+  for (int i = pool->nr_free - 1; i >= 0; i--) {
+    struct mrc_fld *g = pool->free[i];
+    if (g->_nr_comps == nr_comps && g->_nr_ghosts == fld->_nr_ghosts &&
+	g->_aos == fld->_aos && g->_c_order == fld->_c_order &&
+	g->_domain == fld->_domain &&
+	strcmp(mrc_fld_type(g), mrc_fld_type(fld)) == 0) {
+      f = g;
+      pool->free[i] = pool->free[--pool->nr_free];
+      mrc_fld_set(f, 0.);
+      break;
+    }
+  }
+
+  if (!f) {
+    f = mrc_fld_create(ggcm_mhd_comm(mhd));
+    mrc_fld_set_type(f , mrc_fld_type(fld));
+    mrc_fld_set_param_obj(f, "domain", fld->_domain);
+    mrc_fld_set_param_int(f, "nr_spatial_dims", 3);
+    mrc_fld_set_param_int(f, "nr_comps", nr_comps);
+    mrc_fld_set_param_int(f, "nr_ghosts", fld->_nr_ghosts);
+    mrc_fld_set_param_bool(f, "aos", fld->_aos);
+    mrc_fld_set_param_bool(f, "c_order", fld->_c_order);
+    mrc_fld_setup(f);
+    if (pool->advise_hugepages) {
+      ggcm_mhd_fld_pool_advise_hugepages(mhd, f);
+    }
+    pool->nr_allocs++;
+    pool->bytes_total += ggcm_mhd_fld_pool_bytes(f);
+  }
+
+  pool->bytes_in_use += ggcm_mhd_fld_pool_bytes(f);
+  if (pool->bytes_in_use > pool->bytes_high_water) {
+    pool->bytes_high_water = pool->bytes_in_use;
+  }
 
   return f;
 }
@@ -395,7 +494,28 @@ ggcm_mhd_get_3d_fld(struct ggcm_mhd *mhd, int nr_comps)
 void
 ggcm_mhd_put_3d_fld(struct ggcm_mhd *mhd, struct mrc_fld *f)
 {
-  mrc_fld_destroy(f);
+  struct ggcm_mhd_fld_pool *pool = &mhd->fld_pool;
+
+  if (!f) {
+    return;
+  }
+
+  // fields that didn't come from ggcm_mhd_get_3d_fld() (e.g., read from a
+  // checkpoint) may be put, too
+  size_t bytes = ggcm_mhd_fld_pool_bytes(f);
+  pool->bytes_in_use -= MIN(bytes, pool->bytes_in_use);
+
+  if (pool->closed) {
+    pool->bytes_total -= MIN(bytes, pool->bytes_total);
+    mrc_fld_destroy(f);
+    return;
+  }
+
+  if (pool->nr_free == pool->nr_free_alloced) {
+    pool->nr_free_alloced = 2 * pool->nr_free_alloced + 8;
+    pool->free = realloc(pool->free, pool->nr_free_alloced * sizeof(*pool->free));
+  }
+  pool->free[pool->nr_free++] = f;
 }
 
 // ----------------------------------------------------------------------
@@ -429,6 +549,15 @@ ggcm_mhd_default_box(struct ggcm_mhd *mhd)
   mhd->par.gk_norm = true;
 }
 
+// ----------------------------------------------------------------------
+// ggcm_mhd_destroy
+
+static void
+_ggcm_mhd_destroy(struct ggcm_mhd *mhd)
+{
+  ggcm_mhd_fld_pool_destroy(mhd);
+}
+
 // ======================================================================
 // ggcm_mhd class
 
@@ -495,6 +624,9 @@ static struct param ggcm_mhd_descr[] = {
   { "amr_grid_file"   , VAR(amr_grid_file)   , PARAM_STRING("amr_grid.txt")   },
   { "amr"             , VAR(amr)             , PARAM_INT(0)                   },
 
+  { "fld_pool_advise_hugepages", VAR(fld_pool.advise_hugepages), PARAM_BOOL(false) },
+  { "fld_pool_stats"           , VAR(fld_pool.stats)           , PARAM_BOOL(false) },
+
   { "xxnorm"          , VAR(xxnorm)          , MRC_VAR_DOUBLE         },
   { "bbnorm"          , VAR(bbnorm)          , MRC_VAR_DOUBLE         },
   { "vvnorm"          , VAR(vvnorm)          , MRC_VAR_DOUBLE         },
@@ -547,6 +679,7 @@ struct mrc_class_ggcm_mhd mrc_class_ggcm_mhd = {
   .init             = ggcm_mhd_init,
   .create           = _ggcm_mhd_create,
   .setup            = _ggcm_mhd_setup,
+  .destroy          = _ggcm_mhd_destroy,
   .read             = _ggcm_mhd_read,
 };
 
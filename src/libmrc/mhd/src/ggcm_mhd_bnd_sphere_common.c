@@ -61,6 +61,9 @@ ggcm_mhd_bnd_sphere_setup(struct ggcm_mhd_bnd *bnd)
 static void
 ggcm_mhd_bnd_sphere_destroy(struct ggcm_mhd_bnd *bnd)
 {
+  struct ggcm_mhd_bnd_sphere *sub = ggcm_mhd_bnd_sphere(bnd);
+
+  ggcm_mhd_bnd_sphere_map_destroy(&sub->map);
   pde_free();
 }
 
@@ -84,23 +87,34 @@ sphere_fill_ghosts(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
   bnvals[BY] = sub->bnvals[BY] / mhd->bbnorm;
   bnvals[BZ] = sub->bnvals[BZ] / mhd->bbnorm;
 
+  // the same for every ghost point, unless B is kept (see below)
+  mrc_fld_data_t bnstate[s_n_state];
+  convert_state_from_prim(bnstate, bnvals);
+
+#pragma omp parallel for
   for (int i = 0; i < map->cc_n_map; i++) {
     int ix = MRC_I2(map->cc_imap, 0, i);
     int iy = MRC_I2(map->cc_imap, 1, i);
     int iz = MRC_I2(map->cc_imap, 2, i);
     int p  = MRC_I2(map->cc_imap, 3, i);
     
+    mrc_fld_data_t *state = bnstate;
+    mrc_fld_data_t cell_state[s_n_state];
     // FIXME, this is still kinda specific / hacky to ganymede
     // to avoid cutting off the initial perturbation from e.g., the mirror dipole,
     // let's just keep B as-is, rather than using the fixed values above
     if (MT == MT_FCONS_CC) {
-      bnvals[BX] = M3(fld, BX, ix,iy,iz, p);
-      bnvals[BY] = M3(fld, BY, ix,iy,iz, p);
-      bnvals[BZ] = M3(fld, BZ, ix,iy,iz, p);
+      mrc_fld_data_t prim[N_PRIMITIVE];
+      for (int m = 0; m < N_PRIMITIVE; m++) {
+	prim[m] = bnvals[m];
+      }
+      prim[BX] = M3(fld, BX, ix,iy,iz, p);
+      prim[BY] = M3(fld, BY, ix,iy,iz, p);
+      prim[BZ] = M3(fld, BZ, ix,iy,iz, p);
+      convert_state_from_prim(cell_state, prim);
+      state = cell_state;
     }
       
-    mrc_fld_data_t state[s_n_state];
-      convert_state_from_prim(state, bnvals);
       if (MT_BGRID(MT) == MT_BGRID_CC) {
 	convert_put_state_to_3d(state, fld, ix,iy,iz, p);
       } else {
@@ -258,6 +272,25 @@ sphere_fill_ghosts_test_3(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
 #endif
 }
 
+// ----------------------------------------------------------------------
+// sphere_map_check_stencils
+//
+// (re)make the neighbor stencils if we don't have them yet, or they were
+// made for a fld with a different ghost region
+
+static void
+sphere_map_check_stencils(struct ggcm_mhd_bnd_sphere_map *map, struct mrc_fld *fld)
+{
+  bool ok = map->cc_stencil_off;
+  for (int d = 0; d < 3; d++) {
+    ok = ok && map->cc_stencil_ghost_offs[d] == fld->_ghost_offs[d+1] &&
+      map->cc_stencil_ghost_dims[d] == fld->_ghost_dims[d+1];
+  }
+  if (!ok) {
+    ggcm_mhd_bnd_sphere_map_setup_stencils(map, fld);
+  }
+}
+
 // ----------------------------------------------------------------------
 // sphere_fill_ghosts_4
 // use neighbor real cell values to float rho and pressure and B field
@@ -275,9 +308,9 @@ sphere_fill_ghosts_test_4(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
   mrc_fld_data_t rrbn = sub->bnvals[RR] / mhd->rrnorm;
   mrc_fld_data_t ppbn = sub->bnvals[PP] / mhd->ppnorm;
 
-  struct mrc_fld *ymask = mrc_fld_get_as(mhd->ymask, FLD_TYPE);
   struct mrc_crds *crds = mrc_domain_get_crds(mhd->domain);
-  double xc[3];
+
+  sphere_map_check_stencils(map, fld);
 
   if (MT == MT_GKEYLL) {
     int nr_fluids = mhd->par.gk_nr_fluids;
@@ -285,8 +318,6 @@ sphere_fill_ghosts_test_4(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
     int nr_comps = nr_fluids * nr_moments + 8;
     assert(nr_comps == fld->_nr_comps);
     
-    float bn[nr_comps];
-
     float *mass = mhd->par.gk_mass.vals;
     float *pressure_ratios = mhd->par.gk_pressure_ratios.vals;
 
@@ -302,42 +333,34 @@ sphere_fill_ghosts_test_4(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
     for (int s = 0; s < nr_fluids; s++)
       mass_ratios[s] = mass[s] / mass_total;
 
+#pragma omp parallel for
     for (int i = 0; i < map->cc_n_map; i++) {
       int ix = MRC_I2(map->cc_imap, 0, i);
       int iy = MRC_I2(map->cc_imap, 1, i);
       int iz = MRC_I2(map->cc_imap, 2, i);
       int p  = MRC_I2(map->cc_imap, 3, i);
 
+      double xc[3];
       mrc_dcrds_at_cc(crds, ix,iy,iz, p, xc);
       mrc_fld_data_t x = xc[0];
       mrc_fld_data_t y = xc[1];
       mrc_fld_data_t z = xc[2];
 
+      int n_real = map->cc_stencil_off[i+1] - map->cc_stencil_off[i];
+      if (n_real == 0)
+        continue;
+
+      float bn[nr_comps];
       for (int c = 0; c < nr_comps; c++)
         bn[c] = 0.;
-      int n_real = 0;
-
-      for (int jx = ix-1; jx < ix+2; jx++) {
-        for (int jy = iy-1; jy < iy+2; jy++) {
-          for (int jz = iz-1; jz < iz+2; jz++) {
-            if ((jx == ix && jy == iy && jz == iz)
-            || jx < fld->_ghost_offs[1] || jx >= fld->_ghost_offs[1] + fld->_ghost_dims[1]
-            || jy < fld->_ghost_offs[2] || jy >= fld->_ghost_offs[2] + fld->_ghost_dims[2]
-            || jz < fld->_ghost_offs[3] || jz >= fld->_ghost_offs[3] + fld->_ghost_dims[3])
-             continue;
-            if (M3(ymask, 0, jx,jy,jz,p) > 0.) {
-              for (int c = 0; c < nr_comps; c++) {
-                bn[c] += M3(fld, c, jx,jy,jz, p);
-              }
-              n_real += 1;
-            }
-          }
+      for (int k = map->cc_stencil_off[i]; k < map->cc_stencil_off[i+1]; k++) {
+        int nb = map->cc_stencil_nb[k];
+        int jx = ix + nb % 3 - 1, jy = iy + (nb / 3) % 3 - 1, jz = iz + nb / 9 - 1;
+        for (int c = 0; c < nr_comps; c++) {
+          bn[c] += M3(fld, c, jx,jy,jz, p);
         }
       }
 
-      if (n_real == 0)
-        continue;
-
       for (int c = 0; c < nr_comps; c++)
         bn[c] /= n_real;
 
@@ -381,44 +404,35 @@ sphere_fill_ghosts_test_4(struct ggcm_mhd_bnd *bnd, struct mrc_fld *fld)
     }
   } else {
     int nr_comps = fld->_nr_comps;
-    float bn[nr_comps];
 
+#pragma omp parallel for
     for (int i = 0; i < map->cc_n_map; i++) {
       int ix = MRC_I2(map->cc_imap, 0, i);
       int iy = MRC_I2(map->cc_imap, 1, i);
       int iz = MRC_I2(map->cc_imap, 2, i);
       int p  = MRC_I2(map->cc_imap, 3, i);
 
+      double xc[3];
       mrc_dcrds_at_cc(crds, ix,iy,iz, p, xc);
       mrc_fld_data_t x = xc[0];
       mrc_fld_data_t y = xc[1];
       mrc_fld_data_t z = xc[2];
 
+      int n_real = map->cc_stencil_off[i+1] - map->cc_stencil_off[i];
+      if (n_real == 0)
+        continue;
+
+      float bn[nr_comps];
       for (int c = 0; c < nr_comps; c++)
         bn[c] = 0.;
-      int n_real = 0;
-
-      for (int jx = ix-1; jx < ix+2; jx++) {
-        for (int jy = iy-1; jy < iy+2; jy++) {
-          for (int jz = iz-1; jz < iz+2; jz++) {
-            if ((jx == ix && jy == iy && jz == iz)
-            || jx < fld->_ghost_offs[1] || jx >= fld->_ghost_offs[1] + fld->_ghost_dims[1]
-            || jy < fld->_ghost_offs[2] || jy >= fld->_ghost_offs[2] + fld->_ghost_dims[2]
-            || jz < fld->_ghost_offs[3] || jz >= fld->_ghost_offs[3] + fld->_ghost_dims[3])
-             continue;
-            if (M3(ymask, 0, jx,jy,jz,p) > 0.) {
-              for (int c = 0; c < nr_comps; c++) {
-                bn[c] += M3(fld, c, jx,jy,jz, p);
-              }
-              n_real += 1;
-            }
-          }
+      for (int k = map->cc_stencil_off[i]; k < map->cc_stencil_off[i+1]; k++) {
+        int nb = map->cc_stencil_nb[k];
+        int jx = ix + nb % 3 - 1, jy = iy + (nb / 3) % 3 - 1, jz = iz + nb / 9 - 1;
+        for (int c = 0; c < nr_comps; c++) {
+          bn[c] += M3(fld, c, jx,jy,jz, p);
         }
       }
 
-      if (n_real == 0)
-        continue;
-
       for (int c = 0; c < nr_comps; c++)
         bn[c] /= n_real;
 
@@ -519,6 +533,7 @@ sphere_fill_ghosts_E(struct ggcm_mhd_bnd *bnd, struct mrc_fld *E)
   struct ggcm_mhd_bnd_sphere_map *map = &sub->map;
 
   for (int d = 0; d < 3; d++) {
+#pragma omp parallel for
     for (int i = 0; i < map->ec_n_map[d]; i++) {
       int ix = MRC_I2(map->ec_imap[d], 0, i);
       int iy = MRC_I2(map->ec_imap[d], 1, i);
@@ -560,13 +575,9 @@ sphere_fill_ghosts_reconstr(struct ggcm_mhd_bnd *bnd, struct mrc_fld *U_l[],
   struct mrc_crds *crds = mrc_domain_get_crds(bnd->mhd->domain);
 
   for (int d = 0; d < 3; d++) {
-    for (int i = 0; i < map->fc_n_map[d]; i++) {
-      // FIXME, we really should have maps per patch, or some other way
-      // to not go through the entire list here
-      if (p != MRC_I2(map->fc_imap[d], 3, i)) {
-	continue;
-      }
-
+    // each boundary face sets its own ghost-side values only
+#pragma omp parallel for
+    for (int i = map->fc_patch_off[d][p]; i < map->fc_patch_off[d][p+1]; i++) {
       int ix = MRC_I2(map->fc_imap[d], 0, i);
       int iy = MRC_I2(map->fc_imap[d], 1, i);
       int iz = MRC_I2(map->fc_imap[d], 2, i);
@@ -8,6 +8,7 @@
 #include <mrc_fld_as_double.h>
 
 #include <math.h>
+#include <stdlib.h>
 
 // ----------------------------------------------------------------------
 // ggcm_mhd_bnd_sphere_map_is_bnd
@@ -123,10 +124,10 @@ ggcm_mhd_bnd_sphere_map_find_r1(struct ggcm_mhd_bnd_sphere_map *map)
 
   double dr = map->min_dr;
   double r2 = map->radius;
-  double r1 = r2 - dr;
 
- loop2:
-  // check if r1 is ok
+  // find how close to the center any of the +/- 2 neighbors of a cell
+  // outside r2 gets
+  double rmin = 1.e30;
   for (int p = 0; p < mrc_domain_nr_patches(mhd->domain); p++) {
     struct mrc_patch_info info;
     mrc_domain_get_local_patch_info(mhd->domain, p, &info);
@@ -153,10 +154,7 @@ ggcm_mhd_bnd_sphere_map_find_r1(struct ggcm_mhd_bnd_sphere_map *map)
 		double yyy = MRC_MCRDY(crds, iy+jy, p);
 		double zzz = MRC_MCRDZ(crds, iz+jz, p);
 		double rrr = sqrt(sqr(xxx) + sqr(yyy) + sqr(zzz));
-		if (rrr < r1) {
-		  r1 -= map->dr;
-		  goto loop2;
-		}
+		rmin = fmin(rmin, rrr);
 	      }
 	    }
 	  }
@@ -164,6 +162,12 @@ ggcm_mhd_bnd_sphere_map_find_r1(struct ggcm_mhd_bnd_sphere_map *map)
       }
     }
   }
+
+  // step r1 down until none of those neighbors is inside of it
+  double r1 = r2 - dr;
+  while (rmin < r1) {
+    r1 -= map->dr;
+  }
   r1 -= map->extra_dr * dr;
 
   MPI_Allreduce(&r1, &map->r1, 1, MPI_DOUBLE, MPI_MIN, ggcm_mhd_comm(mhd));
@@ -374,10 +378,21 @@ ggcm_mhd_bnd_sphere_map_setup_cc(struct ggcm_mhd_bnd_sphere_map *map)
   int gdims[3];
   mrc_domain_get_global_dims(mhd->domain, gdims);
 
+  // the stencils go with the old map
+  free(map->cc_stencil_off);
+  free(map->cc_stencil_nb);
+  map->cc_stencil_off = NULL;
+  map->cc_stencil_nb = NULL;
+
+  map->nr_patches = mrc_fld_nr_patches(mhd->fld);
+  free(map->cc_patch_off);
+  map->cc_patch_off = calloc(map->nr_patches + 1, sizeof(*map->cc_patch_off));
+
   int cc_n_map = 0;
   for (int p = 0; p < mrc_fld_nr_patches(mhd->fld); p++) {
     struct mrc_patch_info info;
     mrc_domain_get_local_patch_info(mhd->domain, p, &info);
+    map->cc_patch_off[p] = cc_n_map;
     // cell-centered
     int sw[3] = { 2, 2, 2 };
     for (int d = 0; d < 3; d++) {
@@ -403,6 +418,8 @@ ggcm_mhd_bnd_sphere_map_setup_cc(struct ggcm_mhd_bnd_sphere_map *map)
     }
   }
 
+  map->cc_patch_off[map->nr_patches] = cc_n_map;
+
   assert(cc_n_map == map->cc_n_map);
 }
 
@@ -479,10 +496,19 @@ ggcm_mhd_bnd_sphere_map_setup_fc(struct ggcm_mhd_bnd_sphere_map *map)
   int gdims[3];
   mrc_domain_get_global_dims(mhd->domain, gdims);
 
+  map->nr_patches = mrc_fld_nr_patches(mhd->fld);
+  for (int d = 0; d < 3; d++) {
+    free(map->fc_patch_off[d]);
+    map->fc_patch_off[d] = calloc(map->nr_patches + 1, sizeof(*map->fc_patch_off[d]));
+  }
+
   int fc_n_map[3] = {};
   for (int p = 0; p < mrc_fld_nr_patches(mhd->fld); p++) {
     struct mrc_patch_info info;
     mrc_domain_get_local_patch_info(mhd->domain, p, &info);
+    for (int d = 0; d < 3; d++) {
+      map->fc_patch_off[d][p] = fc_n_map[d];
+    }
 
     int l[3] = { 2, 2, 2 }, r[3] = { 1, 1, 1 };
     for (int d = 0; d < 3; d++) {
@@ -530,6 +556,7 @@ ggcm_mhd_bnd_sphere_map_setup_fc(struct ggcm_mhd_bnd_sphere_map *map)
   }
 
   for (int d = 0; d < 3; d++) {
+    map->fc_patch_off[d][map->nr_patches] = fc_n_map[d];
     assert(map->fc_n_map[d] == fc_n_map[d]);
   }
 
@@ -538,3 +565,69 @@ ggcm_mhd_bnd_sphere_map_setup_fc(struct ggcm_mhd_bnd_sphere_map *map)
   }
 }
 
+// ----------------------------------------------------------------------
+// ggcm_mhd_bnd_sphere_map_setup_stencils
+//
+// for each cc ghost point, list the neighbors within +/- 1 that are real
+// cells (ymask > 0) and inside fld's ghost region, in the order they are
+// summed up when filling the ghost point. The ymask doesn't change after
+// setup, so this only needs redoing if the maps or fld's layout change.
+
+void
+ggcm_mhd_bnd_sphere_map_setup_stencils(struct ggcm_mhd_bnd_sphere_map *map,
+				       struct mrc_fld *fld)
+{
+  struct ggcm_mhd *mhd = map->mhd;
+  struct mrc_fld *ymask = mrc_fld_get_as(mhd->ymask, FLD_TYPE);
+
+  free(map->cc_stencil_off);
+  free(map->cc_stencil_nb);
+  map->cc_stencil_off = calloc(map->cc_n_map + 1, sizeof(*map->cc_stencil_off));
+  map->cc_stencil_nb = malloc(26 * map->cc_n_map * sizeof(*map->cc_stencil_nb));
+  for (int d = 0; d < 3; d++) {
+    map->cc_stencil_ghost_offs[d] = fld->_ghost_offs[d+1];
+    map->cc_stencil_ghost_dims[d] = fld->_ghost_dims[d+1];
+  }
+
+  int n = 0;
+  for (int i = 0; i < map->cc_n_map; i++) {
+    int ix = MRC_I2(map->cc_imap, 0, i);
+    int iy = MRC_I2(map->cc_imap, 1, i);
+    int iz = MRC_I2(map->cc_imap, 2, i);
+    int p  = MRC_I2(map->cc_imap, 3, i);
+
+    map->cc_stencil_off[i] = n;
+    for (int jx = ix-1; jx < ix+2; jx++) {
+      for (int jy = iy-1; jy < iy+2; jy++) {
+	for (int jz = iz-1; jz < iz+2; jz++) {
+	  if ((jx == ix && jy == iy && jz == iz)
+	      || jx < fld->_ghost_offs[1] || jx >= fld->_ghost_offs[1] + fld->_ghost_dims[1]
+	      || jy < fld->_ghost_offs[2] || jy >= fld->_ghost_offs[2] + fld->_ghost_dims[2]
+	      || jz < fld->_ghost_offs[3] || jz >= fld->_ghost_offs[3] + fld->_ghost_dims[3])
+	    continue;
+	  if (M3(ymask, 0, jx,jy,jz, p) > 0.) {
+	    map->cc_stencil_nb[n++] = (jx-ix+1) + 3 * ((jy-iy+1) + 3 * (jz-iz+1));
+	  }
+	}
+      }
+    }
+  }
+  map->cc_stencil_off[map->cc_n_map] = n;
+
+  mrc_fld_put_as(ymask, mhd->ymask);
+}
+
+// ----------------------------------------------------------------------
+// ggcm_mhd_bnd_sphere_map_destroy
+
+void
+ggcm_mhd_bnd_sphere_map_destroy(struct ggcm_mhd_bnd_sphere_map *map)
+{
+  free(map->cc_patch_off);
+  for (int d = 0; d < 3; d++) {
+    free(map->fc_patch_off[d]);
+  }
+  free(map->cc_stencil_off);
+  free(map->cc_stencil_nb);
+}
+
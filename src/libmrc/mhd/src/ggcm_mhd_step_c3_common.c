@@ -19,6 +19,7 @@
 #include "pde/pde_mhd_convert.c"
 #include "pde/pde_mhd_reconstruct.c"
 #include "pde/pde_mhd_riemann.c"
+#include "pde/pde_mhd_pencil.c"
 #include "pde/pde_mhd_pushfluid.c"
 #include "pde/pde_mhd_push_ej.c"
 #include "pde/pde_mhd_rmaskn.c"
@@ -55,9 +56,16 @@ struct ggcm_mhd_step_c3 {
 
 #define REPS (1.e-10f)
 
-// 1-d state vars statically rather than having to pass them around
+// 1-d state vars statically rather than having to pass them around,
+// one set per thread, as lines are swept in parallel
 
-static fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F;
+static fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F, l_Flo;
+#pragma omp threadprivate(l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F, l_Flo)
+
+// same for pencils of lines, if mhd_pencil_supported()
+
+static fld1d_pencil_t pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F;
+#pragma omp threadprivate(pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F)
 
 // ----------------------------------------------------------------------
 // ggcm_mhd_step_c3_setup_flds
@@ -87,13 +95,25 @@ ggcm_mhd_step_c3_setup(struct ggcm_mhd_step *step)
   pde_mhd_setup(mhd, 5);
   pde_mhd_compat_setup(mhd);
 
-  fld1d_state_setup(&l_U);
-  fld1d_state_setup(&l_Ul);
-  fld1d_state_setup(&l_Ur);
-  fld1d_state_setup(&l_W);
-  fld1d_state_setup(&l_Wl);
-  fld1d_state_setup(&l_Wr);
-  fld1d_state_setup(&l_F);
+#pragma omp parallel
+  if (!fld1d_state_is_setup(l_U)) {
+    fld1d_state_setup(&l_U);
+    fld1d_state_setup(&l_Ul);
+    fld1d_state_setup(&l_Ur);
+    fld1d_state_setup(&l_W);
+    fld1d_state_setup(&l_Wl);
+    fld1d_state_setup(&l_Wr);
+    fld1d_state_setup(&l_F);
+    fld1d_state_setup(&l_Flo);
+
+    fld1d_pencil_setup(&pc_Ul, s_n_comps);
+    fld1d_pencil_setup(&pc_Ur, s_n_comps);
+    fld1d_pencil_setup(&pc_W, s_n_comps);
+    fld1d_pencil_setup(&pc_Wl, s_n_comps);
+    fld1d_pencil_setup(&pc_Wr, s_n_comps);
+    fld1d_pencil_setup(&pc_F, s_n_comps);
+  }
+  pde_mhd_aux_setup();
 
   if (s_opt_background) {
     mhd->b0 = ggcm_mhd_get_3d_fld(mhd, 3);
@@ -158,14 +178,64 @@ ggcm_mhd_step_c3_get_dt(struct ggcm_mhd_step *step, struct mrc_fld *x)
 // ----------------------------------------------------------------------
 // patch_flux_pred
 
+// ----------------------------------------------------------------------
+// pencil_flux_lo
+//
+// low order fluxes for the lines of the pencil starting at l0, left in
+// pc_F, with the primitive state in pc_W
+
+static void
+pencil_flux_lo(fld3d_t p_U, int l0, int dir, int ib, int ie)
+{
+  for (int l = 0; l < PDE_PENCIL_N; l++) {
+    int j, k;
+    pde_pencil_get_jk(dir, 0, l0, l, &j, &k);
+    mhd_line_get_state(l_U, p_U, j, k, dir, ib - 2, ie + 2);
+    mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
+    fld1d_pencil_set_lane(pc_W, l, l_W, ib - 2, ie + 2);
+  }
+
+  mhd_pencil_reconstruct(pc_Ul, pc_Ur, pc_Wl, pc_Wr, pc_W, (fld1d_pencil_t) {}, (fld1d_pencil_t) {},
+			 ib, ie + 1);
+  mhd_pencil_riemann(pc_F, pc_Ul, pc_Ur, pc_Wl, pc_Wr, ib, ie + 1);
+}
+
+// ----------------------------------------------------------------------
+// patch_flux_pred_pencils
+//
+// same as patch_flux_pred(), PDE_PENCIL_N lines at a time
+
+static void
+patch_flux_pred_pencils(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
+{
+  pde_for_each_dir(dir) {
+    pde_for_each_pencil_omp(dir, l0, 0) {
+      int ib = 0, ie = s_ldims[dir];
+      pencil_flux_lo(p_U, l0, dir, ib, ie);
+      for (int l = 0; l < pde_pencil_n_lanes(dir, 0, l0); l++) {
+	int j, k;
+	pde_pencil_get_jk(dir, 0, l0, l, &j, &k);
+	fld1d_pencil_get_lane(l_F, pc_F, l, ib, ie + 1);
+	mhd_line_put_state(l_F, p_F[dir], j, k, dir, ib, ie + 1);
+      }
+    }
+  }
+}
+
 static void
 patch_flux_pred(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
 {
+  if (mhd_pencil_supported()) {
+    patch_flux_pred_pencils(step, p_F, p_U);
+    return;
+  }
+
   pde_for_each_dir(dir) {
-    pde_for_each_line(dir, j, k, 0) {
+    pde_for_each_line_omp(dir, j, k, 0) {
       int ib = 0, ie = s_ldims[dir];
-      mhd_line_get_state(l_U, p_U, j, k, dir, ib - 1, ie + 1);
-      mhd_prim_from_cons(l_W, l_U, ib - 1, ie + 1);
+      // PLM reconstruction needs two cells beyond the faces
+      mhd_line_get_state(l_U, p_U, j, k, dir, ib - 2, ie + 2);
+      mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
       mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
       mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
       mhd_line_put_state(l_F, p_F[dir], j, k, dir, ib, ie + 1);
@@ -206,25 +276,21 @@ limit_hz(mrc_fld_data_t a2, mrc_fld_data_t aa, mrc_fld_data_t a1)
 }
 
 // ----------------------------------------------------------------------
-// line_flux_corr
+// line_flux_hz
+//
+// blends the low order fluxes l_Flo with high order ones, given the line's
+// state in l_U / l_W
 
 static void
-line_flux_corr(fld3d_t p_F, fld3d_t p_U,
-	       int j, int k, int dir, int ib, int ie)
+line_flux_hz(fld3d_t p_F, int j, int k, int dir, int ib, int ie)
 {
-  static fld1d_state_t l_Fcc, l_Flo, l_lim1;
+  static fld1d_state_t l_Fcc, l_lim1;
+#pragma omp threadprivate(l_Fcc, l_lim1)
   if (!fld1d_state_is_setup(l_Fcc)) {
     fld1d_state_setup(&l_Fcc);
-    fld1d_state_setup(&l_Flo);
     fld1d_state_setup(&l_lim1);
   }
 
-  // calculate low order fluxes
-  mhd_line_get_state(l_U, p_U, j, k, dir, ib - 2, ie + 2);
-  mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
-  mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
-  mhd_riemann(l_Flo, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
-
   // find cell centered fluxes
   for (int i = ib - 2; i < ie + 2; i++) {
     fluxes_mhd_scons(&F1S(l_Fcc, 0, i), &F1S(l_U, 0, i), &F1S(l_W, 0, i), i);
@@ -252,14 +318,60 @@ line_flux_corr(fld3d_t p_F, fld3d_t p_U,
   mhd_line_put_state(l_F, p_F, j, k, dir, ib, ie + 1);
 }
 
+// ----------------------------------------------------------------------
+// line_flux_corr
+
+static void
+line_flux_corr(fld3d_t p_F, fld3d_t p_U,
+	       int j, int k, int dir, int ib, int ie)
+{
+  // calculate low order fluxes
+  mhd_line_get_state(l_U, p_U, j, k, dir, ib - 2, ie + 2);
+  mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
+  mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
+  mhd_riemann(l_Flo, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
+
+  line_flux_hz(p_F, j, k, dir, ib, ie);
+}
+
+// ----------------------------------------------------------------------
+// patch_flux_corr_pencils
+//
+// same as patch_flux_corr(), with the low order fluxes found
+// PDE_PENCIL_N lines at a time
+
+static void
+patch_flux_corr_pencils(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
+{
+  pde_for_each_dir(dir) {
+    pde_for_each_pencil_omp(dir, l0, 0) {
+      int ib = 0, ie = s_ldims[dir];
+      pencil_flux_lo(p_U, l0, dir, ib, ie);
+      for (int l = 0; l < pde_pencil_n_lanes(dir, 0, l0); l++) {
+	int j, k;
+	pde_pencil_get_jk(dir, 0, l0, l, &j, &k);
+	mhd_line_get_state(l_U, p_U, j, k, dir, ib - 2, ie + 2);
+	fld1d_pencil_get_lane(l_W, pc_W, l, ib - 2, ie + 2);
+	fld1d_pencil_get_lane(l_Flo, pc_F, l, ib, ie + 1);
+	line_flux_hz(p_F[dir], j, k, dir, ib, ie);
+      }
+    }
+  }
+}
+
 // ----------------------------------------------------------------------
 // patch_flux_corr
 
 static void
 patch_flux_corr(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
 {
+  if (mhd_pencil_supported()) {
+    patch_flux_corr_pencils(step, p_F, p_U);
+    return;
+  }
+
   pde_for_each_dir(dir) {
-    pde_for_each_line(dir, j, k, 0) {
+    pde_for_each_line_omp(dir, j, k, 0) {
       int ib = 0, ie = s_ldims[dir];
       line_flux_corr(p_F[dir], p_U, j, k, dir, ib, ie);
     }
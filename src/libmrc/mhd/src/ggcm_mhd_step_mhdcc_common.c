@@ -38,6 +38,7 @@
 #include "pde/pde_mhd_current.c"
 #include "pde/pde_mhd_divb_glm.c"
 #include "pde/pde_mhd_riemann.c"
+#include "pde/pde_mhd_pencil.c"
 #include "pde/pde_mhd_resistive.c"
 #include "pde/pde_mhd_stage.c"
 #include "pde/pde_mhd_get_dt.c"
@@ -50,14 +51,6 @@
 struct ggcm_mhd_step_mhdcc {
   struct mhd_options opt;
 
-  fld1d_state_t U;
-  fld1d_state_t U_l;
-  fld1d_state_t U_r;
-  fld1d_state_t W;
-  fld1d_state_t W_l;
-  fld1d_state_t W_r;
-  fld1d_state_t F;
-
   struct mrc_fld *x_star;
 
   struct mrc_fld *fluxes[3];
@@ -66,6 +59,17 @@ struct ggcm_mhd_step_mhdcc {
 
 #define ggcm_mhd_step_mhdcc(step) mrc_to_subobj(step, struct ggcm_mhd_step_mhdcc)
 
+// 1-d state vars statically rather than having to pass them around,
+// one set per thread, as lines are swept in parallel
+
+static fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F;
+#pragma omp threadprivate(l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F)
+
+// same for pencils of lines, if mhd_pencil_supported()
+
+static fld1d_pencil_t pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F, pc_bnd_mask;
+#pragma omp threadprivate(pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F, pc_bnd_mask)
+
 // TODO:
 // - handle various resistivity models
 
@@ -82,13 +86,24 @@ ggcm_mhd_step_mhdcc_setup(struct ggcm_mhd_step *step)
 
   pde_mhd_setup(mhd, mrc_fld_nr_comps(mhd->fld));
 
-  fld1d_state_setup(&sub->U);
-  fld1d_state_setup(&sub->U_l);
-  fld1d_state_setup(&sub->U_r);
-  fld1d_state_setup(&sub->W);
-  fld1d_state_setup(&sub->W_l);
-  fld1d_state_setup(&sub->W_r);
-  fld1d_state_setup(&sub->F);
+#pragma omp parallel
+  if (!fld1d_state_is_setup(l_U)) {
+    fld1d_state_setup(&l_U);
+    fld1d_state_setup(&l_Ul);
+    fld1d_state_setup(&l_Ur);
+    fld1d_state_setup(&l_W);
+    fld1d_state_setup(&l_Wl);
+    fld1d_state_setup(&l_Wr);
+    fld1d_state_setup(&l_F);
+
+    fld1d_pencil_setup(&pc_Ul, s_n_comps);
+    fld1d_pencil_setup(&pc_Ur, s_n_comps);
+    fld1d_pencil_setup(&pc_W, s_n_comps);
+    fld1d_pencil_setup(&pc_Wl, s_n_comps);
+    fld1d_pencil_setup(&pc_Wr, s_n_comps);
+    fld1d_pencil_setup(&pc_F, s_n_comps);
+    fld1d_pencil_setup(&pc_bnd_mask, 1);
+  }
   pde_mhd_aux_setup();
 
   mhd->ymask = ggcm_mhd_get_3d_fld(mhd, 1);
@@ -171,15 +186,11 @@ static void
 mhd_flux_pt1(struct ggcm_mhd_step *step, fld3d_t x,
 	     int j, int k, int dir, int ib, int ie)
 {
-  struct ggcm_mhd_step_mhdcc *sub = ggcm_mhd_step_mhdcc(step);
-  fld1d_state_t U = sub->U, U_l = sub->U_l, U_r = sub->U_r;
-  fld1d_state_t W = sub->W, W_l = sub->W_l, W_r = sub->W_r;
-
   // FIXME: +2,+2 is specifically for PLM reconstr (and enough for PCM)
-  mhd_line_get_state(U, x, j, k, dir, ib - 2, ie + 2);
+  mhd_line_get_state(l_U, x, j, k, dir, ib - 2, ie + 2);
   mhd_line_get_1(s_aux.bnd_mask, s_p_aux.bnd_mask, j, k, dir, ib - 2, ie + 2);
-  mhd_prim_from_cons(W, U, ib - 2, ie + 2);
-  mhd_reconstruct(U_l, U_r, W_l, W_r, W, (fld1d_t) {}, ib, ie + 1);
+  mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
+  mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
 }
 
 // ----------------------------------------------------------------------
@@ -189,15 +200,48 @@ static void
 mhd_flux_pt2(struct ggcm_mhd_step *step, fld3d_t flux, fld3d_t x,
 	     int j, int k, int dir, int ib, int ie)
 {
-  struct ggcm_mhd_step_mhdcc *sub = ggcm_mhd_step_mhdcc(step);
-  fld1d_state_t U_l = sub->U_l, U_r = sub->U_r;
-  fld1d_state_t W = sub->W, W_l = sub->W_l, W_r = sub->W_r, F = sub->F;
-
   mhd_line_get_current(x, j, k, dir, ib, ie + 1);
   mhd_line_get_b0_fc(j, k, dir, ib, ie + 1);
-  mhd_riemann(F, U_l, U_r, W_l, W_r, ib, ie + 1);
-  mhd_add_resistive_flux(F, W, ib, ie + 1);
-  mhd_line_put_state(F, flux, j, k, dir, ib, ie + 1);
+  mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
+  mhd_add_resistive_flux(l_F, l_W, ib, ie + 1);
+  mhd_line_put_state(l_F, flux, j, k, dir, ib, ie + 1);
+}
+
+// ----------------------------------------------------------------------
+// mhd_flux_pencil
+//
+// same as mhd_flux_pt1() followed by mhd_flux_pt2(), for the lines of the
+// pencil starting at l0
+
+static void
+mhd_flux_pencil(struct ggcm_mhd_step *step, fld3d_t flux, fld3d_t x,
+		int l0, int dir, int ib, int ie)
+{
+  for (int l = 0; l < PDE_PENCIL_N; l++) {
+    int j, k;
+    pde_pencil_get_jk(dir, 0, l0, l, &j, &k);
+    mhd_line_get_state(l_U, x, j, k, dir, ib - 2, ie + 2);
+    mhd_line_get_1(s_aux.bnd_mask, s_p_aux.bnd_mask, j, k, dir, ib - 2, ie + 2);
+    mhd_prim_from_cons(l_W, l_U, ib - 2, ie + 2);
+    fld1d_pencil_set_lane(pc_W, l, l_W, ib - 2, ie + 2);
+    fld1d_pencil_set_lane_1(pc_bnd_mask, l, s_aux.bnd_mask, ib - 2, ie + 2);
+  }
+
+  mhd_pencil_reconstruct(pc_Ul, pc_Ur, pc_Wl, pc_Wr, pc_W, (fld1d_pencil_t) {}, pc_bnd_mask,
+			 ib, ie + 1);
+  mhd_pencil_riemann(pc_F, pc_Ul, pc_Ur, pc_Wl, pc_Wr, ib, ie + 1);
+
+  for (int l = 0; l < pde_pencil_n_lanes(dir, 0, l0); l++) {
+    int j, k;
+    pde_pencil_get_jk(dir, 0, l0, l, &j, &k);
+    fld1d_pencil_get_lane(l_F, pc_F, l, ib, ie + 1);
+    if (s_opt_resistivity != OPT_RESISTIVITY_NONE) {
+      fld1d_pencil_get_lane(l_W, pc_W, l, ib - 1, ie + 1);
+      mhd_line_get_current(x, j, k, dir, ib, ie + 1);
+      mhd_add_resistive_flux(l_F, l_W, ib, ie + 1);
+    }
+    mhd_line_put_state(l_F, flux, j, k, dir, ib, ie + 1);
+  }
 }
 
 // ----------------------------------------------------------------------
@@ -244,11 +288,11 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
 	fld3d_get(&Ul[dir], p);
 	fld3d_get(&Ur[dir], p);
 
-	pde_for_each_line(dir, j, k, 0) {
+	pde_for_each_line_omp(dir, j, k, 0) {
 	  int ib = 0, ie = s_ldims[dir];
 	  mhd_flux_pt1(step, x, j, k, dir, ib, ie);
-	  mhd_line_put_state(sub->U_l, Ul[dir], j, k, dir, ib, ie + 1);
-	  mhd_line_put_state(sub->U_r, Ur[dir], j, k, dir, ib, ie + 1);
+	  mhd_line_put_state(l_Ul, Ul[dir], j, k, dir, ib, ie + 1);
+	  mhd_line_put_state(l_Ur, Ur[dir], j, k, dir, ib, ie + 1);
 	}
 
 	fld3d_put(&Ul[dir], p);
@@ -263,12 +307,12 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
 	fld3d_get(&Ul[dir], p);
 	fld3d_get(&Ur[dir], p);
 
-	pde_for_each_line(dir, j, k, 0) {
+	pde_for_each_line_omp(dir, j, k, 0) {
 	  int ib = 0, ie = s_ldims[dir];
-	  mhd_line_get_state(sub->U_l, Ul[dir], j, k, dir, ib, ie + 1);
-	  mhd_line_get_state(sub->U_r, Ur[dir], j, k, dir, ib, ie + 1);
-	  mhd_prim_from_cons(sub->W_l, sub->U_l, ib, ie + 1);
-	  mhd_prim_from_cons(sub->W_r, sub->U_r, ib, ie + 1);
+	  mhd_line_get_state(l_Ul, Ul[dir], j, k, dir, ib, ie + 1);
+	  mhd_line_get_state(l_Ur, Ur[dir], j, k, dir, ib, ie + 1);
+	  mhd_prim_from_cons(l_Wl, l_Ul, ib, ie + 1);
+	  mhd_prim_from_cons(l_Wr, l_Ur, ib, ie + 1);
 	  
 	  mhd_flux_pt2(step, fluxes[dir], x, j, k, dir, 0, s_ldims[dir]);
 	}
@@ -280,7 +324,13 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
     } else { // !s_opt_bc_reconstruct
 
       pde_for_each_dir(dir) {
-	pde_for_each_line(dir, j, k, 0) {
+	if (mhd_pencil_supported()) {
+	  pde_for_each_pencil_omp(dir, l0, 0) {
+	    mhd_flux_pencil(step, fluxes[dir], x, l0, dir, 0, s_ldims[dir]);
+	  }
+	  continue;
+	}
+	pde_for_each_line_omp(dir, j, k, 0) {
 	  int ib = 0, ie = s_ldims[dir];
 	  mhd_flux_pt1(step, x, j, k, dir, ib, ie);
 	  mhd_flux_pt2(step, fluxes[dir], x, j, k, dir, ib, ie);
@@ -29,6 +29,7 @@
 #include "pde/pde_mhd_reconstruct.c"
 #include "pde/pde_mhd_divb_glm.c"
 #include "pde/pde_mhd_riemann.c"
+#include "pde/pde_mhd_pencil.c"
 #include "pde/pde_mhd_stage.c"
 #include "pde/pde_mhd_get_dt.c"
 
@@ -48,19 +49,36 @@ struct ggcm_mhd_step_vlct {
   struct mhd_options opt;
 
   bool debug_dump;
+  bool dt_from_fluxes; // estimate the next dt in the corrector sweep
 
-  fld1d_state_t U;
-  fld1d_state_t U_l;
-  fld1d_state_t U_r;
-  fld1d_state_t W;
-  fld1d_state_t W_l;
-  fld1d_state_t W_r;
-  fld1d_state_t F;
-  fld1d_t bx;
+  struct mrc_fld *B_cc;
+  // get_dt() fills ghosts and finds B_cc, which run() reuses when it's
+  // called right after for the same state
+  struct mrc_fld *cache_x;
+  float cache_time;
+
+  // found in the last corrector sweep, if dt_from_fluxes
+  mrc_fld_data_t max_dti;
+  bool have_max_dti;
 };
 
 #define ggcm_mhd_step_vlct(step) mrc_to_subobj(step, struct ggcm_mhd_step_vlct)
 
+// 1-d state vars statically rather than having to pass them around,
+// one set per thread, as lines are swept in parallel
+
+static fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F;
+static fld1d_t l_bx;
+#pragma omp threadprivate(l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F, l_bx)
+
+// same for pencils of lines, if mhd_pencil_supported()
+
+static fld1d_pencil_t pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F, pc_bx;
+#pragma omp threadprivate(pc_Ul, pc_Ur, pc_W, pc_Wl, pc_Wr, pc_F, pc_bx)
+
+static mrc_fld_data_t l_max_dti;
+#pragma omp threadprivate(l_max_dti)
+
 // ======================================================================
 
 static inline mrc_fld_data_t
@@ -197,25 +215,118 @@ compute_E(struct ggcm_mhd_step *step, struct mrc_fld *E,
   ggcm_mhd_put_3d_fld(step->mhd, Ecc);
 }
 
+// ----------------------------------------------------------------------
+// fluxes_pred_pencils
+//
+// same as the line sweep in fluxes_pred(), PDE_PENCIL_N lines at a time
+
 static void
-fluxes_pred(struct ggcm_mhd_step *step, struct mrc_fld *flux[3], struct mrc_fld *x, struct mrc_fld *B_cc)
+fluxes_pred_pencils(struct mrc_fld *flux, struct mrc_fld *x, struct mrc_fld *B_cc,
+		    int dir, int p)
 {
-  struct ggcm_mhd_step_vlct *sub = ggcm_mhd_step_vlct(step);
-  fld1d_state_t U = sub->U, U_l = sub->U_l, U_r = sub->U_r;
-  fld1d_state_t W = sub->W, W_l = sub->W_l, W_r = sub->W_r;
-  fld1d_state_t F = sub->F;
-  fld1d_t bx = sub->bx;
+  int ldim = s_ldims[dir];
+  pde_for_each_pencil_omp(dir, l0, nghost) {
+    for (int l = 0; l < PDE_PENCIL_N; l++) {
+      int j, k;
+      pde_pencil_get_jk(dir, nghost, l0, l, &j, &k);
+      mhd_get_line_state_fcons_ct(l_U, l_bx, x, B_cc, j, k, dir, p, -nghost, ldim + nghost);
+      mhd_prim_from_cons(l_W, l_U, -nghost, ldim + nghost);
+      fld1d_pencil_set_lane(pc_W, l, l_W, -nghost, ldim + nghost);
+      fld1d_pencil_set_lane_1(pc_bx, l, l_bx, -nghost, ldim + nghost);
+    }
+    mhd_pencil_reconstruct_pcm(pc_Ul, pc_Ur, pc_Wl, pc_Wr, pc_W, pc_bx, -(nghost - 1), ldim + nghost);
+    mhd_pencil_riemann(pc_F, pc_Ul, pc_Ur, pc_Wl, pc_Wr, -(nghost - 1), ldim + nghost);
+    for (int l = 0; l < pde_pencil_n_lanes(dir, nghost, l0); l++) {
+      int j, k;
+      pde_pencil_get_jk(dir, nghost, l0, l, &j, &k);
+      fld1d_pencil_get_lane(l_F, pc_F, l, -(nghost - 1), ldim + nghost);
+      mhd_put_line_state_fcons_ct(flux, l_F, j, k, dir, p, -(nghost - 1), ldim + nghost);
+    }
+  }
+}
 
+static void
+fluxes_pred(struct ggcm_mhd_step *step, struct mrc_fld *flux[3], struct mrc_fld *x, struct mrc_fld *B_cc)
+{
   for (int p = 0; p < mrc_fld_nr_patches(x); p++) {
     pde_for_each_dir(dir) {
       int ldim = s_ldims[dir];
-      pde_for_each_line(dir, j, k, nghost) {
-	mhd_get_line_state_fcons_ct(U, bx, x, B_cc, j, k, dir, p, -nghost, ldim + nghost);
-	mhd_prim_from_cons(W, U, -nghost, ldim + nghost);
-	mhd_reconstruct_pcm(U_l, U_r, W_l, W_r, W, bx, -(nghost - 1), ldim + nghost);
-	mhd_riemann(F, U_l, U_r, W_l, W_r, -(nghost - 1), ldim + nghost);
-	mhd_put_line_state_fcons_ct(flux[dir], F, j, k, dir, p, -(nghost - 1), ldim + nghost);
+      if (mhd_pencil_supported()) {
+	fluxes_pred_pencils(flux[dir], x, B_cc, dir, p);
+	continue;
+      }
+      pde_for_each_line_omp(dir, j, k, nghost) {
+	mhd_get_line_state_fcons_ct(l_U, l_bx, x, B_cc, j, k, dir, p, -nghost, ldim + nghost);
+	mhd_prim_from_cons(l_W, l_U, -nghost, ldim + nghost);
+	mhd_reconstruct_pcm(l_Ul, l_Ur, l_Wl, l_Wr, l_W, l_bx, -(nghost - 1), ldim + nghost);
+	mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, -(nghost - 1), ldim + nghost);
+	mhd_put_line_state_fcons_ct(flux[dir], l_F, j, k, dir, p, -(nghost - 1), ldim + nghost);
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// line_max_dti
+//
+// max inverse timestep along the line, from the fast speed in the line's
+// direction and, if d_i > 0, whistlers, as in pde_mhd_get_dt_fcons_ct_Bcc()
+
+static mrc_fld_data_t
+line_max_dti(fld1d_state_t W, fld1d_t bx, mrc_fld_data_t d_i, int ib, int ie)
+{
+  static const mrc_fld_data_t eps = 1.e-10; // FIXME
+
+  mrc_fld_data_t max_dti = 0.;
+  for (int i = ib; i < ie; i++) {
+    mrc_fld_data_t rri = 1.f / F1S(W, RR, i);
+    mrc_fld_data_t bn = F1S(W, BX, i) + mrc_fld_abs(F1(bx, i) - F1S(W, BX, i));
+    mrc_fld_data_t bt2 = sqr(F1S(W, BY, i)) + sqr(F1S(W, BZ, i));
+    mrc_fld_data_t bb = sqr(bn) + bt2;
+    mrc_fld_data_t cs2 = s_gamma * mrc_fld_max(F1S(W, PP, i), eps) * rri;
+
+    mrc_fld_data_t tsum = bb * rri + cs2;
+    mrc_fld_data_t tdif = bb * rri - cs2;
+    mrc_fld_data_t cfsq = .5f * (tsum + mrc_fld_sqrt(sqr(tdif) + 4.f * cs2 * bt2 * rri));
+    max_dti = mrc_fld_max(max_dti, (mrc_fld_abs(F1S(W, VX, i)) + mrc_fld_sqrt(cfsq)) * PDE_INV_DS(i));
+
+    if (d_i > 0.) {
+      max_dti = mrc_fld_max(max_dti, d_i * bb * rri * 16.f * sqr(PDE_INV_DS(i)));
+    }
+  }
+  return max_dti;
+}
+
+// ----------------------------------------------------------------------
+// fluxes_corr_pencils
+//
+// same as the line sweep in fluxes_corr(), PDE_PENCIL_N lines at a time
+
+static void
+fluxes_corr_pencils(struct mrc_fld *flux, struct mrc_fld *x, struct mrc_fld *B_cc,
+		    int dir, int p, bool calc_dti, mrc_fld_data_t d_i)
+{
+  int ldim = s_ldims[dir];
+  pde_for_each_pencil_omp(dir, l0, 1) {
+    for (int l = 0; l < PDE_PENCIL_N; l++) {
+      int j, k;
+      pde_pencil_get_jk(dir, 1, l0, l, &j, &k);
+      mhd_get_line_state_fcons_ct(l_U, l_bx, x, B_cc, j, k, dir, p, - (nghost - 1), ldim + (nghost - 1));
+      mhd_prim_from_cons(l_W, l_U, - (nghost - 1), ldim + (nghost - 1));
+      if (calc_dti && pde_line_is_interior(dir, j, k)) {
+	l_max_dti = mrc_fld_max(l_max_dti, line_max_dti(l_W, l_bx, d_i, 0, ldim));
       }
+      fld1d_pencil_set_lane(pc_W, l, l_W, - (nghost - 1), ldim + (nghost - 1));
+      fld1d_pencil_set_lane_1(pc_bx, l, l_bx, - (nghost - 1), ldim + (nghost - 1));
+    }
+    mhd_pencil_reconstruct(pc_Ul, pc_Ur, pc_Wl, pc_Wr, pc_W, pc_bx, (fld1d_pencil_t) {},
+			   0, ldim + 1);
+    mhd_pencil_riemann(pc_F, pc_Ul, pc_Ur, pc_Wl, pc_Wr, 0, ldim + 1);
+    for (int l = 0; l < pde_pencil_n_lanes(dir, 1, l0); l++) {
+      int j, k;
+      pde_pencil_get_jk(dir, 1, l0, l, &j, &k);
+      fld1d_pencil_get_lane(l_F, pc_F, l, 0, ldim + 1);
+      mhd_put_line_state_fcons_ct(flux, l_F, j, k, dir, p, 0, ldim + 1);
     }
   }
 }
@@ -224,23 +335,45 @@ static void
 fluxes_corr(struct ggcm_mhd_step *step, struct mrc_fld *flux[3], struct mrc_fld *x, struct mrc_fld *B_cc)
 {
   struct ggcm_mhd_step_vlct *sub = ggcm_mhd_step_vlct(step);
-  fld1d_state_t U = sub->U, U_l = sub->U_l, U_r = sub->U_r;
-  fld1d_state_t W = sub->W, W_l = sub->W_l, W_r = sub->W_r;
-  fld1d_state_t F = sub->F;
-  fld1d_t bx = sub->bx;
+  mrc_fld_data_t d_i = step->mhd->par.d_i;
+  bool calc_dti = sub->dt_from_fluxes;
+
+  if (calc_dti) {
+#pragma omp parallel
+    l_max_dti = 0.;
+  }
 
   for (int p = 0; p < mrc_fld_nr_patches(x); p++) {
+    pde_patch_set(p);
     pde_for_each_dir(dir) {
       int ldim = s_ldims[dir];
-      pde_for_each_line(dir, j, k, 1) {
-	mhd_get_line_state_fcons_ct(U, bx, x, B_cc, j, k, dir, p, - (nghost - 1), ldim + (nghost - 1));
-	mhd_prim_from_cons(W, U, - (nghost - 1), ldim + (nghost - 1));
-	mhd_reconstruct(U_l, U_r, W_l, W_r, W, bx, 0, ldim + 1);
-	mhd_riemann(F, U_l, U_r, W_l, W_r, 0, ldim + 1);
-	mhd_put_line_state_fcons_ct(flux[dir], F, j, k, dir, p, 0, ldim + 1);
+      pde_line_set_dir(dir);
+      if (mhd_pencil_supported()) {
+	fluxes_corr_pencils(flux[dir], x, B_cc, dir, p, calc_dti, d_i);
+	continue;
+      }
+      pde_for_each_line_omp(dir, j, k, 1) {
+	mhd_get_line_state_fcons_ct(l_U, l_bx, x, B_cc, j, k, dir, p, - (nghost - 1), ldim + (nghost - 1));
+	mhd_prim_from_cons(l_W, l_U, - (nghost - 1), ldim + (nghost - 1));
+	if (calc_dti && pde_line_is_interior(dir, j, k)) {
+	  l_max_dti = mrc_fld_max(l_max_dti, line_max_dti(l_W, l_bx, d_i, 0, ldim));
+	}
+	mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, l_bx, 0, ldim + 1);
+	mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, 0, ldim + 1);
+	mhd_put_line_state_fcons_ct(flux[dir], l_F, j, k, dir, p, 0, ldim + 1);
       }
     }
   }
+
+  if (calc_dti) {
+    sub->max_dti = 0.;
+#pragma omp parallel
+    {
+#pragma omp critical
+      sub->max_dti = mrc_fld_max(sub->max_dti, l_max_dti);
+    }
+    sub->have_max_dti = true;
+  }
 }
 
 // ----------------------------------------------------------------------
@@ -254,18 +387,32 @@ ggcm_mhd_step_vlct_setup(struct ggcm_mhd_step *step)
 
   pde_mhd_setup(mhd, mrc_fld_nr_comps(mhd->fld));
 
-  fld1d_state_setup(&sub->U);
-  fld1d_state_setup(&sub->U_l);
-  fld1d_state_setup(&sub->U_r);
-  fld1d_state_setup(&sub->W);
-  fld1d_state_setup(&sub->W_l);
-  fld1d_state_setup(&sub->W_r);
-  fld1d_state_setup(&sub->F);
-  fld1d_setup(&sub->bx);
+#pragma omp parallel
+  if (!fld1d_state_is_setup(l_U)) {
+    fld1d_state_setup(&l_U);
+    fld1d_state_setup(&l_Ul);
+    fld1d_state_setup(&l_Ur);
+    fld1d_state_setup(&l_W);
+    fld1d_state_setup(&l_Wl);
+    fld1d_state_setup(&l_Wr);
+    fld1d_state_setup(&l_F);
+    fld1d_setup(&l_bx);
+
+    fld1d_pencil_setup(&pc_Ul, s_n_comps);
+    fld1d_pencil_setup(&pc_Ur, s_n_comps);
+    fld1d_pencil_setup(&pc_W, s_n_comps);
+    fld1d_pencil_setup(&pc_Wl, s_n_comps);
+    fld1d_pencil_setup(&pc_Wr, s_n_comps);
+    fld1d_pencil_setup(&pc_F, s_n_comps);
+    fld1d_pencil_setup(&pc_bx, 1);
+  }
+  pde_mhd_aux_setup();
 
   mhd->ymask = ggcm_mhd_get_3d_fld(mhd, 1);
   mrc_fld_set(mhd->ymask, 1.);
 
+  sub->B_cc = ggcm_mhd_get_3d_fld(mhd, 3);
+
   ggcm_mhd_step_setup_member_objs_sub(step);
 }
 
@@ -275,9 +422,11 @@ ggcm_mhd_step_vlct_setup(struct ggcm_mhd_step *step)
 static void
 ggcm_mhd_step_vlct_destroy(struct ggcm_mhd_step *step)
 {
+  struct ggcm_mhd_step_vlct *sub = ggcm_mhd_step_vlct(step);
   struct ggcm_mhd *mhd = step->mhd;
 
   ggcm_mhd_put_3d_fld(mhd, mhd->ymask);
+  ggcm_mhd_put_3d_fld(mhd, sub->B_cc);
 
   pde_free();
 }
@@ -406,7 +555,30 @@ compute_Ediffu_const(struct ggcm_mhd_step *step, struct mrc_fld *E_ec,
 static double
 ggcm_mhd_step_vlct_get_dt(struct ggcm_mhd_step *step, struct mrc_fld *x)
 {
-  return pde_mhd_get_dt(step->mhd, x);
+  struct ggcm_mhd_step_vlct *sub = ggcm_mhd_step_vlct(step);
+  struct ggcm_mhd *mhd = step->mhd;
+
+  // the wave speeds were found from the half-step state during the last
+  // corrector sweep, so all that's left to do is to agree on dt
+  if (sub->dt_from_fluxes && sub->have_max_dti) {
+    mrc_fld_data_t dt = mhd->par.thx / sub->max_dti;
+    mrc_fld_data_t dtn;
+    MPI_Allreduce(&dt, &dtn, 1, MPI_MRC_FLD_DATA_T, MPI_MIN, ggcm_mhd_comm(mhd));
+    return dtn;
+  }
+
+  if (s_opt_get_dt != OPT_GET_DT_MHD_CT) {
+    return pde_mhd_get_dt(mhd, x);
+  }
+
+  // fill ghosts and find B_cc as needed by run(), rather than just in the
+  // interior, so that run() doesn't have to redo it
+  ggcm_mhd_fill_ghosts(mhd, x, mhd->time_code);
+  compute_B_cc(sub->B_cc, x, 3, 3);
+  sub->cache_x = x;
+  sub->cache_time = mhd->time_code;
+
+  return pde_mhd_get_dt_fcons_ct_Bcc(mhd, x, sub->B_cc);
 }
 
 // ----------------------------------------------------------------------
@@ -417,7 +589,7 @@ ggcm_mhd_step_vlct_run(struct ggcm_mhd_step *step, struct mrc_fld *x)
 {
   struct ggcm_mhd_step_vlct *sub = ggcm_mhd_step_vlct(step);
   struct ggcm_mhd *mhd = step->mhd;
-  struct mrc_fld *B_cc = ggcm_mhd_get_3d_fld(mhd, 3);
+  struct mrc_fld *B_cc = sub->B_cc;
 
   ldims[0] = mrc_fld_spatial_dims(x)[0];
   ldims[1] = mrc_fld_spatial_dims(x)[1];
@@ -429,15 +601,18 @@ ggcm_mhd_step_vlct_run(struct ggcm_mhd_step *step, struct mrc_fld *x)
 			      ggcm_mhd_get_3d_fld(mhd, 8),
 			      ggcm_mhd_get_3d_fld(mhd, 8), };
 
-  // FIXME, this is done in get_dt, and redoing it could be avoided
-  ggcm_mhd_fill_ghosts(mhd, x, mhd->time_code);
+  // unless get_dt() just did it for this very state
+  bool cached = sub->cache_x == x && sub->cache_time == mhd->time_code;
+  sub->cache_x = NULL;
+  if (!cached) {
+    ggcm_mhd_fill_ghosts(mhd, x, mhd->time_code);
+    compute_B_cc(B_cc, x, 3, 3);
+  }
 
   mrc_fld_data_t dt = mhd->dt_code;
 
   // resistivity
 
-  // FIXME, this is done in get_dt, and redoing it could be avoided
-  compute_B_cc(B_cc, x, 3, 3);
   if (mhd->par.magdiffu == MAGDIFFU_CONST) {
     if (mhd->par.diffco > 0.) {
       compute_Ediffu_const(step, E_ec, x, B_cc);
@@ -526,7 +701,6 @@ ggcm_mhd_step_vlct_run(struct ggcm_mhd_step *step, struct mrc_fld *x)
 
   // clean up
 
-  ggcm_mhd_put_3d_fld(mhd, B_cc);
   ggcm_mhd_put_3d_fld(mhd, x_half);
   ggcm_mhd_put_3d_fld(mhd, E_ec);
   ggcm_mhd_put_3d_fld(mhd, flux[0]);
@@ -633,6 +807,7 @@ static struct param ggcm_mhd_step_vlct_descr[] = {
   { "background"         , VAR(opt.background)     , PARAM_BOOL(false)                          },
 
   { "debug_dump"         , VAR(debug_dump)         , PARAM_BOOL(false)                          },
+  { "dt_from_fluxes"     , VAR(dt_from_fluxes)     , PARAM_BOOL(false)                          },
   {},
 };
 #undef VAR
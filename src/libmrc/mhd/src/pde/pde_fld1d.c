@@ -196,3 +196,81 @@ fld1d_state_is_setup(fld1d_state_t f)
 #endif
 
 
+
+// ======================================================================
+// fld1d_pencil_t
+//
+// PDE_PENCIL_N 1d lines of n_comps mrc_fld_data_t each, stored with the
+// lines ("lanes") innermost, so that a loop over the lanes of F1P(f, m, i)
+// is unit stride and can be vectorized
+
+#ifndef PDE_PENCIL_N
+#define PDE_PENCIL_N 8
+#endif
+
+typedef struct {
+  mrc_fld_data_t *restrict arr;
+  int n_comps;
+} fld1d_pencil_t;
+
+// pointer to the PDE_PENCIL_N lanes of component m at i
+#define F1P(f, m, i) ((f).arr + ((i) * (f).n_comps + (m)) * PDE_PENCIL_N)
+
+static inline void
+fld1d_pencil_setup(fld1d_pencil_t *f, int n_comps)
+{
+  assert(!f->arr);
+
+  f->n_comps = n_comps;
+  f->arr = calloc(s_size_1d * n_comps * PDE_PENCIL_N, sizeof(*f->arr));
+  f->arr += s_n_ghosts * n_comps * PDE_PENCIL_N;
+}
+
+static inline bool
+fld1d_pencil_is_setup(fld1d_pencil_t f)
+{
+  return f.arr;
+}
+
+// ----------------------------------------------------------------------
+// fld1d_pencil_set_lane
+//
+// copies line f into lane l of the pencil
+
+static inline void _mrc_unused
+fld1d_pencil_set_lane(fld1d_pencil_t p, int l, fld1d_state_t f, int ib, int ie)
+{
+  for (int i = ib; i < ie; i++) {
+    for (int m = 0; m < p.n_comps; m++) {
+      F1P(p, m, i)[l] = F1S(f, m, i);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// fld1d_pencil_get_lane
+//
+// copies lane l of the pencil back into line f
+
+static inline void _mrc_unused
+fld1d_pencil_get_lane(fld1d_state_t f, fld1d_pencil_t p, int l, int ib, int ie)
+{
+  for (int i = ib; i < ie; i++) {
+    for (int m = 0; m < p.n_comps; m++) {
+      F1S(f, m, i) = F1P(p, m, i)[l];
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// fld1d_pencil_set_lane_1
+//
+// same as fld1d_pencil_set_lane(), for a single component pencil
+
+static inline void _mrc_unused
+fld1d_pencil_set_lane_1(fld1d_pencil_t p, int l, fld1d_t f, int ib, int ie)
+{
+  for (int i = ib; i < ie; i++) {
+    F1P(p, 0, i)[l] = F1(f, i);
+  }
+}
@@ -254,17 +254,20 @@ pde_mhd_get_dt_fcons(struct ggcm_mhd *mhd, struct mrc_fld *x_fld)
 
 #ifdef OPT_DIVB_CT
 
-// ----------------------------------------------------------------------
-// pde_mhd_get_dt_fcons_ct
+static void compute_B_cc(struct mrc_fld *B_cc, struct mrc_fld *x, int l, int r);
 
+// ----------------------------------------------------------------------
+// pde_mhd_get_dt_fcons_ct_Bcc
+//
 // FIXME, take into account resistivity
 // FIXME, rework
-
-static void compute_B_cc(struct mrc_fld *B_cc, struct mrc_fld *x, int l, int r);
-
+//
+// as pde_mhd_get_dt_fcons_ct(), but using a given cell-centered B (which
+// has to be valid in the interior), so that the caller can keep it around
 
 static mrc_fld_data_t _mrc_unused
-pde_mhd_get_dt_fcons_ct(struct ggcm_mhd *mhd, struct mrc_fld *x)
+pde_mhd_get_dt_fcons_ct_Bcc(struct ggcm_mhd *mhd, struct mrc_fld *x,
+			    struct mrc_fld *Bcc)
 {
   assert(s_opt_eqn == OPT_EQN_MHD_FCONS);
 
@@ -273,10 +276,6 @@ pde_mhd_get_dt_fcons_ct(struct ggcm_mhd *mhd, struct mrc_fld *x)
   mrc_fld_data_t gamma_m1 = s_gamma - 1.f;
   mrc_fld_data_t d_i = mhd->par.d_i;
 
-  struct mrc_fld *Bcc = ggcm_mhd_get_3d_fld(mhd, 3);
-  ggcm_mhd_fill_ghosts(mhd, x, mhd->time_code);
-  compute_B_cc(Bcc, x, 0, 0);
-
   mrc_fld_data_t max_dti_x = 0., max_dti_y = 0., max_dti_z = 0.;
   mrc_fld_data_t max_dti_diff = 0.;
 
@@ -329,6 +328,21 @@ pde_mhd_get_dt_fcons_ct(struct ggcm_mhd *mhd, struct mrc_fld *x)
   mrc_fld_data_t dtn;
   MPI_Allreduce(&dt, &dtn, 1, MPI_MRC_FLD_DATA_T, MPI_MIN, ggcm_mhd_comm(mhd));
 
+  return dtn;
+}
+
+// ----------------------------------------------------------------------
+// pde_mhd_get_dt_fcons_ct
+
+static mrc_fld_data_t _mrc_unused
+pde_mhd_get_dt_fcons_ct(struct ggcm_mhd *mhd, struct mrc_fld *x)
+{
+  struct mrc_fld *Bcc = ggcm_mhd_get_3d_fld(mhd, 3);
+  ggcm_mhd_fill_ghosts(mhd, x, mhd->time_code);
+  compute_B_cc(Bcc, x, 0, 0);
+
+  mrc_fld_data_t dtn = pde_mhd_get_dt_fcons_ct_Bcc(mhd, x, Bcc);
+
   ggcm_mhd_put_3d_fld(mhd, Bcc);
 
   return dtn;
@@ -0,0 +1,294 @@
+
+#ifndef PDE_MHD_PENCIL_C
+#define PDE_MHD_PENCIL_C
+
+#include "pde/pde_mhd_riemann.c"
+
+// ======================================================================
+// reconstruction and Riemann solve on pencils of lines
+//
+// The line sweeps handle one line at a time, and the state at each point
+// is just a handful of components, which leaves nothing for the compiler
+// to vectorize. The functions here do the same work for PDE_PENCIL_N lines
+// at once (see fld1d_pencil_t), with the pointwise kernels applied to all
+// lanes in a unit stride loop, which gcc vectorizes at -O3 given
+// -fno-math-errno -fno-trapping-math (neither changes the results).
+//
+// Only ideal MHD / hydro fluxes are handled, see mhd_pencil_supported().
+// Getting states into and fluxes out of a pencil is left to the stepper,
+// one lane at a time.
+//
+// reconstruct.c needs to be included before this file.
+
+// number of components, as a compile-time constant (for the steppers),
+// so that the loops over components unroll
+#define PENCIL_N_COMPS (s_opt_eqn == OPT_EQN_MHD_FCONS ? 8 : 5)
+
+// ----------------------------------------------------------------------
+// mhd_pencil_supported
+//
+// whether the current options can be handled by the pencil functions,
+// ie., no background field, Hall term or GLM divb cleaning
+
+static bool _mrc_unused
+mhd_pencil_supported()
+{
+  if (s_n_comps != PENCIL_N_COMPS ||
+      s_opt_background ||
+      s_opt_hall != OPT_HALL_NONE ||
+      s_opt_divb == OPT_DIVB_GLM) {
+    return false;
+  }
+
+  return (s_opt_riemann == OPT_RIEMANN_RUSANOV ||
+	  s_opt_riemann == OPT_RIEMANN_HLL ||
+	  (s_opt_riemann == OPT_RIEMANN_HLLD && s_opt_eqn == OPT_EQN_MHD_FCONS));
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_get_pt / mhd_pencil_put_pt
+//
+// state at i in lane l of the pencil
+
+static inline void
+mhd_pencil_get_pt(mrc_fld_data_t u[], fld1d_pencil_t U, int i, int l)
+{
+  for (int m = 0; m < PENCIL_N_COMPS; m++) {
+    u[m] = F1P(U, m, i)[l];
+  }
+}
+
+static inline void
+mhd_pencil_put_pt(fld1d_pencil_t U, mrc_fld_data_t u[], int i, int l)
+{
+  for (int m = 0; m < PENCIL_N_COMPS; m++) {
+    F1P(U, m, i)[l] = u[m];
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_cons_from_prim
+
+static void
+mhd_pencil_cons_from_prim(fld1d_pencil_t U, fld1d_pencil_t W, int ib, int ie)
+{
+  for (int i = ib; i < ie; i++) {
+    for (int l = 0; l < PDE_PENCIL_N; l++) {
+      mrc_fld_data_t u[PSI + 1], w[PSI + 1];
+      mhd_pencil_get_pt(w, W, i, l);
+      if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
+	mhd_pt_fcons_from_prim(u, w);
+      } else {
+	mhd_pt_scons_from_prim(u, w);
+      }
+      mhd_pencil_put_pt(U, u, i, l);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_set_bx
+//
+// replace the reconstructed BX by the face-centered bx, if given
+
+static void
+mhd_pencil_set_bx(fld1d_pencil_t Wl, fld1d_pencil_t Wr, fld1d_pencil_t bx,
+		  int ib, int ie)
+{
+  if (!fld1d_pencil_is_setup(bx)) {
+    return;
+  }
+
+  for (int i = ib; i < ie; i++) {
+    for (int l = 0; l < PDE_PENCIL_N; l++) {
+      F1P(Wl, BX, i)[l] = F1P(bx, 0, i)[l];
+      F1P(Wr, BX, i)[l] = F1P(bx, 0, i)[l];
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_reconstruct_pcm
+//
+// same as mhd_reconstruct_pcm()
+
+static void _mrc_unused
+mhd_pencil_reconstruct_pcm(fld1d_pencil_t Ul, fld1d_pencil_t Ur,
+			   fld1d_pencil_t Wl, fld1d_pencil_t Wr,
+			   fld1d_pencil_t W, fld1d_pencil_t bx, int ib, int ie)
+{
+  for (int i = ib; i < ie; i++) {
+    for (int m = 0; m < PENCIL_N_COMPS; m++) {
+      for (int l = 0; l < PDE_PENCIL_N; l++) {
+	F1P(Wl, m, i)[l] = F1P(W, m, i-1)[l];
+	F1P(Wr, m, i)[l] = F1P(W, m, i  )[l];
+      }
+    }
+  }
+
+  mhd_pencil_cons_from_prim(Ul, Wl, ib, ie);
+  mhd_pencil_cons_from_prim(Ur, Wr, ib, ie);
+
+  mhd_pencil_set_bx(Wl, Wr, bx, ib, ie);
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_reconstruct_plm_prim
+//
+// same as mhd_reconstruct_plm_prim(), but the bnd_mask (if given) is a
+// pencil rather than s_aux.bnd_mask
+
+static void
+mhd_pencil_reconstruct_plm_prim(fld1d_pencil_t Ul, fld1d_pencil_t Ur,
+				fld1d_pencil_t Wl, fld1d_pencil_t Wr,
+				fld1d_pencil_t W, fld1d_pencil_t bx,
+				fld1d_pencil_t bnd_mask, int ib, int ie)
+{
+  // at given i, all components of all lanes are contiguous, so the
+  // differences and limiting are done as a single loop over them
+  const int n = PENCIL_N_COMPS * PDE_PENCIL_N;
+
+  for (int i = ib - 1; i < ie; i++) {
+    mrc_fld_data_t *w = F1P(W, 0, i);
+    mrc_fld_data_t *wm = F1P(W, 0, i-1), *wp = F1P(W, 0, i+1);
+
+    // one-sided differences
+    mrc_fld_data_t dWm[(PSI + 1) * PDE_PENCIL_N], dWp[(PSI + 1) * PDE_PENCIL_N];
+    for (int k = 0; k < n; k++) {
+      dWm[k] = w[k] - wm[k];
+      dWp[k] = wp[k] - w[k];
+    }
+
+    // find limited slope
+    mrc_fld_data_t dW[(PSI + 1) * PDE_PENCIL_N];
+    limit_slope_n(dW, dWm, dWp, n);
+    if (fld1d_pencil_is_setup(bnd_mask)) {
+      // force constant reconstruction next to boundary
+      mrc_fld_data_t *mask = F1P(bnd_mask, 0, i);
+      for (int m = 0; m < PENCIL_N_COMPS; m++) {
+	for (int l = 0; l < PDE_PENCIL_N; l++) {
+	  dW[m * PDE_PENCIL_N + l] = mask[l] == 2.f ? 0.f : dW[m * PDE_PENCIL_N + l];
+	}
+      }
+    }
+
+    // l/r states based on limited slope
+    mrc_fld_data_t *wl = F1P(Wl, 0, i+1), *wr = F1P(Wr, 0, i);
+    for (int k = 0; k < n; k++) {
+      wl[k] = w[k] + .5f * dW[k];
+      wr[k] = w[k] - .5f * dW[k];
+    }
+  }
+
+  mhd_pencil_set_bx(Wl, Wr, bx, ib - 1, ie);
+
+  // set conservative states, too
+  mhd_pencil_cons_from_prim(Ul, Wl, ib, ie);
+  mhd_pencil_cons_from_prim(Ur, Wr, ib, ie);
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_reconstruct
+
+static void _mrc_unused
+mhd_pencil_reconstruct(fld1d_pencil_t Ul, fld1d_pencil_t Ur,
+		       fld1d_pencil_t Wl, fld1d_pencil_t Wr,
+		       fld1d_pencil_t W, fld1d_pencil_t bx,
+		       fld1d_pencil_t bnd_mask, int ib, int ie)
+{
+  if (s_opt_limiter == OPT_LIMITER_FLAT) {
+    mhd_pencil_reconstruct_pcm(Ul, Ur, Wl, Wr, W, bx, ib, ie);
+  } else {
+    mhd_pencil_reconstruct_plm_prim(Ul, Ur, Wl, Wr, W, bx, bnd_mask, ib, ie);
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_fluxes_pt / mhd_pencil_wavespeed_pt
+//
+// fluxes() / wavespeed() without the options that mhd_pencil_supported()
+// excludes
+
+static inline void
+mhd_pencil_fluxes_pt(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[])
+{
+  if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
+    fluxes_mhd_fcons_pt(F, U, W, 0.f, 0.f, 0.f);
+  } else if (s_opt_eqn == OPT_EQN_MHD_SCONS) {
+    fluxes_mhd_scons(F, U, W, 0);
+  } else {
+    fluxes_hd(F, U, W, 0);
+  }
+}
+
+static inline mrc_fld_data_t
+mhd_pencil_wavespeed_pt(mrc_fld_data_t U[], mrc_fld_data_t W[])
+{
+  if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
+    return wavespeed_mhd_fcons_pt(U, W, 0.f, 0.f, 0.f);
+  } else {
+    return wavespeed_mhd_scons(U, W, 0);
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_riemann
+//
+// same as mhd_riemann(), for the solvers that mhd_pencil_supported()
+// allows
+
+static void _mrc_unused
+mhd_pencil_riemann(fld1d_pencil_t F, fld1d_pencil_t Ul, fld1d_pencil_t Ur,
+		   fld1d_pencil_t Wl, fld1d_pencil_t Wr, int ib, int ie)
+{
+  const int n_comps = PENCIL_N_COMPS;
+
+  for (int i = ib; i < ie; i++) {
+    if (s_opt_riemann == OPT_RIEMANN_RUSANOV) {
+      for (int l = 0; l < PDE_PENCIL_N; l++) {
+	mrc_fld_data_t f[PSI + 1], ul[PSI + 1], ur[PSI + 1], wl[PSI + 1], wr[PSI + 1];
+	mrc_fld_data_t fl[PSI + 1], fr[PSI + 1];
+	mhd_pencil_get_pt(ul, Ul, i, l);
+	mhd_pencil_get_pt(ur, Ur, i, l);
+	mhd_pencil_get_pt(wl, Wl, i, l);
+	mhd_pencil_get_pt(wr, Wr, i, l);
+	mhd_pencil_fluxes_pt(fl, ul, wl);
+	mhd_pencil_fluxes_pt(fr, ur, wr);
+	fluxes_rusanov_pt(f, ul, ur, wl, wr, fl, fr, mhd_pencil_wavespeed_pt(ul, wl),
+			  mhd_pencil_wavespeed_pt(ur, wr), n_comps);
+	mhd_pencil_put_pt(F, f, i, l);
+      }
+    } else if (s_opt_riemann == OPT_RIEMANN_HLL) {
+      for (int l = 0; l < PDE_PENCIL_N; l++) {
+	mrc_fld_data_t f[PSI + 1], ul[PSI + 1], ur[PSI + 1], wl[PSI + 1], wr[PSI + 1];
+	mrc_fld_data_t fl[PSI + 1], fr[PSI + 1];
+	mhd_pencil_get_pt(ul, Ul, i, l);
+	mhd_pencil_get_pt(ur, Ur, i, l);
+	mhd_pencil_get_pt(wl, Wl, i, l);
+	mhd_pencil_get_pt(wr, Wr, i, l);
+	mhd_pencil_fluxes_pt(fl, ul, wl);
+	mhd_pencil_fluxes_pt(fr, ur, wr);
+	fluxes_hll_pt(f, ul, ur, wl, wr, fl, fr, mhd_pencil_wavespeed_pt(ul, wl),
+		      mhd_pencil_wavespeed_pt(ur, wr), n_comps);
+	mhd_pencil_put_pt(F, f, i, l);
+      }
+    } else if (s_opt_riemann == OPT_RIEMANN_HLLD) {
+      for (int l = 0; l < PDE_PENCIL_N; l++) {
+	mrc_fld_data_t f[PSI + 1], ul[PSI + 1], ur[PSI + 1], wl[PSI + 1], wr[PSI + 1];
+	mrc_fld_data_t fl[PSI + 1], fr[PSI + 1];
+	mhd_pencil_get_pt(ul, Ul, i, l);
+	mhd_pencil_get_pt(ur, Ur, i, l);
+	mhd_pencil_get_pt(wl, Wl, i, l);
+	mhd_pencil_get_pt(wr, Wr, i, l);
+	mhd_pencil_fluxes_pt(fl, ul, wl);
+	mhd_pencil_fluxes_pt(fr, ur, wr);
+	fluxes_hlld_pt(f, ul, ur, wl, wr, fl, fr, n_comps);
+	mhd_pencil_put_pt(F, f, i, l);
+      }
+    } else {
+      assert(0);
+    }
+  }
+}
+
+#endif
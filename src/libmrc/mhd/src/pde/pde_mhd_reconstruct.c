@@ -36,11 +36,9 @@ mhd_reconstruct_pcm(fld1d_state_t U_l, fld1d_state_t U_r,
 static inline mrc_fld_data_t
 minmod(mrc_fld_data_t a, mrc_fld_data_t b)
 {
-  if (a * b > 0.) {
-    return mrc_fld_abs(a) < mrc_fld_abs(b) ? a : b;
-  } else {
-    return 0.;
-  }
+  // written as selects, so that limiting the lanes of a pencil vectorizes
+  mrc_fld_data_t ab = mrc_fld_abs(a) < mrc_fld_abs(b) ? a : b;
+  return a * b > 0. ? ab : 0.;
 }
 
 // ----------------------------------------------------------------------
@@ -80,21 +78,24 @@ limit_gminmod(mrc_fld_data_t dWm, mrc_fld_data_t dWp)
 }
 
 // ----------------------------------------------------------------------
-// limit_slope
+// limit_slope_n
+//
+// limits the n slopes dWm[] / dWp[] element by element, which are the
+// components of a state for limit_slope(), or the lanes of a pencil
 
-static void
-limit_slope(mrc_fld_data_t dW[], mrc_fld_data_t dWm[], mrc_fld_data_t dWp[])
+static inline void
+limit_slope_n(mrc_fld_data_t dW[], mrc_fld_data_t dWm[], mrc_fld_data_t dWp[], int n)
 {
   if (s_opt_limiter == OPT_LIMITER_MINMOD) {
-    for (int m = 0; m < s_n_comps; m++) {
+    for (int m = 0; m < n; m++) {
       dW[m] = limit_minmod(dWm[m], dWp[m]);
     }
   } else if (s_opt_limiter == OPT_LIMITER_MC) {
-    for (int m = 0; m < s_n_comps; m++) {
+    for (int m = 0; m < n; m++) {
       dW[m] = limit_mc(dWm[m], dWp[m]);
     }
   } else if (s_opt_limiter == OPT_LIMITER_GMINMOD) {
-    for (int m = 0; m < s_n_comps; m++) {
+    for (int m = 0; m < n; m++) {
       dW[m] = limit_gminmod(dWm[m], dWp[m]);
     }
   } else {
@@ -102,6 +103,15 @@ limit_slope(mrc_fld_data_t dW[], mrc_fld_data_t dWm[], mrc_fld_data_t dWp[])
   }
 }
 
+// ----------------------------------------------------------------------
+// limit_slope
+
+static void
+limit_slope(mrc_fld_data_t dW[], mrc_fld_data_t dWm[], mrc_fld_data_t dWp[])
+{
+  limit_slope_n(dW, dWm, dWp, s_n_comps);
+}
+
 // ----------------------------------------------------------------------
 // reconstruct_plm_prim
 //
@@ -5,21 +5,20 @@
 #include "pde/pde_mhd_divb_glm.c"
 
 // FIXME, at least uppercase
-#define sign(x) (( x > 0. ) - ( x < 0. ))
+// (selects rather than int arithmetic on the comparisons, so that hlld
+// still vectorizes on pencils)
+#define sign(x) ((( x > 0. ) ? 1. : 0.) - (( x < 0. ) ? 1. : 0.))
 
 // ----------------------------------------------------------------------
-// fluxes_mhd_fcons
+// fluxes_mhd_fcons_pt
+//
+// ideal MHD fluxes for a given background field B0, without Hall or GLM
+// terms, so there's no branching (shared with the pencil solvers)
 
 static inline void
-fluxes_mhd_fcons(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[], int i)
+fluxes_mhd_fcons_pt(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[],
+		    mrc_fld_data_t B0X, mrc_fld_data_t B0Y, mrc_fld_data_t B0Z)
 {
-  mrc_fld_data_t B0X, B0Y, B0Z;
-  if (s_opt_background) {
-    mrc_fld_data_t *B0 = &F1V(s_aux.b0, 0, i);
-    B0X = B0[0]; B0Y = B0[1]; B0Z = B0[2];
-  } else {
-    B0X = B0Y = B0Z = 0.f;
-  }
   mrc_fld_data_t BTX = B0X + W[BX], BTY = B0Y + W[BY], BTZ = B0Z + W[BZ];
   mrc_fld_data_t b2 = sqr(W[BX]) + sqr(W[BY]) + sqr(W[BZ]);
   mrc_fld_data_t ptot = W[PP] + s_mu0_inv * (.5f * b2 + B0X*W[BX] + B0Y*W[BY] + B0Z*W[BZ]);
@@ -33,7 +32,24 @@ fluxes_mhd_fcons(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[], int
   F[BX] = 0;
   F[BY]  = W[VX] * BTY - W[VY] * BTX;
   F[BZ]  = W[VX] * BTZ - W[VZ] * BTX; 
+}
+
+// ----------------------------------------------------------------------
+// fluxes_mhd_fcons
+
+static inline void
+fluxes_mhd_fcons(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[], int i)
+{
+  mrc_fld_data_t B0X, B0Y, B0Z;
+  if (s_opt_background) {
+    mrc_fld_data_t *B0 = &F1V(s_aux.b0, 0, i);
+    B0X = B0[0]; B0Y = B0[1]; B0Z = B0[2];
+  } else {
+    B0X = B0Y = B0Z = 0.f;
+  }
+  fluxes_mhd_fcons_pt(F, U, W, B0X, B0Y, B0Z);
 
+  mrc_fld_data_t BTX = B0X + W[BX], BTY = B0Y + W[BY], BTZ = B0Z + W[BZ];
   if (s_opt_hall == OPT_HALL_CONST) {
     mrc_fld_data_t *j = &F1V(s_aux.j, 0, i);
     F[BY] -= s_d_i * (j[0] * BTY - j[1] * BTX);
@@ -96,6 +112,28 @@ fluxes(mrc_fld_data_t F[], mrc_fld_data_t U[], mrc_fld_data_t W[], int i)
   }
 }
 
+// ----------------------------------------------------------------------
+// wavespeed_mhd_fcons_pt
+//
+// calculate speed of fastest (fast magnetosonic) wave for a given
+// background field B0, without the Hall (whistler) correction
+
+static inline mrc_fld_data_t
+wavespeed_mhd_fcons_pt(mrc_fld_data_t U[], mrc_fld_data_t W[],
+		       mrc_fld_data_t B0X, mrc_fld_data_t B0Y, mrc_fld_data_t B0Z)
+{
+  mrc_fld_data_t BTX = B0X + W[BX], BTY = B0Y + W[BY], BTZ = B0Z + W[BZ];
+
+  // OPT: 1/rr can be factored out, and inner square root can be written in terms
+  // of By^2 + Bz^2
+  mrc_fld_data_t cs2 = s_gamma * W[PP] / W[RR];
+  mrc_fld_data_t bt2 = sqr(BTX) + sqr(BTY) + sqr(BTZ);
+  mrc_fld_data_t vA2 = bt2 / W[RR] * s_mu0_inv; 
+  mrc_fld_data_t cf2 = .5f * (cs2 + vA2 + 
+			      mrc_fld_sqrt(sqr(vA2 + cs2) - (4.f * cs2 * s_mu0_inv * sqr(BTX) / W[RR])));
+  return mrc_fld_sqrt(cf2);
+}
+
 // ----------------------------------------------------------------------
 // wavespeed_mhd_fcons
 //
@@ -112,23 +150,17 @@ wavespeed_mhd_fcons(mrc_fld_data_t U[], mrc_fld_data_t W[], int i)
   } else {
     B0X = B0Y = B0Z = 0.f;
   }
-  mrc_fld_data_t BTX = B0X + W[BX], BTY = B0Y + W[BY], BTZ = B0Z + W[BZ];
-
-  // OPT: 1/rr can be factored out, and inner square root can be written in terms
-  // of By^2 + Bz^2
-  mrc_fld_data_t cs2 = s_gamma * W[PP] / W[RR];
-  mrc_fld_data_t bt2 = sqr(BTX) + sqr(BTY) + sqr(BTZ);
-  mrc_fld_data_t vA2 = bt2 / W[RR] * s_mu0_inv; 
-  mrc_fld_data_t cf2 = .5f * (cs2 + vA2 + 
-			      mrc_fld_sqrt(sqr(vA2 + cs2) - (4.f * cs2 * s_mu0_inv * sqr(BTX) / W[RR])));
-  mrc_fld_data_t cf = mrc_fld_sqrt(cf2);
-
-  if (s_opt_hall == OPT_HALL_CONST) {
-    mrc_fld_data_t cw = s_d_i * mrc_fld_sqrt(bt2) * s_mu0_inv * M_PI * PDE_INV_DS(i);
-    cf += cw;
-  } else if (s_opt_hall == OPT_HALL_YES) {
-    mrc_fld_data_t cw = s_d_i / W[RR] * mrc_fld_sqrt(bt2) * s_mu0_inv * M_PI * PDE_INV_DS(i);
-    cf += cw;
+  mrc_fld_data_t cf = wavespeed_mhd_fcons_pt(U, W, B0X, B0Y, B0Z);
+
+  if (s_opt_hall != OPT_HALL_NONE) {
+    mrc_fld_data_t bt2 = sqr(B0X + W[BX]) + sqr(B0Y + W[BY]) + sqr(B0Z + W[BZ]);
+    if (s_opt_hall == OPT_HALL_CONST) {
+      mrc_fld_data_t cw = s_d_i * mrc_fld_sqrt(bt2) * s_mu0_inv * M_PI * PDE_INV_DS(i);
+      cf += cw;
+    } else if (s_opt_hall == OPT_HALL_YES) {
+      mrc_fld_data_t cw = s_d_i / W[RR] * mrc_fld_sqrt(bt2) * s_mu0_inv * M_PI * PDE_INV_DS(i);
+      cf += cw;
+    }
   }
 
   return cf;
@@ -162,52 +194,96 @@ wavespeed(mrc_fld_data_t U[], mrc_fld_data_t W[], int i)
 }
 
 // ----------------------------------------------------------------------
-// fluxes_rusanov
+// fluxes_rusanov_pt
+//
+// Rusanov flux from the left / right fluxes and fast speeds, for the first
+// n_comps components
 //
 // FIXME? scons/hydro do things weirdly, IIRC to match what original OpenGGCM
 // is doing.
 
-static void
-fluxes_rusanov(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
-	       mrc_fld_data_t Wl[], mrc_fld_data_t Wr[], int i)
+static inline void
+fluxes_rusanov_pt(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
+		  mrc_fld_data_t Wl[], mrc_fld_data_t Wr[],
+		  mrc_fld_data_t Fl[], mrc_fld_data_t Fr[],
+		  mrc_fld_data_t cf_l, mrc_fld_data_t cf_r, int n_comps)
 {
-  mrc_fld_data_t Fl[s_n_comps], Fr[s_n_comps];
-  mrc_fld_data_t cf, c_l, c_r, c_max;
+  mrc_fld_data_t c_l, c_r, c_max;
 
-  cf = wavespeed(Ul, Wl, i);
   if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
-    mrc_fld_data_t cp_l = Wl[VX] + cf;
-    mrc_fld_data_t cm_l = Wl[VX] - cf; 
-    c_l = mrc_fld_max(mrc_fld_abs(cm_l), mrc_fld_abs(cp_l)); 
+    mrc_fld_data_t cp_l = Wl[VX] + cf_l;
+    mrc_fld_data_t cm_l = Wl[VX] - cf_l; 
+    c_l = MAX(mrc_fld_abs(cm_l), mrc_fld_abs(cp_l)); 
   } else if (s_opt_eqn == OPT_EQN_MHD_SCONS ||
 	     s_opt_eqn == OPT_EQN_HD) {
     mrc_fld_data_t vv = sqr(Wl[VX]) + sqr(Wl[VY]) + sqr(Wl[VZ]);
-    c_l = sqrtf(vv) + cf;
+    c_l = sqrtf(vv) + cf_l;
   }
 
-  cf = wavespeed(Ur, Wr, i);
   if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
-    mrc_fld_data_t cp_r = Wr[VX] + cf;
-    mrc_fld_data_t cm_r = Wr[VX] - cf; 
-    c_r = mrc_fld_max(mrc_fld_abs(cm_r), mrc_fld_abs(cp_r)); 
+    mrc_fld_data_t cp_r = Wr[VX] + cf_r;
+    mrc_fld_data_t cm_r = Wr[VX] - cf_r; 
+    c_r = MAX(mrc_fld_abs(cm_r), mrc_fld_abs(cp_r)); 
   } else if (s_opt_eqn == OPT_EQN_MHD_SCONS ||
 	     s_opt_eqn == OPT_EQN_HD) {
     mrc_fld_data_t vv = sqr(Wr[VX]) + sqr(Wr[VY]) + sqr(Wr[VZ]);
-    c_r = sqrtf(vv) + cf;
+    c_r = sqrtf(vv) + cf_r;
   }
 
   if (s_opt_eqn == OPT_EQN_MHD_FCONS) {
-    c_max = mrc_fld_max(c_l, c_r);
+    c_max = MAX(c_l, c_r);
   } else if (s_opt_eqn == OPT_EQN_MHD_SCONS ||
 	     s_opt_eqn == OPT_EQN_HD) {
     c_max = .5 * (c_l + c_r);
   }
 
+  for (int m = 0; m < n_comps; m++) {
+    F[m] = .5f * (Fl[m] + Fr[m] - c_max * (Ur[m] - Ul[m]));
+  }
+}
+
+// ----------------------------------------------------------------------
+// fluxes_rusanov
+
+static void
+fluxes_rusanov(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
+	       mrc_fld_data_t Wl[], mrc_fld_data_t Wr[], int i)
+{
+  mrc_fld_data_t Fl[s_n_comps], Fr[s_n_comps];
+
+  mrc_fld_data_t cf_l = wavespeed(Ul, Wl, i);
+  mrc_fld_data_t cf_r = wavespeed(Ur, Wr, i);
   fluxes(Fl, Ul, Wl, i);
   fluxes(Fr, Ur, Wr, i);
 
-  for (int m = 0; m < s_n_comps; m++) {
-    F[m] = .5f * (Fl[m] + Fr[m] - c_max * (Ur[m] - Ul[m]));
+  fluxes_rusanov_pt(F, Ul, Ur, Wl, Wr, Fl, Fr, cf_l, cf_r, s_n_comps);
+}
+
+// ----------------------------------------------------------------------
+// fluxes_hll_pt
+//
+// HLL flux from the left / right fluxes and fast speeds, for the first
+// n_comps components
+
+static inline void
+fluxes_hll_pt(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
+	      mrc_fld_data_t Wl[], mrc_fld_data_t Wr[],
+	      mrc_fld_data_t Fl[], mrc_fld_data_t Fr[],
+	      mrc_fld_data_t cf_l, mrc_fld_data_t cf_r, int n_comps)
+{
+  mrc_fld_data_t cp_l = Wl[VX] + cf_l;
+  mrc_fld_data_t cm_l = Wl[VX] - cf_l;
+
+  mrc_fld_data_t cp_r = Wr[VX] + cf_r;
+  mrc_fld_data_t cm_r = Wr[VX] - cf_r;
+
+  // MIN/MAX rather than fmin/fmax, so that the pencil loops vectorize
+  mrc_fld_data_t c_l = MIN(cm_l, cm_r), c_r = MAX(cp_l, cp_r);
+  c_l = MIN(c_l, 0.);
+  c_r = MAX(c_r, 0.);
+
+  for (int m = 0; m < n_comps; m++) {
+    F[m] = ((c_r * Fl[m] - c_l * Fr[m]) + (c_r * c_l * (Ur[m] - Ul[m]))) / (c_r - c_l);
   }
 }
 
@@ -219,25 +295,13 @@ fluxes_hll(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
 	   mrc_fld_data_t Wl[], mrc_fld_data_t Wr[], int i)
 {
   mrc_fld_data_t Fl[s_n_comps], Fr[s_n_comps];
-  mrc_fld_data_t cf;
-
-  cf = wavespeed(Ul, Wl, i);
-  mrc_fld_data_t cp_l = Wl[VX] + cf;
-  mrc_fld_data_t cm_l = Wl[VX] - cf;
-
-  cf = wavespeed(Ur, Wr, i);
-  mrc_fld_data_t cp_r = Wr[VX] + cf;
-  mrc_fld_data_t cm_r = Wr[VX] - cf;
-
-  mrc_fld_data_t c_l =  mrc_fld_min(mrc_fld_min(cm_l, cm_r), 0.);
-  mrc_fld_data_t c_r =  mrc_fld_max(mrc_fld_max(cp_l, cp_r), 0.);
 
+  mrc_fld_data_t cf_l = wavespeed(Ul, Wl, i);
+  mrc_fld_data_t cf_r = wavespeed(Ur, Wr, i);
   fluxes(Fl, Ul, Wl, i);
   fluxes(Fr, Ur, Wr, i);
 
-  for (int m = 0; m < s_n_comps; m++) {
-    F[m] = ((c_r * Fl[m] - c_l * Fr[m]) + (c_r * c_l * (Ur[m] - Ul[m]))) / (c_r - c_l);
-  }
+  fluxes_hll_pt(F, Ul, Ur, Wl, Wr, Fl, Fr, cf_l, cf_r, s_n_comps);
 }
 
 // ----------------------------------------------------------------------
@@ -307,7 +371,7 @@ fluxes_hllc(mrc_fld_data_t F[5], mrc_fld_data_t Ul[5], mrc_fld_data_t Ur[5],
 // ----------------------------------------------------------------------
 // hlld_calc_state_s
 
-static void
+static inline void
 hlld_calc_state_s(mrc_fld_data_t Ws[], mrc_fld_data_t U[], mrc_fld_data_t W[], 
 		  mrc_fld_data_t S, mrc_fld_data_t SM, mrc_fld_data_t sPt, 
 		  mrc_fld_data_t SmU)
@@ -337,17 +401,18 @@ hlld_calc_state_s(mrc_fld_data_t Ws[], mrc_fld_data_t U[], mrc_fld_data_t W[],
 
 
 // ----------------------------------------------------------------------
-// fluxes_hlld
+// fluxes_hlld_pt
 // 
 // Miyoshi & Kusano (2005)
+//
+// HLLD flux from the left / right states and fluxes, for the first n_comps
+// components
 
-static void
-fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
-	    mrc_fld_data_t Wl[], mrc_fld_data_t Wr[], int i)
+static inline void
+fluxes_hlld_pt(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
+	       mrc_fld_data_t Wl[], mrc_fld_data_t Wr[],
+	       mrc_fld_data_t Fl[], mrc_fld_data_t Fr[], int n_comps)
 {
-  assert(s_opt_eqn == OPT_EQN_MHD_FCONS);
-
-    mrc_fld_data_t Fl[s_n_comps], Fr[s_n_comps];
     mrc_fld_data_t bb, cs2, as2, cf;
     
     bb = sqr(Wl[BX]) + sqr(Wl[BY]) + sqr(Wl[BZ]);
@@ -356,7 +421,6 @@ fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
     cf = sqrtf(.5 * (cs2 + as2 + sqrtf(sqr(as2 + cs2)
 				       - (4. * sqr(sqrt(cs2) * Wl[BX]) / Wl[RR]))));       
     
-    fluxes(Fl, Ul, Wl, i);
     mrc_fld_data_t cpv_l = Wl[VX] + cf;
     mrc_fld_data_t cmv_l = Wl[VX] - cf; 
     
@@ -366,11 +430,12 @@ fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
     cf = sqrtf(.5 * (cs2 + as2 + sqrtf(sqr(as2 + cs2)
 				       - (4. * sqr(sqrt(cs2) * Wr[BX]) / Wr[RR]))));     
     
-    fluxes(Fr, Ur, Wr, i);
     mrc_fld_data_t cpv_r = Wr[VX] + cf;
     mrc_fld_data_t cmv_r = Wr[VX] - cf;     
-    mrc_fld_data_t SR =  fmaxf(fmaxf(cpv_l, cpv_r), 0.); 
-    mrc_fld_data_t SL =  fminf(fminf(cmv_l, cmv_r), 0.);     
+    // in single precision, as when this used fmaxf() / fminf()
+    float SR = MAX((float) cpv_l, (float) cpv_r), SL = MIN((float) cmv_l, (float) cmv_r);
+    SR = MAX(SR, 0.f);
+    SL = MIN(SL, 0.f);
     mrc_fld_data_t SRmUR = SR - Wr[VX];
     mrc_fld_data_t SLmUL = SL - Wl[VX];
     
@@ -384,8 +449,8 @@ fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
 			 Wl[RR] * Wr[RR] * SRmUR * SLmUL * (Wr[VX] - Wl[VX])) / 
       (SRmUR * Wr[RR] - SLmUL * Wl[RR]);
     
-    mrc_fld_data_t Urs[s_n_comps], Uls[s_n_comps], Wls[s_n_comps], Wrs[s_n_comps]; 
-    mrc_fld_data_t Urss[s_n_comps], Ulss[s_n_comps], Wlss[s_n_comps], Wrss[s_n_comps];
+    mrc_fld_data_t Urs[PSI + 1], Uls[PSI + 1], Wls[PSI + 1], Wrs[PSI + 1]; 
+    mrc_fld_data_t Urss[PSI + 1], Ulss[PSI + 1], Wlss[PSI + 1], Wrss[PSI + 1];
     
     hlld_calc_state_s(Wls, Ul, Wl, SL, SM, sPt, SLmUL);
     hlld_calc_state_s(Wrs, Ur, Wr, SR, SM, sPt, SRmUR);
@@ -393,6 +458,10 @@ fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
     // MK eq. 49 
     Wlss[RR] = Wls[RR];
     Wrss[RR] = Wrs[RR];
+
+    // MK eq. 39, and Bx is continuous (both needed for vbss below)
+    Wlss[VX] = Wrss[VX] = SM;
+    Wlss[BX] = Wrss[BX] = Wls[BX];
     
     // MK eq. 50 
     mrc_fld_data_t ssPt _mrc_unused = sPt; // FIXME!!!
@@ -464,23 +533,36 @@ fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
     mrc_fld_data_t SLs = SM - fabs(Wl[BX]) / sqrt(Wls[RR]) ; 
     mrc_fld_data_t SRs = SM + fabs(Wr[BX]) / sqrt(Wrs[RR]) ;
         
-    for (int m = 0; m < s_n_comps; m++) {
-      if ( SL > 0 ) {
-	F[m] = Fl[m];
-      } else if (( SL <= 0 ) && ( SLs >= 0 )) {  
-	F[m] = Fl[m] + (SL * (Uls[m] - Ul[m]));
-      } else if (( SLs <= 0 ) && ( SM >= 0 )) { 
-	F[m] = Fl[m] + SLs * Ulss[m] - (SLs - SL) * Uls[m] - SL * Ul[m];
-      } else if (( SRs >= 0 ) && ( SM <= 0 )) {
-	F[m] = Fr[m] + SRs * Urss[m] - (SRs - SR) * Urs[m] - SR * Ur[m];
-      } else if (( SRs <= 0 ) && ( SR >= 0 )) {
-	F[m] = Fr[m] + (SR * (Urs[m] - Ur[m]));
-      } else if ( SR < 0 ) { 	  
-	F[m] = Fr[m];
-      } else {
-	assert(0);
-      }
-    }		      
+    // for anything but NaN speeds, this picks the same as the chain of
+    // if ( SL > 0 ), else if (( SL <= 0 ) && ( SLs >= 0 )), ..., written as
+    // a sequence of selects, the last one that applies taking precedence
+#pragma GCC unroll 8
+    for (int m = 0; m < n_comps; m++) {
+      mrc_fld_data_t f = Fr[m];
+      f = ( SR >= 0 ) ? Fr[m] + (SR * (Urs[m] - Ur[m])) : f;
+      f = ( SRs >= 0 ) ? Fr[m] + SRs * Urss[m] - (SRs - SR) * Urs[m] - SR * Ur[m] : f;
+      f = ( SM >= 0 ) ? Fl[m] + SLs * Ulss[m] - (SLs - SL) * Uls[m] - SL * Ul[m] : f;
+      f = ( SLs >= 0 ) ? Fl[m] + (SL * (Uls[m] - Ul[m])) : f;
+      f = ( SL > 0 ) ? Fl[m] : f;
+      F[m] = f;
+    }
+}
+
+// ----------------------------------------------------------------------
+// fluxes_hlld
+
+static void
+fluxes_hlld(mrc_fld_data_t F[], mrc_fld_data_t Ul[], mrc_fld_data_t Ur[],
+	    mrc_fld_data_t Wl[], mrc_fld_data_t Wr[], int i)
+{
+  assert(s_opt_eqn == OPT_EQN_MHD_FCONS);
+
+  mrc_fld_data_t Fl[s_n_comps], Fr[s_n_comps];
+
+  fluxes(Fl, Ul, Wl, i);
+  fluxes(Fr, Ur, Wr, i);
+
+  fluxes_hlld_pt(F, Ul, Ur, Wl, Wr, Fl, Fr, s_n_comps);
 }
 
 // ----------------------------------------------------------------------
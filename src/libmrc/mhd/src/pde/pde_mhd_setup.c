@@ -678,7 +678,8 @@ pde_mhd_setup(struct ggcm_mhd *mhd, int n_comps)
 // ======================================================================
 // mhd auxiliary fields
 //
-// kept around statically so we don't have to pass all this crap
+// kept around statically so we don't have to pass all this crap.
+// These are per line, so every thread sweeping lines has its own copy.
 
 struct mhd_aux {
   // background B field
@@ -690,13 +691,17 @@ struct mhd_aux {
 };
 
 static struct mhd_aux s_aux;
+#pragma omp threadprivate(s_aux)
 
 static void _mrc_unused
 pde_mhd_aux_setup()
 {
-  fld1d_setup(&s_aux.bnd_mask);
-  fld1d_vec_setup(&s_aux.j);
-  fld1d_vec_setup(&s_aux.b0);
+#pragma omp parallel
+  if (!fld1d_is_setup(s_aux.bnd_mask)) {
+    fld1d_setup(&s_aux.bnd_mask);
+    fld1d_vec_setup(&s_aux.j);
+    fld1d_vec_setup(&s_aux.b0);
+  }
 }
 
 // ----------------------------------------------------------------------
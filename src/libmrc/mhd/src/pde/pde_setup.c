@@ -261,6 +261,101 @@ pde_line_set_dir(int dir)
   for (*_i2 = _i2b; *_i2 < _i2e; (*_i2)++)				\
     for (*_i1 = _i1b; *_i1 < _i1e; (*_i1)++)
 
+// ----------------------------------------------------------------------
+// pde_line_count
+
+static inline int _mrc_unused
+pde_line_count(int dir, int sw)
+{
+  int d1 = dir == 0 ? 1 : 0, d2 = dir == 2 ? 1 : 2;
+  int n1 = s_ldims[d1] + (s_sw[d1] ? 2 * sw : 0);
+  int n2 = s_ldims[d2] + (s_sw[d2] ? 2 * sw : 0);
+  return n1 * n2;
+}
+
+// ----------------------------------------------------------------------
+// pde_line_get_jk
+//
+// finds (j, k) of the l-th line visited by pde_for_each_line(dir, j, k, sw)
+
+static inline int _mrc_unused
+pde_line_get_jk(int dir, int sw, int l, int *j, int *k)
+{
+  int d1 = dir == 0 ? 1 : 0, d2 = dir == 2 ? 1 : 2;
+  int n1 = s_ldims[d1] + (s_sw[d1] ? 2 * sw : 0);
+  int i1 = l % n1 - (s_sw[d1] ? sw : 0);
+  int i2 = l / n1 - (s_sw[d2] ? sw : 0);
+  if (dir == 1) {
+    *k = i1; *j = i2;
+  } else {
+    *j = i1; *k = i2;
+  }
+  return 1;
+}
+
+// ----------------------------------------------------------------------
+// pde_line_is_interior
+//
+// whether line (j, k) of pde_for_each_line(dir, ...) is not a ghost line
+
+static inline bool _mrc_unused
+pde_line_is_interior(int dir, int j, int k)
+{
+  int d1 = dir == 0 ? 1 : 0, d2 = dir == 2 ? 1 : 2;
+  int i1 = dir == 1 ? k : j, i2 = dir == 1 ? j : k;
+  return (i1 >= 0 && i1 < s_ldims[d1] && i2 >= 0 && i2 < s_ldims[d2]);
+}
+
+// ----------------------------------------------------------------------
+// pde_for_each_line_omp
+//
+// same lines as pde_for_each_line, but distributed over OpenMP threads.
+// The body must only use per-thread (threadprivate) line scratch, which is
+// fine as long as it writes nothing but its own line of the output.
+
+#define pde_for_each_line_omp(dir, j, k, sw)				\
+  _Pragma("omp parallel for schedule(static)")				\
+  for (int _l = 0; _l < pde_line_count(dir, sw); _l++)			\
+    for (int j, k, _once = pde_line_get_jk(dir, sw, _l, &j, &k);	\
+	 _once; _once = 0)
+
+// ----------------------------------------------------------------------
+// pde_for_each_pencil_omp
+//
+// same lines as pde_for_each_line, but in pencils of PDE_PENCIL_N lines
+// (lanes) starting at line l0, with the pencils distributed over OpenMP
+// threads. The rules for the body are the same as for
+// pde_for_each_line_omp.
+
+#define pde_for_each_pencil_omp(dir, l0, sw)				\
+  _Pragma("omp parallel for schedule(static)")				\
+  for (int l0 = 0; l0 < pde_line_count(dir, sw); l0 += PDE_PENCIL_N)
+
+// ----------------------------------------------------------------------
+// pde_pencil_n_lanes
+//
+// number of lanes of the pencil starting at l0 that are actual lines, the
+// last pencil may be partially filled
+
+static inline int _mrc_unused
+pde_pencil_n_lanes(int dir, int sw, int l0)
+{
+  return MIN(PDE_PENCIL_N, pde_line_count(dir, sw) - l0);
+}
+
+// ----------------------------------------------------------------------
+// pde_pencil_get_jk
+//
+// finds (j, k) of the line in lane l of the pencil starting at l0. Lanes
+// past the last line repeat it, so that a partial pencil can be processed
+// like a full one, as long as those lanes aren't written back.
+
+static inline void _mrc_unused
+pde_pencil_get_jk(int dir, int sw, int l0, int l, int *j, int *k)
+{
+  pde_line_get_jk(dir, sw, MIN(l0 + l, pde_line_count(dir, sw) - 1), j, k);
+}
+
 
 #endif
 
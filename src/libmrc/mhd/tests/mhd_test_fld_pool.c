@@ -0,0 +1,137 @@
+
+#include <ggcm_mhd_private.h>
+#include <ggcm_mhd_diag.h>
+
+#include <mrc_domain.h>
+#include <mrc_fld_as_double.h>
+
+#include <stdio.h>
+#include <assert.h>
+
+// ======================================================================
+// ggcm_mhd subclass "test"
+
+// ----------------------------------------------------------------------
+// ggcm_mhd_test_create
+
+static void
+ggcm_mhd_test_create(struct ggcm_mhd *mhd)
+{
+  ggcm_mhd_default_box(mhd);
+}
+
+// ----------------------------------------------------------------------
+// ggcm_mhd_test_ops
+
+static struct ggcm_mhd_ops ggcm_mhd_test_ops = {
+  .name             = "test",
+  .create           = ggcm_mhd_test_create,
+};
+
+// ----------------------------------------------------------------------
+// check_zero
+
+static void
+check_zero(struct mrc_fld *f)
+{
+  struct mrc_fld *fld = mrc_fld_get_as(f, FLD_TYPE);
+  for (int p = 0; p < mrc_fld_nr_patches(fld); p++) {
+    for (int m = 0; m < mrc_fld_nr_comps(fld); m++) {
+      mrc_fld_foreach(fld, ix,iy,iz, fld->_nr_ghosts, fld->_nr_ghosts) {
+	assert(M3(fld, m, ix,iy,iz, p) == 0.);
+      } mrc_fld_foreach_end;
+    }
+  }
+  mrc_fld_put_as(fld, f);
+}
+
+// ----------------------------------------------------------------------
+// test_fld_pool
+//
+// fields that have been put are handed out again (zeroed) for a matching
+// nr_comps, and new ones are only created when nothing matches. Setup may
+// have used the pool already, so only changes in its counters are checked.
+
+static void
+test_fld_pool(struct ggcm_mhd *mhd)
+{
+  struct ggcm_mhd_fld_pool *pool = &mhd->fld_pool;
+  int nr_comps_new = 17; // not used by anything else
+  int nr_gets = pool->nr_gets;
+  size_t bytes_in_use = pool->bytes_in_use;
+
+  struct mrc_fld *f1 = ggcm_mhd_get_3d_fld(mhd, 1);
+  struct mrc_fld *f3 = ggcm_mhd_get_3d_fld(mhd, 3);
+  assert(mrc_fld_nr_comps(f1) == 1);
+  assert(mrc_fld_nr_comps(f3) == 3);
+  check_zero(f1);
+  check_zero(f3);
+  size_t bytes1 = (size_t) mrc_fld_len(f1) * f1->_nd->size_of_type;
+  assert(pool->bytes_in_use == bytes_in_use + 4 * bytes1);
+  assert(pool->bytes_high_water >= pool->bytes_in_use);
+
+  mrc_fld_set(f1, 1.);
+  mrc_fld_set(f3, 3.);
+  ggcm_mhd_put_3d_fld(mhd, f1);
+  ggcm_mhd_put_3d_fld(mhd, f3);
+  assert(pool->bytes_in_use == bytes_in_use);
+  int nr_free = pool->nr_free;
+  int nr_allocs = pool->nr_allocs;
+  size_t bytes_total = pool->bytes_total;
+
+  // reuse the most recently put match, and it comes back zeroed
+  struct mrc_fld *g3 = ggcm_mhd_get_3d_fld(mhd, 3);
+  struct mrc_fld *g1 = ggcm_mhd_get_3d_fld(mhd, 1);
+  assert(g3 == f3 && g1 == f1);
+  assert(pool->nr_allocs == nr_allocs && pool->bytes_total == bytes_total);
+  check_zero(g1);
+  check_zero(g3);
+
+  // no match in the pool -> new field
+  ggcm_mhd_put_3d_fld(mhd, g1);
+  struct mrc_fld *g = ggcm_mhd_get_3d_fld(mhd, nr_comps_new);
+  assert(g != f1 && mrc_fld_nr_comps(g) == nr_comps_new);
+  assert(pool->nr_allocs == nr_allocs + 1);
+  assert(pool->bytes_total == bytes_total + nr_comps_new * bytes1);
+  assert(pool->bytes_in_use == bytes_in_use + (3 + nr_comps_new) * bytes1);
+  assert(pool->bytes_high_water >= pool->bytes_in_use);
+
+  ggcm_mhd_put_3d_fld(mhd, g);
+  ggcm_mhd_put_3d_fld(mhd, g3);
+  assert(pool->bytes_in_use == bytes_in_use);
+  assert(pool->nr_free == nr_free + 1);
+  assert(pool->nr_gets == nr_gets + 5);
+}
+
+// ======================================================================
+// main
+//
+// Nothing in this tree builds the MHD code, so this is a manual check for
+// now: build it like the other mhd/tests drivers, linking against the mhd
+// sources and libmrc, and run it, optionally with
+// --ggcm_mhd_fld_pool_advise_hugepages true.
+
+extern struct ggcm_mhd_diag_ops ggcm_mhd_diag_c_ops;
+
+int
+main(int argc, char **argv)
+{
+  mrc_class_register_subclass(&mrc_class_ggcm_mhd, &ggcm_mhd_test_ops);
+  mrc_class_register_subclass(&mrc_class_ggcm_mhd_diag, &ggcm_mhd_diag_c_ops);
+
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+  ggcm_mhd_register();
+
+  struct ggcm_mhd *mhd = ggcm_mhd_create(MPI_COMM_WORLD);
+  ggcm_mhd_set_type(mhd, "test");
+  ggcm_mhd_set_from_options(mhd);
+  ggcm_mhd_setup(mhd);
+
+  test_fld_pool(mhd);
+
+  ggcm_mhd_destroy(mhd);
+
+  MPI_Finalize();
+  return 0;
+}
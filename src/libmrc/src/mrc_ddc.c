@@ -12,6 +12,8 @@
 
 // ----------------------------------------------------------------------
 
+unsigned long long mrc_ddc_bytes_sent;
+
 int _mrc_ddc_idx2dir[27][3] = {
   { -1, -1, -1 },
   {  0, -1, -1 },
@@ -2,14 +2,75 @@
 #include "mrc_ddc_private.h"
 
 #include <mrc_mat.h>
+#include <mrc_vec.h>
 #include <mrc_domain.h>
 #include <mrc_params.h>
+#include <mrc_profile.h>
+#include "mrc_fld_as_double.h" // has to match mrc_mat
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // ======================================================================
 // mrc_ddc_amr
+//
+// The ghost fill is a linear map x <- M x on the local part of the field,
+// given entry by entry through mrc_ddc_amr_add_value(). By default, it's
+// not kept as a matrix, but compiled at assemble time into a plan:
+// Most rows of M are identity (interior points), and those are dropped,
+// so applying the plan only touches the ghost points that actually get
+// set, rather than doing a gather for every point of the field.
+// Setting "use_plan" to false goes through the "csr_mpi" mrc_mat instead,
+// which gives the same results, just more slowly.
+
+struct mrc_ddc_amr_entry {
+  int row; // local
+  int col; // global
+  int seq; // keeps sort stable, so duplicates add up the same as in mrc_mat
+  double val;
+};
+
+struct mrc_ddc_amr_plan {
+  // rows that don't just keep their value, in ascending order, with their
+  // local entries [off[i], off[i+1])
+  int nr_rows;
+  int *rows;
+  int *off;
+  int *cols;
+  mrc_fld_data_t *vals;
+  mrc_fld_data_t *row_buf;
+  // some row reads a row before it that's already been updated, so rows have
+  // to be done one after the other, as the in-place mrc_mat apply does
+  bool in_order;
+
+  // rows without any local entries are just zeroed, as runs [beg, end)
+  // (unless in_order, when they stay in rows[] above)
+  int nr_zero_runs;
+  int *zero_beg;
+  int *zero_end;
+
+  // rows that get contributions from other procs, with the columns
+  // indexing recv_buf
+  int nr_nl_rows;
+  int *nl_rows;
+  int *nl_off;
+  int *nl_cols;
+  mrc_fld_data_t *nl_vals;
+
+  int n_recvs;
+  int *recv_len;
+  int *recv_src;
+  mrc_fld_data_t *recv_buf;
+
+  int n_sends;
+  int *send_len;
+  int *send_dst;
+  int *send_map;
+  mrc_fld_data_t *send_buf;
+
+  MPI_Request *req;
+};
 
 struct mrc_ddc_amr {
   struct mrc_mat *mat;
@@ -17,6 +78,17 @@ struct mrc_ddc_amr {
   struct mrc_domain *domain;
   int sw[3];
   int ib[3], im[4];
+  bool use_plan;
+  bool verbose;
+
+  int n; // local size
+  int off; // global index of first local value
+
+  int nr_entries;
+  int nr_entries_alloced;
+  struct mrc_ddc_amr_entry *entries;
+
+  struct mrc_ddc_amr_plan plan;
 };
 
 #define mrc_ddc_amr(ddc) mrc_to_subobj(ddc, struct mrc_ddc_amr)
@@ -65,9 +137,23 @@ mrc_ddc_amr_setup(struct mrc_ddc *ddc)
   size *= sub->im[3]; // # components
   size *= nr_patches;
 
+  if (sub->verbose) {
+    mprintf("size = %d %d im %d\n", size, nr_patches, sub->im[3]);
+  }
+  sub->n = size;
+  MPI_Exscan(&sub->n, &sub->off, 1, MPI_INT, MPI_SUM, mrc_ddc_comm(ddc));
+  int rank;
+  MPI_Comm_rank(mrc_ddc_comm(ddc), &rank);
+  if (rank == 0) {
+    sub->off = 0;
+  }
+
+  if (sub->use_plan) {
+    return;
+  }
+
   sub->mat = mrc_mat_create(mrc_ddc_comm(ddc));
   mrc_mat_set_type(sub->mat, "csr_mpi");
-  mprintf("size = %d %d im %d\n", size, nr_patches, sub->im[3]);
   mrc_mat_set_param_int(sub->mat, "m", size);
   mrc_mat_set_param_int(sub->mat, "n", size);
   mrc_mat_set_from_options(sub->mat); // to allow changing matrix type
@@ -81,7 +167,30 @@ static void
 mrc_ddc_amr_destroy(struct mrc_ddc *ddc)
 {
   struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
+  struct mrc_ddc_amr_plan *plan = &sub->plan;
+
   mrc_mat_destroy(sub->mat);
+  free(sub->entries);
+
+  free(plan->rows);
+  free(plan->off);
+  free(plan->cols);
+  free(plan->vals);
+  free(plan->row_buf);
+  free(plan->zero_beg);
+  free(plan->zero_end);
+  free(plan->nl_rows);
+  free(plan->nl_off);
+  free(plan->nl_cols);
+  free(plan->nl_vals);
+  free(plan->recv_len);
+  free(plan->recv_src);
+  free(plan->recv_buf);
+  free(plan->send_len);
+  free(plan->send_dst);
+  free(plan->send_map);
+  free(plan->send_buf);
+  free(plan->req);
 }
 
 // ----------------------------------------------------------------------
@@ -116,7 +225,426 @@ mrc_ddc_amr_add_value(struct mrc_ddc *ddc,
 		  sub->im[1] + col[1] - sub->ib[1]) *
 		 sub->im[0] + col[0] - sub->ib[0]);
 
-  mrc_mat_add_value(sub->mat, row_idx, col_idx, val);
+  if (!sub->use_plan) {
+    mrc_mat_add_value(sub->mat, row_idx, col_idx, val);
+    return;
+  }
+
+  if (sub->nr_entries == sub->nr_entries_alloced) {
+    sub->nr_entries_alloced = 2 * sub->nr_entries_alloced + 1024;
+    sub->entries = realloc(sub->entries,
+			   sub->nr_entries_alloced * sizeof(*sub->entries));
+  }
+  struct mrc_ddc_amr_entry *e = &sub->entries[sub->nr_entries];
+  e->row = row_idx - sub->off;
+  e->col = col_idx;
+  e->seq = sub->nr_entries;
+  e->val = val;
+  assert(e->row >= 0 && e->row < sub->n);
+  sub->nr_entries++;
+}
+
+// ======================================================================
+// the compiled plan
+
+static int
+compare_entries(const void *_a, const void *_b)
+{
+  const struct mrc_ddc_amr_entry *a = _a, *b = _b;
+
+  if (a->row != b->row) {
+    return a->row < b->row ? -1 : 1;
+  }
+  if (a->col != b->col) {
+    return a->col < b->col ? -1 : 1;
+  }
+  return a->seq < b->seq ? -1 : (a->seq > b->seq);
+}
+
+static int
+compare_int(const void *_a, const void *_b)
+{
+  const int *a = _a, *b = _b;
+
+  return *a < *b ? -1 : (*a > *b);
+}
+
+// ----------------------------------------------------------------------
+// merge_entries
+//
+// sorts the entries by row, then column, and adds up duplicates, dropping
+// those that end up zero, all the same way mrc_mat_csr does it, so that
+// both end up with bit-for-bit the same values
+
+static void
+merge_entries(struct mrc_ddc_amr *sub)
+{
+  struct mrc_ddc_amr_entry *e = sub->entries;
+
+  qsort(e, sub->nr_entries, sizeof(*e), compare_entries);
+
+  int n = 0;
+  for (int i = 0; i < sub->nr_entries; ) {
+    double val = 0.;
+    int j;
+    for (j = i; j < sub->nr_entries && e[j].row == e[i].row && e[j].col == e[i].col; j++) {
+      val += e[j].val;
+    }
+    if (val != 0.) {
+      e[n] = e[i];
+      e[n].val = val;
+      n++;
+    }
+    i = j;
+  }
+  sub->nr_entries = n;
+}
+
+// ----------------------------------------------------------------------
+// plan_setup_comm
+//
+// finds who owns the non-local columns nl_gcols[nr_nl] (sorted), and tells
+// them which values we'll need from them
+
+static void
+plan_setup_comm(struct mrc_ddc *ddc, int *nl_gcols, int nr_nl)
+{
+  struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
+  struct mrc_ddc_amr_plan *plan = &sub->plan;
+  MPI_Comm comm = mrc_ddc_comm(ddc);
+
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  int *offs_by_rank = calloc(size + 1, sizeof(*offs_by_rank));
+  MPI_Allgather(&sub->off, 1, MPI_INT, offs_by_rank, 1, MPI_INT, comm);
+  MPI_Allreduce(&sub->n, &offs_by_rank[size], 1, MPI_INT, MPI_SUM, comm);
+
+  // nl_gcols is sorted, so it comes grouped by rank already
+  int *recv_cnt_by_rank = calloc(size, sizeof(*recv_cnt_by_rank));
+  for (int i = 0, r = 0; i < nr_nl; i++) {
+    while (nl_gcols[i] >= offs_by_rank[r+1]) {
+      r++;
+    }
+    assert(r != rank);
+    recv_cnt_by_rank[r]++;
+  }
+
+  int *send_cnt_by_rank = calloc(size, sizeof(*send_cnt_by_rank));
+  MPI_Alltoall(recv_cnt_by_rank, 1, MPI_INT, send_cnt_by_rank, 1, MPI_INT, comm);
+
+  int *recv_displs = calloc(size, sizeof(*recv_displs));
+  int *send_displs = calloc(size, sizeof(*send_displs));
+  int send_buf_size = 0;
+  for (int r = 0; r < size; r++) {
+    if (r > 0) {
+      recv_displs[r] = recv_displs[r-1] + recv_cnt_by_rank[r-1];
+    }
+    send_displs[r] = send_buf_size;
+    send_buf_size += send_cnt_by_rank[r];
+    plan->n_recvs += recv_cnt_by_rank[r] > 0;
+    plan->n_sends += send_cnt_by_rank[r] > 0;
+  }
+
+  // the global indices of what we need become the send map on the other side
+  plan->send_map = calloc(send_buf_size, sizeof(*plan->send_map));
+  MPI_Alltoallv(nl_gcols, recv_cnt_by_rank, recv_displs, MPI_INT,
+		plan->send_map, send_cnt_by_rank, send_displs, MPI_INT, comm);
+  for (int i = 0; i < send_buf_size; i++) {
+    plan->send_map[i] -= sub->off;
+    assert(plan->send_map[i] >= 0 && plan->send_map[i] < sub->n);
+  }
+
+  plan->recv_len = calloc(plan->n_recvs, sizeof(*plan->recv_len));
+  plan->recv_src = calloc(plan->n_recvs, sizeof(*plan->recv_src));
+  plan->send_len = calloc(plan->n_sends, sizeof(*plan->send_len));
+  plan->send_dst = calloc(plan->n_sends, sizeof(*plan->send_dst));
+  for (int r = 0, nr = 0, ns = 0; r < size; r++) {
+    if (recv_cnt_by_rank[r] > 0) {
+      plan->recv_len[nr] = recv_cnt_by_rank[r];
+      plan->recv_src[nr] = r;
+      nr++;
+    }
+    if (send_cnt_by_rank[r] > 0) {
+      plan->send_len[ns] = send_cnt_by_rank[r];
+      plan->send_dst[ns] = r;
+      ns++;
+    }
+  }
+  plan->recv_buf = calloc(nr_nl, sizeof(*plan->recv_buf));
+  plan->send_buf = calloc(send_buf_size, sizeof(*plan->send_buf));
+  plan->req = calloc(plan->n_recvs + plan->n_sends, sizeof(*plan->req));
+
+  free(offs_by_rank);
+  free(recv_cnt_by_rank);
+  free(send_cnt_by_rank);
+  free(recv_displs);
+  free(send_displs);
+}
+
+// ----------------------------------------------------------------------
+// plan_is_row
+
+static bool
+plan_is_row(struct mrc_ddc_amr_plan *plan, int row)
+{
+  return bsearch(&row, plan->rows, plan->nr_rows, sizeof(*plan->rows),
+		 compare_int) != NULL;
+}
+
+// ----------------------------------------------------------------------
+// plan_compact_zero_rows
+//
+// moves the rows that have no local entries out of rows[] into runs,
+// typically all the ghost points in invariant directions
+
+static void
+plan_compact_zero_rows(struct mrc_ddc_amr_plan *plan)
+{
+  int nr_zero_rows = 0;
+  for (int r = 0; r < plan->nr_rows; r++) {
+    nr_zero_rows += plan->off[r] == plan->off[r+1];
+  }
+  plan->zero_beg = calloc(nr_zero_rows, sizeof(*plan->zero_beg));
+  plan->zero_end = calloc(nr_zero_rows, sizeof(*plan->zero_end));
+
+  int nr_rows = 0;
+  for (int r = 0; r < plan->nr_rows; r++) {
+    int row = plan->rows[r], beg = plan->off[r], end = plan->off[r+1];
+    if (beg == end) {
+      int n = plan->nr_zero_runs;
+      if (n > 0 && plan->zero_end[n-1] == row) {
+	plan->zero_end[n-1]++;
+      } else {
+	plan->zero_beg[n] = row;
+	plan->zero_end[n] = row + 1;
+	plan->nr_zero_runs++;
+      }
+    } else {
+      // since nr_rows <= r, this doesn't clobber off[] still to be read
+      plan->rows[nr_rows] = row;
+      plan->off[nr_rows] = beg;
+      plan->off[nr_rows + 1] = end;
+      nr_rows++;
+    }
+  }
+  plan->nr_rows = nr_rows;
+}
+
+// ----------------------------------------------------------------------
+// plan_assemble
+
+static void
+plan_assemble(struct mrc_ddc *ddc)
+{
+  struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
+  struct mrc_ddc_amr_plan *plan = &sub->plan;
+  int lo = sub->off, hi = sub->off + sub->n;
+
+  merge_entries(sub);
+  struct mrc_ddc_amr_entry *e = sub->entries;
+  int nr_entries = sub->nr_entries;
+
+  // count, so we can allocate exactly
+  int nr_vals = 0, nr_nl_vals = 0;
+  for (int i = 0, row = 0; row < sub->n; row++) {
+    int nr_local = 0, nr_nl = 0;
+    bool is_identity = false;
+    for (; i < nr_entries && e[i].row == row; i++) {
+      if (e[i].col >= lo && e[i].col < hi) {
+	is_identity = e[i].col - lo == row && e[i].val == 1.;
+	nr_local++;
+      } else {
+	nr_nl++;
+      }
+    }
+    if (!(nr_local == 1 && is_identity && nr_nl == 0)) {
+      plan->nr_rows++;
+      nr_vals += nr_local;
+    }
+    if (nr_nl > 0) {
+      plan->nr_nl_rows++;
+      nr_nl_vals += nr_nl;
+    }
+  }
+
+  plan->rows = calloc(plan->nr_rows, sizeof(*plan->rows));
+  plan->off = calloc(plan->nr_rows + 1, sizeof(*plan->off));
+  plan->cols = calloc(nr_vals, sizeof(*plan->cols));
+  plan->vals = calloc(nr_vals, sizeof(*plan->vals));
+  plan->row_buf = calloc(plan->nr_rows, sizeof(*plan->row_buf));
+  plan->nl_rows = calloc(plan->nr_nl_rows, sizeof(*plan->nl_rows));
+  plan->nl_off = calloc(plan->nr_nl_rows + 1, sizeof(*plan->nl_off));
+  plan->nl_cols = calloc(nr_nl_vals, sizeof(*plan->nl_cols));
+  plan->nl_vals = calloc(nr_nl_vals, sizeof(*plan->nl_vals));
+
+  int ir = 0, iv = 0, inr = 0, inv = 0;
+  for (int i = 0, row = 0; row < sub->n; row++) {
+    int i_beg = i;
+    for (; i < nr_entries && e[i].row == row; i++) {
+    }
+    bool keep = (i - i_beg == 1 && e[i_beg].col - lo == row && e[i_beg].val == 1.);
+    if (!keep) {
+      plan->rows[ir] = row;
+      plan->off[ir] = iv;
+      ir++;
+    }
+    bool has_nl = false;
+    for (int j = i_beg; j < i; j++) {
+      if (e[j].col >= lo && e[j].col < hi) {
+	if (!keep) {
+	  plan->cols[iv] = e[j].col - lo;
+	  plan->vals[iv] = e[j].val;
+	  iv++;
+	}
+      } else {
+	if (!has_nl) {
+	  plan->nl_rows[inr] = row;
+	  plan->nl_off[inr] = inv;
+	  inr++;
+	  has_nl = true;
+	}
+	plan->nl_cols[inv] = e[j].col; // still global, mapped below
+	plan->nl_vals[inv] = e[j].val;
+	inv++;
+      }
+    }
+  }
+  plan->off[ir] = iv;
+  plan->nl_off[inr] = inv;
+  assert(ir == plan->nr_rows && iv == nr_vals);
+  assert(inr == plan->nr_nl_rows && inv == nr_nl_vals);
+
+  free(sub->entries);
+  sub->entries = NULL;
+  sub->nr_entries = sub->nr_entries_alloced = 0;
+
+  // the in-place mrc_mat apply goes row by row, so a row that reads a row
+  // before it sees the updated value
+  for (int r = 0; r < plan->nr_rows && !plan->in_order; r++) {
+    for (int i = plan->off[r]; i < plan->off[r+1]; i++) {
+      if (plan->cols[i] < plan->rows[r] && plan_is_row(plan, plan->cols[i])) {
+	plan->in_order = true;
+	break;
+      }
+    }
+  }
+
+  if (!plan->in_order) {
+    plan_compact_zero_rows(plan);
+  }
+
+  // compact the non-local columns, and have nl_cols index the recv buffer
+  int *nl_gcols = malloc(nr_nl_vals * sizeof(*nl_gcols));
+  memcpy(nl_gcols, plan->nl_cols, nr_nl_vals * sizeof(*nl_gcols));
+  qsort(nl_gcols, nr_nl_vals, sizeof(*nl_gcols), compare_int);
+  int nr_nl = 0;
+  for (int i = 0; i < nr_nl_vals; i++) {
+    if (nr_nl == 0 || nl_gcols[i] != nl_gcols[nr_nl - 1]) {
+      nl_gcols[nr_nl++] = nl_gcols[i];
+    }
+  }
+  for (int i = 0; i < nr_nl_vals; i++) {
+    int *p = bsearch(&plan->nl_cols[i], nl_gcols, nr_nl, sizeof(*nl_gcols),
+		     compare_int);
+    plan->nl_cols[i] = p - nl_gcols;
+  }
+
+  plan_setup_comm(ddc, nl_gcols, nr_nl);
+  free(nl_gcols);
+
+  if (sub->verbose) {
+    mprintf("ddc_amr plan: %d of %d rows, %d vals, %d zero runs, "
+	    "%d non-local rows, %d non-local vals, %d recvs (%d values), "
+	    "%d sends%s\n", plan->nr_rows, sub->n, nr_vals, plan->nr_zero_runs,
+	    plan->nr_nl_rows, nr_nl_vals,
+	    plan->n_recvs, nr_nl, plan->n_sends,
+	    plan->in_order ? ", in order" : "");
+  }
+}
+
+// ----------------------------------------------------------------------
+// plan_apply
+
+// below this, starting up threads costs more than it saves
+#define PLAN_MIN_ROWS_PER_THREAD (4096)
+
+static void
+plan_apply(struct mrc_ddc *ddc, struct mrc_fld *fld)
+{
+  struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
+  struct mrc_ddc_amr_plan *plan = &sub->plan;
+  MPI_Comm comm = mrc_ddc_comm(ddc);
+
+  assert(mrc_vec_size_of_type(fld->_nd->vec) == sizeof(mrc_fld_data_t));
+  assert(mrc_vec_len(fld->_nd->vec) == sub->n);
+  mrc_fld_data_t *x = mrc_vec_get_array(fld->_nd->vec);
+
+  // start communication, sending the values from before the update
+  mrc_fld_data_t *pp = plan->recv_buf;
+  for (int n = 0; n < plan->n_recvs; n++) {
+    MPI_Irecv(pp, plan->recv_len[n], MPI_MRC_FLD_DATA_T, plan->recv_src[n], 2,
+	      comm, &plan->req[n]);
+    pp += plan->recv_len[n];
+  }
+  int *map = plan->send_map;
+  pp = plan->send_buf;
+  for (int n = 0; n < plan->n_sends; n++) {
+    for (int i = 0; i < plan->send_len[n]; i++) {
+      pp[i] = x[map[i]];
+    }
+    MPI_Isend(pp, plan->send_len[n], MPI_MRC_FLD_DATA_T, plan->send_dst[n], 2,
+	      comm, &plan->req[plan->n_recvs + n]);
+    map += plan->send_len[n];
+    pp += plan->send_len[n];
+  }
+
+  // local part
+  if (plan->in_order) {
+    for (int r = 0; r < plan->nr_rows; r++) {
+      mrc_fld_data_t sum = 0.;
+      for (int i = plan->off[r]; i < plan->off[r+1]; i++) {
+	sum += plan->vals[i] * x[plan->cols[i]];
+      }
+      x[plan->rows[r]] = sum;
+    }
+  } else {
+#pragma omp parallel if (plan->nr_rows > PLAN_MIN_ROWS_PER_THREAD * 2)
+    {
+#pragma omp for schedule(static)
+      for (int r = 0; r < plan->nr_rows; r++) {
+	mrc_fld_data_t sum = 0.;
+	for (int i = plan->off[r]; i < plan->off[r+1]; i++) {
+	  sum += plan->vals[i] * x[plan->cols[i]];
+	}
+	plan->row_buf[r] = sum;
+      }
+#pragma omp for schedule(static)
+      for (int r = 0; r < plan->nr_rows; r++) {
+	x[plan->rows[r]] = plan->row_buf[r];
+      }
+#pragma omp for schedule(static)
+      for (int n = 0; n < plan->nr_zero_runs; n++) {
+	memset(&x[plan->zero_beg[n]], 0,
+	       (plan->zero_end[n] - plan->zero_beg[n]) * sizeof(*x));
+      }
+    }
+  }
+
+  // non-local part
+  MPI_Waitall(plan->n_recvs + plan->n_sends, plan->req, MPI_STATUSES_IGNORE);
+
+#pragma omp parallel for schedule(static) if (plan->nr_nl_rows > PLAN_MIN_ROWS_PER_THREAD * 2)
+  for (int r = 0; r < plan->nr_nl_rows; r++) {
+    mrc_fld_data_t sum = 0.;
+    for (int i = plan->nl_off[r]; i < plan->nl_off[r+1]; i++) {
+      sum += plan->nl_vals[i] * plan->recv_buf[plan->nl_cols[i]];
+    }
+    x[plan->nl_rows[r]] = sum + x[plan->nl_rows[r]];
+  }
+
+  mrc_vec_put_array(fld->_nd->vec, x);
 }
 
 // ----------------------------------------------------------------------
@@ -127,7 +655,11 @@ mrc_ddc_amr_assemble(struct mrc_ddc *ddc)
 {
   struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
 
-  mrc_mat_assemble(sub->mat);
+  if (sub->use_plan) {
+    plan_assemble(ddc);
+  } else {
+    mrc_mat_assemble(sub->mat);
+  }
 }
 
 // ----------------------------------------------------------------------
@@ -138,7 +670,18 @@ mrc_ddc_amr_apply(struct mrc_ddc *ddc, struct mrc_fld *fld)
 {
   struct mrc_ddc_amr *sub = mrc_ddc_amr(ddc);
 
-  mrc_mat_apply_in_place(sub->mat, fld->_nd->vec);
+  static int pr;
+  if (!pr) {
+    pr = prof_register("mrc_ddc_amr_apply", 0, 0, 0);
+  }
+
+  prof_start(pr);
+  if (sub->use_plan) {
+    plan_apply(ddc, fld);
+  } else {
+    mrc_mat_apply_in_place(sub->mat, fld->_nd->vec);
+  }
+  prof_stop(pr);
 }
 
 // ----------------------------------------------------------------------
@@ -147,6 +690,9 @@ mrc_ddc_amr_apply(struct mrc_ddc *ddc, struct mrc_fld *fld)
 static struct param mrc_ddc_amr_descr[] = {
   { "sw"                     , VAR(sw)                      , PARAM_INT3(0, 0, 0)    },
   { "n_comp"                 , VAR(im[3])                   , PARAM_INT(0)           },
+  { "use_plan"               , VAR(use_plan)                , PARAM_BOOL(true),
+    .help = "apply a compiled plan rather than a csr_mpi mrc_mat" },
+  { "verbose"                , VAR(verbose)                 , PARAM_BOOL(false)      },
   {},
 };
 #undef VAR
@@ -456,6 +456,7 @@ ddc_run_begin(struct mrc_ddc *ddc, struct mrc_ddc_pattern2 *patt2,
       }
       MPI_Isend(p0, ri[r].n_send * (me - mb), ddc->mpi_type,
 		r, 0, ddc->obj.comm, &patt2->send_req[patt2->send_cnt++]);
+      mrc_ddc_bytes_sent += (unsigned long long) ri[r].n_send * (me - mb) * ddc->size_of_type;
     }
   }  
   assert(p == patt2->send_buf + patt2->n_send * (me - mb) * ddc->size_of_type);
@@ -239,6 +239,7 @@ ddc_run(struct mrc_ddc *ddc, struct mrc_ddc_pattern *patt, int mb, int me,
 #endif
 	  MPI_Isend(s->buf, s->len * (me - mb), ddc->mpi_type, s->nei_rank,
 		    0x1000 + dir1, ddc->obj.comm, &sub->send_reqs[dir1]);
+	  mrc_ddc_bytes_sent += (unsigned long long) s->len * (me - mb) * ddc->size_of_type;
 	} else {
 	  sub->send_reqs[dir1] = MPI_REQUEST_NULL;
 	}
@@ -518,6 +518,26 @@ mrc_fld_axpby(struct mrc_fld *y, double a, struct mrc_fld *x, double b)
   mrc_vec_axpby(y->_nd->vec, a, x->_nd->vec, b);
 }
 
+// ----------------------------------------------------------------------
+// mrc_fld_maxpy
+//
+// y += sum_k alpha[k] * x[k], in one pass over y rather than n
+
+void
+mrc_fld_maxpy(struct mrc_fld *y, int n, const double *alpha, struct mrc_fld **x)
+{
+  if (n == 0) {
+    return;
+  }
+
+  struct mrc_vec *x_vec[n];
+  for (int k = 0; k < n; k++) {
+    assert(mrc_fld_same_shape(x[k], y));
+    x_vec[k] = x[k]->_nd->vec;
+  }
+  mrc_vec_maxpy(y->_nd->vec, n, alpha, x_vec);
+}
+
 // ----------------------------------------------------------------------
 // mrc_fld_norm
 
@@ -1054,6 +1074,8 @@ static struct mrc_obj_method mrc_fld_methods[] = {
   MRC_OBJ_METHOD("copy"     , mrc_fld_copy),
   MRC_OBJ_METHOD("axpy"     , mrc_fld_axpy),
   MRC_OBJ_METHOD("waxpy"    , mrc_fld_waxpy),
+  MRC_OBJ_METHOD("axpby"    , mrc_fld_axpby),
+  MRC_OBJ_METHOD("maxpy"    , mrc_fld_maxpy),
   MRC_OBJ_METHOD("norm"     , mrc_fld_norm),
   MRC_OBJ_METHOD("set"      , mrc_fld_set),
 #ifdef HAVE_PETSC
@@ -1,6 +1,7 @@
 
 #include "mrc_io_private.h"
 #include <mrc_params.h>
+#include <mrc_redist.h>
 #include <mrc_profile.h>
 
 #include <stdlib.h>
@@ -42,22 +43,107 @@ enum {
   DIAG_RESPONSE_SHUTDOWN_COMPLETE,
 };
 
+// ======================================================================
+// slabs
+//
+// With more than one server, each server assembles and writes a slab of
+// the global domain along the slowest varying (non-invariant) dimension.
+// Clients and servers both derive the slabs from the global dims. The
+// servers' domain is a "simple" one, so the slabs need to be of equal size.
+
+static void
+diagsrv_slab(const int gdims[3], int nr_servers, int server, int off[3], int dims[3])
+{
+  int slow_dim = 2;
+  while (slow_dim > 0 && gdims[slow_dim] == 1) {
+    slow_dim--;
+  }
+  for (int d = 0; d < 3; d++) {
+    off[d] = 0;
+    dims[d] = gdims[d];
+  }
+  if (gdims[slow_dim] % nr_servers != 0) {
+    fprintf(stderr, "ERROR: %d diagsrvs don't evenly divide %d cells in dim %d\n",
+	    nr_servers, gdims[slow_dim], slow_dim);
+    abort();
+  }
+  dims[slow_dim] = gdims[slow_dim] / nr_servers;
+  off[slow_dim] = server * dims[slow_dim];
+}
+
 // ======================================================================
 // diag client interface
+//
+// Only rank 0 sends commands, to every server. Field data goes straight
+// from each client to the server(s) whose slab it intersects, using
+// non-blocking sends out of a pool of max_pending buffers, so clients
+// can go on computing while the servers assemble and write. Once all
+// buffers are in flight, the next write waits for the oldest one
+// to be received, which keeps clients from running away from slow
+// servers.
 
 struct diagc_combined_params {
   int rank_diagsrv;
+  int nr_diagsrvs;
+  int max_pending;
+
+  // pending sends, see above
+  MPI_Request *reqs;
+  float **bufs;
+  size_t *buf_caps;
+  int *seq;
+  int next_seq;
 };
 
 #define VAR(x) (void *)offsetof(struct diagc_combined_params, x)
 
 static struct param diagc_combined_params_descr[] = {
   { "rank_diagsrv"        , VAR(rank_diagsrv)      , PARAM_INT(0)       },
+  { "nr_diagsrvs"         , VAR(nr_diagsrvs)       , PARAM_INT(1)       },
+  { "max_pending"         , VAR(max_pending)       , PARAM_INT(4)       },
   {},
 };
 
 #undef VAR
 
+// ----------------------------------------------------------------------
+// diagc_combined_get_buf
+//
+// returns a send buffer of at least n floats, waiting for a pending send
+// to complete if all of them are in use
+
+static float *
+diagc_combined_get_buf(struct mrc_io *io, size_t n, MPI_Request **p_req)
+{
+  struct diagc_combined_params *par = io->obj.subctx;
+
+  int i;
+  for (i = 0; i < par->max_pending; i++) {
+    if (par->reqs[i] == MPI_REQUEST_NULL) {
+      break;
+    }
+  }
+  if (i == par->max_pending) {
+    // all in flight: wait for the oldest
+    i = 0;
+    for (int j = 1; j < par->max_pending; j++) {
+      if (par->seq[j] < par->seq[i]) {
+	i = j;
+      }
+    }
+    MPI_Wait(&par->reqs[i], MPI_STATUS_IGNORE);
+  }
+
+  if (par->buf_caps[i] < n) {
+    free(par->bufs[i]);
+    par->bufs[i] = malloc(n * sizeof(float));
+    par->buf_caps[i] = n;
+  }
+  par->seq[i] = par->next_seq++;
+  *p_req = &par->reqs[i];
+  return par->bufs[i];
+}
+
 // ----------------------------------------------------------------------
 // diagc_combined_setup
 //
@@ -80,15 +166,18 @@ diagc_combined_send_domain_info(struct mrc_io *io, struct mrc_domain *domain)
     ldims[d] = patches[0].ldims[d];
   }
   mrc_domain_get_global_dims(domain, gdims);
-  if (io->rank == 0) {
-    MPI_Send(iw, 0, MPI_CHAR, par->rank_diagsrv, ID_DIAGS_CMD_CREATE, MPI_COMM_WORLD);
-  }
-  MPI_Send(iw, 9, MPI_INT, par->rank_diagsrv, ID_DIAGS_CMD_DOMAIN_INFO, MPI_COMM_WORLD);
-
   struct mrc_crds *crds = mrc_domain_get_crds(domain);
-  for (int d = 0; d < 3; d++) {
-    MPI_Send(&MRC_CRD(crds, d, 0), ldims[d], MPI_FLOAT, par->rank_diagsrv,
-	     ID_DIAGS_CMD_CRDX + d, MPI_COMM_WORLD);
+  for (int s = 0; s < par->nr_diagsrvs; s++) {
+    int rank_srv = par->rank_diagsrv + s;
+    if (io->rank == 0) {
+      MPI_Send(iw, 0, MPI_CHAR, rank_srv, ID_DIAGS_CMD_CREATE, MPI_COMM_WORLD);
+    }
+    MPI_Send(iw, 9, MPI_INT, rank_srv, ID_DIAGS_CMD_DOMAIN_INFO, MPI_COMM_WORLD);
+
+    for (int d = 0; d < 3; d++) {
+      MPI_Send(&MRC_CRD(crds, d, 0), ldims[d], MPI_FLOAT, rank_srv,
+	       ID_DIAGS_CMD_CRDX + d, MPI_COMM_WORLD);
+    }
   }
 
   io->diagc_domain_info_sent = true;
@@ -101,13 +190,41 @@ diagc_combined_setup(struct mrc_io *io)
   struct diagc_combined_params *par = io->obj.subctx;
 
   mrc_io_setup_super(io);
+
+  assert(par->nr_diagsrvs >= 1 && par->max_pending >= 1);
+  par->reqs = calloc(par->max_pending, sizeof(*par->reqs));
+  par->bufs = calloc(par->max_pending, sizeof(*par->bufs));
+  par->buf_caps = calloc(par->max_pending, sizeof(*par->buf_caps));
+  par->seq = calloc(par->max_pending, sizeof(*par->seq));
+  for (int i = 0; i < par->max_pending; i++) {
+    par->reqs[i] = MPI_REQUEST_NULL;
+  }
+
   if (io->rank == 0) {
-    int icmd[1] = { DIAG_CMD_CREATE };
-    MPI_Send(icmd, 1, MPI_INT, par->rank_diagsrv, ID_DIAGS_CMD, MPI_COMM_WORLD);
-    MPI_Send(par_io->outdir, strlen(par_io->outdir) + 1, MPI_CHAR, par->rank_diagsrv,
-	     ID_DIAGS_CREATE_OUTDIR, MPI_COMM_WORLD);
-    MPI_Send(par_io->basename, strlen(par_io->basename) + 1, MPI_CHAR, par->rank_diagsrv,
-	     ID_DIAGS_CREATE_BASENAME, MPI_COMM_WORLD);
+    for (int s = 0; s < par->nr_diagsrvs; s++) {
+      int icmd[1] = { DIAG_CMD_CREATE };
+      MPI_Send(icmd, 1, MPI_INT, par->rank_diagsrv + s, ID_DIAGS_CMD, MPI_COMM_WORLD);
+      MPI_Send(par_io->outdir, strlen(par_io->outdir) + 1, MPI_CHAR, par->rank_diagsrv + s,
+	       ID_DIAGS_CREATE_OUTDIR, MPI_COMM_WORLD);
+      MPI_Send(par_io->basename, strlen(par_io->basename) + 1, MPI_CHAR, par->rank_diagsrv + s,
+	       ID_DIAGS_CREATE_BASENAME, MPI_COMM_WORLD);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// diagc_combined_send_cmd
+//
+// rank 0 only: sends the same message to every server
+
+static void
+diagc_combined_send_cmd(struct mrc_io *io, void *buf, int cnt, MPI_Datatype type, int tag)
+{
+  struct diagc_combined_params *par = io->obj.subctx;
+
+  assert(io->rank == 0);
+  for (int s = 0; s < par->nr_diagsrvs; s++) {
+    MPI_Send(buf, cnt, type, par->rank_diagsrv + s, tag, MPI_COMM_WORLD);
   }
 }
 
@@ -121,37 +238,37 @@ diagc_combined_setup(struct mrc_io *io)
 static void
 diagc_combined_open(struct mrc_io *io, const char *mode)
 {
-  struct diagc_combined_params *par = io->obj.subctx;
   assert(strcmp(mode, "w") == 0); // only writing supported for now
 
   if (io->rank == 0) {
     int icmd[2] = { DIAG_CMD_OPENFILE, io->step };
 
-    MPI_Send(icmd, 2, MPI_INT, par->rank_diagsrv, ID_DIAGS_CMD_OPEN, MPI_COMM_WORLD);
-    MPI_Send(io->par.basename, strlen(io->par.basename) + 1, MPI_CHAR,
-	     par->rank_diagsrv, ID_DIAGS_BASENAME, MPI_COMM_WORLD);
-    MPI_Send(&io->time, 1, MPI_FLOAT, par->rank_diagsrv, ID_DIAGS_TIME, MPI_COMM_WORLD);
+    diagc_combined_send_cmd(io, icmd, 2, MPI_INT, ID_DIAGS_CMD_OPEN);
+    diagc_combined_send_cmd(io, io->par.basename, strlen(io->par.basename) + 1, MPI_CHAR,
+			    ID_DIAGS_BASENAME);
+    diagc_combined_send_cmd(io, &io->time, 1, MPI_FLOAT, ID_DIAGS_TIME);
   }
 }
 
 // ----------------------------------------------------------------------
 // diagc_combined_close
+//
+// doesn't wait for the field data to be received, that happens when the
+// send buffers are needed again, or at the latest in destroy()
 
 static void
 diagc_combined_close(struct mrc_io *io)
 {
-  struct diagc_combined_params *par = io->obj.subctx;
-
   if (io->rank == 0) {
     char str[] = "";
-    MPI_Send(str, 1, MPI_CHAR, par->rank_diagsrv, ID_DIAGS_FLDNAME, MPI_COMM_WORLD);
+    diagc_combined_send_cmd(io, str, 1, MPI_CHAR, ID_DIAGS_FLDNAME);
   }
 }
 
 // ----------------------------------------------------------------------
 // diagc_combined_destroy
 //
-// shuts down the diag server process
+// shuts down the diag server process(es)
 
 static void
 diagc_combined_destroy(struct mrc_io *io)
@@ -162,6 +279,17 @@ diagc_combined_destroy(struct mrc_io *io)
 
   struct diagc_combined_params *par = io->obj.subctx;
 
+  if (par->reqs) {
+    MPI_Waitall(par->max_pending, par->reqs, MPI_STATUSES_IGNORE);
+    for (int i = 0; i < par->max_pending; i++) {
+      free(par->bufs[i]);
+    }
+    free(par->reqs);
+    free(par->bufs);
+    free(par->buf_caps);
+    free(par->seq);
+  }
+
   MPI_Comm_rank(MPI_COMM_WORLD, &comm_world_rank);
   if (mrc_io_is_setup(io) && comm_world_rank == 0) {
     wait_for_response = 1;
@@ -169,9 +297,12 @@ diagc_combined_destroy(struct mrc_io *io)
     wait_for_response = 0;
   }
   
-  icmd[0] = DIAG_CMD_SHUTDOWN;
-  icmd[1] = wait_for_response;
-  MPI_Send(icmd, 2, MPI_INT, par->rank_diagsrv, ID_DIAGS_CMD, MPI_COMM_WORLD);
+  // the servers only listen to rank 0
+  if (io->rank == 0) {
+    icmd[0] = DIAG_CMD_SHUTDOWN;
+    icmd[1] = wait_for_response;
+    diagc_combined_send_cmd(io, icmd, 2, MPI_INT, ID_DIAGS_CMD);
+  }
 
   if (0&&wait_for_response) {
     int response = 0;
@@ -190,14 +321,17 @@ diagc_combined_destroy(struct mrc_io *io)
 // diagc_combined_write_field
 
 static void
-copy_and_scale(float *buf, struct mrc_fld *fld, int m, float scale)
+copy_and_scale(float *buf, struct mrc_fld *f, int m, float scale,
+	       const int off[3], const int ilo[3], const int ihi[3])
 {
-  struct mrc_fld *f = mrc_fld_get_as(fld, "float");
   int i = 0;
-  mrc_fld_foreach(f, ix,iy,iz, 0, 0) {
-    buf[i++] = scale * MRC_F3(f, m, ix,iy,iz);
-  } mrc_fld_foreach_end;
-  mrc_fld_put_as(f, fld);
+  for (int iz = ilo[2]; iz < ihi[2]; iz++) {
+    for (int iy = ilo[1]; iy < ihi[1]; iy++) {
+      for (int ix = ilo[0]; ix < ihi[0]; ix++) {
+	buf[i++] = scale * MRC_F3(f, m, ix - off[0], iy - off[1], iz - off[2]);
+      }
+    }
+  }
 }
 
 static void
@@ -211,32 +345,34 @@ diagc_combined_write_field(struct mrc_io *io, const char *path,
   int nr_patches;
   struct mrc_patch *patches = mrc_domain_get_patches(fld->_domain, &nr_patches);
   assert(nr_patches == 1);
-  int *ldims = patches[0].ldims;
-  int nout = ldims[0] * ldims[1] * ldims[2];
-  float *buf = calloc(sizeof(float), nout);
 
   if (io->rank == 0) {
-    MPI_Send((char *)mrc_fld_name(fld), strlen(mrc_fld_name(fld)) + 1,
-	     MPI_CHAR, par->rank_diagsrv, ID_DIAGS_FLDNAME, MPI_COMM_WORLD);
-    MPI_Send((char *)mrc_fld_comp_name(fld, m), strlen(mrc_fld_comp_name(fld, m)) + 1,
-	     MPI_CHAR, par->rank_diagsrv, ID_DIAGS_FLDNAME, MPI_COMM_WORLD);
+    const char *name = mrc_fld_name(fld), *comp_name = mrc_fld_comp_name(fld, m);
+    diagc_combined_send_cmd(io, (char *) name, strlen(name) + 1, MPI_CHAR, ID_DIAGS_FLDNAME);
+    diagc_combined_send_cmd(io, (char *) comp_name, strlen(comp_name) + 1, MPI_CHAR,
+			    ID_DIAGS_FLDNAME);
     int outtype = DIAG_TYPE_3D;
-    MPI_Send(&outtype, 1, MPI_INT, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE, MPI_COMM_WORLD);
+    diagc_combined_send_cmd(io, &outtype, 1, MPI_INT, ID_DIAGS_CMD_WRITE);
   }
 
-  copy_and_scale(buf, fld, m, scale);
+  // the servers know everyone's patch, so only the data needs to be sent
+  int gdims[3];
+  mrc_domain_get_global_dims(fld->_domain, gdims);
+  struct mrc_fld *f = mrc_fld_get_as(fld, "float");
+  for (int s = 0; s < par->nr_diagsrvs; s++) {
+    int slab_off[3], slab_dims[3], ilo[3], ihi[3];
+    diagsrv_slab(gdims, par->nr_diagsrvs, s, slab_off, slab_dims);
+    if (!find_intersection(ilo, ihi, patches[0].off, patches[0].ldims, slab_off, slab_dims)) {
+      continue;
+    }
 
-  int iw[6], *off = iw, *dims = iw + 3; // off, then dims
-  for (int d = 0; d < 3; d++) {
-    off[d] = patches[0].off[d];
-    dims[d] = patches[0].ldims[d];
+    int n = (ihi[0] - ilo[0]) * (ihi[1] - ilo[1]) * (ihi[2] - ilo[2]);
+    MPI_Request *req;
+    float *buf = diagc_combined_get_buf(io, n, &req);
+    copy_and_scale(buf, f, m, scale, patches[0].off, ilo, ihi);
+    MPI_Isend(buf, n, MPI_FLOAT, par->rank_diagsrv + s, ID_DIAGS_DATA, MPI_COMM_WORLD, req);
   }
-
-  MPI_Send(iw, 6, MPI_INT, par->rank_diagsrv, ID_DIAGS_SUBDOMAIN, MPI_COMM_WORLD);
-  MPI_Send(buf, nout, MPI_FLOAT, par->rank_diagsrv, ID_DIAGS_DATA, MPI_COMM_WORLD);
-
-  free(buf);
+  mrc_fld_put_as(f, fld);
 }
 
 static void
@@ -249,6 +385,9 @@ diagc_combined_write_m3(struct mrc_io *io, const char *path, struct mrc_fld *fld
   }
 }
 
+// 2d slices are small, they're still sent synchronously, and always to the
+// first server, which writes them on its own
+
 static void
 diagc_combined_write_field2d(struct mrc_io *io, float scale, struct mrc_fld *fld,
 			     int outtype, float sheet)
@@ -261,14 +400,12 @@ diagc_combined_write_field2d(struct mrc_io *io, float scale, struct mrc_fld *fld
   int dim = outtype - DIAG_TYPE_2D_X;
 
   if (io->rank == 0) {
-    MPI_Send("mrc_f2", strlen("mrc_f2") + 1, MPI_CHAR, par->rank_diagsrv,
-	     ID_DIAGS_FLDNAME, MPI_COMM_WORLD);
-    MPI_Send((char *) mrc_fld_comp_name(fld, 0), strlen(mrc_fld_comp_name(fld, 0)) + 1,
-	     MPI_CHAR, par->rank_diagsrv, ID_DIAGS_FLDNAME, MPI_COMM_WORLD);
-    MPI_Send(&outtype, 1, MPI_INT, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE, MPI_COMM_WORLD);
-    MPI_Send(&sheet, 1, MPI_FLOAT, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE, MPI_COMM_WORLD);
+    const char *comp_name = mrc_fld_comp_name(fld, 0);
+    diagc_combined_send_cmd(io, "mrc_f2", strlen("mrc_f2") + 1, MPI_CHAR, ID_DIAGS_FLDNAME);
+    diagc_combined_send_cmd(io, (char *) comp_name, strlen(comp_name) + 1, MPI_CHAR,
+			    ID_DIAGS_FLDNAME);
+    diagc_combined_send_cmd(io, &outtype, 1, MPI_INT, ID_DIAGS_CMD_WRITE);
+    diagc_combined_send_cmd(io, &sheet, 1, MPI_FLOAT, ID_DIAGS_CMD_WRITE);
   }
 
   int iw[6] = { -1, };
@@ -286,7 +423,8 @@ diagc_combined_write_field2d(struct mrc_io *io, float scale, struct mrc_fld *fld
 
     MPI_Send(iw, 6, MPI_INT, par->rank_diagsrv, ID_DIAGS_SUBDOMAIN, MPI_COMM_WORLD);
     struct mrc_fld *f = mrc_fld_get_as(fld, "float");
-    MPI_Send(fld->_nd->arr, mrc_fld_len(fld), MPI_FLOAT, par->rank_diagsrv, ID_DIAGS_2DDATA, MPI_COMM_WORLD);
+    MPI_Send(f->_nd->arr, mrc_fld_len(fld), MPI_FLOAT, par->rank_diagsrv, ID_DIAGS_2DDATA,
+	     MPI_COMM_WORLD);
     mrc_fld_put_as(f, fld);
   } else {
     MPI_Send(iw, 6, MPI_INT, par->rank_diagsrv, ID_DIAGS_SUBDOMAIN, MPI_COMM_WORLD);
@@ -297,55 +435,45 @@ static void
 diagc_combined_write_attr(struct mrc_io *io, const char *path, int type,
 			  const char *name, union param_u *pv)
 {
-  struct diagc_combined_params *par = io->obj.subctx;
-
   if (io->rank == 0) {
-    MPI_Send((char *)path, strlen(path) + 1, MPI_CHAR, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
-    MPI_Send(&type, 1, MPI_INT, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
-    MPI_Send((char *)name, strlen(name) + 1, MPI_CHAR, par->rank_diagsrv,
-	     ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+    diagc_combined_send_cmd(io, (char *)path, strlen(path) + 1, MPI_CHAR,
+			    ID_DIAGS_CMD_WRITE_ATTR);
+    diagc_combined_send_cmd(io, &type, 1, MPI_INT, ID_DIAGS_CMD_WRITE_ATTR);
+    diagc_combined_send_cmd(io, (char *)name, strlen(name) + 1, MPI_CHAR,
+			    ID_DIAGS_CMD_WRITE_ATTR);
     switch (type) {
     case PT_BOOL:
     case PT_INT:
     case PT_SELECT:
     case MRC_VAR_INT:
     case MRC_VAR_BOOL:
-      MPI_Send(&pv->u_int, 1, MPI_INT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, &pv->u_int, 1, MPI_INT, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_FLOAT:
-      MPI_Send(&pv->u_float, 1, MPI_FLOAT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, &pv->u_float, 1, MPI_FLOAT, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_DOUBLE:
     case MRC_VAR_DOUBLE:
-      MPI_Send(&pv->u_double, 1, MPI_DOUBLE, par->rank_diagsrv,
-         ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, &pv->u_double, 1, MPI_DOUBLE, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_STRING:
-      MPI_Send((char *)pv->u_string, strlen(pv->u_string) + 1, MPI_CHAR, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, (char *)pv->u_string, strlen(pv->u_string) + 1, MPI_CHAR,
+			      ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_INT3:
-      MPI_Send(pv->u_int3, 3, MPI_INT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, pv->u_int3, 3, MPI_INT, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_FLOAT3:
-      MPI_Send(pv->u_float3, 3, MPI_FLOAT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, pv->u_float3, 3, MPI_FLOAT, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_DOUBLE3:
     case MRC_VAR_DOUBLE3:
-      MPI_Send(pv->u_double3, 3, MPI_DOUBLE, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, pv->u_double3, 3, MPI_DOUBLE, ID_DIAGS_CMD_WRITE_ATTR);
       break;
     case PT_INT_ARRAY:
-      MPI_Send(&pv->u_int_array.nr_vals, 1, MPI_INT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
-      MPI_Send(pv->u_int_array.vals, pv->u_int_array.nr_vals, MPI_INT, par->rank_diagsrv,
-	       ID_DIAGS_CMD_WRITE_ATTR, MPI_COMM_WORLD);
+      diagc_combined_send_cmd(io, &pv->u_int_array.nr_vals, 1, MPI_INT, ID_DIAGS_CMD_WRITE_ATTR);
+      diagc_combined_send_cmd(io, pv->u_int_array.vals, pv->u_int_array.nr_vals, MPI_INT,
+			      ID_DIAGS_CMD_WRITE_ATTR);
       break;
     default:
       mprintf("type %d\n", type);
@@ -381,6 +509,10 @@ struct mrc_io_ops mrc_io_combined_ops = {
 struct diagsrv_one {
   list_t mrc_io_list;
 
+  MPI_Comm comm; // all servers
+  int nr_servers;
+  int server; // this server's index (rank in comm)
+
   // only valid from open() -> close()
   struct mrc_io *io;
 
@@ -406,11 +538,30 @@ struct diagsrv_srv_ops {
 
 // ----------------------------------------------------------------------
 
+struct diagsrv_block {
+  int rank; // client sending this block
+  int ilo[3], ihi[3]; // global index range
+  int off; // offset into rbuf
+};
+
 struct mrc_io_entry {
   struct mrc_io *io;
   struct mrc_domain *domain;
   int ldims[3];
 
+  // 3d field data: which client sends which block of our slab
+  int slab_off[3], slab_dims[3];
+  int nr_blocks;
+  struct diagsrv_block *blocks;
+  float *rbuf;
+  MPI_Request *reqs;
+
+  // with more than one server, the first one writes 2d slices through its
+  // own io, on a domain with the whole global crds
+  struct mrc_io *io_2d;
+  struct mrc_domain *domain_2d;
+  bool io_2d_open;
+
   char *basename;
   list_t entry;
 };
@@ -432,13 +583,24 @@ create_diagsrv_io(struct diagsrv_one *ds,
 		  const char *format, const char *outdir, const char *basename)
 {
   struct mrc_io_entry *p = calloc(1, sizeof(*p));
-  p->io = mrc_io_create(MPI_COMM_SELF);
+  p->io = mrc_io_create(ds->comm);
   mrc_io_set_type(p->io, format);
   mrc_io_set_param_string(p->io, "outdir", outdir);
   mrc_io_set_param_string(p->io, "basename", basename);
   mrc_io_setup(p->io);
   mrc_io_view(p->io);
 
+  if (ds->nr_servers > 1 && ds->server == 0) {
+    char *basename_2d = malloc(strlen(basename) + 4);
+    sprintf(basename_2d, "%s_2d", basename);
+    p->io_2d = mrc_io_create(MPI_COMM_SELF);
+    mrc_io_set_type(p->io_2d, "xdmf_serial");
+    mrc_io_set_param_string(p->io_2d, "outdir", outdir);
+    mrc_io_set_param_string(p->io_2d, "basename", basename_2d);
+    mrc_io_setup(p->io_2d);
+    free(basename_2d);
+  }
+
   p->basename = strdup(basename);
   list_add_tail(&p->entry, &ds->mrc_io_list);
 }
@@ -463,10 +625,9 @@ ds_srv_set_domain(struct diagsrv_one *ds, struct mrc_domain *domain)
 {
   struct diagsrv_srv *srv = ds->srv;
   srv->domain = domain;
-  int gdims[3];
-  mrc_domain_get_global_dims(domain, gdims);
-  int nglobal = gdims[0] * gdims[1] * gdims[2];
-  srv->gfld = malloc(nglobal * sizeof(float));
+  struct mrc_patch *patches = mrc_domain_get_patches(domain, NULL);
+  int *ldims = patches[0].ldims;
+  srv->gfld = malloc(ldims[0] * ldims[1] * ldims[2] * sizeof(float));
 }
 
 static void
@@ -584,13 +745,22 @@ ds_srv_cache_set_domain(struct diagsrv_one *ds, struct mrc_domain *domain)
 {
   struct diagsrv_srv_cache_ctx *srv = ds->srv;
   srv->domain = domain;
+  // a 3d field only needs our slab, a 2d slice up to a whole plane
   int gdims[3];
   mrc_domain_get_global_dims(domain, gdims);
-  int nglobal = gdims[0] * gdims[1] * gdims[2];
+  struct mrc_patch *patches = mrc_domain_get_patches(domain, NULL);
+  int *ldims = patches[0].ldims;
+  size_t n = ldims[0] * ldims[1] * ldims[2];
+  for (int d = 0; d < 3; d++) {
+    size_t n_plane = gdims[(d+1) % 3] * gdims[(d+2) % 3];
+    if (n < n_plane) {
+      n = n_plane;
+    }
+  }
   for (int i = 0; i < MAX_FIELDS; i++) {
     srv->obj_names[i] = NULL;
     srv->fld_names[i] = NULL;
-    srv->gflds[i] = malloc(nglobal * sizeof(float));
+    srv->gflds[i] = malloc(n * sizeof(float));
   }
 }
 
@@ -792,18 +962,6 @@ add_to_field_2d(struct mrc_fld *g, struct mrc_fld *l, int ib[2])
   mrc_fld_put_as(_l, l);
 }
 
-static void
-add_to_field_3d(struct mrc_fld *g_, struct mrc_fld *l_, int ib[3])
-{
-  struct mrc_fld *g = mrc_fld_get_as(g_, "float");
-  struct mrc_fld *l = mrc_fld_get_as(l_, "float");
-  mrc_fld_foreach(l, ix,iy,iz, 0, 0) {
-    MRC_F3(g,0, ix+ib[0],iy+ib[1],iz+ib[2]) = MRC_F3(l,0, ix,iy,iz);
-  } mrc_fld_foreach_end;
-  mrc_fld_put_as(g, g_);
-  mrc_fld_put_as(l, l_);
-}
-
 // ----------------------------------------------------------------------
 // diagsrv_one
 
@@ -833,25 +991,55 @@ find_ds_srv(const char *ds_srv)
 }
 
 
-static struct mrc_domain *
-diagsrv_recv_domain_info(int nr_procs, int ldims[3])
+// ----------------------------------------------------------------------
+// diagsrv_recv_domain_info
+//
+// sets up the domain the servers write to, which is decomposed into slabs
+// (but otherwise the same as the clients' domain), and finds what blocks
+// of 3d field data each client is going to send
+
+static void
+diagsrv_recv_domain_info(struct diagsrv_one *ds, struct mrc_io_entry *io_entry,
+			 int nr_procs)
 {
+  int *ldims = io_entry->ldims;
   for (int d = 0; d < 3; d++) {
     ldims[d] = 0;
   }
 
   struct mrc_domain *domain = NULL;
   struct mrc_crds *crds = NULL;
+  int *slab_off = io_entry->slab_off, *slab_dims = io_entry->slab_dims;
+  struct diagsrv_block *blocks = calloc(nr_procs, sizeof(*blocks));
+  int nr_blocks = 0, buf_size = 0;
+
   int iw[9], *off = iw, *_ldims = iw + 3, *gdims = iw + 6;
   for (int rank = 0; rank < nr_procs; rank++) {
     MPI_Recv(iw, 9, MPI_INT, rank, ID_DIAGS_CMD_DOMAIN_INFO, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
     if (rank == 0) {
-      domain = mrc_domain_create(MPI_COMM_SELF);
+      diagsrv_slab(gdims, ds->nr_servers, ds->server, slab_off, slab_dims);
+      int np[3] = { 1, 1, 1 };
+      for (int d = 0; d < 3; d++) {
+	if (slab_dims[d] != gdims[d]) {
+	  np[d] = ds->nr_servers;
+	}
+      }
+      domain = mrc_domain_create(ds->comm);
       mrc_domain_set_type(domain, "simple");
       mrc_domain_set_param_int3(domain, "m", gdims);
+      mrc_domain_set_param_int3(domain, "np", np);
+      mrc_domain_set_param_int3(domain, "lm", slab_dims);
       crds = mrc_domain_get_crds(domain);
       mrc_crds_set_type(crds, "rectilinear");
       mrc_domain_setup(domain);
+
+      if (io_entry->io_2d) {
+	io_entry->domain_2d = mrc_domain_create(MPI_COMM_SELF);
+	mrc_domain_set_type(io_entry->domain_2d, "simple");
+	mrc_domain_set_param_int3(io_entry->domain_2d, "m", gdims);
+	mrc_crds_set_type(mrc_domain_get_crds(io_entry->domain_2d), "rectilinear");
+	mrc_domain_setup(io_entry->domain_2d);
+      }
     }
     for (int d = 0; d < 3; d++) {
       // find max local domain
@@ -865,16 +1053,76 @@ diagsrv_recv_domain_info(int nr_procs, int ldims[3])
       MPI_Recv(buf, _ldims[d], MPI_FLOAT, rank, ID_DIAGS_CMD_CRDX + d, MPI_COMM_WORLD,
 	       MPI_STATUS_IGNORE);
       for (int i = 0; i < _ldims[d]; i++) {
-        MRC_CRD(crds, d, i + off[d]) = buf[i];
+	int li = i + off[d] - slab_off[d];
+	if (li >= 0 && li < slab_dims[d]) {
+	  MRC_CRD(crds, d, li) = buf[i];
+	}
+	if (io_entry->domain_2d) {
+	  MRC_CRD(mrc_domain_get_crds(io_entry->domain_2d), d, i + off[d]) = buf[i];
+	}
       }
       free(buf);
     }
+
+    struct diagsrv_block *b = &blocks[nr_blocks];
+    if (find_intersection(b->ilo, b->ihi, off, _ldims, slab_off, slab_dims)) {
+      b->rank = rank;
+      b->off = buf_size;
+      buf_size += (b->ihi[0] - b->ilo[0]) * (b->ihi[1] - b->ilo[1]) * (b->ihi[2] - b->ilo[2]);
+      nr_blocks++;
+    }
+  }
+
+  io_entry->domain = domain;
+  io_entry->nr_blocks = nr_blocks;
+  io_entry->blocks = blocks;
+  io_entry->rbuf = malloc(buf_size * sizeof(float));
+  io_entry->reqs = calloc(nr_blocks, sizeof(*io_entry->reqs));
+}
+
+// ----------------------------------------------------------------------
+// diagsrv_recv_fld_3d
+//
+// receives our slab of a 3d field, copying the blocks into place in
+// whatever order they arrive
+
+static void
+diagsrv_recv_fld_3d(struct mrc_io_entry *io_entry, struct mrc_fld *gfld3)
+{
+  struct diagsrv_block *blocks = io_entry->blocks;
+  for (int i = 0; i < io_entry->nr_blocks; i++) {
+    struct diagsrv_block *b = &blocks[i];
+    int n = (b->ihi[0] - b->ilo[0]) * (b->ihi[1] - b->ilo[1]) * (b->ihi[2] - b->ilo[2]);
+    MPI_Irecv(io_entry->rbuf + b->off, n, MPI_FLOAT, b->rank, ID_DIAGS_DATA,
+	      MPI_COMM_WORLD, &io_entry->reqs[i]);
   }
-  return domain;
+
+  struct mrc_fld *g = mrc_fld_get_as(gfld3, "float");
+  int *slab_off = io_entry->slab_off;
+  for (int k = 0; k < io_entry->nr_blocks; k++) {
+    int i;
+    MPI_Waitany(io_entry->nr_blocks, io_entry->reqs, &i, MPI_STATUS_IGNORE);
+    struct diagsrv_block *b = &blocks[i];
+    float *buf = io_entry->rbuf + b->off;
+    for (int iz = b->ilo[2]; iz < b->ihi[2]; iz++) {
+      for (int iy = b->ilo[1]; iy < b->ihi[1]; iy++) {
+	for (int ix = b->ilo[0]; ix < b->ihi[0]; ix++) {
+	  MRC_F3(g,0, ix - slab_off[0], iy - slab_off[1], iz - slab_off[2]) = *buf++;
+	}
+      }
+    }
+  }
+  mrc_fld_put_as(g, gfld3);
 }
 
 void
 mrc_io_server(const char *ds_format, const char *ds_srv, int nr_procs)
+{
+  mrc_io_servers(MPI_COMM_SELF, ds_format, ds_srv, nr_procs);
+}
+
+void
+mrc_io_servers(MPI_Comm comm, const char *ds_format, const char *ds_srv, int nr_procs)
 {
   struct diagsrv_params {
     char *format;
@@ -900,7 +1148,10 @@ static struct param diagsrv_params_descr[] = {
   struct diagsrv_srv_ops *srv_ops = find_ds_srv(par.server);
   struct diagsrv_one ds = {
     .srv_ops    = srv_ops,
+    .comm       = comm,
   };
+  MPI_Comm_size(comm, &ds.nr_servers);
+  MPI_Comm_rank(comm, &ds.server);
   INIT_LIST_HEAD(&ds.mrc_io_list);
 
   int respond_to_rank = -1;
@@ -1022,7 +1273,7 @@ static struct param diagsrv_params_descr[] = {
 	continue;
       } else if (status.MPI_TAG == ID_DIAGS_CMD_CREATE) {
 	assert (!io_entry->domain);
-	io_entry->domain = diagsrv_recv_domain_info(nr_procs, io_entry->ldims);
+	diagsrv_recv_domain_info(&ds, io_entry, nr_procs);
 	srv_ops->set_domain(&ds, io_entry->domain);
 	mrc_domain_get_global_dims(io_entry->domain, gdims);
 	int *ldims = io_entry->ldims;
@@ -1049,6 +1300,9 @@ static struct param diagsrv_params_descr[] = {
 	float sheet;
 	MPI_Recv(&sheet, 1, MPI_FLOAT, 0, ID_DIAGS_CMD_WRITE, MPI_COMM_WORLD,
 		 MPI_STATUS_IGNORE);
+	if (ds.server != 0) { // the first server does all 2d slices
+	  continue;
+	}
 
 	int i0 = -1, i1 = -1;
 	switch (outtype) {
@@ -1059,7 +1313,15 @@ static struct param diagsrv_params_descr[] = {
 	  assert(0);
 	}
 
-	struct mrc_fld *gfld2 = srv_ops->get_gfld_2d(&ds, (int [2]) { gdims[i0], gdims[i1] });
+	struct mrc_fld *gfld2;
+	if (io_entry->io_2d) {
+	  gfld2 = mrc_fld_create(MPI_COMM_SELF);
+	  mrc_fld_set_param_int_array(gfld2, "dims", 3, (int[3]) { gdims[i0], gdims[i1], 1 });
+	  mrc_fld_setup(gfld2);
+	  gfld2->_domain = io_entry->domain_2d; // FIXME, same hack as in get_gfld_2d()
+	} else {
+	  gfld2 = srv_ops->get_gfld_2d(&ds, (int [2]) { gdims[i0], gdims[i1] });
+	}
 
 	for (int k = 0; k < nr_procs; k++) {
 	  int iw[6], *off = iw, *dims = iw + 3; // off, then dims
@@ -1080,29 +1342,20 @@ static struct param diagsrv_params_descr[] = {
 	  }
 	}
 
-	srv_ops->put_gfld_2d(&ds, gfld2, fld_name80, outtype, sheet);
-      } else {
-	struct mrc_fld *gfld3 = srv_ops->get_gfld_3d(&ds, gdims);
-
-	for (int k = 0; k < nr_procs; k++) {
-	  int iw[6], *off = iw, *dims = iw + 3; // off, then dims
-	  MPI_Recv(iw, 6, MPI_INT, k, ID_DIAGS_SUBDOMAIN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-	  // receive data and add to field
-	  if (iw[0] > -1) {
-	    struct mrc_fld *lfld3 = mrc_fld_create(MPI_COMM_SELF);
-	    mrc_fld_set_param_int_array(lfld3, "dims", 4,
-				       (int[4]) { dims[0], dims[1], dims[2], 1 });
-	    mrc_fld_set_array(lfld3, w2);
-	    mrc_fld_setup(lfld3);
-	    struct mrc_fld *_lfld3 = mrc_fld_get_as(lfld3, "float");
-	    MPI_Recv(lfld3->_nd->arr, mrc_fld_len(lfld3), MPI_FLOAT, k, ID_DIAGS_DATA, MPI_COMM_WORLD,
-		     MPI_STATUS_IGNORE);
-	    mrc_fld_put_as(_lfld3, lfld3);
-	    add_to_field_3d(gfld3, lfld3, off);
-	    mrc_fld_destroy(lfld3);
+	if (io_entry->io_2d) {
+	  if (!io_entry->io_2d_open) {
+	    mrc_io_open(io_entry->io_2d, "w", step, time);
+	    io_entry->io_2d_open = true;
 	  }
+	  mrc_fld_set_comp_name(gfld2, 0, fld_name80);
+	  mrc_io_write_field2d(io_entry->io_2d, 1., gfld2, outtype, sheet);
+	  mrc_fld_destroy(gfld2);
+	} else {
+	  srv_ops->put_gfld_2d(&ds, gfld2, fld_name80, outtype, sheet);
 	}
+      } else {
+	struct mrc_fld *gfld3 = srv_ops->get_gfld_3d(&ds, gdims);
+	diagsrv_recv_fld_3d(io_entry, gfld3);
 
 	mrc_fld_set_name(gfld3, obj_name80);
 	mrc_fld_set_comp_name(gfld3, 0, fld_name80);
@@ -1111,6 +1364,10 @@ static struct param diagsrv_params_descr[] = {
     }
     srv_ops->close(&ds);
     ds.io = NULL;
+    if (io_entry->io_2d_open) {
+      mrc_io_close(io_entry->io_2d);
+      io_entry->io_2d_open = false;
+    }
   }  //for (;;) //loop waiting for data to write...
   free(w2);
 
@@ -1118,6 +1375,11 @@ static struct param diagsrv_params_descr[] = {
     struct mrc_io_entry *p = list_entry(ds.mrc_io_list.next, struct mrc_io_entry, entry);
     mrc_io_destroy(p->io);
     mrc_domain_destroy(p->domain);
+    mrc_io_destroy(p->io_2d);
+    mrc_domain_destroy(p->domain_2d);
+    free(p->blocks);
+    free(p->rbuf);
+    free(p->reqs);
     list_del(&p->entry);
     free(p);
   }
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 
 // ======================================================================
 
@@ -20,6 +21,8 @@ struct xdmf_file {
   list_t xdmf_spatial_list;
 };
 
+struct xdmf_job;
+
 struct xdmf {
   int slab_dims[3];
   int slab_off[3];
@@ -29,10 +32,28 @@ struct xdmf {
   char *romio_cb_write;
   char *romio_ds_write;
   int nr_writers;
+  bool async;            //< writers write to hdf5 on a separate thread
+  int chunk_dims[3];     //< hdf5 chunk size for 3d fields, 0 = not chunked
+  int compression;       //< gzip level for 3d fields, 0 = off
+  bool shuffle;          //< shuffle filter before gzip
   MPI_Comm comm_writers; //< communicator for only the writers
   int *writers;          //< rank (in mrc_io comm) for each writer
   int is_writer;         //< this rank is a writer
   char *mode;            //< open mode, "r" or "w"
+
+  // async state, see "async flush" below
+  pthread_t flush_thread;
+  pthread_mutex_t flush_lock;
+  pthread_cond_t flush_cond;
+  struct xdmf_job *jobs_head, *jobs_tail;
+  bool flush_quit;
+  struct mrc_ndarray *stage[2]; //< staging buffers for 3d fields
+  bool stage_busy[2];
+  int cur_stage;
+  bool flush_running;
+
+  struct mrc_redist redist; //< gather plan for 3d fields, kept across writes
+  bool have_redist;
 };
 
 #define VAR(x) (void *)offsetof(struct xdmf, x)
@@ -43,12 +64,218 @@ static struct param xdmf_collective_descr[] = {
   { "romio_ds_write"         , VAR(romio_ds_write)          , PARAM_STRING(NULL)     },
   { "slab_dims"              , VAR(slab_dims)               , PARAM_INT3(0, 0, 0)    },
   { "slab_off"               , VAR(slab_off)                , PARAM_INT3(0, 0, 0)    },
+  { "async"                  , VAR(async)                   , PARAM_BOOL(false)      },
+  { "chunk_dims"             , VAR(chunk_dims)              , PARAM_INT3(0, 0, 0)    },
+  { "compression"            , VAR(compression)             , PARAM_INT(0)           },
+  { "shuffle"                , VAR(shuffle)                 , PARAM_BOOL(true)       },
   {},
 };
 #undef VAR
 
 #define to_xdmf(io) mrc_to_subobj(io, struct xdmf)
 
+// ======================================================================
+// async flush
+//
+// With "async", whatever the writers do to the h5 file while writing a
+// step (attributes, 3d fields, closing the file) is queued up as jobs that
+// a flush thread runs in order. A 3d field component is written out of one
+// staging buffer while the next one is being gathered into the other, and
+// the writes still pending at close overlap with whatever the caller does
+// next. Every writer queues the same jobs in the same order, so collective
+// hdf5 calls still match up. Anything else that touches the h5 file waits
+// for the queue to drain first.
+// Without "async", jobs are run right away.
+
+enum {
+  XDMF_JOB_ATTR,
+  XDMF_JOB_FLD,
+  XDMF_JOB_CLOSE,
+};
+
+struct xdmf_job {
+  struct xdmf_job *next;
+  int type;
+  hid_t h5_file;
+  char *path;
+  char *name;
+  // XDMF_JOB_ATTR
+  int attr_type;
+  union param_u val;
+  // XDMF_JOB_FLD
+  int m;
+  bool first_comp;
+  struct mrc_ndarray *nd;
+  int stage; //< staging buffer nd is, or -1
+  int slab_offs[3];
+  int slab_dims[3];
+};
+
+static void writer_write_attr(struct mrc_io *io, hid_t h5_file, const char *path,
+			      int type, const char *name, union param_u *pv);
+static void writer_write_fld(struct mrc_io *io, struct xdmf_job *job);
+
+// ----------------------------------------------------------------------
+// xdmf_job_run
+
+static void
+xdmf_job_run(struct mrc_io *io, struct xdmf_job *job)
+{
+  switch (job->type) {
+  case XDMF_JOB_ATTR:
+    writer_write_attr(io, job->h5_file, job->path, job->attr_type, job->name,
+		      &job->val);
+    break;
+  case XDMF_JOB_FLD:
+    writer_write_fld(io, job);
+    break;
+  case XDMF_JOB_CLOSE:
+    H5Fclose(job->h5_file);
+    break;
+  default:
+    assert(0);
+  }
+}
+
+// ----------------------------------------------------------------------
+// xdmf_job_destroy
+
+static void
+xdmf_job_destroy(struct xdmf_job *job)
+{
+  if (job->type == XDMF_JOB_ATTR) {
+    if (job->attr_type == PT_STRING) {
+      free((char *) job->val.u_string);
+    } else if (job->attr_type == PT_INT_ARRAY) {
+      free(job->val.u_int_array.vals);
+    }
+  }
+  free(job->path);
+  free(job->name);
+  free(job);
+}
+
+// ----------------------------------------------------------------------
+// xdmf_flush_thread
+
+static void *
+xdmf_flush_thread(void *arg)
+{
+  struct mrc_io *io = arg;
+  struct xdmf *xdmf = to_xdmf(io);
+
+  pthread_mutex_lock(&xdmf->flush_lock);
+  for (;;) {
+    while (!xdmf->jobs_head && !xdmf->flush_quit) {
+      pthread_cond_wait(&xdmf->flush_cond, &xdmf->flush_lock);
+    }
+    if (!xdmf->jobs_head) {
+      break;
+    }
+
+    // the job stays at the head of the queue while it's running, so that
+    // xdmf_flush_wait() waits for it, too
+    struct xdmf_job *job = xdmf->jobs_head;
+    pthread_mutex_unlock(&xdmf->flush_lock);
+    xdmf_job_run(io, job);
+    pthread_mutex_lock(&xdmf->flush_lock);
+
+    xdmf->jobs_head = job->next;
+    if (!xdmf->jobs_head) {
+      xdmf->jobs_tail = NULL;
+    }
+    if (job->type == XDMF_JOB_FLD && job->stage >= 0) {
+      xdmf->stage_busy[job->stage] = false;
+    }
+    xdmf_job_destroy(job);
+    pthread_cond_broadcast(&xdmf->flush_cond);
+  }
+  pthread_mutex_unlock(&xdmf->flush_lock);
+
+  return NULL;
+}
+
+// ----------------------------------------------------------------------
+// xdmf_job_submit
+
+static void
+xdmf_job_submit(struct mrc_io *io, struct xdmf_job *job)
+{
+  struct xdmf *xdmf = to_xdmf(io);
+
+  if (!xdmf->flush_running) {
+    xdmf_job_run(io, job);
+    xdmf_job_destroy(job);
+    return;
+  }
+
+  pthread_mutex_lock(&xdmf->flush_lock);
+  if (xdmf->jobs_tail) {
+    xdmf->jobs_tail->next = job;
+  } else {
+    xdmf->jobs_head = job;
+  }
+  xdmf->jobs_tail = job;
+  pthread_cond_broadcast(&xdmf->flush_cond);
+  pthread_mutex_unlock(&xdmf->flush_lock);
+}
+
+// ----------------------------------------------------------------------
+// xdmf_flush_wait
+//
+// wait until all queued jobs have been run
+
+static void
+xdmf_flush_wait(struct xdmf *xdmf)
+{
+  if (!xdmf->flush_running) {
+    return;
+  }
+
+  pthread_mutex_lock(&xdmf->flush_lock);
+  while (xdmf->jobs_head) {
+    pthread_cond_wait(&xdmf->flush_cond, &xdmf->flush_lock);
+  }
+  pthread_mutex_unlock(&xdmf->flush_lock);
+}
+
+// ----------------------------------------------------------------------
+// xdmf_get_stage
+//
+// returns staging buffer s, shaped like tmpl, once it's no longer being
+// written from
+
+static struct mrc_ndarray *
+xdmf_get_stage(struct xdmf *xdmf, int s, struct mrc_ndarray *tmpl)
+{
+  pthread_mutex_lock(&xdmf->flush_lock);
+  while (xdmf->stage_busy[s]) {
+    pthread_cond_wait(&xdmf->flush_cond, &xdmf->flush_lock);
+  }
+  pthread_mutex_unlock(&xdmf->flush_lock);
+
+  struct mrc_ndarray *nd = xdmf->stage[s];
+  if (nd && (mrc_ndarray_data_type(nd) != mrc_ndarray_data_type(tmpl) ||
+	     memcmp(mrc_ndarray_dims(nd), mrc_ndarray_dims(tmpl), 3 * sizeof(int)) != 0 ||
+	     memcmp(mrc_ndarray_offs(nd), mrc_ndarray_offs(tmpl), 3 * sizeof(int)) != 0)) {
+    mrc_ndarray_destroy(nd);
+    nd = NULL;
+  }
+  if (!nd) {
+    nd = mrc_ndarray_create(MPI_COMM_SELF);
+    mrc_ndarray_set_param_int_array(nd, "dims", 3, mrc_ndarray_dims(tmpl));
+    mrc_ndarray_set_param_int_array(nd, "offs", 3, mrc_ndarray_offs(tmpl));
+    mrc_ndarray_set_type(nd, mrc_ndarray_type(tmpl));
+    mrc_ndarray_setup(nd);
+    xdmf->stage[s] = nd;
+  }
+
+  pthread_mutex_lock(&xdmf->flush_lock);
+  xdmf->stage_busy[s] = true;
+  pthread_mutex_unlock(&xdmf->flush_lock);
+  return nd;
+}
+
 // ----------------------------------------------------------------------
 // xdmf_collective_setup
 
@@ -79,6 +306,44 @@ xdmf_collective_setup(struct mrc_io *io)
       xdmf->is_writer = 1;
   }
   MPI_Comm_split(mrc_io_comm(io), xdmf->is_writer, io->rank, &xdmf->comm_writers);
+
+  if (!xdmf->is_writer) {
+    return;
+  }
+
+#ifdef H5_HAVE_PARALLEL
+  if (xdmf->compression > 0 && xdmf->use_independent_io && xdmf->nr_writers > 1) {
+    mpi_printf(xdmf->comm_writers, "WARNING: xdmf_collective: parallel hdf5 "
+	       "can't compress with independent io, not compressing.\n");
+    xdmf->compression = 0;
+  }
+#endif
+
+  if (xdmf->async) {
+    // the flush thread's hdf5 calls may overlap with the ones made while
+    // writing the next field
+    hbool_t threadsafe = 0;
+    H5is_library_threadsafe(&threadsafe);
+    if (!threadsafe) {
+      mpi_printf(xdmf->comm_writers, "WARNING: xdmf_collective: async needs "
+		 "a thread-safe hdf5 library, writing synchronously.\n");
+      return;
+    }
+#ifdef H5_HAVE_PARALLEL
+    // the flush thread's mpi-io calls will run concurrently with our own
+    int provided;
+    MPI_Query_thread(&provided);
+    if (provided < MPI_THREAD_MULTIPLE) {
+      mpi_printf(xdmf->comm_writers, "WARNING: xdmf_collective: async needs "
+		 "MPI_THREAD_MULTIPLE, writing synchronously.\n");
+      return;
+    }
+#endif
+    pthread_mutex_init(&xdmf->flush_lock, NULL);
+    pthread_cond_init(&xdmf->flush_cond, NULL);
+    int ierr = pthread_create(&xdmf->flush_thread, NULL, xdmf_flush_thread, io); CE;
+    xdmf->flush_running = true;
+  }
 }
 
 // ----------------------------------------------------------------------
@@ -88,6 +353,24 @@ static void
 xdmf_collective_destroy(struct mrc_io *io)
 {
   struct xdmf *xdmf = to_xdmf(io);
+
+  if (xdmf->flush_running) {
+    pthread_mutex_lock(&xdmf->flush_lock);
+    xdmf->flush_quit = true;
+    pthread_cond_broadcast(&xdmf->flush_cond);
+    pthread_mutex_unlock(&xdmf->flush_lock);
+    pthread_join(xdmf->flush_thread, NULL);
+    pthread_cond_destroy(&xdmf->flush_cond);
+    pthread_mutex_destroy(&xdmf->flush_lock);
+    xdmf->flush_running = false;
+  }
+  for (int s = 0; s < 2; s++) {
+    mrc_ndarray_destroy(xdmf->stage[s]);
+  }
+  if (xdmf->have_redist) {
+    mrc_redist_destroy(&xdmf->redist);
+    xdmf->have_redist = false;
+  }
   
   free(xdmf->writers);
   if (xdmf->comm_writers) {
@@ -115,6 +398,9 @@ xdmf_collective_open(struct mrc_io *io, const char *mode)
 	  io->step, 0);
 
   if (xdmf->is_writer) {
+    // the previous file may still be being closed
+    xdmf_flush_wait(xdmf);
+
     hid_t plist = H5Pcreate(H5P_FILE_ACCESS);
     MPI_Info info;
     MPI_Info_create(&info);
@@ -151,7 +437,10 @@ xdmf_collective_close(struct mrc_io *io)
 
   xdmf_spatial_close(&file->xdmf_spatial_list, io, xdmf->xdmf_temporal);
   if (xdmf->is_writer) {
-    H5Fclose(file->h5_file);
+    struct xdmf_job *job = calloc(1, sizeof(*job));
+    job->type = XDMF_JOB_CLOSE;
+    job->h5_file = file->h5_file;
+    xdmf_job_submit(io, job);
     memset(file, 0, sizeof(*file));
   }
   free(xdmf->mode);
@@ -159,22 +448,16 @@ xdmf_collective_close(struct mrc_io *io)
 }
 
 static void
-xdmf_collective_write_attr(struct mrc_io *io, const char *path, int type,
-		const char *name, union param_u *pv)
+writer_write_attr(struct mrc_io *io, hid_t h5_file, const char *path, int type,
+		  const char *name, union param_u *pv)
 {
-  struct xdmf *xdmf = to_xdmf(io);
-  struct xdmf_file *file = &xdmf->file;
   int ierr;
   
-  if (!xdmf->is_writer) {
-    // FIXME? should check whether the attribute is the same on every proc?
-    return;
-  }
   hid_t group;
-  if (H5Lexists(file->h5_file, path, H5P_DEFAULT) > 0) {
-    group = H5Gopen(file->h5_file, path, H5P_DEFAULT); H5_CHK(group);
+  if (H5Lexists(h5_file, path, H5P_DEFAULT) > 0) {
+    group = H5Gopen(h5_file, path, H5P_DEFAULT); H5_CHK(group);
   } else {
-    group = H5Gcreate(file->h5_file, path, H5P_DEFAULT, H5P_DEFAULT,
+    group = H5Gcreate(h5_file, path, H5P_DEFAULT, H5P_DEFAULT,
 		      H5P_DEFAULT); H5_CHK(group);
   }
 
@@ -237,6 +520,39 @@ xdmf_collective_write_attr(struct mrc_io *io, const char *path, int type,
   ierr = H5Gclose(group); CE;
 }
 
+// ----------------------------------------------------------------------
+// xdmf_collective_write_attr
+
+static void
+xdmf_collective_write_attr(struct mrc_io *io, const char *path, int type,
+		const char *name, union param_u *pv)
+{
+  struct xdmf *xdmf = to_xdmf(io);
+  struct xdmf_file *file = &xdmf->file;
+  
+  if (!xdmf->is_writer) {
+    // FIXME? should check whether the attribute is the same on every proc?
+    return;
+  }
+
+  // the job may run later, so it needs its own copy of the value
+  struct xdmf_job *job = calloc(1, sizeof(*job));
+  job->type = XDMF_JOB_ATTR;
+  job->h5_file = file->h5_file;
+  job->path = strdup(path);
+  job->name = strdup(name);
+  job->attr_type = type;
+  job->val = *pv;
+  if (type == PT_STRING && pv->u_string) {
+    job->val.u_string = strdup(pv->u_string);
+  } else if (type == PT_INT_ARRAY) {
+    int nr_vals = pv->u_int_array.nr_vals;
+    job->val.u_int_array.vals = malloc(nr_vals * sizeof(int));
+    memcpy(job->val.u_int_array.vals, pv->u_int_array.vals, nr_vals * sizeof(int));
+  }
+  xdmf_job_submit(io, job);
+}
+
 static void
 xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
 			  const char *name, union param_u *pv)
@@ -245,6 +561,8 @@ xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
   struct xdmf_file *file = &xdmf->file;
   int ierr;
 
+  xdmf_flush_wait(xdmf);
+
   // read on I/O procs
   if (xdmf->is_writer) {
     hid_t group = H5Gopen(file->h5_file, path, H5P_DEFAULT); H5_CHK(group);
@@ -557,6 +875,9 @@ xdmf_collective_write_m1(struct mrc_io *io, const char *path, struct mrc_fld *m1
   struct xdmf_file *file = &xdmf->file;
   int ierr;
 
+  // this one writes synchronously, so let pending writes go first
+  xdmf_flush_wait(xdmf);
+
   struct collective_m1_ctx ctx;
   int nr_comps = mrc_fld_nr_comps(m1);
   mrc_fld_get_param_int(m1, "dim", &ctx.dim);
@@ -729,6 +1050,8 @@ xdmf_collective_read_m1(struct mrc_io *io, const char *path, struct mrc_fld *m1)
   struct xdmf_file *file = &xdmf->file;
   int ierr;
 
+  xdmf_flush_wait(xdmf);
+
   assert(mrc_fld_data_type(m1) == MRC_NT_FLOAT);
   struct collective_m1_ctx ctx;
   int gdims[3];
@@ -807,33 +1130,36 @@ xdmf_collective_read_m1(struct mrc_io *io, const char *path, struct mrc_fld *m1)
 // only called on writer procs
 
 static void
-writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
-		 const char *path, struct mrc_ndarray *nd, int m,
-		 struct mrc_fld *m3, struct xdmf_spatial *xs, hid_t group0)
+writer_write_fld(struct mrc_io *io, struct xdmf_job *job)
 {
+  struct xdmf *xdmf = to_xdmf(io);
+  struct mrc_ndarray *nd = job->nd;
   int ierr;
 
-  char default_name[100];
-  const char *compname;
-
-  // If the comps aren't named just name them by their component number
-  if ( !(compname = mrc_fld_comp_name(m3, m)) ) {
-    sprintf(default_name, "_UNSET_%d", m);
-    compname = (const char *) default_name;
+  hid_t group0;
+  if (H5Lexists(job->h5_file, job->path, H5P_DEFAULT) > 0) {
+    group0 = H5Gopen(job->h5_file, job->path, H5P_DEFAULT); H5_CHK(group0);
+  } else {
+    assert(0); // FIXME, can this happen?
+    group0 = H5Gcreate(job->h5_file, job->path, H5P_DEFAULT,
+		       H5P_DEFAULT, H5P_DEFAULT); H5_CHK(group0);
+  }
+  if (job->first_comp) {
+    int nr_1 = 1;
+    H5LTset_attribute_int(group0, ".", "nr_patches", &nr_1, 1);
   }
 
-  xdmf_spatial_save_fld_info(xs, strdup(compname), strdup(path), false, mrc_fld_data_type(m3));
-
-  hid_t group_fld = H5Gcreate(group0, compname, H5P_DEFAULT,
+  hid_t group_fld = H5Gcreate(group0, job->name, H5P_DEFAULT,
 			      H5P_DEFAULT, H5P_DEFAULT); H5_CHK(group_fld);
-  ierr = H5LTset_attribute_int(group_fld, ".", "m", &m, 1); CE;
+  ierr = H5LTset_attribute_int(group_fld, ".", "m", &job->m, 1); CE;
   
   hid_t group = H5Gcreate(group_fld, "p0", H5P_DEFAULT,
 			  H5P_DEFAULT, H5P_DEFAULT); H5_CHK(group);
   int i0 = 0;
   ierr = H5LTset_attribute_int(group, ".", "global_patch", &i0, 1); CE;
 
-  hsize_t fdims[3] = { redist->slab_dims[2], redist->slab_dims[1], redist->slab_dims[0] };
+  const int *slab_dims = job->slab_dims, *slab_offs = job->slab_offs;
+  hsize_t fdims[3] = { slab_dims[2], slab_dims[1], slab_dims[0] };
   hid_t filespace = H5Screate_simple(3, fdims, NULL); H5_CHK(filespace);
   hid_t dtype;
   switch (mrc_ndarray_data_type(nd)) {
@@ -843,11 +1169,28 @@ writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
   default: assert(0);
   }
 
+  // compression needs chunking; by default, chunks are x-y planes
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE); H5_CHK(dcpl);
+  const int *cd = xdmf->chunk_dims;
+  if (cd[0] || cd[1] || cd[2] || xdmf->compression > 0) {
+    hsize_t cdims[3];
+    for (int d = 0; d < 3; d++) {
+      int c = cd[d] > 0 ? cd[d] : (d < 2 ? slab_dims[d] : 1);
+      cdims[2 - d] = MIN(c, slab_dims[d]);
+    }
+    ierr = H5Pset_chunk(dcpl, 3, cdims); CE;
+    if (xdmf->compression > 0) {
+      if (xdmf->shuffle) {
+	ierr = H5Pset_shuffle(dcpl); CE;
+      }
+      ierr = H5Pset_deflate(dcpl, xdmf->compression); CE;
+    }
+  }
+
   hid_t dset = H5Dcreate(group, "3d", dtype, filespace, H5P_DEFAULT,
-			 H5P_DEFAULT, H5P_DEFAULT); H5_CHK(dset);
+			 dcpl, H5P_DEFAULT); H5_CHK(dset);
   hid_t dxpl = H5Pcreate(H5P_DATASET_XFER); H5_CHK(dxpl);
 #ifdef H5_HAVE_PARALLEL
-  struct xdmf *xdmf = to_xdmf(io);
   if (xdmf->use_independent_io) {
     ierr = H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_INDEPENDENT); CE;
   } else {
@@ -856,9 +1199,9 @@ writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
 #endif
   const int *im = mrc_ndarray_dims(nd), *ib = mrc_ndarray_offs(nd);
   hsize_t mdims[3] = { im[2], im[1], im[0] };
-  hsize_t foff[3] = { ib[2] - redist->slab_offs[2],
-		      ib[1] - redist->slab_offs[1],
-		      ib[0] - redist->slab_offs[0] };
+  hsize_t foff[3] = { ib[2] - slab_offs[2],
+		      ib[1] - slab_offs[1],
+		      ib[0] - slab_offs[0] };
   hid_t memspace = H5Screate_simple(3, mdims, NULL);
   ierr = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foff, NULL,
 			     mdims, NULL); CE;
@@ -869,9 +1212,11 @@ writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
   ierr = H5Sclose(memspace); CE;
   ierr = H5Sclose(filespace); CE;
   ierr = H5Pclose(dxpl); CE;
+  ierr = H5Pclose(dcpl); CE;
 
   ierr = H5Gclose(group); CE;
   ierr = H5Gclose(group_fld); CE;
+  ierr = H5Gclose(group0); CE;
 }
 
 // ----------------------------------------------------------------------
@@ -882,9 +1227,15 @@ xdmf_collective_write_m3(struct mrc_io *io, const char *path, struct mrc_fld *m3
 {
   struct xdmf *xdmf = to_xdmf(io);
 
-  struct mrc_redist redist[1];
-  mrc_redist_init(redist, m3->_domain, xdmf->slab_off, xdmf->slab_dims,
-		  xdmf->nr_writers);
+  // the plan only gets rebuilt if the domain / its balancing has changed
+  struct mrc_redist *redist = &xdmf->redist;
+  if (!xdmf->have_redist) {
+    mrc_redist_init(redist, m3->_domain, xdmf->slab_off, xdmf->slab_dims,
+		    xdmf->nr_writers);
+    xdmf->have_redist = true;
+  } else {
+    mrc_redist_update(redist, m3->_domain);
+  }
 
   struct xdmf_file *file = &xdmf->file;
   struct xdmf_spatial *xs = xdmf_spatial_find(&file->xdmf_spatial_list,
@@ -907,41 +1258,56 @@ xdmf_collective_write_m3(struct mrc_io *io, const char *path, struct mrc_fld *m3
     }
   }
 
-  hid_t group0 = 0;
-
-  if (xdmf->is_writer) {
-    if (H5Lexists(file->h5_file, path, H5P_DEFAULT) > 0) {
-      group0 = H5Gopen(file->h5_file, path, H5P_DEFAULT);
-    } else {
-      assert(0); // FIXME, can this happen?
-      group0 = H5Gcreate(file->h5_file, path, H5P_DEFAULT,
-			 H5P_DEFAULT, H5P_DEFAULT); H5_CHK(group0);
-    }
-    int nr_1 = 1;
-    H5LTset_attribute_int(group0, ".", "nr_patches", &nr_1, 1);
-  }
-
   struct mrc_ndarray *nd = mrc_redist_get_ndarray(redist, m3_soa);
 
   for (int m = 0; m < mrc_fld_nr_comps(m3); m++) {
-    mrc_redist_run(redist, nd, m3_soa, m);
+    // when writing async, gather into the staging buffer that's not
+    // (or no longer) being written from
+    struct mrc_ndarray *buf = nd;
+    int stage = -1;
+    if (xdmf->flush_running && redist->is_writer) {
+      stage = xdmf->cur_stage;
+      xdmf->cur_stage = !xdmf->cur_stage;
+      buf = xdmf_get_stage(xdmf, stage, nd);
+    }
+
+    mrc_redist_run(redist, buf, m3_soa, m);
 
     if (redist->is_writer) {
-      writer_write_fld(redist, io, path, nd, m, m3, xs, group0);
+      char default_name[100];
+      const char *compname;
+
+      // If the comps aren't named just name them by their component number
+      if ( !(compname = mrc_fld_comp_name(m3, m)) ) {
+	sprintf(default_name, "_UNSET_%d", m);
+	compname = (const char *) default_name;
+      }
+
+      xdmf_spatial_save_fld_info(xs, strdup(compname), strdup(path), false,
+				 mrc_fld_data_type(m3));
+
+      struct xdmf_job *job = calloc(1, sizeof(*job));
+      job->type = XDMF_JOB_FLD;
+      job->h5_file = file->h5_file;
+      job->path = strdup(path);
+      job->name = strdup(compname);
+      job->m = m;
+      job->first_comp = (m == 0);
+      job->nd = buf;
+      job->stage = stage;
+      for (int d = 0; d < 3; d++) {
+	job->slab_offs[d] = redist->slab_offs[d];
+	job->slab_dims[d] = redist->slab_dims[d];
+      }
+      xdmf_job_submit(io, job);
     }
   }
 
   mrc_redist_put_ndarray(redist, nd);
-  
-  if (xdmf->is_writer) {
-    H5Gclose(group0);
-  }
 
   if (m3->_aos) {
     mrc_fld_put_as(m3_soa, m3);
   }
-
-  mrc_redist_destroy(redist);
 }
 
 // ======================================================================
@@ -1400,6 +1766,8 @@ xdmf_collective_read_m3(struct mrc_io *io, const char *path, struct mrc_fld *m3)
   struct xdmf_file *file = &xdmf->file;
   int ierr;
 
+  xdmf_flush_wait(xdmf);
+
   //assert(m3->_data_type == MRC_NT_FLOAT);
   struct collective_m3_ctx ctx;
   collective_m3_init(io, &ctx, m3->_domain);
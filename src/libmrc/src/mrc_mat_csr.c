@@ -8,6 +8,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define SELL_C_MAX (64)
+
 // ----------------------------------------------------------------------
 // mrc_mat_csr_create
 
@@ -41,6 +43,7 @@ mrc_mat_csr_setup(struct mrc_mat *mat)
   assert(size == 1);
   
   assert(sub->nr_initial_cols > 0);
+  assert(sub->sell_c >= 0 && sub->sell_c <= SELL_C_MAX);
   
   sub->nr_vals = 0;
   sub->nr_rows = mat->m;
@@ -88,6 +91,8 @@ mrc_mat_csr_destroy(struct mrc_mat *mat)
     assert(sub->_init_vals == NULL && sub->_init_cols == NULL &&
            sub->_nr_cols == NULL && sub->_nr_cols_alloced == NULL);
   }
+
+  mrc_mat_csr_sell_invalidate(mat);
 }
 
 // ----------------------------------------------------------------------
@@ -204,6 +209,8 @@ mrc_mat_csr_assemble(struct mrc_mat *mat)
 {
   struct mrc_mat_csr *sub = mrc_mat_csr(mat);
 
+  mrc_mat_csr_sell_invalidate(mat);
+
   mrc_vec_set_type(sub->rows, "int");
   mrc_vec_set_param_int(sub->rows, "len", sub->nr_rows + 1);  
   mrc_vec_set_type(sub->vals, FLD_TYPE);
@@ -295,9 +302,136 @@ mrc_mat_csr_print(struct mrc_mat *mat)
   }
 }
 
+// ----------------------------------------------------------------------
+// _mrc_mat_csr_sell_setup
+//
+// SELL-C-sigma: rows are sorted by length within windows of sigma rows, then
+// taken C at a time into chunks, each padded to its longest row and stored
+// column-major, so that the C rows of a chunk can be done in SIMD lanes.
+
+struct _mrc_mat_csr_sell_row {
+  int len;
+  int row;
+};
+
+static int
+_mrc_mat_csr_sell_cmp(const void *_a, const void *_b)
+{
+  const struct _mrc_mat_csr_sell_row *a = _a, *b = _b;
+
+  // longest first, and keep the original order otherwise
+  if (a->len != b->len) {
+    return a->len > b->len ? -1 : 1;
+  }
+  return a->row < b->row ? -1 : (a->row > b->row);
+}
+
+static void
+_mrc_mat_csr_sell_setup(struct mrc_mat *mat)
+{
+  struct mrc_mat_csr *sub = mrc_mat_csr(mat);
+  int C = sub->sell_c;
+  int sigma = MAX(sub->sell_sigma, 1);
+
+  mrc_fld_data_t *vals = mrc_vec_get_array(sub->vals);
+  int *cols = mrc_vec_get_array(sub->cols);
+  int *rows = mrc_vec_get_array(sub->rows);
+
+  int *len = malloc(sub->nr_rows * sizeof(*len));
+  struct _mrc_mat_csr_sell_row *by_len = malloc(sub->nr_rows * sizeof(*by_len));
+  for (int row = 0; row < sub->nr_rows; row++) {
+    len[row] = rows[row + 1] - rows[row];
+    by_len[row].len = len[row];
+    by_len[row].row = row;
+  }
+  for (int beg = 0; beg < sub->nr_rows; beg += sigma) {
+    int n = MIN(sigma, sub->nr_rows - beg);
+    qsort(&by_len[beg], n, sizeof(*by_len), _mrc_mat_csr_sell_cmp);
+  }
+
+  sub->_nr_chunks = (sub->nr_rows + C - 1) / C;
+  sub->_sell_rows = malloc(sub->_nr_chunks * C * sizeof(*sub->_sell_rows));
+  for (int i = 0; i < sub->_nr_chunks * C; i++) {
+    sub->_sell_rows[i] = i < sub->nr_rows ? by_len[i].row : -1;
+  }
+  free(by_len);
+
+  sub->_chunk_off = malloc((sub->_nr_chunks + 1) * sizeof(*sub->_chunk_off));
+  sub->_chunk_off[0] = 0;
+  for (int c = 0; c < sub->_nr_chunks; c++) {
+    int max_len = 0;
+    for (int r = 0; r < C; r++) {
+      int row = sub->_sell_rows[c * C + r];
+      if (row >= 0) {
+        max_len = MAX(max_len, len[row]);
+      }
+    }
+    sub->_chunk_off[c + 1] = sub->_chunk_off[c] + max_len * C;
+  }
+
+  // padding has val 0, and repeats the row's last col, so it doesn't gather
+  // from x where the row itself wouldn't (col 0 for empty rows)
+  int nr_sell = sub->_chunk_off[sub->_nr_chunks];
+  sub->_sell_cols = calloc(nr_sell, sizeof(*sub->_sell_cols));
+  sub->_sell_vals = calloc(nr_sell, sizeof(*sub->_sell_vals));
+  for (int c = 0; c < sub->_nr_chunks; c++) {
+    int max_len = (sub->_chunk_off[c + 1] - sub->_chunk_off[c]) / C;
+    for (int r = 0; r < C; r++) {
+      int row = sub->_sell_rows[c * C + r];
+      if (row < 0) {
+        continue;
+      }
+      int pad_col = len[row] > 0 ? cols[rows[row + 1] - 1] : 0;
+      for (int j = 0; j < max_len; j++) {
+        int i = sub->_chunk_off[c] + j * C + r;
+        if (j < len[row]) {
+          sub->_sell_cols[i] = cols[rows[row] + j];
+          sub->_sell_vals[i] = vals[rows[row] + j];
+        } else {
+          sub->_sell_cols[i] = pad_col;
+        }
+      }
+    }
+  }
+
+  if (sub->verbose) {
+    mprintf("csr: SELL-%d-%d, %d chunks, fill %g%%\n", C, sigma,
+            sub->_nr_chunks, 100. * sub->nr_vals / MAX(nr_sell, 1));
+  }
+
+  free(len);
+  mrc_vec_put_array(sub->vals, vals);
+  mrc_vec_put_array(sub->cols, cols);
+  mrc_vec_put_array(sub->rows, rows);
+}
+
+// ----------------------------------------------------------------------
+// mrc_mat_csr_sell_invalidate
+//
+// drops the SELL copy, it'll be remade from vals / cols on the next apply
+
+void
+mrc_mat_csr_sell_invalidate(struct mrc_mat *mat)
+{
+  struct mrc_mat_csr *sub = mrc_mat_csr(mat);
+
+  free(sub->_chunk_off);
+  free(sub->_sell_rows);
+  free(sub->_sell_cols);
+  free(sub->_sell_vals);
+  sub->_chunk_off = NULL;
+  sub->_sell_rows = NULL;
+  sub->_sell_cols = NULL;
+  sub->_sell_vals = NULL;
+  sub->_nr_chunks = 0;
+}
+
 // ----------------------------------------------------------------------
 // mrc_mat_csr_apply_gemv
 // z = alpha * mat * x + beta * y
+//
+// Out of place, rows are done in parallel. In place (z == x), rows have to
+// be done in order, since later rows see the already updated values.
 
 static inline void
 _mrc_mat_csr_apply_gemv(struct mrc_vec *z, mrc_fld_data_t alpha,
@@ -324,18 +458,61 @@ _mrc_mat_csr_apply_gemv(struct mrc_vec *z, mrc_fld_data_t alpha,
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
   mrc_fld_data_t *z_arr = mrc_vec_get_array(z);
 
-  for (int row_idx=0; row_idx < sub->nr_rows; row_idx++) {
-    mrc_fld_data_t sum = 0.0;
-    for (int i=rows[row_idx]; i < rows[row_idx + 1]; i++) {
-      int col_idx = cols[i];
-      sum += alpha * vals[i] * x_arr[col_idx];
+  if (z_arr == x_arr) {
+    for (int row_idx=0; row_idx < sub->nr_rows; row_idx++) {
+      mrc_fld_data_t sum = 0.0;
+      for (int i=rows[row_idx]; i < rows[row_idx + 1]; i++) {
+        int col_idx = cols[i];
+        sum += alpha * vals[i] * x_arr[col_idx];
+      }
+      if (non_zero_beta) {
+        // this is protected by the if statement
+        // in case y_arr == NAN but beta == 0.0
+        sum += beta * y_arr[row_idx];
+      }
+      z_arr[row_idx] = sum;
+    }
+  } else if (sub->sell_c > 0) {
+    const int C = sub->sell_c;
+    if (!sub->_sell_rows) {
+      _mrc_mat_csr_sell_setup(mat);
     }
-    if (non_zero_beta) {
-      // this is protected by the if statement
-      // in case y_arr == NAN but beta == 0.0
-      sum += beta * y_arr[row_idx];
+    const int *sell_rows = sub->_sell_rows, *chunk_off = sub->_chunk_off;
+    const int *sell_cols = sub->_sell_cols;
+    const double *sell_vals = sub->_sell_vals;
+#pragma omp parallel for schedule(static)
+    for (int c = 0; c < sub->_nr_chunks; c++) {
+      mrc_fld_data_t sum[SELL_C_MAX] = {};
+      for (int i = chunk_off[c]; i < chunk_off[c + 1]; i += C) {
+#pragma omp simd
+        for (int r = 0; r < C; r++) {
+          sum[r] += alpha * sell_vals[i + r] * x_arr[sell_cols[i + r]];
+        }
+      }
+      for (int r = 0; r < C; r++) {
+        int row_idx = sell_rows[c * C + r];
+        if (row_idx < 0) {
+          continue;
+        }
+        if (non_zero_beta) {
+          sum[r] += beta * y_arr[row_idx];
+        }
+        z_arr[row_idx] = sum[r];
+      }
+    }
+  } else {
+#pragma omp parallel for schedule(static)
+    for (int row_idx=0; row_idx < sub->nr_rows; row_idx++) {
+      mrc_fld_data_t sum = 0.0;
+      for (int i=rows[row_idx]; i < rows[row_idx + 1]; i++) {
+        int col_idx = cols[i];
+        sum += alpha * vals[i] * x_arr[col_idx];
+      }
+      if (non_zero_beta) {
+        sum += beta * y_arr[row_idx];
+      }
+      z_arr[row_idx] = sum;
     }
-    z_arr[row_idx] = sum;
   }
 
   mrc_vec_put_array(x, x_arr);
@@ -405,6 +582,10 @@ static struct param mrc_mat_csr_descr[] = {
   .help = "How many empty columnts to use for each new row" },
   { "growth_factor"    , VAR(growth_factor)    , PARAM_FLOAT(0.5),
   .help = "Fraction of current nr_cols to add to rows" },
+  { "sell_c"           , VAR(sell_c)           , PARAM_INT(0),
+  .help = "If > 0, apply using SELL-C-sigma with chunks of this many rows" },
+  { "sell_sigma"       , VAR(sell_sigma)       , PARAM_INT(1),
+  .help = "Sort rows by length within windows of this many rows for SELL" },
   {},
 };
 #undef VAR
@@ -45,6 +45,8 @@ struct mrc_mat_csr_mpi {
   bool do_profiling;
   int nr_initial_cols;  // how much initial space to allocate for each new row
   float growth_factor;  // fraction of current # of cols to add when a row needs to grow
+  int sell_c;  // passed on to A and B
+  int sell_sigma;
 };
 
 #define mrc_mat_csr_mpi(mat) mrc_to_subobj(mat, struct mrc_mat_csr_mpi)
@@ -89,6 +91,8 @@ mrc_mat_csr_mpi_setup(struct mrc_mat *mat)
   mrc_mat_set_param_bool(sub->A, "verbose", sub->verbose);
   mrc_mat_set_param_int(sub->A, "nr_initial_cols", sub->nr_initial_cols);
   mrc_mat_set_param_float(sub->A, "growth_factor", sub->growth_factor);
+  mrc_mat_set_param_int(sub->A, "sell_c", sub->sell_c);
+  mrc_mat_set_param_int(sub->A, "sell_sigma", sub->sell_sigma);
   mrc_mat_setup(sub->A);
 
   // B is the off diagonal block, so # of rows = local # of rows,
@@ -100,6 +104,8 @@ mrc_mat_csr_mpi_setup(struct mrc_mat *mat)
   mrc_mat_set_param_bool(sub->B, "verbose", sub->verbose);
   mrc_mat_set_param_int(sub->B, "nr_initial_cols", sub->nr_initial_cols);
   mrc_mat_set_param_float(sub->B, "growth_factor", sub->growth_factor);
+  mrc_mat_set_param_int(sub->B, "sell_c", sub->sell_c);
+  mrc_mat_set_param_int(sub->B, "sell_sigma", sub->sell_sigma);
   mrc_mat_setup(sub->B);
 
   mrc_mat_setup_super(mat);
@@ -315,6 +321,7 @@ mrc_mat_csr_mpi_assemble(struct mrc_mat *mat)
   mrc_vec_put_array(sub_B->cols, b_cols);
   b_rows = NULL;
   b_cols = NULL;  
+  mrc_mat_csr_sell_invalidate(sub->B);
 
   // for each rank, find how many columns we need to receive from that rank
   sub->n_recvs = 0;
@@ -688,6 +695,10 @@ static struct param mrc_mat_csr_mpi_descr[] = {
   .help = "How many empty columnts to use for each new row" },
   { "growth_factor"     , VAR(growth_factor)     , PARAM_FLOAT(0.5),
   .help = "Fraction of current nr_cols to add to rows" },
+  { "sell_c"            , VAR(sell_c)            , PARAM_INT(0),
+  .help = "If > 0, apply using SELL-C-sigma with chunks of this many rows" },
+  { "sell_sigma"        , VAR(sell_sigma)        , PARAM_INT(1),
+  .help = "Sort rows by length within windows of this many rows for SELL" },
   {},
 };
 #undef VAR
@@ -139,7 +139,10 @@ mrc_mat_mcsr_apply(struct mrc_vec *y, struct mrc_mat *mat, struct mrc_vec *x)
   assert(mrc_vec_size_of_type(x) == sizeof(mrc_fld_data_t));
   mrc_fld_data_t *x_arr = mrc_vec_get_array(x);
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
-    
+
+  // rows are added contiguously, so each row_idx only appears once. In place
+  // (y == x), rows have to be done in order, though.
+#pragma omp parallel for schedule(static) if (y_arr != x_arr)
   for (int row = 0; row < sub->nr_rows; row++) {
     int row_idx = sub->rows[row].idx;
     mrc_fld_data_t sum = 0.;
@@ -167,7 +170,8 @@ mrc_mat_mcsr_apply_add(struct mrc_vec *y, struct mrc_mat *mat, struct mrc_vec *x
   assert(mrc_vec_size_of_type(x) == sizeof(mrc_fld_data_t));
   mrc_fld_data_t *x_arr = mrc_vec_get_array(x);
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
-    
+
+#pragma omp parallel for schedule(static) if (y_arr != x_arr)
   for (int row = 0; row < sub->nr_rows; row++) {
     int row_idx = sub->rows[row].idx;
     mrc_fld_data_t sum = 0.;
@@ -4,7 +4,7 @@
 #include <assert.h>
 #include <string.h>
 
-struct prof_globals prof_globals;
+PROF_TLS struct prof_globals prof_globals;
 
 static int prof_inited;
 static int nr_prof_data;
@@ -48,15 +48,16 @@ prof_register(const char *name, float simd, int flops, int bytes)
     prof_init();
   }
 
-  assert(nr_prof_data < MAX_PROF);
-  struct prof_data *p = &prof_data[nr_prof_data++];
+  int pr = __sync_fetch_and_add(&nr_prof_data, 1);
+  assert(pr < MAX_PROF);
+  struct prof_data *p = &prof_data[pr];
 
   p->name = name;
   p->simd = simd;
   p->flops = flops;
   p->bytes = bytes;
 
-  return nr_prof_data;
+  return pr + 1;
 }
 
 void
@@ -123,3 +124,521 @@ prof_print_mpi(MPI_Comm comm)
     pinfo->cnt = 0;
   }
 }
+
+// ======================================================================
+// hierarchical profiling
+
+#define PROF_MAX_NODES (1024)
+#define PROF_MAX_DEPTH (64)
+#define PROF_MAX_THREADS (256)
+#define PROF_HIST_BINS (40) // bin b holds per-step times in [2^b, 2^(b+1)) ns
+#define PROF_MAX_PATH (1024)
+
+struct prof_node {
+  int pr; // region, as returned by prof_register(), 0 for the root
+  int parent;
+  int first_child;
+  int next_sibling;
+  int cnt;
+  long long time; // total time, ns
+  long long step_time; // time accumulated in the current step
+  long long step_min, step_max;
+  int nr_steps;
+  int hist[PROF_HIST_BINS];
+};
+
+struct prof_event {
+  int node;
+  long long start;
+  long long dur;
+};
+
+struct prof_thread {
+  int tid;
+  int nr_nodes;
+  struct prof_node nodes[PROF_MAX_NODES];
+  int depth;
+  int stack[PROF_MAX_DEPTH];
+  long long stack_start[PROF_MAX_DEPTH];
+  struct prof_event *events;
+  int nr_events;
+  int max_events;
+};
+
+static PROF_TLS struct prof_thread *prof_thr;
+static struct prof_thread *prof_threads[PROF_MAX_THREADS];
+static int prof_nr_threads;
+static int prof_trace_max_events;
+static long long prof_t0;
+
+// ----------------------------------------------------------------------
+// prof_thread_get
+
+static struct prof_thread *
+prof_thread_get(void)
+{
+  if (prof_thr) {
+    return prof_thr;
+  }
+
+  int tid = __sync_fetch_and_add(&prof_nr_threads, 1);
+  assert(tid < PROF_MAX_THREADS);
+  struct prof_thread *thr = calloc(1, sizeof(*thr));
+  thr->tid = tid;
+  thr->nr_nodes = 1; // root
+  thr->nodes[0].parent = -1;
+  thr->nodes[0].first_child = -1;
+  thr->nodes[0].next_sibling = -1;
+  thr->stack[0] = 0;
+  thr->depth = 1;
+  if (prof_trace_max_events > 0) {
+    thr->events = calloc(prof_trace_max_events, sizeof(*thr->events));
+    thr->max_events = prof_trace_max_events;
+  }
+  __sync_bool_compare_and_swap(&prof_t0, 0, prof_time_ns());
+  prof_threads[tid] = thr;
+  prof_thr = thr;
+  return thr;
+}
+
+// ----------------------------------------------------------------------
+// prof_node_child
+
+static int
+prof_node_child(struct prof_thread *thr, int parent, int pr)
+{
+  struct prof_node *nodes = thr->nodes;
+  for (int n = nodes[parent].first_child; n >= 0; n = nodes[n].next_sibling) {
+    if (nodes[n].pr == pr) {
+      return n;
+    }
+  }
+
+  if (thr->nr_nodes == PROF_MAX_NODES) {
+    return -1;
+  }
+  int n = thr->nr_nodes++;
+  memset(&nodes[n], 0, sizeof(nodes[n]));
+  nodes[n].pr = pr;
+  nodes[n].parent = parent;
+  nodes[n].first_child = -1;
+  nodes[n].next_sibling = nodes[parent].first_child;
+  nodes[n].step_min = -1;
+  nodes[parent].first_child = n;
+  return n;
+}
+
+// ----------------------------------------------------------------------
+// prof_enter
+
+void
+prof_enter(int pr, long long t, int restart)
+{
+  struct prof_thread *thr = prof_thread_get();
+  if (thr->depth == PROF_MAX_DEPTH) {
+    return;
+  }
+
+  int n = prof_node_child(thr, thr->stack[thr->depth - 1], pr);
+  if (n < 0) {
+    return;
+  }
+  if (restart) {
+    thr->nodes[n].cnt--;
+  }
+  thr->stack[thr->depth] = n;
+  thr->stack_start[thr->depth] = t;
+  thr->depth++;
+}
+
+// ----------------------------------------------------------------------
+// prof_leave
+//
+// regions are supposed to be properly nested, but if they aren't, any
+// regions that were entered after pr are closed as well
+
+void
+prof_leave(int pr, long long t)
+{
+  struct prof_thread *thr = prof_thread_get();
+
+  int d;
+  for (d = thr->depth - 1; d > 0; d--) {
+    if (thr->nodes[thr->stack[d]].pr == pr) {
+      break;
+    }
+  }
+  if (d == 0) { // not found
+    return;
+  }
+
+  while (thr->depth > d) {
+    thr->depth--;
+    int n = thr->stack[thr->depth];
+    long long dur = t - thr->stack_start[thr->depth];
+    struct prof_node *node = &thr->nodes[n];
+    node->cnt++;
+    node->time += dur;
+    node->step_time += dur;
+    if (thr->nr_events < thr->max_events) {
+      struct prof_event *ev = &thr->events[thr->nr_events++];
+      ev->node = n;
+      ev->start = thr->stack_start[thr->depth];
+      ev->dur = dur;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// prof_step_end
+
+void
+prof_step_end(void)
+{
+  for (int tid = 0; tid < prof_nr_threads; tid++) {
+    struct prof_thread *thr = prof_threads[tid];
+    if (!thr) {
+      continue;
+    }
+    for (int n = 1; n < thr->nr_nodes; n++) {
+      struct prof_node *node = &thr->nodes[n];
+      long long dt = node->step_time;
+      if (dt <= 0) {
+	continue;
+      }
+      int b = 0;
+      while (b < PROF_HIST_BINS - 1 && (dt >> (b + 1)) > 0) {
+	b++;
+      }
+      node->hist[b]++;
+      if (node->step_min < 0 || dt < node->step_min) {
+	node->step_min = dt;
+      }
+      if (dt > node->step_max) {
+	node->step_max = dt;
+      }
+      node->nr_steps++;
+      node->step_time = 0;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// prof_trace_enable
+
+void
+prof_trace_enable(int max_events)
+{
+  prof_trace_max_events = max_events;
+  prof_thread_get();
+  // threads that don't exist yet get their buffers when they first show up
+  for (int tid = 0; tid < prof_nr_threads; tid++) {
+    struct prof_thread *thr = prof_threads[tid];
+    if (thr && !thr->events) {
+      thr->events = calloc(max_events, sizeof(*thr->events));
+      thr->max_events = max_events;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// prof_node_path
+
+static void
+prof_node_path(struct prof_thread *thr, int n, char *path)
+{
+  if (thr->nodes[n].parent <= 0) {
+    strcpy(path, "");
+  } else {
+    prof_node_path(thr, thr->nodes[n].parent, path);
+    strncat(path, "/", PROF_MAX_PATH - strlen(path) - 1);
+  }
+  strncat(path, prof_data[thr->nodes[n].pr - 1].name,
+	  PROF_MAX_PATH - strlen(path) - 1);
+}
+
+// ----------------------------------------------------------------------
+// prof_gather_text
+//
+// collects every rank's text buffer on rank 0, returns the concatenation
+// there (to be freed by the caller), NULL elsewhere
+
+static char *
+prof_gather_text(MPI_Comm comm, const char *buf, int len, int **p_lens,
+		 int **p_displs)
+{
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  int *lens = NULL, *displs = NULL;
+  char *all = NULL;
+  if (rank == 0) {
+    lens = calloc(size, sizeof(*lens));
+    displs = calloc(size, sizeof(*displs));
+  }
+  MPI_Gather(&len, 1, MPI_INT, lens, 1, MPI_INT, 0, comm);
+  if (rank == 0) {
+    int total = 0;
+    for (int r = 0; r < size; r++) {
+      displs[r] = total;
+      total += lens[r];
+    }
+    all = malloc(total + 1);
+    all[total] = 0;
+  }
+  MPI_Gatherv((void *) buf, len, MPI_CHAR, all, lens, displs, MPI_CHAR, 0, comm);
+  *p_lens = lens;
+  *p_displs = displs;
+  return all;
+}
+
+// ----------------------------------------------------------------------
+// prof_json_entry
+//
+// a region as seen by one rank, summed over threads
+
+struct prof_json_entry {
+  char path[PROF_MAX_PATH];
+  int depth;
+  int cnt;
+  double time; // s
+  double step_min, step_max; // s
+  int nr_steps;
+  int hist[PROF_HIST_BINS];
+  // across ranks
+  int nr_ranks;
+  double time_min, time_max;
+  int rank_min, rank_max;
+};
+
+static struct prof_json_entry *
+prof_json_find(struct prof_json_entry **p_entries, int *nr, int *max,
+	       const char *path)
+{
+  for (int i = 0; i < *nr; i++) {
+    if (strcmp((*p_entries)[i].path, path) == 0) {
+      return &(*p_entries)[i];
+    }
+  }
+  if (*nr == *max) {
+    *max = 2 * *max + 16;
+    *p_entries = realloc(*p_entries, *max * sizeof(**p_entries));
+  }
+  struct prof_json_entry *e = &(*p_entries)[(*nr)++];
+  memset(e, 0, sizeof(*e));
+  strcpy(e->path, path);
+  e->step_min = -1.;
+  return e;
+}
+
+// ----------------------------------------------------------------------
+// prof_write_json
+
+void
+prof_write_json(MPI_Comm comm, const char *filename)
+{
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  // merge this rank's threads by path
+  int nr = 0, max = 0;
+  struct prof_json_entry *entries = NULL;
+  char path[PROF_MAX_PATH];
+  for (int tid = 0; tid < prof_nr_threads; tid++) {
+    struct prof_thread *thr = prof_threads[tid];
+    if (!thr) {
+      continue;
+    }
+    for (int n = 1; n < thr->nr_nodes; n++) {
+      struct prof_node *node = &thr->nodes[n];
+      prof_node_path(thr, n, path);
+      struct prof_json_entry *e = prof_json_find(&entries, &nr, &max, path);
+      e->cnt += node->cnt;
+      e->time += node->time * 1e-9;
+      if (node->nr_steps > 0) {
+	if (e->step_min < 0. || node->step_min * 1e-9 < e->step_min) {
+	  e->step_min = node->step_min * 1e-9;
+	}
+	if (node->step_max * 1e-9 > e->step_max) {
+	  e->step_max = node->step_max * 1e-9;
+	}
+      }
+      if (node->nr_steps > e->nr_steps) {
+	e->nr_steps = node->nr_steps;
+      }
+      for (int b = 0; b < PROF_HIST_BINS; b++) {
+	e->hist[b] += node->hist[b];
+      }
+    }
+  }
+
+  // serialize
+  int len = 0, buf_size = 1024;
+  char *buf = malloc(buf_size);
+  for (int i = 0; i < nr; i++) {
+    struct prof_json_entry *e = &entries[i];
+    while (buf_size - len < PROF_MAX_PATH + 40 * (PROF_HIST_BINS + 6)) {
+      buf_size *= 2;
+      buf = realloc(buf, buf_size);
+    }
+    len += sprintf(buf + len, "%s\t%d %.9g %.9g %.9g %d", e->path, e->cnt,
+		   e->time, e->step_min, e->step_max, e->nr_steps);
+    for (int b = 0; b < PROF_HIST_BINS; b++) {
+      len += sprintf(buf + len, " %d", e->hist[b]);
+    }
+    len += sprintf(buf + len, "\n");
+  }
+  free(entries);
+
+  int *lens, *displs;
+  char *all = prof_gather_text(comm, buf, len, &lens, &displs);
+  free(buf);
+  if (rank != 0) {
+    return;
+  }
+
+  // aggregate across ranks
+  nr = 0, max = 0;
+  entries = NULL;
+  for (int r = 0; r < size; r++) {
+    char *p = all + displs[r], *end = p + lens[r];
+    while (p < end) {
+      char *tab = strchr(p, '\t');
+      *tab = 0;
+      struct prof_json_entry *e = prof_json_find(&entries, &nr, &max, p);
+      p = tab + 1;
+      int cnt, nr_steps, n;
+      double time, step_min, step_max;
+      sscanf(p, "%d %lg %lg %lg %d%n", &cnt, &time, &step_min, &step_max,
+	     &nr_steps, &n);
+      p += n;
+      for (int b = 0; b < PROF_HIST_BINS; b++) {
+	int h;
+	sscanf(p, " %d%n", &h, &n);
+	p += n;
+	e->hist[b] += h;
+      }
+      p = strchr(p, '\n') + 1;
+
+      e->cnt += cnt;
+      e->time += time;
+      if (e->nr_ranks == 0 || time < e->time_min) {
+	e->time_min = time;
+	e->rank_min = r;
+      }
+      if (e->nr_ranks == 0 || time > e->time_max) {
+	e->time_max = time;
+	e->rank_max = r;
+      }
+      if (step_min >= 0. && (e->step_min < 0. || step_min < e->step_min)) {
+	e->step_min = step_min;
+      }
+      if (step_max > e->step_max) {
+	e->step_max = step_max;
+      }
+      if (nr_steps > e->nr_steps) {
+	e->nr_steps = nr_steps;
+      }
+      e->nr_ranks++;
+    }
+  }
+  free(all);
+  free(lens);
+  free(displs);
+
+  FILE *f = fopen(filename, "w");
+  if (!f) {
+    fprintf(stderr, "prof_write_json: cannot open '%s'\n", filename);
+    free(entries);
+    return;
+  }
+  fprintf(f, "{\n  \"nr_ranks\": %d,\n  \"regions\": [", size);
+  for (int i = 0; i < nr; i++) {
+    struct prof_json_entry *e = &entries[i];
+    // regions that don't occur on some ranks count as zero time there
+    double time_avg = e->time / size;
+    if (e->nr_ranks < size) {
+      e->time_min = 0.;
+      e->rank_min = -1;
+    }
+    const char *name = strrchr(e->path, '/');
+    name = name ? name + 1 : e->path;
+    int depth = 0;
+    for (const char *c = e->path; *c; c++) {
+      depth += (*c == '/');
+    }
+    fprintf(f, "%s\n    {\"path\": \"%s\", \"name\": \"%s\", \"depth\": %d,",
+	    i > 0 ? "," : "", e->path, name, depth);
+    fprintf(f, " \"count\": %d, \"nr_ranks\": %d,", e->cnt, e->nr_ranks);
+    fprintf(f, " \"time_avg\": %g, \"time_min\": %g, \"rank_min\": %d,",
+	    time_avg, e->time_min, e->rank_min);
+    fprintf(f, " \"time_max\": %g, \"rank_max\": %d, \"imbalance\": %g,",
+	    e->time_max, e->rank_max,
+	    time_avg > 0. ? e->time_max / time_avg - 1. : 0.);
+    fprintf(f, " \"nr_steps\": %d, \"step_min\": %g, \"step_max\": %g,",
+	    e->nr_steps, e->step_min < 0. ? 0. : e->step_min, e->step_max);
+    fprintf(f, " \"step_hist_log2_ns\": [");
+    for (int b = 0; b < PROF_HIST_BINS; b++) {
+      fprintf(f, "%s%d", b > 0 ? ", " : "", e->hist[b]);
+    }
+    fprintf(f, "]}");
+  }
+  fprintf(f, "\n  ]\n}\n");
+  fclose(f);
+  free(entries);
+}
+
+// ----------------------------------------------------------------------
+// prof_write_chrome_trace
+//
+// writes a file that can be loaded into chrome://tracing or Perfetto, with
+// one process per rank and one track per thread
+
+void
+prof_write_chrome_trace(MPI_Comm comm, const char *filename)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  int len = 0, buf_size = 1024;
+  char *buf = malloc(buf_size);
+  for (int tid = 0; tid < prof_nr_threads; tid++) {
+    struct prof_thread *thr = prof_threads[tid];
+    if (!thr) {
+      continue;
+    }
+    for (int i = 0; i < thr->nr_events; i++) {
+      struct prof_event *ev = &thr->events[i];
+      while (buf_size - len < 256) {
+	buf_size *= 2;
+	buf = realloc(buf, buf_size);
+      }
+      len += snprintf(buf + len, buf_size - len,
+		      ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, "
+		      "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+		      prof_data[thr->nodes[ev->node].pr - 1].name, rank, tid,
+		      (ev->start - prof_t0) * 1e-3, ev->dur * 1e-3);
+    }
+  }
+
+  int *lens, *displs;
+  char *all = prof_gather_text(comm, buf, len, &lens, &displs);
+  free(buf);
+  if (rank != 0) {
+    return;
+  }
+
+  FILE *f = fopen(filename, "w");
+  if (f) {
+    // skip the leading ",", if any
+    fprintf(f, "{\"traceEvents\": [%s\n]}\n", all[0] ? all + 1 : all);
+    fclose(f);
+  } else {
+    fprintf(stderr, "prof_write_chrome_trace: cannot open '%s'\n", filename);
+  }
+  free(all);
+  free(lens);
+  free(displs);
+}
@@ -3,11 +3,49 @@
 #include <mrc_domain.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------
+// mrc_redist_setup_layout
+//
+// (re)derive everything that depends on the domain's patch layout
+
+static void
+mrc_redist_setup_layout(struct mrc_redist *redist)
+{
+  struct mrc_domain *domain = redist->domain;
+
+  mrc_domain_get_global_dims(domain, redist->gdims);
+  int nr_patches;
+  struct mrc_patch *patches = mrc_domain_get_patches(domain, &nr_patches);
+  free(redist->patches);
+  redist->nr_patches = nr_patches;
+  redist->patches = calloc(nr_patches, sizeof(*redist->patches));
+  memcpy(redist->patches, patches, nr_patches * sizeof(*redist->patches));
+
+  for (int d = 0; d < 3; d++) {
+    if (redist->slab_dims_req[d]) {
+      redist->slab_dims[d] = redist->slab_dims_req[d];
+    } else {
+      redist->slab_dims[d] = redist->gdims[d];
+    }
+    redist->slab_offs[d] = redist->slab_offs_req[d];
+  }
+  redist->slow_dim = 2;
+  while (redist->gdims[redist->slow_dim] == 1) {
+    redist->slow_dim--;
+  }
+  assert(redist->slow_dim >= 0);
+  int total_slow_indices = redist->slab_dims[redist->slow_dim];
+  redist->slow_indices_per_writer = total_slow_indices / redist->nr_writers;
+  redist->slow_indices_rmndr = total_slow_indices % redist->nr_writers;
+}
 
 void
 mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
 		int slab_offs[3], int slab_dims[3], int nr_writers)
 {
+  memset(redist, 0, sizeof(*redist));
   redist->domain = domain;
   redist->comm = mrc_domain_comm(domain);
   MPI_Comm_rank(redist->comm, &redist->rank);
@@ -27,37 +65,62 @@ mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
   
   MPI_Comm_split(redist->comm, redist->is_writer, redist->rank, &redist->comm_writers);
 
-  int gdims[3];
-  mrc_domain_get_global_dims(domain, gdims);
-  int nr_patches;
-  mrc_domain_get_patches(domain, &nr_patches);
-  int nr_global_patches;
-  mrc_domain_get_nr_global_patches(domain, &nr_global_patches);
   for (int d = 0; d < 3; d++) {
-    if (slab_dims[d]) {
-      redist->slab_dims[d] = slab_dims[d];
-    } else {
-      redist->slab_dims[d] = gdims[d];
-    }
-    redist->slab_offs[d] = slab_offs[d];
+    redist->slab_offs_req[d] = slab_offs[d];
+    redist->slab_dims_req[d] = slab_dims[d];
   }
-  redist->slow_dim = 2;
-  while (gdims[redist->slow_dim] == 1) {
-    redist->slow_dim--;
-  }
-  assert(redist->slow_dim >= 0);
-  int total_slow_indices = redist->slab_dims[redist->slow_dim];
-  redist->slow_indices_per_writer = total_slow_indices / nr_writers;
-  redist->slow_indices_rmndr = total_slow_indices % nr_writers;
+  mrc_redist_setup_layout(redist);
 }
 
 void
 mrc_redist_destroy(struct mrc_redist *redist)
 {
+  mrc_redist_invalidate(redist);
+  free(redist->write_send.buf);
+  free(redist->write_recv.buf);
+  mrc_ndarray_destroy(redist->nd);
+  free(redist->patches);
   free(redist->writer_ranks);
   MPI_Comm_free(&redist->comm_writers);
 }
 
+// ----------------------------------------------------------------------
+// mrc_redist_update
+//
+// Switches to (possibly) another domain, which has to have the same ranks
+// as the current one. The plan is kept if the patch layout is unchanged
+// everywhere, otherwise it'll be rebuilt on the next
+// mrc_redist_get_ndarray(). Collective.
+
+void
+mrc_redist_update(struct mrc_redist *redist, struct mrc_domain *domain)
+{
+  int changed = (domain != redist->domain);
+  if (!changed) {
+    int gdims[3], nr_patches;
+    mrc_domain_get_global_dims(domain, gdims);
+    struct mrc_patch *patches = mrc_domain_get_patches(domain, &nr_patches);
+    changed = (memcmp(gdims, redist->gdims, sizeof(gdims)) != 0 ||
+	       nr_patches != redist->nr_patches ||
+	       memcmp(patches, redist->patches, nr_patches * sizeof(*patches)) != 0);
+  }
+  // the old domain's communicator may be gone already, even if the new domain
+  // happens to live at the same address, so always switch to the new one
+  redist->domain = domain;
+  redist->comm = mrc_domain_comm(domain);
+
+  // a patch moving from one rank to another changes the writers' plans, too
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, redist->comm);
+  if (!changed) {
+    return;
+  }
+
+  MPI_Comm_free(&redist->comm_writers);
+  MPI_Comm_split(redist->comm, redist->is_writer, redist->rank, &redist->comm_writers);
+  mrc_redist_setup_layout(redist);
+  mrc_redist_invalidate(redist);
+}
+
 static void
 mrc_redist_writer_offs_dims(struct mrc_redist *redist, int writer,
 			    int *writer_offs, int *writer_dims)
@@ -96,12 +159,12 @@ MPI_Datatype to_mpi_datatype(int data_type)
 // mrc_redist_write_send_init
 
 static void
-mrc_redist_write_send_init(struct mrc_redist *redist, int size_of_type)
+mrc_redist_write_send_init(struct mrc_redist *redist)
 {
   struct mrc_redist_write_send *send = &redist->write_send;
 
-  int nr_patches;
-  struct mrc_patch *patches = mrc_domain_get_patches(redist->domain, &nr_patches);
+  int nr_patches = redist->nr_patches;
+  struct mrc_patch *patches = redist->patches;
 
   // count number of writers we actually need to communicate with
   int n_peers = 0;
@@ -206,8 +269,6 @@ mrc_redist_write_send_init(struct mrc_redist *redist, int size_of_type)
   }
   assert(last == send->buf_size);
   
-  send->buf = malloc(send->buf_size * size_of_type);
-  assert(send->buf);
   int off = 0;
   for (struct mrc_redist_peer* w = send->peers_begin; w != send->peers_end; w++) {
     assert(off == send->disps[w->rank]);
@@ -238,7 +299,6 @@ mrc_redist_write_send_destroy(struct mrc_redist *redist)
   free(send->reqs);
   free(send->disps);
   free(send->cnts);
-  free(send->buf);
 }
 
 // ----------------------------------------------------------------------
@@ -303,7 +363,7 @@ mrc_redist_write_send_prep(struct mrc_redist *redist, struct mrc_fld *m3, int m)
 // mrc_redist_write_recv_init
 
 static void
-mrc_redist_write_recv_init(struct mrc_redist *redist, int size_of_type)
+mrc_redist_write_recv_init(struct mrc_redist *redist)
 {
   struct mrc_redist_write_recv *recv = &redist->write_recv;
 
@@ -315,14 +375,12 @@ mrc_redist_write_recv_init(struct mrc_redist *redist, int size_of_type)
 // mrc_redist_write_recv_init2
 
 static void
-mrc_redist_write_recv_init2(struct mrc_redist *redist, struct mrc_ndarray *nd,
-			    int size_of_type)
+mrc_redist_write_recv_init2(struct mrc_redist *redist, int *writer_offs, int *writer_dims)
 {
   struct mrc_redist_write_recv *recv = &redist->write_recv;
 
   // find out who's sending, OPT: this way is not very scalable
   // could also be optimized by just looking at slow_dim
-  // FIXME, figure out pattern and cache, at least across components
 
   int nr_global_patches;
   mrc_domain_get_nr_global_patches(redist->domain, &nr_global_patches);
@@ -334,7 +392,7 @@ mrc_redist_write_recv_init2(struct mrc_redist *redist, struct mrc_ndarray *nd,
 
     int ilo[3], ihi[3];
     int has_intersection = find_intersection(ilo, ihi, info.off, info.ldims,
-					     mrc_ndarray_offs(nd), mrc_ndarray_dims(nd));
+					     writer_offs, writer_dims);
     if (!has_intersection) {
       continue;
     }
@@ -355,7 +413,7 @@ mrc_redist_write_recv_init2(struct mrc_redist *redist, struct mrc_ndarray *nd,
 
     int ilo[3], ihi[3];
     int has_intersection = find_intersection(ilo, ihi, info.off, info.ldims,
-					     mrc_ndarray_offs(nd), mrc_ndarray_dims(nd));
+					     writer_offs, writer_dims);
     if (!has_intersection) {
       continue;
     }
@@ -436,9 +494,6 @@ mrc_redist_write_recv_init2(struct mrc_redist *redist, struct mrc_ndarray *nd,
   }
   assert(last == recv->buf_size);
   
-  // alloc aggregate recv buffers
-  recv->buf = malloc(recv->buf_size * size_of_type);
-  assert(recv->buf);
   int off = 0;
   for (struct mrc_redist_peer *peer = recv->peers_begin; peer != recv->peers_end; peer++) {
     peer->off = off;
@@ -519,7 +574,7 @@ mrc_redist_write_destroy(struct mrc_redist *redist)
 
   free(recv->reqs);
   free(recv->disps);
-  free(recv->buf);
+  free(recv->cnts);
   free(recv->peers_begin);
 
   free(recv->recv_patches);
@@ -580,59 +635,118 @@ mrc_redist_write_comm_local(struct mrc_redist *redist, struct mrc_ndarray *nd,
   }
 }
 
+// ----------------------------------------------------------------------
+// mrc_redist_invalidate
+//
+// drop the plan, so that it'll be rebuilt on next use
+
+void
+mrc_redist_invalidate(struct mrc_redist *redist)
+{
+  if (!redist->plan_valid) {
+    return;
+  }
+
+  mrc_redist_write_send_destroy(redist);
+  mrc_redist_write_destroy(redist);
+  redist->plan_valid = false;
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_reserve
+//
+// buffers are only ever grown, so they get reused across components,
+// fields and output steps
+
+static void *
+mrc_redist_reserve(void *buf, size_t *buf_cap, size_t size)
+{
+  if (size > *buf_cap) {
+    free(buf);
+    buf = malloc(size);
+    assert(buf);
+    *buf_cap = size;
+  }
+  return buf;
+}
+
 // ----------------------------------------------------------------------
 // mrc_redist_get_ndarray
 
 struct mrc_ndarray *
 mrc_redist_get_ndarray(struct mrc_redist *redist, struct mrc_fld *m3)
 {
-  mrc_redist_write_send_init(redist, m3->_nd->size_of_type);
-  mrc_redist_write_recv_init(redist, m3->_nd->size_of_type);
+  assert(m3->_domain == redist->domain);
+
+  int writer_dims[3], writer_off[3];
+  if (redist->is_writer) {
+    int writer;
+    MPI_Comm_rank(redist->comm_writers, &writer);
+    mrc_redist_writer_offs_dims(redist, writer, writer_off, writer_dims);
+#if 0
+    mprintf("writer_off %d %d %d dims %d %d %d\n",
+	    writer_off[0], writer_off[1], writer_off[2],
+	    writer_dims[0], writer_dims[1], writer_dims[2]);
+#endif
+  }
+
+  if (!redist->plan_valid) {
+    mrc_redist_write_send_init(redist);
+    mrc_redist_write_recv_init(redist);
+    if (redist->is_writer) {
+      mrc_redist_write_recv_init2(redist, writer_off, writer_dims);
+    }
+    redist->plan_valid = true;
+  }
+
+  int size_of_type = m3->_nd->size_of_type;
+  struct mrc_redist_write_send *send = &redist->write_send;
+  send->buf = mrc_redist_reserve(send->buf, &send->buf_cap,
+				 send->buf_size * size_of_type);
 
   if (!redist->is_writer) {
     return NULL;
   }
-  
-  struct mrc_ndarray *nd = mrc_ndarray_create(redist->comm_writers);
 
-  int writer;
-  MPI_Comm_rank(redist->comm_writers, &writer);
-  int writer_dims[3], writer_off[3];
-  mrc_redist_writer_offs_dims(redist, writer, writer_off, writer_dims);
-#if 0
-  mprintf("writer_off %d %d %d dims %d %d %d\n",
-	  writer_off[0], writer_off[1], writer_off[2],
-	  writer_dims[0], writer_dims[1], writer_dims[2]);
-#endif
-  
-  mrc_ndarray_set_param_int_array(nd, "dims", 3, writer_dims);
-  mrc_ndarray_set_param_int_array(nd, "offs", 3, writer_off);
-  
-  switch (mrc_fld_data_type(m3)) {
-  case MRC_NT_FLOAT: mrc_ndarray_set_type(nd, "float"); break;
-  case MRC_NT_DOUBLE: mrc_ndarray_set_type(nd, "double"); break;
-  case MRC_NT_INT: mrc_ndarray_set_type(nd, "int"); break;
-  default: assert(0);
+  struct mrc_redist_write_recv *recv = &redist->write_recv;
+  recv->buf = mrc_redist_reserve(recv->buf, &recv->buf_cap,
+				 recv->buf_size * size_of_type);
+
+  struct mrc_ndarray *nd = redist->nd;
+  if (nd && (mrc_ndarray_data_type(nd) != mrc_fld_data_type(m3) ||
+	     memcmp(mrc_ndarray_dims(nd), writer_dims, sizeof(writer_dims)) != 0 ||
+	     memcmp(mrc_ndarray_offs(nd), writer_off, sizeof(writer_off)) != 0)) {
+    mrc_ndarray_destroy(nd);
+    nd = NULL;
   }
-  mrc_ndarray_setup(nd);
+  if (!nd) {
+    nd = mrc_ndarray_create(redist->comm_writers);
+    mrc_ndarray_set_param_int_array(nd, "dims", 3, writer_dims);
+    mrc_ndarray_set_param_int_array(nd, "offs", 3, writer_off);
 
-  mrc_redist_write_recv_init2(redist, nd, m3->_nd->size_of_type);
+    switch (mrc_fld_data_type(m3)) {
+    case MRC_NT_FLOAT: mrc_ndarray_set_type(nd, "float"); break;
+    case MRC_NT_DOUBLE: mrc_ndarray_set_type(nd, "double"); break;
+    case MRC_NT_INT: mrc_ndarray_set_type(nd, "int"); break;
+    default: assert(0);
+    }
+    mrc_ndarray_setup(nd);
+    redist->nd = nd;
+  }
 
   return nd;
 }
 
 // ----------------------------------------------------------------------
 // mrc_redist_put_ndarray
+//
+// the ndarray, like the plan and the buffers, stays around for the next
+// mrc_redist_get_ndarray()
 
 void
 mrc_redist_put_ndarray(struct mrc_redist *redist, struct mrc_ndarray *nd)
 {
-  mrc_redist_write_send_destroy(redist);
-
-  if (redist->is_writer) {
-    mrc_redist_write_destroy(redist);
-    mrc_ndarray_destroy(nd);
-  }
+  assert(nd == redist->nd || !redist->is_writer);
 }
 
 // ----------------------------------------------------------------------
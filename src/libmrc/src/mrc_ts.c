@@ -85,6 +85,10 @@ mrc_ts_set_solution(struct mrc_ts *ts, struct mrc_obj *x)
   ts->vec_waxpy =
     (void (*)(struct mrc_obj *, float, struct mrc_obj *, struct mrc_obj *)) mrc_obj_get_method(x, "waxpy");
   assert(ts->vec_waxpy);
+  ts->vec_axpby =
+    (void (*)(struct mrc_obj *, double, struct mrc_obj *, double)) mrc_obj_get_method(x, "axpby");
+  ts->vec_maxpy =
+    (void (*)(struct mrc_obj *, int, const double *, struct mrc_obj **)) mrc_obj_get_method(x, "maxpy");
   ts->vec_norm =
     (float (*)(struct mrc_obj *)) mrc_obj_get_method(x, "norm");
   assert(ts->vec_norm);
@@ -271,6 +275,8 @@ mrc_ts_init()
   mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_ode45_ops);
   mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_rk2_ops);
   mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_rk4_ops);
+  mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_lsrk3_ops);
+  mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_lsrk4_ops);
   
 #ifdef HAVE_PETSC
   mrc_class_register_subclass(&mrc_class_mrc_ts, &mrc_ts_petsc_ops);
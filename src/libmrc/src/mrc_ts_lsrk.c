@@ -0,0 +1,137 @@
+
+#include <mrc_ts_private.h>
+
+#include <assert.h>
+
+// ======================================================================
+// low-storage (2N) Runge-Kutta
+//
+// Williamson's form: for s = 0..nr_stages-1
+//   dx = A[s] * dx + dt * f(t + C[s] * dt, x)
+//   x  = x + B[s] * dx
+// Only dx and the rhs result k are kept in addition to x, vs 6 vectors
+// for rk4, and each stage makes one pass over dx and one over x.
+
+struct mrc_ts_lsrk_scheme {
+  int nr_stages;
+  const double *A, *B, *C;
+};
+
+// Williamson (1980), 3 stages, 3rd order
+static const double lsrk3_A[] = { 0., -5./9., -153./128. };
+static const double lsrk3_B[] = { 1./3., 15./16., 8./15. };
+static const double lsrk3_C[] = { 0., 1./3., 3./4. };
+
+static const struct mrc_ts_lsrk_scheme lsrk3 = {
+  .nr_stages = 3, .A = lsrk3_A, .B = lsrk3_B, .C = lsrk3_C,
+};
+
+// Carpenter & Kennedy (1994), 5 stages, 4th order
+static const double lsrk4_A[] = {
+  0.,
+  -567301805773. / 1357537059087.,
+  -2404267990393. / 2016746695238.,
+  -3550918686646. / 2091501179385.,
+  -1275806237668. / 842570457699.,
+};
+static const double lsrk4_B[] = {
+  1432997174477. / 9575080441755.,
+  5161836677717. / 13612068292357.,
+  1720146321549. / 2090206949498.,
+  3134564353537. / 4481467310338.,
+  2277821191437. / 14882151754819.,
+};
+static const double lsrk4_C[] = {
+  0.,
+  1432997174477. / 9575080441755.,
+  2526269341429. / 6820363962896.,
+  2006345519317. / 3224310063776.,
+  2802321613138. / 2924317926251.,
+};
+
+static const struct mrc_ts_lsrk_scheme lsrk4 = {
+  .nr_stages = 5, .A = lsrk4_A, .B = lsrk4_B, .C = lsrk4_C,
+};
+
+struct mrc_ts_lsrk {
+  const struct mrc_ts_lsrk_scheme *scheme;
+  struct mrc_obj *dx;
+  struct mrc_obj *k;
+};
+
+static void
+mrc_ts_lsrk_setup(struct mrc_ts *ts)
+{
+  struct mrc_ts_lsrk *lsrk = mrc_to_subobj(ts, struct mrc_ts_lsrk);
+
+  assert(ts->x);
+  // the first stage overwrites dx, so it doesn't need to be zeroed
+  assert(ts->vec_axpby);
+  lsrk->dx = mrc_ts_vec_duplicate(ts, ts->x);
+  lsrk->k = mrc_ts_vec_duplicate(ts, ts->x);
+
+  mrc_ts_setup_super(ts);
+}
+
+static void
+mrc_ts_lsrk_destroy(struct mrc_ts *ts)
+{
+  struct mrc_ts_lsrk *lsrk = mrc_to_subobj(ts, struct mrc_ts_lsrk);
+
+  mrc_obj_destroy(lsrk->dx);
+  mrc_obj_destroy(lsrk->k);
+}
+
+static void
+mrc_ts_lsrk_step(struct mrc_ts *ts)
+{
+  struct mrc_ts_lsrk *lsrk = mrc_to_subobj(ts, struct mrc_ts_lsrk);
+  const struct mrc_ts_lsrk_scheme *sch = lsrk->scheme;
+
+  struct mrc_obj *x = ts->x;
+  for (int s = 0; s < sch->nr_stages; s++) {
+    mrc_ts_rhsf(ts, lsrk->k, ts->time + sch->C[s] * ts->dt, x);
+    mrc_ts_vec_axpby(ts, lsrk->dx, ts->dt, lsrk->k, sch->A[s]);
+    mrc_ts_vec_axpy(ts, x, sch->B[s], lsrk->dx);
+  }
+}
+
+// ======================================================================
+// mrc_ts_lsrk3
+
+static void
+mrc_ts_lsrk3_create(struct mrc_ts *ts)
+{
+  struct mrc_ts_lsrk *lsrk = mrc_to_subobj(ts, struct mrc_ts_lsrk);
+
+  lsrk->scheme = &lsrk3;
+}
+
+struct mrc_ts_ops mrc_ts_lsrk3_ops = {
+  .name             = "lsrk3",
+  .size             = sizeof(struct mrc_ts_lsrk),
+  .create           = mrc_ts_lsrk3_create,
+  .setup            = mrc_ts_lsrk_setup,
+  .destroy          = mrc_ts_lsrk_destroy,
+  .step             = mrc_ts_lsrk_step,
+};
+
+// ======================================================================
+// mrc_ts_lsrk4
+
+static void
+mrc_ts_lsrk4_create(struct mrc_ts *ts)
+{
+  struct mrc_ts_lsrk *lsrk = mrc_to_subobj(ts, struct mrc_ts_lsrk);
+
+  lsrk->scheme = &lsrk4;
+}
+
+struct mrc_ts_ops mrc_ts_lsrk4_ops = {
+  .name             = "lsrk4",
+  .size             = sizeof(struct mrc_ts_lsrk),
+  .create           = mrc_ts_lsrk4_create,
+  .setup            = mrc_ts_lsrk_setup,
+  .destroy          = mrc_ts_lsrk_destroy,
+  .step             = mrc_ts_lsrk_step,
+};
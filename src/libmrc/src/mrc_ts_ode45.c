@@ -146,9 +146,11 @@ mrc_ts_ode45_solve(struct mrc_ts *ts)
     for (int j = 0; j < 6; j++) {
       // k_(:,j+1) = feval(FUN, t+c_(j+1)*h, x+h*k_(:,1:j)*a_(j+1,1:j) );
       mrc_ts_vec_copy(ts, gamma1, x);
+      float aj[7];
       for (int k = 0; k <= j; k++) {
-	mrc_ts_vec_axpy(ts, gamma1, ts->dt * a[j+1][k], xk[k]);
+	aj[k] = ts->dt * a[j+1][k];
       }
+      mrc_ts_vec_maxpy(ts, gamma1, j + 1, aj, xk);
       float time = ts->time + c[j+1] * ts->dt;
       mrc_ts_rhsf(ts, xk[j+1], time, gamma1);
     }
@@ -156,16 +158,19 @@ mrc_ts_ode45_solve(struct mrc_ts *ts)
     // compute the 4th order estimate
     //x4=x + h* (k_*b4_);
     mrc_ts_vec_copy(ts, x4, x);
+    float bk[7];
     for (int k = 0; k < 7; k++) {
-      mrc_ts_vec_axpy(ts, x4, ts->dt * b4[k], xk[k]);
+      bk[k] = ts->dt * b4[k];
     }
+    mrc_ts_vec_maxpy(ts, x4, 7, bk, xk);
 
     // compute the 5th order estimate
     //x5=x + h*(k_*b5_);
     mrc_ts_vec_copy(ts, x5, x);
     for (int k = 0; k < 7; k++) {
-      mrc_ts_vec_axpy(ts, x5, ts->dt * b5[k], xk[k]);
+      bk[k] = ts->dt * b5[k];
     }
+    mrc_ts_vec_maxpy(ts, x5, 7, bk, xk);
 
     // estimate the local truncation error
     mrc_ts_vec_waxpy(ts, gamma1, -1., x4, x5);
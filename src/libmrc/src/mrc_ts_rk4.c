@@ -53,10 +53,8 @@ mrc_ts_rk4_step(struct mrc_ts *ts)
   mrc_ts_vec_waxpy(ts, xt, ts->dt, xk[2], x);
   mrc_ts_rhsf(ts, xk[3], ts->time + ts->dt, xt);
 
-  mrc_ts_vec_axpy(ts, x, 1./6. * ts->dt, xk[0]);
-  mrc_ts_vec_axpy(ts, x, 1./3. * ts->dt, xk[1]);
-  mrc_ts_vec_axpy(ts, x, 1./3. * ts->dt, xk[2]);
-  mrc_ts_vec_axpy(ts, x, 1./6. * ts->dt, xk[3]);
+  float b[4] = { 1./6. * ts->dt, 1./3. * ts->dt, 1./3. * ts->dt, 1./6. * ts->dt };
+  mrc_ts_vec_maxpy(ts, x, 4, b, xk);
 }
 
 struct mrc_ts_ops mrc_ts_rk4_ops = {
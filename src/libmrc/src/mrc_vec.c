@@ -37,6 +37,18 @@ mrc_vec_axpby(struct mrc_vec *y, double alpha, struct mrc_vec *x, double beta)
   mrc_vec_ops(y)->axpby(y, alpha, x, beta);
 }
 
+void
+mrc_vec_maxpy(struct mrc_vec *y, int n, const double *alpha, struct mrc_vec **x)
+{
+  if (!mrc_vec_ops(y)->maxpy) {
+    for (int k = 0; k < n; k++) {
+      mrc_vec_axpy(y, alpha[k], x[k]);
+    }
+    return;
+  }
+  mrc_vec_ops(y)->maxpy(y, n, alpha, x);
+}
+
 void 
 mrc_vec_set(struct mrc_vec *x, double alpha)
 {
@@ -200,6 +212,9 @@ mrc_vec_size_of_type(struct mrc_vec *x)
 // ======================================================================
 // mrc_vec subclasses
 
+// most vectors that can be combined in a single maxpy
+#define MRC_VEC_MAXPY_MAX (16)
+
 #define MAKE_MRC_VEC_TYPE(type, TYPE)					\
 									\
   static void								\
@@ -241,12 +256,40 @@ mrc_vec_size_of_type(struct mrc_vec *x)
     assert(strcmp(mrc_vec_type(y), mrc_vec_type(x)) == 0);		\
     type *y_arr = y->arr, *x_arr =  x->arr;				\
     type talpha = (type) alpha, tbeta = (type) beta;			\
+    if (tbeta == 0) { /* y may not have been initialized */		\
+      for (int i = 0; i < y->len; i++) {				\
+	y_arr[i] = talpha * x_arr[i];					\
+      }									\
+      return;								\
+    }									\
     for (int i = 0; i < y->len; i++) {					\
       y_arr[i] = talpha * x_arr[i] + tbeta * y_arr[i];			\
      }									\
   }									\
 									\
   static void								\
+  mrc_vec_##type##_maxpy(struct mrc_vec *y, int n, const double *alpha,	\
+			 struct mrc_vec **x)				\
+  {									\
+    assert(n <= MRC_VEC_MAXPY_MAX);					\
+    type *x_arr[MRC_VEC_MAXPY_MAX], talpha[MRC_VEC_MAXPY_MAX];		\
+    for (int k = 0; k < n; k++) {					\
+      assert(y->len == x[k]->len);					\
+      assert(strcmp(mrc_vec_type(y), mrc_vec_type(x[k])) == 0);	\
+      x_arr[k] = x[k]->arr;						\
+      talpha[k] = (type) alpha[k];					\
+    }									\
+    type *y_arr = y->arr;						\
+    for (int i = 0; i < y->len; i++) {					\
+      type val = y_arr[i];						\
+      for (int k = 0; k < n; k++) {					\
+	val += talpha[k] * x_arr[k][i];					\
+      }									\
+      y_arr[i] = val;							\
+    }									\
+  }									\
+									\
+  static void								\
   mrc_vec_##type##_set(struct mrc_vec *x, double val)			\
   {									\
     type *arr = x->arr;							\
@@ -267,6 +310,8 @@ mrc_vec_size_of_type(struct mrc_vec *x)
   static struct mrc_obj_method mrc_vec_##type##_methods[] = {		\
     MRC_OBJ_METHOD("axpy", mrc_vec_##type##_axpy),			\
     MRC_OBJ_METHOD("waxpy", mrc_vec_##type##_waxpy),			\
+    MRC_OBJ_METHOD("axpby", mrc_vec_##type##_axpby),			\
+    MRC_OBJ_METHOD("maxpy", mrc_vec_##type##_maxpy),			\
     MRC_OBJ_METHOD("set", mrc_vec_##type##_set),			\
     MRC_OBJ_METHOD("copy", mrc_vec_##type##_copy),			\
     {},									\
@@ -283,6 +328,7 @@ mrc_vec_size_of_type(struct mrc_vec *x)
     .axpy                  = mrc_vec_##type##_axpy,			\
     .waxpy                 = mrc_vec_##type##_waxpy,			\
     .axpby                 = mrc_vec_##type##_axpby,			\
+    .maxpy                 = mrc_vec_##type##_maxpy,			\
     .set                   = mrc_vec_##type##_set,			\
     .copy                  = mrc_vec_##type##_copy,			\
   };
@@ -59,6 +59,7 @@ static struct param mrctest_domain_params_descr[] = {
   { "npy"             , VAR(nproc[1])        , PARAM_INT(1)          },
   { "npz"             , VAR(nproc[2])        , PARAM_INT(1)          },
   { "use_diagsrv"     , VAR(use_diagsrv)     , PARAM_BOOL(false)     },
+  { "nr_diagsrvs"     , VAR(nr_diagsrvs)     , PARAM_INT(1)          },
   {},
 };
 #undef VAR
@@ -194,7 +195,10 @@ static void
 mod_diagsrv(struct mrc_mod *mod, void *arg)
 {
   int nr_procs_domain = mrc_mod_get_nr_procs(mod, "domain");
-  mrc_io_server("xdmf_serial", "cache", nr_procs_domain);
+  // xdmf_serial can't write from more than one server
+  int nr_diagsrvs = mrc_mod_get_nr_procs(mod, "diagsrv");
+  const char *format = nr_diagsrvs > 1 ? "xdmf_collective" : "xdmf_serial";
+  mrc_io_servers(mrc_mod_get_comm(mod), format, "cache", nr_procs_domain);
 }
 
 void
@@ -208,7 +212,7 @@ mrctest_domain(void (*mod_domain)(struct mrc_mod *mod, void *arg))
   struct mrc_mod *mod = mrc_mod_create(MPI_COMM_WORLD);
   mrc_mod_register(mod, "domain", nproc_domain, mod_domain, &par);
   if (par.use_diagsrv) {
-    mrc_mod_register(mod, "diagsrv", 1, mod_diagsrv, &par);
+    mrc_mod_register(mod, "diagsrv", par.nr_diagsrvs, mod_diagsrv, &par);
   }
   mrc_mod_view(mod);
   mrc_mod_setup(mod);
@@ -317,6 +317,172 @@ step_fdtd(struct mrc_fld *fld, struct mrc_ddc *ddc_E, struct mrc_ddc *ddc_H)
   }
 }
 
+// ----------------------------------------------------------------------
+// create_ddc
+
+static struct mrc_ddc *
+create_ddc(struct mrc_fld *fld, bool use_plan)
+{
+  struct mrc_ddc *ddc = mrc_ddc_create(mrc_domain_comm(fld->_domain));
+  mrc_ddc_set_type(ddc, "amr");
+  mrc_ddc_set_domain(ddc, fld->_domain);
+  mrc_ddc_set_param_int(ddc, "size_of_type", sizeof(mrc_fld_data_t));
+  mrc_ddc_set_param_int3(ddc, "sw", fld->_sw.vals);
+  mrc_ddc_set_param_int(ddc, "n_comp", 6);
+  mrc_ddc_set_param_bool(ddc, "use_plan", use_plan);
+  mrc_ddc_setup(ddc);
+  mrc_ddc_amr_set_by_stencil(ddc, EX, 1, (int[]) { 0, 1, 1 }, &stencils_coarse[EX], &stencils_fine[EX]);
+  mrc_ddc_amr_set_by_stencil(ddc, EY, 1, (int[]) { 1, 0, 1 }, &stencils_coarse[EY], &stencils_fine[EY]);
+  mrc_ddc_amr_set_by_stencil(ddc, EZ, 1, (int[]) { 1, 1, 0 }, &stencils_coarse[EZ], &stencils_fine[EZ]);
+  mrc_ddc_amr_set_by_stencil(ddc, HX, 1, (int[]) { 1, 0, 0 }, &stencils_coarse[HX], &stencils_fine[HX]);
+  mrc_ddc_amr_set_by_stencil(ddc, HY, 1, (int[]) { 0, 1, 0 }, &stencils_coarse[HY], &stencils_fine[HY]);
+  mrc_ddc_amr_set_by_stencil(ddc, HZ, 1, (int[]) { 0, 0, 1 }, &stencils_coarse[HZ], &stencils_fine[HZ]);
+  mrc_ddc_amr_assemble(ddc);
+
+  return ddc;
+}
+
+// ----------------------------------------------------------------------
+// create_ddc_random
+//
+// interior points are kept, ghost points get a few random entries each,
+// including duplicates, entries that cancel, other ghost points and points
+// on other patches
+
+static struct mrc_ddc *
+create_ddc_random(struct mrc_fld *fld, bool use_plan)
+{
+  struct mrc_domain *domain = fld->_domain;
+  int ldims[3], nr_global_patches;
+  mrc_domain_get_param_int3(domain, "m", ldims);
+  mrc_domain_get_nr_global_patches(domain, &nr_global_patches);
+  int sw[3] = { fld->_sw.vals[0], fld->_sw.vals[1], fld->_sw.vals[2] };
+
+  struct mrc_ddc *ddc = mrc_ddc_create(mrc_domain_comm(domain));
+  mrc_ddc_set_type(ddc, "amr");
+  mrc_ddc_set_domain(ddc, domain);
+  mrc_ddc_set_param_int(ddc, "size_of_type", sizeof(mrc_fld_data_t));
+  mrc_ddc_set_param_int3(ddc, "sw", sw);
+  mrc_ddc_set_param_int(ddc, "n_comp", NR_COMPS);
+  mrc_ddc_set_param_bool(ddc, "use_plan", use_plan);
+  mrc_ddc_setup(ddc);
+
+  srand(1);
+  mrc_fld_foreach_patch(fld, p) {
+    struct mrc_patch_info info;
+    mrc_domain_get_local_patch_info(domain, p, &info);
+    int gp = info.global_patch;
+    for (int m = 0; m < NR_COMPS; m++) {
+      mrc_fld_foreach(fld, ix,iy,iz, sw[0], sw[0]) {
+	int i[3] = { ix, iy, iz };
+	if (ix >= 0 && ix < ldims[0] && iy >= 0 && iy < ldims[1] &&
+	    iz >= 0 && iz < ldims[2]) {
+	  mrc_ddc_amr_add_value(ddc, gp, m, i, gp, m, i, 1.);
+	  continue;
+	}
+	int nr_entries = 1 + rand() % 4;
+	for (int n = 0; n < nr_entries; n++) {
+	  int gp_col = rand() % nr_global_patches;
+	  int m_col = rand() % NR_COMPS;
+	  int j[3];
+	  for (int d = 0; d < 3; d++) {
+	    j[d] = -sw[d] + rand() % (ldims[d] + 2 * sw[d]);
+	  }
+	  double val = (rand() % 8 + 1) / 8.;
+	  mrc_ddc_amr_add_value(ddc, gp, m, i, gp_col, m_col, j, val);
+	  switch (rand() % 4) {
+	  case 0: mrc_ddc_amr_add_value(ddc, gp, m, i, gp_col, m_col, j, val); break;
+	  case 1: mrc_ddc_amr_add_value(ddc, gp, m, i, gp_col, m_col, j, -val); break;
+	  }
+	}
+      } mrc_fld_foreach_end;
+    }
+  }
+  mrc_ddc_amr_assemble(ddc);
+
+  return ddc;
+}
+
+// ----------------------------------------------------------------------
+// check_ddc_plan
+//
+// the compiled plan has to fill the ghosts exactly like the csr_mpi matrix
+// does, also when that's applied again on already filled ghosts. Also times
+// both.
+
+static void
+check_ddc_plan(struct mrc_fld *fld, struct mrc_ddc *ddc_plan,
+	       struct mrc_ddc *ddc_csr, const char *name, int bench_iters)
+{
+  // every value, ghost points included, so stale ghosts would show
+  mrc_fld_foreach_patch(fld, p) {
+    for (int m = 0; m < NR_COMPS; m++) {
+      mrc_fld_foreach(fld, ix,iy,iz, 2, 2) {
+	M3(fld, m, ix,iy,iz, p) = sin(1. + ix + 3.*iy + 7.*iz + 11.*m + 13.*p);
+      } mrc_fld_foreach_end;
+    }
+  }
+  struct mrc_fld *fld_csr = mrc_fld_duplicate(fld);
+  mrc_fld_copy(fld_csr, fld);
+
+  for (int n = 0; n < 2; n++) {
+    mrc_ddc_amr_apply(ddc_plan, fld);
+    mrc_ddc_amr_apply(ddc_csr, fld_csr);
+
+    int nr_diff = 0;
+    mrc_fld_foreach_patch(fld, p) {
+      for (int m = 0; m < NR_COMPS; m++) {
+	mrc_fld_foreach(fld, ix,iy,iz, 2, 2) {
+	  if (M3(fld, m, ix,iy,iz, p) != M3(fld_csr, m, ix,iy,iz, p)) {
+	    mprintf("%s: m %d [%d,%d,%d] p %d: %g (plan) %g (csr)\n", name,
+		    m, ix, iy, iz, p,
+		    M3(fld, m, ix,iy,iz, p), M3(fld_csr, m, ix,iy,iz, p));
+	    nr_diff++;
+	  }
+	} mrc_fld_foreach_end;
+      }
+    }
+    assert(nr_diff == 0);
+  }
+
+  if (bench_iters > 0) {
+    struct mrc_ddc *ddcs[2] = { ddc_csr, ddc_plan };
+    const char *names[2] = { "csr_mpi", "plan" };
+    for (int i = 0; i < 2; i++) {
+      MPI_Barrier(mrc_fld_comm(fld));
+      double t = MPI_Wtime();
+      for (int n = 0; n < bench_iters; n++) {
+	mrc_ddc_amr_apply(ddcs[i], fld);
+      }
+      t = MPI_Wtime() - t;
+      MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, mrc_fld_comm(fld));
+      mpi_printf(mrc_fld_comm(fld), "ddc_amr %s %-7s: %g ms / apply\n", name,
+		 names[i], 1e3 * t / bench_iters);
+    }
+  }
+
+  mrc_fld_destroy(fld_csr);
+}
+
+// ----------------------------------------------------------------------
+// test_plan
+
+static void
+test_plan(struct mrc_fld *fld, int bench_iters)
+{
+  struct mrc_ddc *ddc_plan = create_ddc(fld, true);
+  struct mrc_ddc *ddc_csr = create_ddc(fld, false);
+  check_ddc_plan(fld, ddc_plan, ddc_csr, "stencil", bench_iters);
+  mrc_ddc_destroy(ddc_plan);
+  mrc_ddc_destroy(ddc_csr);
+
+  ddc_plan = create_ddc_random(fld, true);
+  ddc_csr = create_ddc_random(fld, false);
+  check_ddc_plan(fld, ddc_plan, ddc_csr, "random", bench_iters);
+  mrc_ddc_destroy(ddc_plan);
+  mrc_ddc_destroy(ddc_csr);
+}
+
 // FIXME hacky workaround
 
 static void
@@ -348,6 +514,52 @@ mrc_fld_write_as_float(struct mrc_fld *g, struct mrc_io *io)
   mrc_fld_destroy(fld);
 }
 
+// ----------------------------------------------------------------------
+// run_fdtd
+
+static void
+run_fdtd(struct mrc_fld *fld)
+{
+  struct mrc_ddc *ddc_E = create_ddc(fld, true);
+  struct mrc_ddc *ddc_H = create_ddc(fld, true);
+
+  // write field to disk
+
+  struct mrc_io *io = mrc_io_create(mrc_fld_comm(fld));
+  mrc_io_set_type(io, "xdmf2");
+  mrc_io_set_param_int(io, "sw", 0);
+  mrc_io_set_from_options(io);
+  mrc_io_setup(io);
+
+  mrc_io_open(io, "w", 0, 0);
+  mrc_fld_write_as_float(fld, io);
+  mrc_io_close(io);
+
+  mrc_ddc_amr_apply(ddc_E, fld);
+  mrc_ddc_amr_apply(ddc_H, fld);
+#if 0
+  find_ghosts(fld->_domain, fld, EY, (int[]) { 1, 0, 1 }, 2);
+  find_ghosts(fld->_domain, fld, EZ, (int[]) { 1, 1, 0 }, 2);
+#endif
+
+  mrc_io_open(io, "w", 1, 1);
+  mrc_fld_write_as_float(fld, io);
+  mrc_io_close(io);
+
+  for (int n = 0; n <= 100; n++) {
+    mrc_io_open(io, "w", n+2, n+2);
+    mrc_fld_write_as_float(fld, io);
+    mrc_io_close(io);
+
+    step_fdtd(fld, ddc_E, ddc_H);
+  }
+
+  mrc_io_destroy(io);
+
+  mrc_ddc_destroy(ddc_E);
+  mrc_ddc_destroy(ddc_H);
+}
+
 float
 func1(float x, float y, int m)
 {
@@ -382,6 +594,13 @@ main(int argc, char **argv)
   MPI_Init(&argc, &argv);
   libmrc_params_init(argc, argv);
 
+  bool check_plan = false;
+  int bench_iters = 10;
+  int amr_domain = 4;
+  mrc_params_get_option_bool("check_plan", &check_plan);
+  mrc_params_get_option_int("bench_iters", &bench_iters);
+  mrc_params_get_option_int("amr_domain", &amr_domain);
+
   struct mrc_domain *domain = mrc_domain_create(MPI_COMM_WORLD);
   struct mrc_crds *crds = mrc_domain_get_crds(domain);
   mrc_domain_set_type(domain, "amr");
@@ -390,7 +609,14 @@ main(int argc, char **argv)
   mrc_crds_set_param_int(crds, "sw", 2);
   
   mrc_domain_set_from_options(domain);
-  mrctest_set_amr_domain_4(domain);
+  switch (amr_domain) {
+  case 0: mrctest_set_amr_domain_0(domain); break;
+  case 1: mrctest_set_amr_domain_1(domain); break;
+  case 2: mrctest_set_amr_domain_2(domain); break;
+  case 3: mrctest_set_amr_domain_3(domain); break;
+  case 4: mrctest_set_amr_domain_4(domain); break;
+  default: assert(0);
+  }
 
   mrc_domain_setup(domain);
   mrc_domain_plot(domain);
@@ -451,72 +677,12 @@ main(int argc, char **argv)
     } mrc_fld_foreach_end;
   }
 
-  struct mrc_ddc *ddc_E = mrc_ddc_create(mrc_domain_comm(domain));
-  mrc_ddc_set_type(ddc_E, "amr");
-  mrc_ddc_set_domain(ddc_E, domain);
-  mrc_ddc_set_param_int(ddc_E, "size_of_type", sizeof(mrc_fld_data_t));
-  mrc_ddc_set_param_int3(ddc_E, "sw", fld->_sw.vals);
-  mrc_ddc_set_param_int(ddc_E, "n_comp", 6);
-  mrc_ddc_setup(ddc_E);
-  mrc_ddc_amr_set_by_stencil(ddc_E, EX, 1, (int[]) { 0, 1, 1 }, &stencils_coarse[EX], &stencils_fine[EX]);
-  mrc_ddc_amr_set_by_stencil(ddc_E, EY, 1, (int[]) { 1, 0, 1 }, &stencils_coarse[EY], &stencils_fine[EY]);
-  mrc_ddc_amr_set_by_stencil(ddc_E, EZ, 1, (int[]) { 1, 1, 0 }, &stencils_coarse[EZ], &stencils_fine[EZ]);
-  mrc_ddc_amr_set_by_stencil(ddc_E, HX, 1, (int[]) { 1, 0, 0 }, &stencils_coarse[HX], &stencils_fine[HX]);
-  mrc_ddc_amr_set_by_stencil(ddc_E, HY, 1, (int[]) { 0, 1, 0 }, &stencils_coarse[HY], &stencils_fine[HY]);
-  mrc_ddc_amr_set_by_stencil(ddc_E, HZ, 1, (int[]) { 0, 0, 1 }, &stencils_coarse[HZ], &stencils_fine[HZ]);
-  mrc_ddc_amr_assemble(ddc_E);
-
-  struct mrc_ddc *ddc_H = mrc_ddc_create(mrc_domain_comm(domain));
-  mrc_ddc_set_type(ddc_H, "amr");
-  mrc_ddc_set_domain(ddc_H, domain);
-  mrc_ddc_set_param_int(ddc_H, "size_of_type", sizeof(mrc_fld_data_t));
-  mrc_ddc_set_param_int3(ddc_H, "sw", fld->_sw.vals);
-  mrc_ddc_set_param_int(ddc_H, "n_comp", 6);
-  mrc_ddc_setup(ddc_H);
-  mrc_ddc_amr_set_by_stencil(ddc_H, EX, 1, (int[]) { 0, 1, 1 }, &stencils_coarse[EX], &stencils_fine[EX]);
-  mrc_ddc_amr_set_by_stencil(ddc_H, EY, 1, (int[]) { 1, 0, 1 }, &stencils_coarse[EY], &stencils_fine[EY]);
-  mrc_ddc_amr_set_by_stencil(ddc_H, EZ, 1, (int[]) { 1, 1, 0 }, &stencils_coarse[EZ], &stencils_fine[EZ]);
-  mrc_ddc_amr_set_by_stencil(ddc_H, HX, 1, (int[]) { 1, 0, 0 }, &stencils_coarse[HX], &stencils_fine[HX]);
-  mrc_ddc_amr_set_by_stencil(ddc_H, HY, 1, (int[]) { 0, 1, 0 }, &stencils_coarse[HY], &stencils_fine[HY]);
-  mrc_ddc_amr_set_by_stencil(ddc_H, HZ, 1, (int[]) { 0, 0, 1 }, &stencils_coarse[HZ], &stencils_fine[HZ]);
-  mrc_ddc_amr_assemble(ddc_H);
-
-  // write field to disk
-
-  struct mrc_io *io = mrc_io_create(mrc_domain_comm(domain));
-  mrc_io_set_type(io, "xdmf2");
-  mrc_io_set_param_int(io, "sw", 0);
-  mrc_io_set_from_options(io);
-  mrc_io_setup(io);
-
-  mrc_io_open(io, "w", 0, 0);
-  mrc_fld_write_as_float(fld, io);
-  mrc_io_close(io);
-
-  mrc_ddc_amr_apply(ddc_E, fld);
-  mrc_ddc_amr_apply(ddc_H, fld);
-#if 0
-  find_ghosts(domain, fld, EY, (int[]) { 1, 0, 1 }, 2);
-  find_ghosts(domain, fld, EZ, (int[]) { 1, 1, 0 }, 2);
-#endif
-
-  mrc_io_open(io, "w", 1, 1);
-  mrc_fld_write_as_float(fld, io);
-  mrc_io_close(io);
-
-  for (int n = 0; n <= 100; n++) {
-    mrc_io_open(io, "w", n+2, n+2);
-    mrc_fld_write_as_float(fld, io);
-    mrc_io_close(io);
-
-    step_fdtd(fld, ddc_E, ddc_H);
+  if (check_plan) {
+    test_plan(fld, bench_iters);
+  } else {
+    run_fdtd(fld);
   }
 
-  mrc_io_destroy(io);
-
-  mrc_ddc_destroy(ddc_E);
-  mrc_ddc_destroy(ddc_H);
-
   mrc_fld_destroy(fld);
 
   mrc_domain_destroy(domain);
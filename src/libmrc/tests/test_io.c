@@ -36,7 +36,7 @@ struct mrc_class_test_io_attrs mrc_class_test_io_attrs = {
 // ----------------------------------------------------------------------
 
 static void
-dump_field(struct mrc_fld *fld, int rank_diagsrv)
+dump_field(struct mrc_fld *fld, int rank_diagsrv, int nr_diagsrvs)
 {
   struct mrc_domain *domain = fld->_domain;
   assert(domain);
@@ -54,6 +54,7 @@ dump_field(struct mrc_fld *fld, int rank_diagsrv)
     io = mrc_io_create(comm);
     mrc_io_set_type(io, "combined");
     mrc_io_set_param_int(io, "rank_diagsrv", rank_diagsrv);
+    mrc_io_set_param_int(io, "nr_diagsrvs", nr_diagsrvs);
   } else {
     io = mrc_io_create(comm);
   }
@@ -70,6 +71,15 @@ dump_field(struct mrc_fld *fld, int rank_diagsrv)
   mrc_io_open(io, "w", 1, 1.);
   mrc_obj_write(dict, io);
   mrc_fld_write(fld, io);
+  if (rank_diagsrv >= 0) {
+    // 2d slices are only supported by the diag server path
+    struct mrc_crds *crds = mrc_domain_get_crds(domain);
+    for (int outtype = DIAG_TYPE_2D_X; outtype <= DIAG_TYPE_2D_Z; outtype++) {
+      int d = outtype - DIAG_TYPE_2D_X;
+      float sheet = crds->l[d] + .3 * (crds->h[d] - crds->l[d]);
+      mrc_io_write_field_slice(io, 1., fld, outtype, sheet);
+    }
+  }
   mrc_io_close(io);
 
   mrc_io_destroy(io);
@@ -88,7 +98,7 @@ mod_domain(struct mrc_mod *mod, void *arg)
 
   struct mrc_fld *fld = mrctest_create_field_1(domain);
   int rank_diagsrv = mrc_mod_get_first_node(mod, "diagsrv");
-  dump_field(fld, rank_diagsrv);
+  dump_field(fld, rank_diagsrv, mrc_mod_get_nr_procs(mod, "diagsrv"));
   mrc_fld_destroy(fld);
 
   mrc_domain_destroy(domain);
@@ -3,8 +3,10 @@
 #include <mrc_fld.h>
 #include <mrc_fld_as_double.h>
 #include <mrc_mat.h>
+#include <mrc_vec.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <math.h>
@@ -63,6 +65,155 @@ static const struct entry *mat_1[12] = {
   [11] = (struct entry[]) { { 11, 1. }, { -1, } },
 };
 
+// ----------------------------------------------------------------------
+// make_mat_2
+//
+// rows of 1 - 7 entries, scattered over the columns, so that SELL chunks
+// have rows of different lengths
+
+const int N_2 = 100;
+
+static struct entry **
+make_mat_2()
+{
+  struct entry **mat = calloc(N_2, sizeof(*mat));
+  for (int row = 0; row < N_2; row++) {
+    int len = 1 + (row * 5) % 7;
+    struct entry *e = calloc(len + 1, sizeof(*e));
+    for (int j = 0; j < len; j++) {
+      e[j].col = (row * 7 + 3 * j) % N_2;
+      e[j].val = 1. + row + .1 * j;
+    }
+    e[len].col = -1;
+    mat[row] = e;
+  }
+  return mat;
+}
+
+// ----------------------------------------------------------------------
+// create_mat
+
+static struct mrc_mat *
+create_mat(const char *type, int sell_c, int sell_sigma,
+	   const struct entry **mat, int N)
+{
+  struct mrc_mat *A = mrc_mat_create(MPI_COMM_SELF);
+  mrc_mat_set_type(A, type);
+  mrc_mat_set_param_int(A, "m", N);
+  mrc_mat_set_param_int(A, "n", N);
+  if (sell_c) {
+    mrc_mat_set_param_int(A, "sell_c", sell_c);
+    mrc_mat_set_param_int(A, "sell_sigma", sell_sigma);
+  }
+  mrc_mat_setup(A);
+  for (int row = 0; row < N; row++) {
+    for (const struct entry *e = mat[row]; e && e->col >= 0; e++) {
+      mrc_mat_add_value(A, row, e->col, e->val);
+    }
+  }
+  mrc_mat_assemble(A);
+  return A;
+}
+
+// ----------------------------------------------------------------------
+// create_vec
+
+static struct mrc_vec *
+create_vec(int N, int seed)
+{
+  struct mrc_vec *x = mrc_vec_create(MPI_COMM_SELF);
+  mrc_vec_set_type(x, FLD_TYPE);
+  mrc_vec_set_param_int(x, "len", N);
+  mrc_vec_setup(x);
+  mrc_fld_data_t *arr = mrc_vec_get_array(x);
+  for (int i = 0; i < N; i++) {
+    arr[i] = ((i + seed) * 37) % 11 - 5.;
+  }
+  mrc_vec_put_array(x, arr);
+  return x;
+}
+
+// ----------------------------------------------------------------------
+// check_vec
+
+static void
+check_vec(struct mrc_vec *x, struct mrc_vec *x_ref, const char *what)
+{
+  int N = mrc_vec_len(x);
+  mrc_fld_data_t *arr = mrc_vec_get_array(x);
+  mrc_fld_data_t *arr_ref = mrc_vec_get_array(x_ref);
+  for (int i = 0; i < N; i++) {
+    if (fabs(arr[i] - arr_ref[i]) > 1e-12 * fmax(1., fabs(arr_ref[i]))) {
+      mprintf("%s: [%d] %g != %g\n", what, i, arr[i], arr_ref[i]);
+      assert(0);
+    }
+  }
+  mrc_vec_put_array(x, arr);
+  mrc_vec_put_array(x_ref, arr_ref);
+}
+
+// ----------------------------------------------------------------------
+// check_formats
+//
+// apply, apply_add and apply_in_place (also as apply with y == x) for
+// mcsr and csr with SELL have to match plain csr
+
+static void
+check_formats(const struct entry **mat, int N)
+{
+  static struct {
+    const char *type;
+    int sell_c, sell_sigma;
+  } formats[] = {
+    { "mcsr" },
+    { "csr", 4, 1 },
+    { "csr", 4, 8 },
+    { "csr", 8, 32 },
+  };
+
+  struct mrc_mat *A_ref = create_mat("csr", 0, 0, mat, N);
+  struct mrc_vec *x = create_vec(N, 0);
+  struct mrc_vec *y0 = create_vec(N, 1);
+  struct mrc_vec *y_ref = create_vec(N, 1), *y = create_vec(N, 1);
+  struct mrc_vec *ya_ref = create_vec(N, 1), *ya = create_vec(N, 1);
+  struct mrc_vec *xi_ref = create_vec(N, 0), *xi = create_vec(N, 0);
+  mrc_mat_apply(y_ref, A_ref, x);
+  mrc_mat_apply_add(ya_ref, A_ref, x);
+  mrc_mat_apply_in_place(A_ref, xi_ref);
+
+  for (int f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    struct mrc_mat *A = create_mat(formats[f].type, formats[f].sell_c,
+				   formats[f].sell_sigma, mat, N);
+    mrc_vec_set(y, 0.);
+    mrc_mat_apply(y, A, x);
+    check_vec(y, y_ref, "apply");
+
+    mrc_vec_copy(ya, y0);
+    mrc_mat_apply_add(ya, A, x);
+    check_vec(ya, ya_ref, "apply_add");
+
+    mrc_vec_copy(xi, x);
+    mrc_mat_apply_in_place(A, xi);
+    check_vec(xi, xi_ref, "apply_in_place");
+
+    mrc_vec_copy(xi, x);
+    mrc_mat_apply(xi, A, xi);
+    check_vec(xi, xi_ref, "apply y == x");
+
+    mrc_mat_destroy(A);
+  }
+
+  mrc_vec_destroy(x);
+  mrc_vec_destroy(y0);
+  mrc_vec_destroy(y_ref);
+  mrc_vec_destroy(y);
+  mrc_vec_destroy(ya_ref);
+  mrc_vec_destroy(ya);
+  mrc_vec_destroy(xi_ref);
+  mrc_vec_destroy(xi);
+  mrc_mat_destroy(A_ref);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -72,6 +223,10 @@ main(int argc, char **argv)
   int testcase = 0;
   mrc_params_get_option_int("testcase", &testcase);
 
+  check_formats(mat_0, N_0);
+  check_formats(mat_1, N_1);
+  check_formats((const struct entry **) make_mat_2(), N_2);
+
   int N;
   const struct entry **mat;
 
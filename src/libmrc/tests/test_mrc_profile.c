@@ -0,0 +1,89 @@
+
+#include <mrc_profile.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void
+spin(long long ns)
+{
+  long long t0 = prof_time_ns();
+  while (prof_time_ns() - t0 < ns) {
+  }
+}
+
+static char *
+read_file(const char *filename)
+{
+  FILE *f = fopen(filename, "r");
+  assert(f);
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *buf = malloc(len + 1);
+  size_t n = fread(buf, 1, len, f);
+  assert(n == len);
+  buf[len] = 0;
+  fclose(f);
+  return buf;
+}
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  int pr_step = prof_register("test_step", 1., 0, 0);
+  int pr_a = prof_register("test_a", 1., 0, 0);
+  int pr_b = prof_register("test_b", 1., 0, 0);
+
+  prof_trace_enable(1000);
+  for (int n = 0; n < 4; n++) {
+    prof_start(pr_step);
+    prof_start(pr_a);
+    spin(100000);
+    prof_start(pr_b);
+    spin(100000);
+    prof_stop(pr_b);
+    prof_stop(pr_a);
+    prof_start(pr_b);
+    spin(100000);
+    prof_stop(pr_b);
+    prof_restart(pr_b);
+    prof_stop(pr_b);
+    prof_stop(pr_step);
+    prof_step_end();
+  }
+
+  // flat totals still work as before
+  assert(prof_globals.info[pr_b - 1].cnt == 8);
+
+  prof_write_json(MPI_COMM_WORLD, "test_mrc_profile.json");
+  prof_write_chrome_trace(MPI_COMM_WORLD, "test_mrc_profile_trace.json");
+
+  if (rank == 0) {
+    char *json = read_file("test_mrc_profile.json");
+    assert(strstr(json, "\"path\": \"test_step\""));
+    assert(strstr(json, "\"path\": \"test_step/test_a\""));
+    assert(strstr(json, "\"path\": \"test_step/test_a/test_b\""));
+    assert(strstr(json, "\"path\": \"test_step/test_b\""));
+    assert(strstr(json, "\"nr_steps\": 4"));
+    free(json);
+
+    char *trace = read_file("test_mrc_profile_trace.json");
+    assert(strncmp(trace, "{\"traceEvents\": [\n{\"name\": ", 27) == 0);
+    assert(strstr(trace, "\"name\": \"test_a\", \"ph\": \"X\""));
+    free(trace);
+
+    unlink("test_mrc_profile.json");
+    unlink("test_mrc_profile_trace.json");
+  }
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,162 @@
+
+#include <mrc_redist.h>
+#include <mrc_domain.h>
+#include <mrc_fld.h>
+#include <mrc_ndarray.h>
+#include <mrc_params.h>
+
+#include <stdio.h>
+#include <assert.h>
+
+// ----------------------------------------------------------------------
+// value
+//
+// global index (plus an offset per component), so that every point of the
+// gathered slab can be checked
+
+static double
+value(const int gdims[3], int m, int ix, int iy, int iz)
+{
+  return m * 1000000 + (iz * gdims[1] + iy) * gdims[0] + ix;
+}
+
+// ----------------------------------------------------------------------
+// create_domain
+//
+// mx, my are per process, so the domain can be split across any number of
+// procs
+
+static struct mrc_domain *
+create_domain(int mx, int my, int mz, int npx, int npy)
+{
+  struct mrc_domain *domain = mrc_domain_create(MPI_COMM_WORLD);
+  mrc_domain_set_type(domain, "simple");
+  mrc_domain_set_param_int3(domain, "m", (int [3]) { mx * npx, my * npy, mz });
+  mrc_domain_set_param_int3(domain, "np", (int [3]) { npx, npy, 1 });
+  mrc_domain_setup(domain);
+  return domain;
+}
+
+// ----------------------------------------------------------------------
+// check_redist
+//
+// redistributes all components of a field of the given type and checks
+// what ends up on the writers
+
+static void
+check_redist(struct mrc_redist *redist, struct mrc_domain *domain,
+	     const char *type, int nr_comps)
+{
+  int gdims[3];
+  mrc_domain_get_global_dims(domain, gdims);
+
+  struct mrc_fld *fld = mrc_domain_fld_create(domain, 0, NULL);
+  mrc_fld_set_type(fld, type);
+  mrc_fld_set_param_int(fld, "nr_comps", nr_comps);
+  mrc_fld_setup(fld);
+
+  mrc_fld_foreach_patch(fld, p) {
+    struct mrc_patch_info info;
+    mrc_domain_get_local_patch_info(domain, p, &info);
+    for (int m = 0; m < nr_comps; m++) {
+      mrc_fld_foreach(fld, ix,iy,iz, 0,0) {
+	double val = value(gdims, m, ix + info.off[0], iy + info.off[1], iz + info.off[2]);
+	switch (mrc_fld_data_type(fld)) {
+	case MRC_NT_FLOAT:  MRC_S5(fld, ix,iy,iz, m, p) = val; break;
+	case MRC_NT_DOUBLE: MRC_D5(fld, ix,iy,iz, m, p) = val; break;
+	case MRC_NT_INT:    MRC_I5(fld, ix,iy,iz, m, p) = val; break;
+	default: assert(0);
+	}
+      } mrc_fld_foreach_end;
+    }
+  }
+
+  struct mrc_ndarray *nd = mrc_redist_get_ndarray(redist, fld);
+  for (int m = 0; m < nr_comps; m++) {
+    mrc_redist_run(redist, nd, fld, m);
+    if (!nd) { // not a writer
+      continue;
+    }
+
+    assert(mrc_ndarray_data_type(nd) == mrc_fld_data_type(fld));
+    int *offs = mrc_ndarray_offs(nd), *dims = mrc_ndarray_dims(nd);
+    for (int iz = offs[2]; iz < offs[2] + dims[2]; iz++) {
+      for (int iy = offs[1]; iy < offs[1] + dims[1]; iy++) {
+	for (int ix = offs[0]; ix < offs[0] + dims[0]; ix++) {
+	  double val;
+	  switch (mrc_ndarray_data_type(nd)) {
+	  case MRC_NT_FLOAT:  val = MRC_S3(nd, ix,iy,iz); break;
+	  case MRC_NT_DOUBLE: val = MRC_D3(nd, ix,iy,iz); break;
+	  case MRC_NT_INT:    val = MRC_I3(nd, ix,iy,iz); break;
+	  default: assert(0);
+	  }
+	  if (val != value(gdims, m, ix, iy, iz)) {
+	    mprintf("%s m %d [%d,%d,%d]: %g != %g\n", type, m, ix, iy, iz,
+		    val, value(gdims, m, ix, iy, iz));
+	    assert(0);
+	  }
+	}
+      }
+    }
+  }
+  mrc_redist_put_ndarray(redist, nd);
+
+  mrc_fld_destroy(fld);
+}
+
+// ----------------------------------------------------------------------
+// main
+//
+// the plan is reused while the domain stays the same, rebuilt when it
+// changes, and the redist always ends up on the current domain's
+// communicator, even when a new domain has an unchanged layout
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  int nr_writers = size > 1 ? size - 1 : 1;
+
+  struct mrc_domain *domain = create_domain(8, 12, 10, size, 1);
+  struct mrc_redist redist;
+  mrc_redist_init(&redist, domain, (int [3]) { 0, 0, 0 }, (int [3]) { 0, 0, 0 },
+		  nr_writers);
+
+  // same domain, plan is kept
+  for (int step = 0; step < 3; step++) {
+    mrc_redist_update(&redist, domain);
+    check_redist(&redist, domain, "float", 3);
+    check_redist(&redist, domain, "double", 2);
+    check_redist(&redist, domain, "int", 1);
+  }
+
+  // new domain with the same layout, the old one (and its comm) is gone
+  mrc_domain_destroy(domain);
+  domain = create_domain(8, 12, 10, size, 1);
+  mrc_redist_update(&redist, domain);
+  assert(redist.comm == mrc_domain_comm(domain));
+  check_redist(&redist, domain, "float", 2);
+
+  // different decomposition
+  struct mrc_domain *domain2 = create_domain(8, 10, 6, 1, size);
+  mrc_redist_update(&redist, domain2);
+  assert(redist.comm == mrc_domain_comm(domain2));
+  check_redist(&redist, domain2, "double", 2);
+  mrc_domain_destroy(domain);
+
+  // different global dims
+  struct mrc_domain *domain3 = create_domain(12, 8, 4, size, 1);
+  mrc_redist_update(&redist, domain3);
+  check_redist(&redist, domain3, "float", 2);
+
+  mrc_redist_destroy(&redist);
+  mrc_domain_destroy(domain2);
+  mrc_domain_destroy(domain3);
+
+  MPI_Finalize();
+  return 0;
+}
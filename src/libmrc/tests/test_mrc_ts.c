@@ -0,0 +1,194 @@
+
+#include <mrc_ts.h>
+#include <mrc_fld.h>
+#include <mrc_vec.h>
+#include <mrc_params.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+// ======================================================================
+// test ODE
+//
+// y' = k cos(k t) y, y(0) = 1, so y(t) = exp(sin(k t)). The rhs depends on
+// t, which makes it check the stage times, too. A second component with
+// y' = -k sin(k t) y, y(t) = exp(cos(k t) - 1) is carried along.
+// mrc_ts passes the time as float, so k is chosen large enough that the
+// truncation error stays well above the resulting error floor.
+
+static const double k = 4.;
+
+static void
+calc_rhs(void *ctx, struct mrc_obj *_rhs, float t, struct mrc_obj *_x)
+{
+  struct mrc_fld *rhs = (struct mrc_fld *) _rhs, *x = (struct mrc_fld *) _x;
+
+  MRC_D2(rhs, 0, 0) = k * cos(k * t) * MRC_D2(x, 0, 0);
+  MRC_D2(rhs, 1, 0) = -k * sin(k * t) * MRC_D2(x, 1, 0);
+}
+
+// ----------------------------------------------------------------------
+// solve
+//
+// integrates from 0 to max_time using the given scheme and dt, returns the
+// max error vs the exact solution
+
+static double
+solve(const char *type, double dt, double max_time)
+{
+  struct mrc_fld *x = mrc_fld_create(MPI_COMM_WORLD);
+  mrc_fld_set_type(x, "double");
+  mrc_fld_set_param_int_array(x, "dims", 2, (int [2]) { 2, 1 });
+  mrc_fld_setup(x);
+  MRC_D2(x, 0, 0) = 1.;
+  MRC_D2(x, 1, 0) = 1.;
+
+  struct mrc_ts *ts = mrc_ts_create(MPI_COMM_WORLD);
+  mrc_ts_set_type(ts, type);
+  mrc_ts_set_param_float(ts, "dt", dt);
+  mrc_ts_set_param_float(ts, "max_time", max_time);
+  mrc_ts_set_solution(ts, mrc_fld_to_mrc_obj(x));
+  mrc_ts_set_rhs_function(ts, calc_rhs, NULL);
+  mrc_ts_setup(ts);
+  mrc_ts_solve(ts);
+  double t = mrc_ts_time(ts);
+  assert(fabs(t - max_time) < 1e-6);
+  mrc_ts_destroy(ts);
+
+  double err = fmax(fabs(MRC_D2(x, 0, 0) - exp(sin(k * t))),
+		    fabs(MRC_D2(x, 1, 0) - exp(cos(k * t) - 1.)));
+  mrc_fld_destroy(x);
+  return err;
+}
+
+// ----------------------------------------------------------------------
+// test_order
+//
+// halving dt, starting from dt0, should reduce the error by (at least)
+// 2^order. The coefficients only get passed on as float, so the dt's are
+// per scheme, to stay clear of round-off in the asymptotic range.
+
+static void
+test_order(const char *type, int order, double dt0)
+{
+  // powers of 2, so that the (float) time hits max_time exactly
+  const double max_time = 2.;
+  double dt = dt0;
+  double err = solve(type, dt, max_time);
+  for (int i = 0; i < 2; i++) {
+    dt /= 2.;
+    double err_half = solve(type, dt, max_time);
+    double rate = log2(err / err_half);
+    mpi_printf(MPI_COMM_WORLD, "%-6s dt %-9g err %-12g rate %g\n",
+	       type, dt, err_half, rate);
+    if (rate < order - .3) {
+      mpi_printf(MPI_COMM_WORLD, "%s: expected order %d, got %g\n",
+		 type, order, rate);
+      assert(0);
+    }
+    err = err_half;
+  }
+}
+
+// ======================================================================
+// test_maxpy
+//
+// mrc_vec_maxpy() gives the same result as the corresponding sequence of
+// mrc_vec_axpy()s
+
+static struct mrc_vec *
+create_vec(const char *type, int len, int seed)
+{
+  struct mrc_vec *vec = mrc_vec_create(MPI_COMM_WORLD);
+  mrc_vec_set_type(vec, type);
+  mrc_vec_set_param_int(vec, "len", len);
+  mrc_vec_setup(vec);
+
+  srand(seed);
+  if (mrc_vec_size_of_type(vec) == sizeof(double)) {
+    double *arr = mrc_vec_get_array(vec);
+    for (int i = 0; i < len; i++) {
+      arr[i] = (double) rand() / RAND_MAX - .5;
+    }
+    mrc_vec_put_array(vec, arr);
+  } else {
+    float *arr = mrc_vec_get_array(vec);
+    for (int i = 0; i < len; i++) {
+      arr[i] = (float) rand() / RAND_MAX - .5f;
+    }
+    mrc_vec_put_array(vec, arr);
+  }
+  return vec;
+}
+
+static void
+test_maxpy(const char *type, double eps)
+{
+  const int len = 1000, n_max = 16;
+
+  struct mrc_vec *x[n_max];
+  double alpha[n_max];
+  for (int k = 0; k < n_max; k++) {
+    x[k] = create_vec(type, len, k + 1);
+    alpha[k] = (k % 2 ? -1. : 1.) / (k + 1);
+  }
+
+  for (int n = 0; n <= n_max; n++) {
+    struct mrc_vec *y = create_vec(type, len, 100);
+    struct mrc_vec *y_ref = create_vec(type, len, 100);
+    mrc_vec_maxpy(y, n, alpha, x);
+    for (int k = 0; k < n; k++) {
+      mrc_vec_axpy(y_ref, alpha[k], x[k]);
+    }
+
+    // y_ref = y_ref - y
+    mrc_vec_axpby(y_ref, -1., y, 1.);
+    double diff = 0.;
+    if (mrc_vec_size_of_type(y_ref) == sizeof(double)) {
+      double *arr = mrc_vec_get_array(y_ref);
+      for (int i = 0; i < len; i++) {
+	diff = fmax(diff, fabs(arr[i]));
+      }
+      mrc_vec_put_array(y_ref, arr);
+    } else {
+      float *arr = mrc_vec_get_array(y_ref);
+      for (int i = 0; i < len; i++) {
+	diff = fmax(diff, fabs(arr[i]));
+      }
+      mrc_vec_put_array(y_ref, arr);
+    }
+    if (diff > eps) {
+      mpi_printf(MPI_COMM_WORLD, "maxpy %s n %d: diff %g\n", type, n, diff);
+      assert(0);
+    }
+
+    mrc_vec_destroy(y);
+    mrc_vec_destroy(y_ref);
+  }
+
+  for (int k = 0; k < n_max; k++) {
+    mrc_vec_destroy(x[k]);
+  }
+}
+
+// ======================================================================
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+
+  test_maxpy("double", 1e-14);
+  test_maxpy("float", 1e-5);
+
+  test_order("rk2", 2, 1. / 8.);
+  test_order("rk4", 4, 1. / 8.);
+  test_order("lsrk3", 3, 1. / 8.);
+  test_order("lsrk4", 4, 1. / 4.);
+
+  MPI_Finalize();
+  return 0;
+}
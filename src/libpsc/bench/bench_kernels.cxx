@@ -0,0 +1,403 @@
+
+// ======================================================================
+// bench_kernels
+//
+// Micro-benchmarks for the host hot kernels, run on a single synthetic patch
+// with a thermal plasma (electrons and ions).
+//
+// usage: bench_kernels [--ppc=N] [--kT=T] [--n_cells=N] [benchmark options]
+//
+//   --ppc      particles per cell per species (default 100)
+//   --kT       temperature in units of m_e c^2 (default .01)
+//   --n_cells  cells per patch in each non-invariant direction (default 16)
+//
+// Use e.g. --benchmark_out=bench.json --benchmark_out_format=json to keep the
+// results for regression tracking.
+
+#include <benchmark/benchmark.h>
+
+#include "psc.h"
+#include "psc_fields_c.h"
+#include "psc_fields_single.h"
+#include "psc_particles_double.h"
+#include "psc_particles_single.h"
+#include "../libpsc/psc_push_particles/push_config.hxx"
+#include "../libpsc/psc_push_particles/1vb/psc_push_particles_1vb.h"
+#include "../libpsc/psc_bnd/psc_bnd_impl.hxx"
+#include "../libpsc/psc_collision/psc_collision_impl.hxx"
+#include "../libpsc/psc_output_fields/fields_item_moments_1st.hxx"
+#include "../libpsc/psc_sort/psc_sort_impl.hxx"
+#include "bnd_particles_impl.hxx"
+#include "psc_push_fields_impl.hxx"
+#include "setup_fields.hxx"
+#include "setup_particles.hxx"
+
+#include <cstring>
+
+static struct
+{
+  int ppc = 100;
+  double kT = .01;
+  int n_cells = 16;
+} params;
+
+// ======================================================================
+// BenchSetup
+//
+// grid, fields and particles shared by all benchmarks
+
+template <typename DIM, typename MP, typename MF>
+struct BenchSetup
+{
+  using dim = DIM;
+  using Mparticles = MP;
+  using MfieldsState = MF;
+
+  BenchSetup() : grid_{make_grid()}, mflds{grid_}, mprts{grid_}
+  {
+    setupFields(mflds, [](int m, double crd[3]) {
+      switch (m) {
+        case EX: return .01 * std::sin(.1 * crd[1]);
+        case EY: return .01 * std::cos(.1 * crd[2]);
+        case HZ: return .1 + .01 * std::sin(.1 * crd[0]);
+        default: return 0.;
+      }
+    });
+
+    SetupParticles<Mparticles> setup_particles(grid_);
+    setup_particles(mprts, [&](int kind, Double3 crd, psc_particle_npt& npt) {
+      npt.n = 1.;
+      for (int d = 0; d < 3; d++) {
+        npt.T[d] = params.kT;
+      }
+    });
+  }
+
+  const Grid_t& grid() const { return grid_; }
+
+  // number of interior cells
+  int n_cells() const
+  {
+    return grid_.ldims[0] * grid_.ldims[1] * grid_.ldims[2];
+  }
+
+  // number of ghost cells
+  int n_ghosts() const
+  {
+    const auto& ibn = grid_.ibn;
+    const auto& ldims = grid_.ldims;
+    return (ldims[0] + 2 * ibn[0]) * (ldims[1] + 2 * ibn[1]) *
+             (ldims[2] + 2 * ibn[2]) -
+           n_cells();
+  }
+
+private:
+  static Grid_t make_grid()
+  {
+    Int3 gdims = {params.n_cells, params.n_cells, params.n_cells};
+    Int3 ibn = {2, 2, 2};
+    for (int d = 0; d < 3; d++) {
+      if (dim::InvarX::value && d == 0 || dim::InvarY::value && d == 1 ||
+          dim::InvarZ::value && d == 2) {
+        gdims[d] = 1;
+        ibn[d] = 0;
+      }
+    }
+
+    auto length = Vec3<double>{10. * gdims[0], 10. * gdims[1], 10. * gdims[2]};
+    auto domain = Grid_t::Domain{gdims, length};
+    auto bc =
+      psc::grid::BC{{BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                    {BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                    {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC},
+                    {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC}};
+    auto kinds = Grid_t::Kinds{Grid_t::Kind(-1., 1., "e"),
+                               Grid_t::Kind(1., 100., "i")};
+
+    auto norm_params = Grid_t::NormalizationParams::dimensionless();
+    norm_params.nicell = params.ppc;
+    auto norm = Grid_t::Normalization{norm_params};
+
+    return Grid_t{domain, bc, kinds, norm, 1., -1, ibn};
+  }
+
+  Grid_t grid_;
+
+public:
+  MfieldsState mflds;
+  Mparticles mprts;
+};
+
+// ----------------------------------------------------------------------
+// set_prts_counters
+
+template <typename Mparticles>
+static void set_prts_counters(benchmark::State& state, Mparticles& mprts)
+{
+  using Particle = typename Mparticles::Particle;
+
+  size_t n_prts = mprts.size();
+  state.counters["prts/s"] =
+    benchmark::Counter(n_prts, benchmark::Counter::kIsIterationInvariantRate);
+  // each particle is read and written once
+  state.SetBytesProcessed(state.iterations() * 2 * n_prts * sizeof(Particle));
+}
+
+// ======================================================================
+// particle push
+
+template <typename PushParticles, typename DIM>
+static void BM_PushParticles(benchmark::State& state)
+{
+  using Mparticles = typename PushParticles::Mparticles;
+  using MfieldsState = typename PushParticles::MfieldsState;
+
+  BenchSetup<DIM, Mparticles, MfieldsState> setup;
+  PushParticles pushp;
+  BndParticles_<Mparticles> bndp{setup.grid()};
+
+  for (auto _ : state) {
+    pushp.push_mprts(setup.mprts, setup.mflds);
+    // keep particles inside the patch, but don't time it
+    state.PauseTiming();
+    bndp(setup.mprts);
+    state.ResumeTiming();
+  }
+
+  set_prts_counters(state, setup.mprts);
+}
+
+template <typename DIM>
+using PushParticlesVbSingle = PushParticlesVb<
+  Config1vbecSplit<MparticlesSingle, MfieldsStateSingle, DIM>>;
+
+template <typename DIM>
+using PushParticlesEsirkepovDouble =
+  PushParticlesEsirkepov<Config2ndDouble<DIM>>;
+
+BENCHMARK_TEMPLATE(BM_PushParticles, PushParticlesVbSingle<dim_yz>, dim_yz);
+BENCHMARK_TEMPLATE(BM_PushParticles, PushParticlesVbSingle<dim_xyz>, dim_xyz);
+BENCHMARK_TEMPLATE(BM_PushParticles, PushParticlesEsirkepovDouble<dim_yz>,
+                   dim_yz);
+BENCHMARK_TEMPLATE(BM_PushParticles, PushParticlesEsirkepovDouble<dim_xyz>,
+                   dim_xyz);
+
+// ======================================================================
+// particle boundary exchange
+
+template <typename DIM>
+static void BM_BndParticles(benchmark::State& state)
+{
+  using Mparticles = MparticlesSingle;
+
+  BenchSetup<DIM, Mparticles, MfieldsStateSingle> setup;
+  PushParticlesVbSingle<DIM> pushp;
+  BndParticles_<Mparticles> bndp{setup.grid()};
+
+  for (auto _ : state) {
+    // move particles so that there is something to exchange
+    state.PauseTiming();
+    pushp.push_mprts(setup.mprts, setup.mflds);
+    state.ResumeTiming();
+    bndp(setup.mprts);
+  }
+
+  set_prts_counters(state, setup.mprts);
+}
+
+BENCHMARK_TEMPLATE(BM_BndParticles, dim_yz);
+BENCHMARK_TEMPLATE(BM_BndParticles, dim_xyz);
+
+// ======================================================================
+// sort
+
+template <typename DIM>
+static void BM_SortCountsort2(benchmark::State& state)
+{
+  using Mparticles = MparticlesSingle;
+
+  BenchSetup<DIM, Mparticles, MfieldsStateSingle> setup;
+  PushParticlesVbSingle<DIM> pushp;
+  BndParticles_<Mparticles> bndp{setup.grid()};
+  SortCountsort2<Mparticles> sort;
+
+  for (auto _ : state) {
+    // sort what one step has perturbed, as in an actual run
+    state.PauseTiming();
+    pushp.push_mprts(setup.mprts, setup.mflds);
+    bndp(setup.mprts);
+    state.ResumeTiming();
+    sort(setup.mprts);
+  }
+
+  set_prts_counters(state, setup.mprts);
+}
+
+BENCHMARK_TEMPLATE(BM_SortCountsort2, dim_yz);
+BENCHMARK_TEMPLATE(BM_SortCountsort2, dim_xyz);
+
+// ======================================================================
+// moments
+
+template <typename DIM>
+static void BM_Moments_1st(benchmark::State& state)
+{
+  using Mparticles = MparticlesSingle;
+
+  BenchSetup<DIM, Mparticles, MfieldsStateSingle> setup;
+
+  for (auto _ : state) {
+    Moments_1st<Mparticles, MfieldsSingle> moments{setup.mprts};
+    benchmark::DoNotOptimize(moments);
+  }
+
+  set_prts_counters(state, setup.mprts);
+}
+
+BENCHMARK_TEMPLATE(BM_Moments_1st, dim_yz);
+BENCHMARK_TEMPLATE(BM_Moments_1st, dim_xyz);
+
+// ======================================================================
+// collisions
+
+template <typename DIM>
+static void BM_CollisionHost(benchmark::State& state)
+{
+  using Mparticles = MparticlesSingle;
+  using Collision = CollisionHost<Mparticles, MfieldsStateSingle,
+                                  MfieldsSingle, RngC<float>>;
+
+  BenchSetup<DIM, Mparticles, MfieldsStateSingle> setup;
+  SortCountsort2<Mparticles> sort;
+  Collision collision{setup.grid(), 1, .1};
+
+  // collisions require sorted particles, and don't change positions
+  sort(setup.mprts);
+  for (auto _ : state) {
+    collision(setup.mprts);
+  }
+
+  set_prts_counters(state, setup.mprts);
+}
+
+BENCHMARK_TEMPLATE(BM_CollisionHost, dim_yz);
+BENCHMARK_TEMPLATE(BM_CollisionHost, dim_xyz);
+
+// ======================================================================
+// field push
+
+template <typename DIM>
+static void BM_PushEH(benchmark::State& state)
+{
+  using MfieldsState = MfieldsStateSingle;
+  using real_t = typename MfieldsState::real_t;
+
+  BenchSetup<DIM, MparticlesSingle, MfieldsState> setup;
+  PushFields<MfieldsState> pushf;
+
+  for (auto _ : state) {
+    pushf.push_E(setup.mflds, 1., DIM{});
+    pushf.push_H(setup.mflds, 1., DIM{});
+  }
+
+  state.counters["cells/s"] = benchmark::Counter(
+    setup.n_cells(), benchmark::Counter::kIsIterationInvariantRate);
+  // E: reads J, E, H, writes E; H: reads E, H, writes H
+  state.SetBytesProcessed(state.iterations() * setup.n_cells() * 21 *
+                          sizeof(real_t));
+}
+
+BENCHMARK_TEMPLATE(BM_PushEH, dim_yz);
+BENCHMARK_TEMPLATE(BM_PushEH, dim_xyz);
+
+// ======================================================================
+// field ghost exchange
+
+template <typename DIM, bool ADD>
+static void BM_Bnd(benchmark::State& state)
+{
+  using MfieldsState = MfieldsStateSingle;
+  using real_t = typename MfieldsState::real_t;
+
+  BenchSetup<DIM, MparticlesSingle, MfieldsState> setup;
+  Bnd_<MfieldsState> bnd{setup.grid(), setup.grid().ibn};
+
+  for (auto _ : state) {
+    if (ADD) {
+      bnd.add_ghosts(setup.mflds, JXI, JXI + 3);
+    } else {
+      bnd.fill_ghosts(setup.mflds, EX, EX + 6);
+    }
+  }
+
+  int n_comps = ADD ? 3 : 6;
+  state.counters["cells/s"] = benchmark::Counter(
+    setup.n_ghosts(), benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(state.iterations() * setup.n_ghosts() * n_comps *
+                          sizeof(real_t));
+}
+
+template <typename DIM>
+static void BM_Bnd_fill_ghosts(benchmark::State& state)
+{
+  BM_Bnd<DIM, false>(state);
+}
+
+template <typename DIM>
+static void BM_Bnd_add_ghosts(benchmark::State& state)
+{
+  BM_Bnd<DIM, true>(state);
+}
+
+BENCHMARK_TEMPLATE(BM_Bnd_fill_ghosts, dim_yz);
+BENCHMARK_TEMPLATE(BM_Bnd_fill_ghosts, dim_xyz);
+BENCHMARK_TEMPLATE(BM_Bnd_add_ghosts, dim_yz);
+BENCHMARK_TEMPLATE(BM_Bnd_add_ghosts, dim_xyz);
+
+// ======================================================================
+// main
+
+static bool parse_arg(const char* arg, const char* name, const char** val)
+{
+  size_t len = strlen(name);
+  if (strncmp(arg, name, len) == 0 && arg[len] == '=') {
+    *val = arg + len + 1;
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  // take out our own options, leave the rest to benchmark
+  int n_args = 1;
+  for (int i = 1; i < argc; i++) {
+    const char* val;
+    if (parse_arg(argv[i], "--ppc", &val)) {
+      params.ppc = atoi(val);
+    } else if (parse_arg(argv[i], "--kT", &val)) {
+      params.kT = atof(val);
+    } else if (parse_arg(argv[i], "--n_cells", &val)) {
+      params.n_cells = atoi(val);
+    } else {
+      argv[n_args++] = argv[i];
+    }
+  }
+  argc = n_args;
+
+  benchmark::AddCustomContext("ppc", std::to_string(params.ppc));
+  benchmark::AddCustomContext("kT", std::to_string(params.kT));
+  benchmark::AddCustomContext("n_cells", std::to_string(params.n_cells));
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  MPI_Finalize();
+  return 0;
+}
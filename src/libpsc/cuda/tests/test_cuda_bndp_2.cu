@@ -7,7 +7,7 @@
 
 #include "gtest/gtest.h"
 
-struct prof_globals prof_globals; // FIXME
+PROF_TLS struct prof_globals prof_globals; // FIXME
 
 int prof_register(const char* name, float simd, int flops, int bytes)
 {
@@ -25,7 +25,7 @@ enum
 
 #include <mrc_profile.h>
 
-struct prof_globals prof_globals; // FIXME
+PROF_TLS struct prof_globals prof_globals; // FIXME
 
 int prof_register(const char* name, float simd, int flops, int bytes)
 {
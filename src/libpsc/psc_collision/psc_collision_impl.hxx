@@ -6,6 +6,7 @@
 #include "fields.hxx"
 #include "fields3d.hxx"
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 
@@ -40,9 +41,13 @@ struct CollisionHost
     real_t s[NR_STATS];
   };
 
-  CollisionHost(const Grid_t& grid, int interval, double nu)
+  // The random numbers for a cell are determined by seed, the patch and the
+  // timestep, so a run restarted from a checkpoint (which has the timestep)
+  // continues with the same collisions.
+  CollisionHost(const Grid_t& grid, int interval, double nu, uint32_t seed = 0)
     : interval_{interval},
       nu_{nu},
+      seed_{seed},
       mflds_stats_{grid, NR_STATS, grid.ibn},
       mflds_rei_{grid, NR_STATS, grid.ibn}
   {
@@ -68,16 +73,19 @@ struct CollisionHost
       find_cell_offsets(prts, offsets);
 
       auto F = mflds_stats_[p];
+      uint32_t global_patch = grid.localPatchInfo(p).global_patch;
+      uint32_t step = grid.timestep();
       grid.Foreach_3d(0, 0, [&](int ix, int iy, int iz) {
         int c = (iz * ldims[1] + iy) * ldims[0] + ix;
+        Rng rng{global_patch, seed_, step, uint32_t(c)};
 
         update_rei_before(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
 
         struct psc_collision_stats stats = {};
         // mprintf("p %d ijk %d:%d:%d # %d\n", p, ix, iy, iz, offsets[c+1] -
         // offsets[c]);
-        auto permute = randomize_in_cell(offsets[c], offsets[c + 1]);
-        collide_in_cell(prts, permute, &stats);
+        auto permute = randomize_in_cell(offsets[c], offsets[c + 1], rng);
+        collide_in_cell(prts, permute, rng, &stats);
 
         update_rei_after(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
 
@@ -164,11 +172,15 @@ struct CollisionHost
   // ----------------------------------------------------------------------
   // randomize_in_cell
 
-  static std::vector<int> randomize_in_cell(int n_start, int n_end)
+  static std::vector<int> randomize_in_cell(int n_start, int n_end, Rng& rng)
   {
     std::vector<int> permute(n_end - n_start);
     std::iota(permute.begin(), permute.end(), n_start);
-    std::random_shuffle(permute.begin(), permute.end());
+    // Fisher-Yates, drawing from the cell's own stream
+    for (int i = int(permute.size()) - 1; i > 0; i--) {
+      int j = std::min(int(rng.uniform() * (i + 1)), i);
+      std::swap(permute[i], permute[j]);
+    }
     return permute;
   }
 
@@ -218,7 +230,7 @@ struct CollisionHost
   // collide_in_cell
 
   void collide_in_cell(Particles& prts, const std::vector<int>& permute,
-                       struct psc_collision_stats* stats)
+                       Rng& rng, struct psc_collision_stats* stats)
   {
     const auto& grid = prts.grid();
     int nn = permute.size();
@@ -237,22 +249,21 @@ struct CollisionHost
 
     int n = 0;
     if (nn % 2 == 1) { // odd # of particles: do 3-collision
-      nudts[cnt++] = do_bc(prts, permute[0], permute[1], .5 * nudt1);
-      nudts[cnt++] = do_bc(prts, permute[0], permute[2], .5 * nudt1);
-      nudts[cnt++] = do_bc(prts, permute[1], permute[2], .5 * nudt1);
+      nudts[cnt++] = do_bc(prts, permute[0], permute[1], .5 * nudt1, rng);
+      nudts[cnt++] = do_bc(prts, permute[0], permute[2], .5 * nudt1, rng);
+      nudts[cnt++] = do_bc(prts, permute[1], permute[2], .5 * nudt1, rng);
       n = 3;
     }
     for (; n < nn; n += 2) { // do remaining particles as pair
-      nudts[cnt++] = do_bc(prts, permute[n], permute[n + 1], nudt1);
+      nudts[cnt++] = do_bc(prts, permute[n], permute[n + 1], nudt1, rng);
     }
 
     calc_stats(stats, nudts, cnt);
     free(nudts);
   }
 
-  real_t do_bc(Particles& prts, int n1, int n2, real_t nudt1)
+  real_t do_bc(Particles& prts, int n1, int n2, real_t nudt1, Rng& rng)
   {
-    Rng rng;
     const auto& mprts = prts.mprts();
     BinaryCollision<Mparticles, Particle> bc(mprts);
     return bc(prts[n1], prts[n2], nudt1, rng);
@@ -264,6 +275,7 @@ private:
   // parameters
   double nu_;
   int interval_;
+  uint32_t seed_;
 
 public: // FIXME
   // for output
@@ -1,13 +1,33 @@
 
 #include "heating.hxx"
+#include "balance.hxx"
+#include "rng_philox.hxx"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
-#include <stdlib.h>
+#include <vector>
 
 // ======================================================================
 // Heating__
+//
+// The heating shape HS is a template parameter, so that it can be inlined
+// into the particle loop. It defaults to a std::function for shapes that
+// aren't known at compile time.
+//
+// Since the shape typically vanishes in most of the domain (e.g., outside of
+// a foil), a per-cell, per-kind mask is precomputed by sampling the shape at
+// the corners, edge / face centers and center of each cell, and particles in
+// cells where it vanishes at all of these are skipped without evaluating the
+// shape. (Shapes with features smaller than a cell hence need to be avoided.)
+//
+// Random kicks come from the RNG_HEATING stream, keyed by global patch,
+// timestep and particle index, so patches can be processed in parallel, the
+// result does not depend on the number of threads, and a run restarted from a
+// checkpoint (which has the timestep) continues with the same kicks.
 
-template <typename MP>
+template <typename MP,
+          typename HS = std::function<double(const double*, const int)>>
 struct Heating__ : HeatingBase
 {
   using Mparticles = MP;
@@ -18,7 +38,9 @@ struct Heating__ : HeatingBase
   // ctor
 
   template <typename FUNC>
-  Heating__(const Grid_t& grid, int interval, FUNC get_H) : get_H_{get_H}
+  Heating__(const Grid_t& grid, int interval, FUNC get_H,
+            unsigned int seed = 0)
+    : get_H_{get_H}, seed_{seed}
   {
     heating_dt_ = interval * grid.dt;
   }
@@ -26,38 +48,51 @@ struct Heating__ : HeatingBase
   // ----------------------------------------------------------------------
   // kick_particle
 
-  void kick_particle(Particle& prt, real_t H)
+  void kick_particle(Particle& prt, real_t H, const float ran[4])
   {
-    float ran1, ran2, ran3, ran4, ran5, ran6;
-    do {
-      ran1 = random() / ((float)RAND_MAX + 1);
-      ran2 = random() / ((float)RAND_MAX + 1);
-      ran3 = random() / ((float)RAND_MAX + 1);
-      ran4 = random() / ((float)RAND_MAX + 1);
-      ran5 = random() / ((float)RAND_MAX + 1);
-      ran6 = random() / ((float)RAND_MAX + 1);
-    } while (ran1 >= 1.f || ran2 >= 1.f || ran3 >= 1.f || ran4 >= 1.f ||
-             ran5 >= 1.f || ran6 >= 1.f);
-
-    real_t ranx = sqrtf(-2.f * logf(1.0 - ran1)) * cosf(2.f * M_PI * ran2);
-    real_t rany = sqrtf(-2.f * logf(1.0 - ran3)) * cosf(2.f * M_PI * ran4);
-    real_t ranz = sqrtf(-2.f * logf(1.0 - ran5)) * cosf(2.f * M_PI * ran6);
-
-    real_t Dpxi = sqrtf(H * heating_dt_);
-    real_t Dpyi = sqrtf(H * heating_dt_);
-    real_t Dpzi = sqrtf(H * heating_dt_);
-
-    prt.u[0] += Dpxi * ranx;
-    prt.u[1] += Dpyi * rany;
-    prt.u[2] += Dpzi * ranz;
+    real_t Dp = std::sqrt(H * heating_dt_);
+
+    prt.u[0] += Dp * ran[0];
+    prt.u[1] += Dp * ran[1];
+    prt.u[2] += Dp * ran[2];
   }
 
+  // ----------------------------------------------------------------------
+  // operator()
+
   void operator()(Mparticles& mprts)
   {
+    const auto& grid = mprts.grid();
+    if (mask_.empty() ||
+        balance_generation_cnt_ != psc_balance_generation_cnt) {
+      setup_mask(grid);
+    }
+
+    Vec3<double> dxi = {1. / grid.domain.dx[0], 1. / grid.domain.dx[1],
+                        1. / grid.domain.dx[2]};
+    Int3 ldims = grid.ldims;
+    int n_kinds = grid.kinds.size();
+
+#pragma omp parallel for
     for (int p = 0; p < mprts.n_patches(); p++) {
       auto&& prts = mprts[p];
-      auto& patch = mprts.grid().patches[p];
+      auto& patch = grid.patches[p];
+      const auto& mask = mask_[p];
+      RngStream rng{RNG_HEATING, uint32_t(grid.localPatchInfo(p).global_patch),
+                    seed_, uint32_t(grid.timestep())};
+
+      uint32_t n = 0;
       for (auto& prt : prts) {
+        Int3 idx;
+        for (int d = 0; d < 3; d++) {
+          idx[d] = int(std::floor(prt.x[d] * dxi[d]));
+          idx[d] = std::min(std::max(idx[d], 0), ldims[d] - 1);
+        }
+        int cell = (idx[2] * ldims[1] + idx[1]) * ldims[0] + idx[0];
+        if (!mask[cell * n_kinds + prt.kind]) {
+          n++;
+          continue;
+        }
 
         double xx[3] = {
           prt.x[0] + patch.xb[0],
@@ -66,15 +101,66 @@ struct Heating__ : HeatingBase
         };
         double H = get_H_(xx, prt.kind);
         if (H > 0.f) {
-          kick_particle(prt, H);
+          float ran[4];
+          rng.normal4(n, ran);
+          kick_particle(prt, H, ran);
         }
+        n++;
       }
     }
   }
 
+private:
+  // ----------------------------------------------------------------------
+  // setup_mask
+
+  void setup_mask(const Grid_t& grid)
+  {
+    balance_generation_cnt_ = psc_balance_generation_cnt;
+
+    const Int3& ldims = grid.ldims;
+    int n_kinds = grid.kinds.size();
+    int n_cells = ldims[0] * ldims[1] * ldims[2];
+    // sample at corners, edge / face centers and cell center, or just at the
+    // cell center in invariant directions
+    Int3 n_samples, s_off;
+    for (int d = 0; d < 3; d++) {
+      n_samples[d] = grid.isInvar(d) ? 1 : 3;
+      s_off[d] = grid.isInvar(d) ? 1 : 0;
+    }
+    const auto& dx = grid.domain.dx;
+
+    mask_.resize(grid.n_patches());
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto& patch = grid.patches[p];
+      auto& mask = mask_[p];
+      mask.assign(n_cells * n_kinds, 0);
+      grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+        int cell = (k * ldims[1] + j) * ldims[0] + i;
+        for (int kind = 0; kind < n_kinds; kind++) {
+          for (int sz = 0; sz < n_samples[2]; sz++) {
+            for (int sy = 0; sy < n_samples[1]; sy++) {
+              for (int sx = 0; sx < n_samples[0]; sx++) {
+                double xx[3] = {patch.x_nc(i) + .5 * (sx + s_off[0]) * dx[0],
+                                patch.y_nc(j) + .5 * (sy + s_off[1]) * dx[1],
+                                patch.z_nc(k) + .5 * (sz + s_off[2]) * dx[2]};
+                if (get_H_(xx, kind) > 0.) {
+                  mask[cell * n_kinds + kind] = 1;
+                }
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+
 private:
   real_t heating_dt_;
-  std::function<double(const double*, const int)> get_H_;
+  HS get_H_;
+  uint32_t seed_;
+  std::vector<std::vector<uint8_t>> mask_; // per patch, cell, kind
+  int balance_generation_cnt_ = -1;
 };
 
 // ======================================================================
@@ -82,10 +168,11 @@ private:
 //
 // FIXME, this should become unnecessary
 
-template <typename Mparticles>
+template <typename Mparticles,
+          typename HS = std::function<double(const double*, const int)>>
 struct HeatingSelector
 {
-  using Heating = Heating__<Mparticles>;
+  using Heating = Heating__<Mparticles, HS>;
 };
 
 #ifdef USE_CUDA
@@ -93,15 +180,15 @@ struct HeatingSelector
 #include "../libpsc/cuda/heating_cuda_impl.hxx"
 
 // FIXME, enable_if for any BS
-template <>
-struct HeatingSelector<MparticlesCuda<BS444>>
+template <typename HS>
+struct HeatingSelector<MparticlesCuda<BS444>, HS>
 {
   using Mparticles = MparticlesCuda<BS444>;
   using Heating = HeatingCuda<HeatingSpotFoil<dim_xyz>, Mparticles>;
 };
 
-template <>
-struct HeatingSelector<MparticlesCuda<BS144>>
+template <typename HS>
+struct HeatingSelector<MparticlesCuda<BS144>, HS>
 {
   using Mparticles = MparticlesCuda<BS144>;
   using Heating = HeatingCuda<HeatingSpotFoil<dim_yz>, Mparticles>;
@@ -4,25 +4,41 @@
 #include "pushp_current_esirkepov.hxx"
 #include "../libpsc/psc_checks/checks_impl.hxx"
 
+#include <vector>
+
 // ======================================================================
 // PushParticlesEsirkepov
+//
+// A patch is pushed one tile of TILE_SIZE^3 cells at a time, the particles
+// of a tile being those that start out in it. Each tile deposits into its
+// own small CurrentTile, which is then added into the patch's J. Likewise,
+// E and H are gathered from an EMCache that holds just the tile, padded the
+// same way, which covers the reach of the interpolation stencil. Tiles are
+// colored by the parity of their index in each direction. Since padded
+// tiles only overlap with their immediate neighbors, tiles of one color can
+// be pushed by different threads at the same time, without atomics.
 
 template <typename C>
 struct PushParticlesEsirkepov
 {
   static const int MAX_NR_KINDS = 10;
+  static const int TILE_SIZE = 8;
 
   using Mparticles = typename C::Mparticles;
   using MfieldsState = typename C::MfieldsState;
   using AdvanceParticle_t = typename C::AdvanceParticle_t;
   using InterpolateEM_t = typename C::InterpolateEM_t;
+  using Dim = typename C::Dim;
+  using CurrentTile_t = CurrentTile<typename InterpolateEM_t::real_t, Dim>;
   using Current =
-    CurrentEsirkepov<typename C::Order, typename C::Dim,
-                     Fields3d<typename MfieldsState::fields_view_t>,
-                     InterpolateEM_t>;
+    CurrentEsirkepov<typename C::Order, Dim, CurrentTile_t, InterpolateEM_t>;
   using real_t = typename Mparticles::real_t;
   using Real3 = Vec3<real_t>;
 
+  // same-colored tiles, two tiles apart, mustn't overlap when padded
+  static_assert(TILE_SIZE >= CurrentTile_t::PAD_LO + CurrentTile_t::PAD_HI,
+                "TILE_SIZE too small");
+
   using checks_order =
     checks_order_2nd; // FIXME, sometimes 1st even with Esirkepov
 
@@ -39,50 +55,136 @@ struct PushParticlesEsirkepov
     for (int k = 0; k < kinds.size(); k++) {
       dq_kind[k] = .5f * grid.norm.eta * grid.dt * kinds[k].q / kinds[k].m;
     }
-    InterpolateEM_t ip;
-    AdvanceParticle_t advance(grid.dt);
-    Current current(grid);
+    const Int3& ldims = grid.ldims;
+    Int3 n_tiles;
+    for (int d = 0; d < 3; d++) {
+      n_tiles[d] = (ldims[d] + TILE_SIZE - 1) / TILE_SIZE;
+    }
+    const int n_tiles_total = n_tiles[0] * n_tiles[1] * n_tiles[2];
+
+    std::vector<int> tile_off, order;
 
     auto accessor = mprts.accessor_();
     for (int p = 0; p < mflds.n_patches(); p++) {
       auto flds = mflds[p];
       auto prts = accessor[p];
-      typename InterpolateEM_t::fields_t EM(flds);
-      typename Current::fields_t J(flds);
-
       flds.zero(JXI, JXI + 3);
 
-      for (auto prt : prts) {
-        Real3& x = prt.x();
-
-        real_t xm[3];
-        for (int d = 0; d < 3; d++) {
-          xm[d] = x[d] * dxi[d];
+      find_tiles(prts, dxi, ldims, n_tiles, tile_off, order);
+
+#pragma omp parallel
+      {
+        InterpolateEM_t ip;
+        AdvanceParticle_t advance(grid.dt);
+        Current current(grid);
+        typename InterpolateEM_t::Cache EM;
+        CurrentTile_t J;
+
+        for (int color = 0; color < 8; color++) {
+#pragma omp for schedule(dynamic)
+          for (int t = 0; t < n_tiles_total; t++) {
+            int it[3] = {t % n_tiles[0], (t / n_tiles[0]) % n_tiles[1],
+                         t / (n_tiles[0] * n_tiles[1])};
+            if ((it[0] & 1) + 2 * (it[1] & 1) + 4 * (it[2] & 1) != color ||
+                tile_off[t] == tile_off[t + 1]) {
+              continue;
+            }
+
+            int lo[3], n[3], em_lo[3], em_n[3];
+            for (int d = 0; d < 3; d++) {
+              lo[d] = it[d] * TILE_SIZE;
+              n[d] = std::min(int(TILE_SIZE), ldims[d] - lo[d]);
+              em_lo[d] = lo[d] - CurrentTile_t::PAD_LO;
+              em_n[d] = n[d] + CurrentTile_t::PAD_LO + CurrentTile_t::PAD_HI;
+            }
+            EM.load(flds, em_lo, em_n);
+            J.reset(lo, n);
+            for (int i = tile_off[t]; i < tile_off[t + 1]; i++) {
+              push_prt(prts[order[i]], ip, advance, current, EM, J, dxi,
+                       dq_kind);
+            }
+            J.flush(flds);
+          }
         }
-        ip.set_coeffs(xm);
+      }
+    }
+  }
 
-        // CHARGE DENSITY FORM FACTOR AT (n+.5)*dt
-        current.charge_before(ip);
+private:
+  // ----------------------------------------------------------------------
+  // find_tiles
+  //
+  // order lists the particles tile by tile (keeping their relative order),
+  // those of tile t being at [tile_off[t], tile_off[t+1])
+
+  template <typename Particles>
+  static void find_tiles(Particles& prts, const Real3& dxi, const Int3& ldims,
+                         const Int3& n_tiles, std::vector<int>& tile_off,
+                         std::vector<int>& order)
+  {
+    const int n_prts = prts.size();
+    std::vector<int> tile_by_prt(n_prts);
+    tile_off.assign(n_tiles[0] * n_tiles[1] * n_tiles[2] + 1, 0);
+    for (int n = 0; n < n_prts; n++) {
+      Real3 x = prts[n].x();
+      int it[3];
+      for (int d = 0; d < 3; d++) {
+        int i = int(std::floor(x[d] * dxi[d]));
+        it[d] = std::min(std::max(i, 0), ldims[d] - 1) / TILE_SIZE;
+      }
+      int t = (it[2] * n_tiles[1] + it[1]) * n_tiles[0] + it[0];
+      tile_by_prt[n] = t;
+      tile_off[t + 1]++;
+    }
+    for (int t = 0; t < n_tiles[0] * n_tiles[1] * n_tiles[2]; t++) {
+      tile_off[t + 1] += tile_off[t];
+    }
+
+    order.resize(n_prts);
+    std::vector<int> pos(tile_off.begin(), tile_off.end() - 1);
+    for (int n = 0; n < n_prts; n++) {
+      order[pos[tile_by_prt[n]]++] = n;
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // push_prt
+
+  template <typename Particle>
+  static void push_prt(Particle&& prt, InterpolateEM_t& ip,
+                       AdvanceParticle_t& advance, Current& current,
+                       const typename InterpolateEM_t::Cache& EM,
+                       CurrentTile_t& J, const Real3& dxi,
+                       const real_t* dq_kind)
+  {
+    Real3& x = prt.x();
 
-        // FIELD INTERPOLATION
-        Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
-        Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
+    real_t xm[3];
+    for (int d = 0; d < 3; d++) {
+      xm[d] = x[d] * dxi[d];
+    }
+    ip.set_coeffs(xm);
 
-        // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
-        real_t dq = dq_kind[prt.kind()];
-        advance.push_p(prt.u(), E, H, dq);
+    // CHARGE DENSITY FORM FACTOR AT (n+.5)*dt
+    current.charge_before(ip);
 
-        // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
-        auto v = advance.calc_v(prt.u());
-        advance.push_x(x, v);
+    // FIELD INTERPOLATION
+    Vec3<typename InterpolateEM_t::real_t> E, H;
+    ip.eh(EM, E, H);
 
-        // CHARGE DENSITY FORM FACTOR AT (n+1.5)*dt
-        current.charge_after(x);
+    // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+    real_t dq = dq_kind[prt.kind()];
+    advance.push_p(prt.u(), Real3(E), Real3(H), dq);
 
-        // CURRENT DENSITY AT (n+1.0)*dt
-        current.prep(prt.qni_wni(), v);
-        current.calc(J);
-      }
-    }
+    // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
+    auto v = advance.calc_v(prt.u());
+    advance.push_x(x, v);
+
+    // CHARGE DENSITY FORM FACTOR AT (n+1.5)*dt
+    current.charge_after(x);
+
+    // CURRENT DENSITY AT (n+1.0)*dt
+    current.prep(prt.qni_wni(), v);
+    current.calc(J);
   }
 };
@@ -4,6 +4,9 @@
 #include "inc_defs.h"
 #include "interpolate.hxx"
 
+#include <algorithm>
+#include <vector>
+
 // ----------------------------------------------------------------------
 // find_l_minmax
 
@@ -162,6 +165,84 @@ struct CurrentDir<order, IP, std::true_type>
   real_t fnqv;
 };
 
+// ======================================================================
+// CurrentTile
+//
+// J for a tile of cells [lo, lo + n) of a patch, padded such that it holds
+// everything deposited by particles that start out in the tile (they move
+// less than a cell per step, so 2nd order deposits stay within
+// [lo - PAD_LO, lo + n + PAD_HI), and 1st order ones even closer). The block
+// is small enough to stay in cache while a tile's particles are pushed, and
+// is added into the patch's J once at the end. Invariant directions have
+// extent 1.
+
+template <typename R, typename D>
+class CurrentTile
+{
+public:
+  using real_t = R;
+  using dim = D;
+
+  static const int PAD_LO = 2;
+  static const int PAD_HI = 3;
+
+  void reset(const int lo[3], const int n[3])
+  {
+    ib_[0] = dim::InvarX::value ? 0 : lo[0] - PAD_LO;
+    ib_[1] = dim::InvarY::value ? 0 : lo[1] - PAD_LO;
+    ib_[2] = dim::InvarZ::value ? 0 : lo[2] - PAD_LO;
+    im_[0] = dim::InvarX::value ? 1 : n[0] + PAD_LO + PAD_HI;
+    im_[1] = dim::InvarY::value ? 1 : n[1] + PAD_LO + PAD_HI;
+    im_[2] = dim::InvarZ::value ? 1 : n[2] + PAD_LO + PAD_HI;
+    data_.assign(3 * im_[0] * im_[1] * im_[2], real_t(0));
+  }
+
+  real_t& operator()(int m, int i, int j, int k)
+  {
+    return data_[index(m, i, j, k)];
+  }
+
+  // add into JXI .. JZI of the patch's fields, as far as they reach
+  template <typename FE>
+  void flush(FE& flds) const
+  {
+    int lo[3], hi[3];
+    for (int d = 0; d < 3; d++) {
+      lo[d] = std::max(ib_[d], int(flds.ib()[d]));
+      hi[d] = std::min(ib_[d] + im_[d], int(flds.ib()[d] + flds.im()[d]));
+    }
+    for (int m = 0; m < 3; m++) {
+      for (int k = lo[2]; k < hi[2]; k++) {
+        for (int j = lo[1]; j < hi[1]; j++) {
+          for (int i = lo[0]; i < hi[0]; i++) {
+            flds(JXI + m, i, j, k) += data_[index(m, i, j, k)];
+          }
+        }
+      }
+    }
+  }
+
+private:
+  int index(int m, int i_, int j_, int k_) const
+  {
+    int i = dim::InvarX::value ? 0 : i_ - ib_[0];
+    int j = dim::InvarY::value ? 0 : j_ - ib_[1];
+    int k = dim::InvarZ::value ? 0 : k_ - ib_[2];
+
+#ifdef BOUNDS_CHECK
+    assert(m >= 0 && m < 3);
+    assert(i >= 0 && i < im_[0]);
+    assert(j >= 0 && j < im_[1]);
+    assert(k >= 0 && k < im_[2]);
+#endif
+
+    return ((m * im_[2] + k) * im_[1] + j) * im_[0] + i;
+  }
+
+  std::vector<real_t> data_;
+  int ib_[3], im_[3];
+};
+
 // ======================================================================
 // Current
 
@@ -0,0 +1,183 @@
+
+#include "psc_telemetry.h"
+
+#include <mrc_ddc.h>
+
+#include <mpi.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <map>
+
+// ======================================================================
+// psc_telemetry: per-step performance telemetry
+
+static const char* psc_telemetry_name[NR_TELEMETRY] = {
+  "prts",
+  "prts_pushed",
+  "time_push",
+  "push_rate",
+  "time_step",
+  "bndp_prts_sent",
+  "bndp_bytes_sent",
+  "bndp_neighbors",
+  "bndp_max_prts_nei",
+  "ghost_bytes_sent",
+  "peak_rss_mib",
+};
+
+struct NeighborSend
+{
+  size_t n_prts = 0;
+  size_t n_bytes = 0;
+};
+
+static bool telemetry_enabled;
+static FILE* telemetry_file;      // aggregate, rank 0 only
+static FILE* telemetry_file_rank; // per rank, if requested
+static double telemetry_val[NR_TELEMETRY];
+static std::map<int, NeighborSend> telemetry_nei;
+static unsigned long long telemetry_ghost_bytes_last;
+
+void psc_telemetry_open(const std::string& filename, bool per_rank)
+{
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if (rank == 0) {
+    telemetry_file = fopen(filename.c_str(), "w");
+    assert(telemetry_file);
+    fprintf(telemetry_file, "step");
+    for (int n = 0; n < NR_TELEMETRY; n++) {
+      const char* name = psc_telemetry_name[n];
+      fprintf(telemetry_file, ",%s_min,%s_avg,%s_max", name, name, name);
+    }
+    fprintf(telemetry_file, "\n");
+    fflush(telemetry_file);
+  }
+
+  if (per_rank) {
+    char s[20];
+    sprintf(s, ".%06d", rank);
+    telemetry_file_rank = fopen((filename + s).c_str(), "w");
+    assert(telemetry_file_rank);
+    fprintf(telemetry_file_rank, "step,rank");
+    for (int n = 0; n < NR_TELEMETRY; n++) {
+      fprintf(telemetry_file_rank, ",%s", psc_telemetry_name[n]);
+    }
+    // "nei_rank:prts:bytes" entries separated by ' '
+    fprintf(telemetry_file_rank, ",bndp_sent_by_nei\n");
+    fflush(telemetry_file_rank);
+  }
+
+  telemetry_ghost_bytes_last = mrc_ddc_bytes_sent;
+  telemetry_enabled = true;
+}
+
+void psc_telemetry_close()
+{
+  if (telemetry_file) {
+    fclose(telemetry_file);
+    telemetry_file = nullptr;
+  }
+  if (telemetry_file_rank) {
+    fclose(telemetry_file_rank);
+    telemetry_file_rank = nullptr;
+  }
+  telemetry_enabled = false;
+}
+
+bool psc_telemetry_enabled() { return telemetry_enabled; }
+
+void psc_telemetry_add(int n, double val)
+{
+  if (telemetry_enabled) {
+    telemetry_val[n] += val;
+  }
+}
+
+void psc_telemetry_neighbor_send(int rank, size_t n_prts, size_t n_bytes)
+{
+  if (telemetry_enabled) {
+    auto& nei = telemetry_nei[rank];
+    nei.n_prts += n_prts;
+    nei.n_bytes += n_bytes;
+  }
+}
+
+void psc_telemetry_step(int timestep)
+{
+  if (!telemetry_enabled) {
+    return;
+  }
+
+  double* val = telemetry_val;
+
+  // derived quantities
+  if (val[TELEMETRY_TIME_PUSH] > 0.) {
+    val[TELEMETRY_PUSH_RATE] =
+      val[TELEMETRY_PRTS_PUSHED] / val[TELEMETRY_TIME_PUSH];
+  }
+  for (auto& item : telemetry_nei) {
+    if (item.second.n_prts > 0) {
+      val[TELEMETRY_BNDP_PRTS_SENT] += item.second.n_prts;
+      val[TELEMETRY_BNDP_BYTES_SENT] += item.second.n_bytes;
+      val[TELEMETRY_BNDP_NEIGHBORS] += 1;
+      val[TELEMETRY_BNDP_MAX_PRTS_NEI] =
+        std::max(val[TELEMETRY_BNDP_MAX_PRTS_NEI], double(item.second.n_prts));
+    }
+  }
+  val[TELEMETRY_GHOST_BYTES_SENT] =
+    mrc_ddc_bytes_sent - telemetry_ghost_bytes_last;
+  telemetry_ghost_bytes_last = mrc_ddc_bytes_sent;
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  val[TELEMETRY_PEAK_RSS] = usage.ru_maxrss / 1024.; // ru_maxrss is in kB
+
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  if (telemetry_file_rank) {
+    fprintf(telemetry_file_rank, "%d,%d", timestep, rank);
+    for (int n = 0; n < NR_TELEMETRY; n++) {
+      fprintf(telemetry_file_rank, ",%g", val[n]);
+    }
+    fprintf(telemetry_file_rank, ",");
+    const char* sep = "";
+    for (auto& item : telemetry_nei) {
+      fprintf(telemetry_file_rank, "%s%d:%zu:%zu", sep, item.first,
+              item.second.n_prts, item.second.n_bytes);
+      sep = " ";
+    }
+    fprintf(telemetry_file_rank, "\n");
+    fflush(telemetry_file_rank);
+  }
+
+  double val_min[NR_TELEMETRY], val_max[NR_TELEMETRY], val_sum[NR_TELEMETRY];
+  MPI_Reduce(val, val_min, NR_TELEMETRY, MPI_DOUBLE, MPI_MIN, 0,
+             MPI_COMM_WORLD);
+  MPI_Reduce(val, val_max, NR_TELEMETRY, MPI_DOUBLE, MPI_MAX, 0,
+             MPI_COMM_WORLD);
+  MPI_Reduce(val, val_sum, NR_TELEMETRY, MPI_DOUBLE, MPI_SUM, 0,
+             MPI_COMM_WORLD);
+
+  if (telemetry_file) {
+    fprintf(telemetry_file, "%d", timestep);
+    for (int n = 0; n < NR_TELEMETRY; n++) {
+      fprintf(telemetry_file, ",%g,%g,%g", val_min[n], val_sum[n] / size,
+              val_max[n]);
+    }
+    fprintf(telemetry_file, "\n");
+    fflush(telemetry_file);
+  }
+
+  // reset counters
+  for (int n = 0; n < NR_TELEMETRY; n++) {
+    val[n] = 0.;
+  }
+  telemetry_nei.clear();
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include "../libpsc/vpic/vpic_config.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Grid = VpicConfigPsc::Grid;
+using Mparticles = VpicConfigPsc::Mparticles;
+using Species = Mparticles::Species;
+using MfieldsInterpolator = VpicConfigPsc::MfieldsInterpolator;
+using MfieldsAccumulator = VpicConfigPsc::MfieldsAccumulator;
+using AccumulatorOps = VpicConfigPsc::AccumulatorOps;
+using ParticlesOps = VpicConfigPsc::ParticlesOps;
+
+// ======================================================================
+// AdvancePTest
+//
+// advance_p with several pipelines (and the remainder pipeline) gives the
+// same particles and movers as a single pipeline, and after the reduction,
+// the same current up to round-off
+
+struct AdvancePTest : ::testing::Test
+{
+  // 37 blocks of 16, which don't split evenly, plus a remainder of 5
+  static const int n_prts = 16 * 37 + 5;
+
+  AdvancePTest()
+  {
+    double dx[3] = {1., 1., 1.};
+    double xl[3] = {0., 0., 0.};
+    double xh[3] = {4., 4., 4.};
+    int gdims[3] = {4, 4, 4};
+    vgrid_.setup(dx, .5, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, gdims, {1, 1, 1});
+    // particles leaving in x become movers
+    vgrid_.set_pbc(BOUNDARY(-1, 0, 0), Grid::absorb_particles);
+    vgrid_.set_pbc(BOUNDARY(1, 0, 0), Grid::absorb_particles);
+  }
+
+  void init(Species& sp, MfieldsInterpolator& interpolator)
+  {
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> pos(-1.f, 1.f);
+    std::normal_distribution<float> mom(0.f, 1.f);
+    std::uniform_int_distribution<int> cell(1, 4);
+
+    auto& ip = interpolator.getPatch(0);
+    for (int v = 0; v < vgrid_.nv; v++) {
+      float* f = reinterpret_cast<float*>(&ip[v]);
+      for (int m = 0; m < 18; m++) {
+        f[m] = .1f * pos(gen);
+      }
+    }
+
+    for (int n = 0; n < n_prts; n++) {
+      auto& prt = sp.p[n];
+      prt.dx = pos(gen);
+      prt.dy = pos(gen);
+      prt.dz = pos(gen);
+      prt.i = VOXEL(cell(gen), cell(gen), cell(gen), vgrid_.nx, vgrid_.ny,
+                    vgrid_.nz);
+      prt.ux = mom(gen);
+      prt.uy = mom(gen);
+      prt.uz = mom(gen);
+      prt.w = 1.f + pos(gen);
+    }
+    sp.np = n_prts;
+  }
+
+  void check(int n_pipeline)
+  {
+    Species sp_ref("ref", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    Species sp("pipelines", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    MfieldsInterpolator interpolator(&vgrid_);
+    MfieldsAccumulator acc_ref(&vgrid_, 1), acc(&vgrid_, n_pipeline);
+    init(sp_ref, interpolator);
+    init(sp, interpolator);
+
+    ParticlesOps::advance_p(sp_ref, acc_ref, interpolator);
+    AccumulatorOps::reduce(acc_ref);
+    ParticlesOps::advance_p(sp, acc, interpolator);
+    AccumulatorOps::reduce(acc);
+
+    EXPECT_EQ(memcmp(sp.p, sp_ref.p, n_prts * sizeof(*sp.p)), 0);
+
+    // movers end up compacted, in particle order
+    ASSERT_GT(sp_ref.nm, n_pipeline);
+    ASSERT_EQ(sp.nm, sp_ref.nm);
+    EXPECT_EQ(memcmp(sp.pm, sp_ref.pm, sp.nm * sizeof(*sp.pm)), 0);
+
+    for (int k = 1; k <= vgrid_.nz; k++) {
+      for (int j = 1; j <= vgrid_.ny; j++) {
+        for (int i = 1; i <= vgrid_.nx; i++) {
+          const float* a = reinterpret_cast<const float*>(&acc(0, i, j, k));
+          const float* a_ref =
+            reinterpret_cast<const float*>(&acc_ref(0, i, j, k));
+          for (int m = 0; m < 12; m++) {
+            EXPECT_NEAR(a[m], a_ref[m], 1e-5 * (1. + std::abs(a_ref[m])))
+              << "ijk " << i << " " << j << " " << k << " m " << m;
+          }
+        }
+      }
+    }
+  }
+
+  Grid vgrid_;
+};
+
+TEST_F(AdvancePTest, Pipelines2) { check(2); }
+
+TEST_F(AdvancePTest, Pipelines4) { check(4); }
+
+TEST_F(AdvancePTest, Pipelines7) { check(7); }
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
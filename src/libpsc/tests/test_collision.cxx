@@ -3,6 +3,7 @@
 
 #include "testing.hxx"
 #include "../libpsc/psc_collision/psc_collision_impl.hxx"
+#include "../libpsc/psc_heating/psc_heating_impl.hxx"
 #include "psc_particles_single.h"
 #include "psc_fields_single.h"
 
@@ -170,6 +171,132 @@ TYPED_TEST(CollisionTest, Test1)
   EXPECT_NEAR(std::abs(prtf1.u()[2]), 0.17342988, eps);
 }
 
+// ======================================================================
+// CollisionRng
+//
+// with the counter-based RngC, the collisions are determined by the seed and
+// the timestep alone, so a new Collision (as after a restart) picks up where
+// the old one left off
+
+using CollisionRngTest =
+  CollisionHost<MparticlesDouble, MfieldsStateDouble, MfieldsC,
+                RngC<MparticlesDouble::real_t>>;
+
+static std::vector<double> collide(Grid_t& grid, int timestep, uint32_t seed,
+                                   std::vector<double> u = {})
+{
+  MparticlesDouble mprts{grid};
+  {
+    auto inj = mprts.injector();
+    auto injector = inj[0];
+    for (int n = 0; n < 20; n++) {
+      Vec3<double> u_n = {.1 * n, -.05 * n, .02 * (n % 7)};
+      if (!u.empty()) {
+        u_n = {u[3 * n], u[3 * n + 1], u[3 * n + 2]};
+      }
+      injector(psc::particle::Inject{{5., 5., 5.}, u_n, 1., 0});
+    }
+  }
+
+  grid.timestep_ = timestep;
+  auto collision = CollisionRngTest(grid, 1, 1., seed);
+  collision(mprts);
+
+  std::vector<double> u_after;
+  auto accessor = mprts.accessor();
+  for (auto prt : accessor[0]) {
+    for (int d = 0; d < 3; d++) {
+      u_after.push_back(prt.u()[d]);
+    }
+  }
+  return u_after;
+}
+
+TEST(CollisionRng, Reproducible)
+{
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "test_species")};
+  auto& grid = make_psc<dim_yz>(kinds);
+
+  auto u = collide(grid, 3, 7);
+  EXPECT_EQ(collide(grid, 3, 7), u);
+  EXPECT_NE(collide(grid, 3, 8), u);
+  EXPECT_NE(collide(grid, 4, 7), u);
+
+  // step 4, continuing from the state after step 3
+  auto u4 = collide(grid, 4, 7, u);
+  EXPECT_NE(u4, u);
+  EXPECT_EQ(collide(grid, 4, 7, u), u4);
+}
+
+// ======================================================================
+// HeatingRng
+//
+// same for heating: a Heating that is created fresh at step 4, as after a
+// restart, gives the same kicks as the one that has been running all along
+
+using HeatingRngTest = Heating__<MparticlesDouble>;
+
+static MparticlesDouble make_heating_mprts(const Grid_t& grid)
+{
+  MparticlesDouble mprts{grid};
+  auto inj = mprts.injector();
+  auto injector = inj[0];
+  for (int n = 0; n < 20; n++) {
+    injector(psc::particle::Inject{
+      {5., 5. + 7. * n, 5. + 3. * n}, {.1 * n, 0., 0.}, 1., 0});
+  }
+  return mprts;
+}
+
+static std::vector<double> get_u(MparticlesDouble& mprts)
+{
+  std::vector<double> u;
+  auto accessor = mprts.accessor();
+  for (auto prt : accessor[0]) {
+    for (int d = 0; d < 3; d++) {
+      u.push_back(prt.u()[d]);
+    }
+  }
+  return u;
+}
+
+TEST(HeatingRng, Restart)
+{
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "test_species")};
+  auto& grid = make_psc<dim_yz>(kinds);
+  auto get_H = [](const double* xx, int kind) { return 1.; };
+
+  // running along, steps 3 and 4
+  auto mprts = make_heating_mprts(grid);
+  HeatingRngTest heating{grid, 1, get_H, 7};
+  grid.timestep_ = 3;
+  heating(mprts);
+  auto u3 = get_u(mprts);
+  grid.timestep_ = 4;
+  heating(mprts);
+  auto u4 = get_u(mprts);
+  EXPECT_NE(u3, u4);
+
+  // restarted after step 3
+  auto mprts_restart = make_heating_mprts(grid);
+  HeatingRngTest heating_restart{grid, 1, get_H, 7};
+  grid.timestep_ = 3;
+  heating_restart(mprts_restart);
+  EXPECT_EQ(get_u(mprts_restart), u3);
+  HeatingRngTest heating_restart2{grid, 1, get_H, 7};
+  grid.timestep_ = 4;
+  heating_restart2(mprts_restart);
+  EXPECT_EQ(get_u(mprts_restart), u4);
+
+  // a different seed gives different kicks
+  auto mprts_seed = make_heating_mprts(grid);
+  HeatingRngTest heating_seed{grid, 1, get_H, 8};
+  grid.timestep_ = 3;
+  heating_seed(mprts_seed);
+  EXPECT_NE(get_u(mprts_seed), u3);
+  grid.timestep_ = 0;
+}
+
 // ======================================================================
 // main
 
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "../libpsc/vpic/dump_aggregated.hxx"
+
+#include <cstdio>
+#include <vector>
+
+// ----------------------------------------------------------------------
+// make_dump
+//
+// what a rank would write into its own file: a small header with its
+// rank, followed by a rank-dependent number of values (none for rank 1)
+
+static DumpBuffer make_dump(int rank)
+{
+  DumpBuffer buf;
+  int n = rank == 1 ? 0 : 10 + 7 * rank;
+  buf.write(&rank, 1);
+  buf.write(&n, 1);
+  std::vector<float> data(n);
+  for (int i = 0; i < n; i++) {
+    data[i] = rank + .001f * i;
+  }
+  buf.write(data.data(), data.size());
+  return buf;
+}
+
+// ----------------------------------------------------------------------
+// RoundTrip
+//
+// ranks are grouped two at a time, and each rank finds its own dump in its
+// group's file again. The dumps are sent to the writing rank in chunks, here
+// small ones that don't divide the dumps evenly, as well as in one piece.
+
+class DumpAggregated : public ::testing::TestWithParam<size_t>
+{};
+
+INSTANTIATE_TEST_SUITE_P(ChunkSize, DumpAggregated,
+                         ::testing::Values(size_t(7), size_t(64),
+                                           dump_aggregated::default_chunk_size));
+
+TEST_P(DumpAggregated, RoundTrip)
+{
+  const int io_group_size = 2;
+  int group = psc_world_rank / io_group_size;
+  MPI_Comm io_comm;
+  MPI_Comm_split(psc_comm_world, group, psc_world_rank, &io_comm);
+  int io_size;
+  MPI_Comm_size(io_comm, &io_size);
+
+  char filename[256];
+  sprintf(filename, "test_dump_aggregated.g%d", group);
+
+  DumpBuffer buf = make_dump(psc_world_rank);
+  dump_aggregated::write(buf, io_comm, psc_world_rank, filename, GetParam());
+  MPI_Barrier(psc_comm_world);
+
+  // the index lists the group's ranks in order, with their blocks following
+  // each other
+  FILE* file = fopen(filename, "rb");
+  ASSERT_TRUE(file);
+  std::vector<dump_aggregated::IndexEntry> index;
+  ASSERT_TRUE(dump_aggregated::read_index(file, index));
+  fclose(file);
+  ASSERT_EQ(index.size(), io_size);
+  for (int r = 0; r < io_size; r++) {
+    EXPECT_EQ(index[r].rank, group * io_group_size + r);
+    EXPECT_EQ(index[r].size, make_dump(index[r].rank).buf.size());
+    if (r > 0) {
+      EXPECT_EQ(index[r].offset, index[r - 1].offset + index[r - 1].size);
+    }
+  }
+
+  // each rank's data comes back unchanged
+  std::vector<char> data;
+  ASSERT_TRUE(dump_aggregated::read_rank(filename, psc_world_rank, data));
+  EXPECT_EQ(data, buf.buf);
+
+  // ranks that aren't in the file, and files that aren't aggregated ones
+  EXPECT_FALSE(dump_aggregated::read_rank(filename, psc_world_size, data));
+  EXPECT_FALSE(dump_aggregated::read_rank("does_not_exist", 0, data));
+
+  MPI_Barrier(psc_comm_world);
+  int io_rank;
+  MPI_Comm_rank(io_comm, &io_rank);
+  if (io_rank == 0) {
+    file = fopen(filename, "wb");
+    fputs("not an aggregated dump", file);
+    fclose(file);
+    EXPECT_FALSE(dump_aggregated::read_rank(filename, psc_world_rank, data));
+    remove(filename);
+  }
+
+  MPI_Comm_free(&io_comm);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
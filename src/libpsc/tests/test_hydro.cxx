@@ -0,0 +1,262 @@
+
+#include <gtest/gtest.h>
+
+#include "test_common.hxx"
+
+#include "../libpsc/vpic/vpic_config.h"
+#include "../libpsc/vpic/psc_hydro_ops.hxx"
+#include "mfields_hydro.hxx"
+
+#include <algorithm>
+#include <random>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using Grid = VpicConfigPsc::Grid;
+using Mparticles = VpicConfigPsc::Mparticles;
+using Species = Mparticles::Species;
+using MfieldsInterpolator = VpicConfigPsc::MfieldsInterpolator;
+
+template <typename _MfieldsHydro, template <typename...> class _HydroOps>
+struct Config
+{
+  using MfieldsHydro = _MfieldsHydro;
+  using HydroOps = _HydroOps<Mparticles, MfieldsHydro, MfieldsInterpolator>;
+};
+
+using HydroTestTypes =
+  ::testing::Types<Config<MfieldsHydroPsc<Grid>, PscHydroOps>,
+                   Config<MfieldsHydroQ<Grid>, PscHydroQOps>>;
+
+// ======================================================================
+// HydroTest
+
+template <typename T>
+struct HydroTest : ::testing::Test
+{
+  using MfieldsHydro = typename T::MfieldsHydro;
+  using HydroOps = typename T::HydroOps;
+
+  HydroTest() : grid_{make_grid()}
+  {
+    auto& domain = grid_.domain;
+    double dx[3] = {1., 1., 1.};
+    double xl[3] = {0., 0., 0.};
+    double xh[3] = {domain.length[0], domain.length[1], domain.length[2]};
+    vgrid_.setup(dx, .5, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, domain.gdims, domain.np);
+  }
+
+  // 4^3 cells per proc, decomposed such that there are edge and corner
+  // neighbors when running on 4 or 8 procs
+  static Grid_t make_grid()
+  {
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    Int3 np = size == 8 ? Int3{2, 2, 2}
+                        : size == 4 ? Int3{2, 2, 1} : Int3{size, 1, 1};
+    Int3 gdims = {4 * np[0], 4 * np[1], 4 * np[2]};
+    auto domain = Grid_t::Domain{gdims, Vec3<double>(gdims), {}, np};
+    auto bc = psc::grid::BC{};
+    auto kinds = Grid_t::Kinds{};
+    auto norm = Grid_t::Normalization{};
+    double dt = .1;
+    return Grid_t{domain, bc, kinds, norm, dt};
+  }
+
+  void init(Species& sp, MfieldsInterpolator& interpolator, int n_prts,
+            int seed)
+  {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> pos(-1.f, 1.f);
+    std::normal_distribution<float> mom(0.f, .5f);
+    std::uniform_int_distribution<int> cell(1, 4);
+
+    auto& ip = interpolator.getPatch(0);
+    for (int v = 0; v < vgrid_.nv; v++) {
+      float* f = reinterpret_cast<float*>(&ip[v]);
+      for (int m = 0; m < 18; m++) {
+        f[m] = .1f * pos(gen);
+      }
+    }
+
+    for (int n = 0; n < n_prts; n++) {
+      auto& prt = sp.p[n];
+      prt.dx = pos(gen);
+      prt.dy = pos(gen);
+      prt.dz = pos(gen);
+      prt.i = VOXEL(cell(gen), cell(gen), cell(gen), vgrid_.nx, vgrid_.ny,
+                    vgrid_.nz);
+      prt.ux = mom(gen);
+      prt.uy = mom(gen);
+      prt.uz = mom(gen);
+      prt.w = 1.f;
+    }
+    sp.np = n_prts;
+  }
+
+  Grid_t grid_;
+  Grid vgrid_;
+};
+
+TYPED_TEST_SUITE(HydroTest, HydroTestTypes);
+
+// ----------------------------------------------------------------------
+// TotalCharge
+//
+// the trilinear deposit conserves the total charge
+
+TYPED_TEST(HydroTest, TotalCharge)
+{
+  using MfieldsHydro = typename TypeParam::MfieldsHydro;
+  using HydroOps = typename TypeParam::HydroOps;
+  const int n_prts = 1000;
+
+  Species sp("electron", -1., 1., n_prts, 1, 0, 0, &this->vgrid_);
+  MfieldsInterpolator interpolator(&this->vgrid_);
+  this->init(sp, interpolator, n_prts, 1);
+
+  MfieldsHydro hydro{this->grid_, &this->vgrid_};
+  HydroOps ops;
+  HydroOps::clear(hydro);
+  ops.accumulate_hydro_p({&hydro}, {&sp}, interpolator);
+
+  double rho = 0.;
+  auto& H = hydro.getPatch(0);
+  for (int v = 0; v < this->vgrid_.nv; v++) {
+    rho += H[v].rho;
+  }
+  EXPECT_NEAR(rho * this->vgrid_.dV, -n_prts, 1e-3);
+}
+
+// ----------------------------------------------------------------------
+// MultiSpecies
+//
+// accumulating several species in one (threaded) pass gives the same result
+// as a serial accumulation of each species on its own, both for particles
+// that are sorted by voxel and ones that aren't (the second pass reusing the
+// per-thread scratch of the first)
+
+TYPED_TEST(HydroTest, MultiSpecies)
+{
+  using MfieldsHydro = typename TypeParam::MfieldsHydro;
+  using HydroOps = typename TypeParam::HydroOps;
+  const int n_prts = 1000;
+
+#ifdef _OPENMP
+  int n_thread = omp_get_max_threads();
+  omp_set_num_threads(4);
+#endif
+
+  HydroOps ops;
+  for (bool sorted : {false, true}) {
+    Species sp_e("electron", -1., 1., n_prts, 1, 0, 0, &this->vgrid_);
+    Species sp_i("ion", 1., 100., n_prts, 1, 0, 0, &this->vgrid_);
+    MfieldsInterpolator interpolator(&this->vgrid_);
+    this->init(sp_e, interpolator, n_prts, 1);
+    this->init(sp_i, interpolator, n_prts, 2);
+    if (sorted) {
+      for (auto sp : {&sp_e, &sp_i}) {
+        std::stable_sort(sp->p, sp->p + sp->np,
+                         [](const auto& a, const auto& b) { return a.i < b.i; });
+      }
+    }
+
+    MfieldsHydro hydro_e{this->grid_, &this->vgrid_};
+    MfieldsHydro hydro_i{this->grid_, &this->vgrid_};
+    HydroOps::clear(hydro_e);
+    HydroOps::clear(hydro_i);
+    ops.accumulate_hydro_p({&hydro_e, &hydro_i}, {&sp_e, &sp_i},
+                           interpolator);
+
+    MfieldsHydro ref{this->grid_, &this->vgrid_};
+    for (auto hydro_sp : {std::make_pair(&hydro_e, &sp_e),
+                          std::make_pair(&hydro_i, &sp_i)}) {
+      HydroOps::clear(ref);
+      HydroOps::accumulate_hydro_p(ref.getPatch(0).data(), *hydro_sp.second,
+                                   interpolator.getPatch(0), 0,
+                                   hydro_sp.second->np);
+
+      auto& H = hydro_sp.first->getPatch(0);
+      auto& H_ref = ref.getPatch(0);
+      for (int v = 0; v < this->vgrid_.nv; v++) {
+        const float* h = reinterpret_cast<const float*>(&H[v]);
+        const float* h_ref = reinterpret_cast<const float*>(&H_ref[v]);
+        for (int m = 0; m < MfieldsHydro::N_COMP; m++) {
+          EXPECT_NEAR(h[m], h_ref[m], 1e-5 * (1. + std::abs(h_ref[m])))
+            << "sorted " << sorted << " v " << v << " m " << m;
+        }
+      }
+    }
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(n_thread);
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Synchronize
+//
+// synchronize exchanges with all neighbors at once, which should give the
+// same sums as the exchanges going one direction after the other. Run on 8
+// procs to check corner neighbors, too.
+
+TYPED_TEST(HydroTest, Synchronize)
+{
+  using MfieldsHydro = typename TypeParam::MfieldsHydro;
+  using HydroOps = typename TypeParam::HydroOps;
+  using F3D = Field3D<typename MfieldsHydro::Patch>;
+  using CommHydro = typename HydroOps::template CommHydro<Grid, F3D>;
+
+  MfieldsHydro hydro{this->grid_, &this->vgrid_};
+  MfieldsHydro ref{this->grid_, &this->vgrid_};
+  const int n_comp = MfieldsHydro::N_COMP;
+  const int n = this->vgrid_.nv * n_comp;
+  std::mt19937 gen(psc_world_rank);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (int i = 0; i < n; i++) {
+    hydro.data()[i] = dist(gen);
+  }
+  std::copy(hydro.data(), hydro.data() + n, ref.data());
+
+  HydroOps::synchronize(hydro);
+
+  F3D H_ref{ref.getPatch(0)};
+  CommHydro comm{this->vgrid_};
+  for (int dir = 0; dir < 3; dir++) {
+    comm.begin(dir, H_ref);
+    comm.end(dir, H_ref);
+  }
+
+  for (int i = 0; i < n; i++) {
+    EXPECT_NEAR(hydro.data()[i], ref.data()[i], 1e-5) << "i " << i;
+  }
+
+  // second time around goes through the persistent requests that are
+  // already set up
+  std::copy(ref.data(), ref.data() + n, hydro.data());
+  HydroOps::synchronize(hydro);
+  for (int dir = 0; dir < 3; dir++) {
+    comm.begin(dir, H_ref);
+    comm.end(dir, H_ref);
+  }
+  for (int i = 0; i < n; i++) {
+    EXPECT_NEAR(hydro.data()[i], ref.data()[i], 1e-4) << "i " << i;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,133 @@
+
+#include <gtest/gtest.h>
+
+#include "psc.h" // FIXME, just for EX etc
+
+#include "fields.hxx"
+#include "interpolate.hxx"
+#include "psc_fields_c.h"
+#include "psc_fields_single.h"
+
+#include <random>
+
+template <typename _Mfields, typename _OPT_IP, typename _dim>
+struct InterpolateTestConfig
+{
+  using Mfields = _Mfields;
+  using dim = _dim;
+  using InterpolateEM_t =
+    InterpolateEM<Fields3d<typename Mfields::fields_view_t>, _OPT_IP, dim>;
+};
+
+using InterpolateTestTypes = ::testing::Types<
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_xyz>,
+  InterpolateTestConfig<MfieldsSingle, opt_ip_2nd, dim_xyz>,
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_yz>,
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_xz>,
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_xy>,
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_y>,
+  InterpolateTestConfig<MfieldsC, opt_ip_2nd, dim_z>,
+  InterpolateTestConfig<MfieldsC, opt_ip_1st, dim_yz>,
+  InterpolateTestConfig<MfieldsC, opt_ip_1st, dim_xz>>;
+
+template <typename T>
+struct InterpolateTest : ::testing::Test
+{};
+
+TYPED_TEST_SUITE(InterpolateTest, InterpolateTestTypes);
+
+// ----------------------------------------------------------------------
+// Gather
+//
+// gathering all components at once from the EMCache gives the same as
+// interpolating them one at a time
+
+TYPED_TEST(InterpolateTest, Gather)
+{
+  using Mfields = typename TypeParam::Mfields;
+  using dim = typename TypeParam::dim;
+  using InterpolateEM_t = typename TypeParam::InterpolateEM_t;
+  using real_t = typename InterpolateEM_t::real_t;
+  const real_t eps = sizeof(real_t) == sizeof(float) ? 1e-5 : 1e-12;
+
+  Int3 gdims = {dim::InvarX::value ? 1 : 4, dim::InvarY::value ? 1 : 4,
+                dim::InvarZ::value ? 1 : 4};
+  Int3 ibn = {dim::InvarX::value ? 0 : 2, dim::InvarY::value ? 0 : 2,
+              dim::InvarZ::value ? 0 : 2};
+  auto domain = Grid_t::Domain{gdims, Vec3<double>(gdims), {}, {1, 1, 1}};
+  Grid_t grid{domain, psc::grid::BC{}, Grid_t::Kinds{},
+              Grid_t::Normalization{}, .1};
+  Mfields mflds{grid, NR_FIELDS, ibn};
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<real_t> dist(-1., 1.);
+  auto flds = mflds[0];
+  for (int k = -ibn[2]; k < gdims[2] + ibn[2]; k++) {
+    for (int j = -ibn[1]; j < gdims[1] + ibn[1]; j++) {
+      for (int i = -ibn[0]; i < gdims[0] + ibn[0]; i++) {
+        for (int m = EX; m <= HZ; m++) {
+          flds(m, i, j, k) = dist(gen);
+        }
+      }
+    }
+  }
+
+  typename InterpolateEM_t::fields_t EM(flds);
+  typename InterpolateEM_t::Cache cache;
+  cache.load(flds);
+
+  std::uniform_real_distribution<real_t> pos(0., 4.);
+  InterpolateEM_t ip;
+  for (int n = 0; n < 100; n++) {
+    real_t xm[3];
+    for (int d = 0; d < 3; d++) {
+      xm[d] = gdims[d] == 1 ? 0 : pos(gen);
+    }
+    ip.set_coeffs(xm);
+
+    real_t E[3], H[3];
+    ip.eh(cache, E, H);
+    EXPECT_NEAR(E[0], ip.ex(EM), eps);
+    EXPECT_NEAR(E[1], ip.ey(EM), eps);
+    EXPECT_NEAR(E[2], ip.ez(EM), eps);
+    EXPECT_NEAR(H[0], ip.hx(EM), eps);
+    EXPECT_NEAR(H[1], ip.hy(EM), eps);
+    EXPECT_NEAR(H[2], ip.hz(EM), eps);
+  }
+
+  // a cache of just one cell, padded by the stencil's reach, does as well
+  // for particles in that cell
+  int tile_lo[3], tile_n[3];
+  for (int d = 0; d < 3; d++) {
+    tile_lo[d] = gdims[d] == 1 ? 0 : 1 - 2;
+    tile_n[d] = gdims[d] == 1 ? 1 : 1 + 2 + 3;
+  }
+  typename InterpolateEM_t::Cache tile;
+  tile.load(flds, tile_lo, tile_n);
+
+  std::uniform_real_distribution<real_t> pos_tile(1., 2.);
+  for (int n = 0; n < 100; n++) {
+    real_t xm[3];
+    for (int d = 0; d < 3; d++) {
+      xm[d] = gdims[d] == 1 ? 0 : pos_tile(gen);
+    }
+    ip.set_coeffs(xm);
+
+    real_t E[3], H[3], E_tile[3], H_tile[3];
+    ip.eh(cache, E, H);
+    ip.eh(tile, E_tile, H_tile);
+    for (int m = 0; m < 3; m++) {
+      EXPECT_EQ(E_tile[m], E[m]);
+      EXPECT_EQ(H_tile[m], H[m]);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,149 @@
+
+#include <gtest/gtest.h>
+
+#include "test_common.hxx"
+
+#include "../libpsc/vpic/vpic_config.h"
+#include "../libpsc/vpic/marder_vpic.hxx"
+
+#include <cstring>
+#include <memory>
+#include <random>
+
+using Grid = VpicConfigPsc::Grid;
+using Mparticles = VpicConfigPsc::Mparticles;
+using MfieldsState = VpicConfigPsc::MfieldsState;
+using MaterialList = MfieldsState::MaterialList;
+using MarderOps = MarderVpicOps<Mparticles, MfieldsState>;
+
+// ======================================================================
+// MarderVpicTest
+//
+// The fused clean_div_{e,b}_pass need to give the same fields as doing
+// compute_div_*_err, compute_rms_div_*_err and clean_div_* one after the
+// other
+
+struct MarderVpicTest : ::testing::Test
+{
+  void setup(Int3 ldims)
+  {
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    Int3 np = {size, 1, 1};
+    Int3 gdims = {ldims[0] * np[0], ldims[1], ldims[2]};
+    auto domain = Grid_t::Domain{gdims, Vec3<double>(gdims), {}, np};
+    grid_.reset(new Grid_t{domain, psc::grid::BC{}, Grid_t::Kinds{},
+                           Grid_t::Normalization{}, .1});
+
+    double dx[3] = {1., 1., 1.};
+    double xl[3] = {0., 0., 0.};
+    double xh[3] = {domain.length[0], domain.length[1], domain.length[2]};
+    vgrid_.setup(dx, .5, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, domain.gdims, domain.np);
+
+    material_list_.append(
+      MaterialList::create("vacuum", 1., 1., 1., 1., 1., 1., 0., 0., 0., 0.,
+                           0., 0.));
+  }
+
+  void init(MfieldsState& mflds)
+  {
+    std::mt19937 gen(psc_world_rank);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    auto& fa = mflds.getPatch(0);
+    for (int v = 0; v < vgrid_.nv; v++) {
+      fa[v].ex = dist(gen);
+      fa[v].ey = dist(gen);
+      fa[v].ez = dist(gen);
+      fa[v].cbx = dist(gen);
+      fa[v].cby = dist(gen);
+      fa[v].cbz = dist(gen);
+      fa[v].rhof = dist(gen);
+      fa[v].rhob = dist(gen);
+    }
+  }
+
+  void check_clean_div_e()
+  {
+    MfieldsState mflds{*grid_, &vgrid_, material_list_};
+    MfieldsState ref{*grid_, &vgrid_, material_list_};
+    init(mflds);
+    init(ref);
+
+    MarderOps ops;
+    for (int round = 0; round < 3; round++) {
+      ops.compute_div_e_err(ref);
+      double err_ref = ops.compute_rms_div_e_err(ref);
+      ops.clean_div_e(ref);
+
+      double err = ops.clean_div_e_pass(mflds, true);
+      EXPECT_NEAR(err, err_ref, 1e-5 * err_ref);
+      EXPECT_EQ(memcmp(mflds.data(), ref.data(),
+                       vgrid_.nv * sizeof(MfieldsState::Element)),
+                0);
+    }
+  }
+
+  void check_clean_div_b()
+  {
+    MfieldsState mflds{*grid_, &vgrid_, material_list_};
+    MfieldsState ref{*grid_, &vgrid_, material_list_};
+    init(mflds);
+    init(ref);
+
+    MarderOps ops;
+    for (int round = 0; round < 3; round++) {
+      ops.compute_div_b_err(ref);
+      double err_ref = ops.compute_rms_div_b_err(ref);
+      ops.clean_div_b(ref);
+
+      double err = ops.clean_div_b_pass(mflds, true);
+      EXPECT_NEAR(err, err_ref, 1e-5 * err_ref);
+      EXPECT_EQ(memcmp(mflds.data(), ref.data(),
+                       vgrid_.nv * sizeof(MfieldsState::Element)),
+                0);
+    }
+  }
+
+  std::unique_ptr<Grid_t> grid_;
+  Grid vgrid_;
+  MaterialList material_list_;
+};
+
+TEST_F(MarderVpicTest, CleanDivE)
+{
+  setup({4, 3, 5});
+  check_clean_div_e();
+}
+
+TEST_F(MarderVpicTest, CleanDivE2d)
+{
+  setup({4, 1, 5});
+  check_clean_div_e();
+}
+
+TEST_F(MarderVpicTest, CleanDivB)
+{
+  setup({4, 3, 5});
+  check_clean_div_b();
+}
+
+TEST_F(MarderVpicTest, CleanDivB2d)
+{
+  setup({4, 1, 5});
+  check_clean_div_b();
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
@@ -541,6 +541,38 @@ TEST(TestSetupParticles, Tag)
   }
 }
 
+// ----------------------------------------------------------------------
+// Fractional
+//
+// with fractional particles per cell, partition() needs to come up with
+// the same random number of particles in each cell as the actual setup
+
+TEST(TestSetupParticles, Fractional)
+{
+  using Mparticles = MparticlesDouble;
+
+  auto domain = Grid_t::Domain{{1, 8, 8}, {10., 80., 80.}, {}, {1, 1, 1}};
+  auto kinds = Grid_t::Kinds{{1., 100., "i"}};
+  auto prm = Grid_t::NormalizationParams::dimensionless();
+  prm.nicell = 4;
+  Grid_t grid{domain, {}, kinds, {prm}, .1};
+  Mparticles mprts{grid};
+
+  SetupParticles<Mparticles> setup_particles(grid);
+  setup_particles.fractional_n_particles_per_cell = true;
+  auto init_npt = [&](int kind, Double3 crd, psc_particle_npt& npt) {
+    npt.n = 1.3;
+  };
+  auto n_prts_by_patch = setup_particles.partition(grid, init_npt);
+  setup_particles(mprts, init_npt);
+
+  auto n_cells =
+    grid.domain.gdims[0] * grid.domain.gdims[1] * grid.domain.gdims[2];
+  EXPECT_EQ(mprts.size(), n_prts_by_patch[0]);
+  EXPECT_GT(mprts.size(), n_cells * 5);
+  EXPECT_LT(mprts.size(), n_cells * 6);
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
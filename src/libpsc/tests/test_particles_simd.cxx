@@ -0,0 +1,160 @@
+
+#include <gtest/gtest.h>
+
+#include "../libpsc/vpic/vpic_config.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Grid = VpicConfigPsc::Grid;
+using Mparticles = VpicConfigPsc::Mparticles;
+using Species = Mparticles::Species;
+using MfieldsInterpolator = VpicConfigPsc::MfieldsInterpolator;
+using MfieldsAccumulator = VpicConfigPsc::MfieldsAccumulator;
+using ParticlesOps = VpicConfigPsc::ParticlesOps;
+
+// ======================================================================
+// ParticlesSimdTest
+//
+// The 8- and 16-wide pipelines need to give bit-for-bit the same results
+// as the scalar pipeline
+
+struct ParticlesSimdTest : ::testing::Test
+{
+  static const int n_prts = 16 * 37;
+
+  ParticlesSimdTest()
+  {
+    double dx[3] = {1., 1., 1.};
+    double xl[3] = {0., 0., 0.};
+    double xh[3] = {4., 4., 4.};
+    int gdims[3] = {4, 4, 4};
+    vgrid_.setup(dx, .5, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, gdims, {1, 1, 1});
+  }
+
+  void init(Species& sp, MfieldsInterpolator& interpolator)
+  {
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> pos(-1.f, 1.f);
+    std::normal_distribution<float> mom(0.f, .5f);
+    std::uniform_int_distribution<int> cell(1, 4);
+
+    auto& ip = interpolator.getPatch(0);
+    for (int v = 0; v < vgrid_.nv; v++) {
+      float* f = reinterpret_cast<float*>(&ip[v]);
+      for (int m = 0; m < 18; m++) {
+        f[m] = .1f * pos(gen);
+      }
+    }
+
+    for (int n = 0; n < n_prts; n++) {
+      auto& prt = sp.p[n];
+      prt.dx = pos(gen);
+      prt.dy = pos(gen);
+      prt.dz = pos(gen);
+      prt.i = VOXEL(cell(gen), cell(gen), cell(gen), vgrid_.nx, vgrid_.ny,
+                    vgrid_.nz);
+      prt.ux = mom(gen);
+      prt.uy = mom(gen);
+      prt.uz = mom(gen);
+      prt.w = 1.f + pos(gen);
+    }
+    sp.np = n_prts;
+  }
+
+  int simd_width(int width)
+  {
+    return psc_vpic_simd_width() >= width ? width : 0;
+  }
+
+  void check_advance_p(int width)
+  {
+    Species sp_ref("ref", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    Species sp("simd", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    MfieldsInterpolator interpolator(&vgrid_);
+    MfieldsAccumulator acc_ref(&vgrid_), acc(&vgrid_);
+    init(sp_ref, interpolator);
+    init(sp, interpolator);
+
+    ParticlesOps::particle_mover_seg_t seg_ref, seg;
+    ParticlesOps::advance_p_pipeline(sp_ref, acc_ref[0], interpolator,
+                                     &seg_ref, sp_ref.p, n_prts, sp_ref.pm,
+                                     sp_ref.max_nm);
+    ParticlesOps::advance_p_pipeline_simd(sp, acc[0], interpolator, &seg,
+                                          sp.p, n_prts, sp.pm, sp.max_nm,
+                                          width);
+
+    EXPECT_EQ(memcmp(sp.p, sp_ref.p, n_prts * sizeof(*sp.p)), 0);
+    ASSERT_EQ(seg.nm, seg_ref.nm);
+    EXPECT_EQ(seg.n_ignored, seg_ref.n_ignored);
+    EXPECT_EQ(memcmp(sp.pm, sp_ref.pm, seg.nm * sizeof(*sp.pm)), 0);
+    EXPECT_EQ(memcmp(acc.data(), acc_ref.data(),
+                     acc.stride() * sizeof(*acc.data())),
+              0);
+  }
+
+  void check_uncenter_p(int width)
+  {
+    Species sp_ref("ref", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    Species sp("simd", -1., 1., n_prts, n_prts, 0, 0, &vgrid_);
+    MfieldsInterpolator interpolator(&vgrid_);
+    init(sp_ref, interpolator);
+    init(sp, interpolator);
+
+    ParticlesOps::uncenter_p_pipeline(&sp_ref, interpolator, 0, n_prts);
+    ParticlesOps::uncenter_p_pipeline_simd(&sp, interpolator, 0, n_prts,
+                                           width);
+
+    EXPECT_EQ(memcmp(sp.p, sp_ref.p, n_prts * sizeof(*sp.p)), 0);
+  }
+
+  Grid vgrid_;
+};
+
+TEST_F(ParticlesSimdTest, AdvanceP8)
+{
+  if (!simd_width(8)) {
+    GTEST_SKIP() << "no AVX2 kernels";
+  }
+  check_advance_p(8);
+}
+
+TEST_F(ParticlesSimdTest, AdvanceP16)
+{
+  if (!simd_width(16)) {
+    GTEST_SKIP() << "no AVX-512 kernels";
+  }
+  check_advance_p(16);
+}
+
+TEST_F(ParticlesSimdTest, UncenterP8)
+{
+  if (!simd_width(8)) {
+    GTEST_SKIP() << "no AVX2 kernels";
+  }
+  check_uncenter_p(8);
+}
+
+TEST_F(ParticlesSimdTest, UncenterP16)
+{
+  if (!simd_width(16)) {
+    GTEST_SKIP() << "no AVX-512 kernels";
+  }
+  check_uncenter_p(16);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
@@ -91,6 +91,76 @@ TYPED_TEST(PushFieldsTest, Pushf2)
   });
 }
 
+// ======================================================================
+// PushFieldsHEHTest
+//
+// checks that the temporally blocked push_HEH() gives the same result as
+// the H-E-H sequence with ghost exchanges in between
+
+template <typename T>
+struct PushFieldsHEHTest : PushParticlesTest<T>
+{};
+
+using PushFieldsHEHTestTypes =
+  ::testing::Types<TestConfig1vbec3dSingleYZ, TestConfig1vbec3dSingleXZ,
+                   TestConfig1vbec3dSingle>;
+
+TYPED_TEST_SUITE(PushFieldsHEHTest, PushFieldsHEHTestTypes);
+
+TYPED_TEST(PushFieldsHEHTest, HEH)
+{
+  using MfieldsState = typename TypeParam::MfieldsState;
+  using dim = typename TypeParam::dim;
+  using PushFields = typename TypeParam::PushFields;
+  using Bnd = typename TypeParam::Bnd;
+
+  this->make_psc({});
+  const auto& grid = this->grid();
+
+  Vec3<double> k;
+  for (int d = 0; d < 3; d++) {
+    k[d] = 2. * M_PI / grid.domain.length[d];
+  }
+
+  auto init = [&](int m, double crd[3]) {
+    double x = k[0] * crd[0], y = k[1] * crd[1], z = k[2] * crd[2];
+    return sin((m + 1) * x + 2 * y + (m % 3 + 1) * z) + .1 * cos(m * y + z);
+  };
+
+  auto mflds_ref = MfieldsState{grid};
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds_ref, init);
+  setupFields(mflds, init);
+
+  PushFields pushf;
+  Bnd bnd{grid, grid.ibn};
+
+  // reference: separate sub-steps w/ ghost exchange
+  bnd.fill_ghosts(mflds_ref, JXI, HX + 3);
+  pushf.push_H(mflds_ref, .5, dim{});
+  bnd.fill_ghosts(mflds_ref, HX, HX + 3);
+  pushf.push_E(mflds_ref, 1., dim{});
+  bnd.fill_ghosts(mflds_ref, EX, EX + 3);
+  pushf.push_H(mflds_ref, .5, dim{});
+  bnd.fill_ghosts(mflds_ref, HX, HX + 3);
+
+  // blocked
+  bnd.fill_ghosts(mflds, JXI, HX + 3);
+  pushf.push_HEH(mflds, dim{});
+  bnd.fill_ghosts(mflds, EX, HX + 3);
+
+  for (int p = 0; p < mflds.n_patches(); p++) {
+    auto flds_ref = mflds_ref[p];
+    auto flds = mflds[p];
+    for (int m = EX; m < HX + 3; m++) {
+      grid.Foreach_3d(2, 2, [&](int i, int j, int k) {
+        EXPECT_EQ(flds(m, i, j, k), flds_ref(m, i, j, k))
+          << "m " << m << " ijk " << i << ":" << j << ":" << k;
+      });
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
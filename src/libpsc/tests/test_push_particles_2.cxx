@@ -173,6 +173,140 @@ TYPED_TEST(PushParticlesTest, Cyclo)
   }
 }
 
+// ======================================================================
+// Tiled test
+//
+// pushing tile by tile, with the current going through CurrentTile, gives
+// the same particles and current as pushing the particles in their original
+// order and depositing straight into the patch's J
+
+template <typename dim, typename PushParticles>
+static void testTiled(Int3 gdims)
+{
+  using Mparticles = typename PushParticles::Mparticles;
+  using MfieldsState = typename PushParticles::MfieldsState;
+  using InterpolateEM_t = typename PushParticles::InterpolateEM_t;
+  using Fields = Fields3d<typename MfieldsState::fields_view_t>;
+  using CurrentRef = CurrentEsirkepov<opt_order_2nd, dim, Fields,
+                                      InterpolateEM_t>;
+  using real_t = typename Mparticles::real_t;
+  using Real3 = Vec3<real_t>;
+
+  Int3 ibn = {2, 2, 2};
+  for (int d = 0; d < 3; d++) {
+    if (gdims[d] == 1) {
+      ibn[d] = 0;
+    }
+  }
+  auto domain = Grid_t::Domain{gdims, 10. * Vec3<double>(gdims)};
+  auto bc =
+    psc::grid::BC{{BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                  {BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                  {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC},
+                  {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC}};
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(-1., 1., "e")};
+  auto norm_params = Grid_t::NormalizationParams::dimensionless();
+  norm_params.nicell = 10;
+  Grid_t grid{domain, bc, kinds, {norm_params}, 1., -1, ibn};
+
+  auto mflds = MfieldsState{grid};
+  auto ref = MfieldsState{grid};
+  setupFields(mflds, [](int m, double crd[3]) {
+    return .01 * std::sin(.1 * (m + 1) * (crd[0] + 2. * crd[1] + 3. * crd[2]));
+  });
+  setupFields(ref, [](int m, double crd[3]) {
+    return .01 * std::sin(.1 * (m + 1) * (crd[0] + 2. * crd[1] + 3. * crd[2]));
+  });
+
+  Mparticles mprts{grid}, mprts_ref{grid};
+  for (auto* m : {&mprts, &mprts_ref}) {
+    RngPool rngpool;
+    Rng* rng = rngpool[0];
+    auto inj = m->injector();
+    auto injector = inj[0];
+    for (int n = 0; n < 2000; n++) {
+      injector({{rng->uniform(0, domain.length[0]),
+                 rng->uniform(0, domain.length[1]),
+                 rng->uniform(0, domain.length[2])},
+                {rng->normal(0., .3), rng->normal(0., .3),
+                 rng->normal(0., .3)},
+                1.,
+                0});
+    }
+  }
+
+  PushParticles::push_mprts(mprts, mflds);
+
+  // reference
+  {
+    Real3 dxi = Real3{1., 1., 1.} / Real3(grid.domain.dx);
+    real_t dq = .5f * grid.norm.eta * grid.dt * kinds[0].q / kinds[0].m;
+    InterpolateEM_t ip;
+    typename PushParticles::AdvanceParticle_t advance(grid.dt);
+    CurrentRef current(grid);
+    auto flds = ref[0];
+    Fields EM(flds), J(flds);
+    flds.zero(JXI, JXI + 3);
+    auto accessor = mprts_ref.accessor_();
+    for (auto prt : accessor[0]) {
+      Real3& x = prt.x();
+      real_t xm[3];
+      for (int d = 0; d < 3; d++) {
+        xm[d] = x[d] * dxi[d];
+      }
+      ip.set_coeffs(xm);
+      current.charge_before(ip);
+      Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
+      Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
+      advance.push_p(prt.u(), E, H, dq);
+      auto v = advance.calc_v(prt.u());
+      advance.push_x(x, v);
+      current.charge_after(x);
+      current.prep(prt.qni_wni(), v);
+      current.calc(J);
+    }
+  }
+
+  auto prts = mprts.accessor()[0];
+  auto prts_ref = mprts_ref.accessor()[0];
+  auto it_ref = prts_ref.begin();
+  for (auto prt : prts) {
+    auto prt_ref = *it_ref++;
+    for (int d = 0; d < 3; d++) {
+      EXPECT_NEAR(prt.u()[d], prt_ref.u()[d], 1e-12);
+      EXPECT_NEAR(prt.x()[d], prt_ref.x()[d], 1e-12);
+    }
+  }
+
+  auto flds = mflds[0];
+  auto flds_ref = ref[0];
+  double max_j = 0.;
+  for (int m = JXI; m <= JZI; m++) {
+    for (int k = -ibn[2]; k < gdims[2] + ibn[2]; k++) {
+      for (int j = -ibn[1]; j < gdims[1] + ibn[1]; j++) {
+        for (int i = -ibn[0]; i < gdims[0] + ibn[0]; i++) {
+          EXPECT_NEAR(flds(m, i, j, k), flds_ref(m, i, j, k), 1e-12)
+            << "m " << m << " ijk " << i << ":" << j << ":" << k;
+          max_j = std::max(max_j, std::abs(flds_ref(m, i, j, k)));
+        }
+      }
+    }
+  }
+  EXPECT_GT(max_j, 0.);
+}
+
+TEST(PushParticlesEsirkepov, TiledXYZ)
+{
+  testTiled<dim_xyz, PushParticlesEsirkepov<Config2ndDouble<dim_xyz>>>(
+    {20, 16, 12});
+}
+
+TEST(PushParticlesEsirkepov, TiledYZ)
+{
+  testTiled<dim_yz, PushParticlesEsirkepov<Config2ndDouble<dim_yz>>>(
+    {1, 20, 12});
+}
+
 // ======================================================================
 // main
 
@@ -2,6 +2,9 @@
 #include <gtest/gtest.h>
 
 #include "../vpic/PscRng.h"
+#include "rng_philox.hxx"
+
+#include <vector>
 
 using Rng = PscRng;
 using RngPool = PscRngPool<Rng>;
@@ -18,6 +21,141 @@ TEST(Rng, RngPool)
   }
 }
 
+TEST(Rng, Philox4x32KnownAnswer)
+{
+  // known answer tests from the Random123 distribution
+  auto r = Philox4x32::generate({{0, 0, 0, 0}}, {{0, 0}});
+  EXPECT_EQ(r.v[0], 0x6627e8d5u);
+  EXPECT_EQ(r.v[1], 0xe169c58du);
+  EXPECT_EQ(r.v[2], 0xbc57ac4cu);
+  EXPECT_EQ(r.v[3], 0x9b00dbd8u);
+
+  r = Philox4x32::generate({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                           {{0xa4093822, 0x299f31d0}});
+  EXPECT_EQ(r.v[0], 0xd16cfe09u);
+  EXPECT_EQ(r.v[1], 0x94fdccebu);
+  EXPECT_EQ(r.v[2], 0x5001e420u);
+  EXPECT_EQ(r.v[3], 0x24126ea1u);
+}
+
+TEST(Rng, Philox4x32Normal)
+{
+  const int n = 100000;
+  double sum = 0., sum2 = 0.;
+  for (uint32_t i = 0; i < n; i++) {
+    float r[4];
+    Philox4x32::normal4({{i, 0, 0, 0}}, {{1, 2}}, r);
+    for (int m = 0; m < 4; m++) {
+      EXPECT_TRUE(std::isfinite(r[m]));
+      sum += r[m];
+      sum2 += r[m] * r[m];
+    }
+  }
+  double mean = sum / (4 * n), var = sum2 / (4 * n) - mean * mean;
+  EXPECT_NEAR(mean, 0., .01);
+  EXPECT_NEAR(var, 1., .01);
+}
+
+// ======================================================================
+// RngStream
+
+TEST(Rng, RngStreamReproducible)
+{
+  RngStream a{RNG_COLLISION, 3, 1, 7, 11};
+  RngStream b{RNG_COLLISION, 3, 1, 7, 11};
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(a.uniform(), b.uniform());
+  }
+
+  // reset() starts the substream over
+  b.reset(7, 11);
+  RngStream c{RNG_COLLISION, 3, 1, 7, 11};
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(b.normal(), c.normal());
+  }
+}
+
+TEST(Rng, RngStreamIndependent)
+{
+  // changing any one of purpose, id, seed, step, cell gives other numbers
+  float ref = RngStream{RNG_COLLISION, 3, 1, 7, 11}.uniform();
+  EXPECT_NE(RngStream(RNG_HEATING, 3, 1, 7, 11).uniform(), ref);
+  EXPECT_NE(RngStream(RNG_COLLISION, 4, 1, 7, 11).uniform(), ref);
+  EXPECT_NE(RngStream(RNG_COLLISION, 3, 2, 7, 11).uniform(), ref);
+  EXPECT_NE(RngStream(RNG_COLLISION, 3, 1, 8, 11).uniform(), ref);
+  EXPECT_NE(RngStream(RNG_COLLISION, 3, 1, 7, 12).uniform(), ref);
+}
+
+TEST(Rng, RngStreamBatched)
+{
+  // batched draws give the same numbers as single draws, also when
+  // starting in the middle of a block of four
+  for (int n : {1, 3, 4, 9, 17}) {
+    RngStream a{RNG_SETUP_PARTICLES, 1}, b{RNG_SETUP_PARTICLES, 1};
+    a.uniform();
+    b.uniform();
+    a.normal();
+    b.normal();
+
+    std::vector<float> u(n), r(n);
+    a.uniform(u.data(), n);
+    a.normal(r.data(), n);
+    for (int i = 0; i < n; i++) {
+      EXPECT_EQ(u[i], b.uniform());
+    }
+    for (int i = 0; i < n; i++) {
+      EXPECT_EQ(r[i], b.normal());
+    }
+  }
+}
+
+TEST(Rng, RngStreamNormal4)
+{
+  // random access by draw index matches Philox4x32::normal4 with the
+  // documented counter / key layout
+  RngStream rng{RNG_HEATING, 5, 2, 9};
+  float r[4], ref[4];
+  rng.normal4(13, r);
+  Philox4x32::normal4({{13, 9, 0, RNG_HEATING}}, {{5, 2}}, ref);
+  for (int m = 0; m < 4; m++) {
+    EXPECT_EQ(r[m], ref[m]);
+  }
+}
+
+TEST(Rng, RngStreamUniform)
+{
+  const int n = 100000;
+  RngStream rng{RNG_PSC_RNG, 0};
+  std::vector<float> u(n);
+  rng.uniform(u.data(), n);
+  double sum = 0., sum2 = 0.;
+  for (auto val : u) {
+    EXPECT_GT(val, 0.f);
+    EXPECT_LE(val, 1.f);
+    sum += val;
+    sum2 += val * val;
+  }
+  double mean = sum / n, var = sum2 / n - mean * mean;
+  EXPECT_NEAR(mean, .5, .005);
+  EXPECT_NEAR(var, 1. / 12., .002);
+}
+
+TEST(Rng, PscRngNormal)
+{
+  const int n = 100000;
+  Rng rng;
+  rng.seed(3);
+  double sum = 0., sum2 = 0.;
+  for (int i = 0; i < n; i++) {
+    double r = rng.normal(1., 2.);
+    sum += r;
+    sum2 += r * r;
+  }
+  double mean = sum / n, var = sum2 / n - mean * mean;
+  EXPECT_NEAR(mean, 1., .03);
+  EXPECT_NEAR(var, 4., .06);
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
@@ -0,0 +1,187 @@
+
+#include <gtest/gtest.h>
+
+#include "../libpsc/vpic/vpic_config.h"
+#include "../libpsc/vpic/sort_vpic.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Grid = VpicConfigPsc::Grid;
+using Mparticles = VpicConfigPsc::Mparticles;
+using Species = Mparticles::Species;
+using Particle = Mparticles::Particle;
+using Sort = SortVpic<Mparticles>;
+
+// ======================================================================
+// SortVpicTest
+
+struct SortVpicTest : ::testing::Test
+{
+  static const int n_prts = 10000;
+
+  SortVpicTest()
+  {
+    double dx[3] = {1., 1., 1.};
+    double xl[3] = {0., 0., 0.};
+    double xh[3] = {8., 4., 4.};
+    int gdims[3] = {8, 4, 4};
+    vgrid_.setup(dx, .5, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, gdims, {1, 1, 1});
+  }
+
+  int random_voxel()
+  {
+    std::uniform_int_distribution<int> x(1, vgrid_.nx), y(1, vgrid_.ny),
+      z(1, vgrid_.nz);
+    return VOXEL(x(gen_), y(gen_), z(gen_), vgrid_.nx, vgrid_.ny, vgrid_.nz);
+  }
+
+  void init(Species& sp)
+  {
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    for (int n = 0; n < n_prts; n++) {
+      auto& prt = sp.p[n];
+      prt.dx = dist(gen_);
+      prt.dy = dist(gen_);
+      prt.dz = dist(gen_);
+      prt.i = random_voxel();
+      prt.ux = dist(gen_);
+      prt.uy = dist(gen_);
+      prt.uz = dist(gen_);
+      prt.w = n;
+    }
+    sp.np = n_prts;
+  }
+
+  // move every `every`-th particle to a random voxel
+  void perturb(Species& sp, int every)
+  {
+    for (int n = 0; n < sp.np; n += every) {
+      sp.p[n].i = random_voxel();
+    }
+  }
+
+  static std::vector<Particle> stable_sorted(const Species& sp)
+  {
+    std::vector<Particle> prts(sp.p, sp.p + sp.np);
+    std::stable_sort(
+      prts.begin(), prts.end(),
+      [](const Particle& a, const Particle& b) { return a.i < b.i; });
+    return prts;
+  }
+
+  // particles are sorted, partition matches, and they're the same particles
+  // as before (w is unique)
+  static void check_sorted(const Species& sp, std::vector<Particle> ref)
+  {
+    const int nv = sp.vgrid().nv;
+    for (int v = 0; v < nv; v++) {
+      ASSERT_LE(sp.partition[v], sp.partition[v + 1]);
+      for (int n = sp.partition[v]; n < sp.partition[v + 1]; n++) {
+        ASSERT_EQ(sp.p[n].i, v);
+      }
+    }
+    EXPECT_EQ(sp.partition[0], 0);
+    EXPECT_EQ(sp.partition[nv], sp.np);
+
+    std::vector<Particle> prts(sp.p, sp.p + sp.np);
+    auto by_w = [](const Particle& a, const Particle& b) { return a.w < b.w; };
+    std::sort(prts.begin(), prts.end(), by_w);
+    std::sort(ref.begin(), ref.end(), by_w);
+    ASSERT_EQ(prts.size(), ref.size());
+    EXPECT_EQ(memcmp(prts.data(), ref.data(), prts.size() * sizeof(Particle)),
+              0);
+  }
+
+  std::mt19937 gen_{1234};
+  Grid vgrid_;
+};
+
+// ----------------------------------------------------------------------
+// Counting
+//
+// the counting sort is stable
+
+TEST_F(SortVpicTest, Counting)
+{
+  Species sp("electron", -1., 1., n_prts, 1, 1, 0, &vgrid_);
+  init(sp);
+  auto ref = stable_sorted(sp);
+
+  Sort sort;
+  sort.sort_p(sp);
+  check_sorted(sp, ref);
+  EXPECT_EQ(memcmp(sp.p, ref.data(), n_prts * sizeof(Particle)), 0);
+}
+
+// ----------------------------------------------------------------------
+// InPlace
+//
+// re-sorting shortly after, with few particles out of order
+
+TEST_F(SortVpicTest, InPlace)
+{
+  Species sp("electron", -1., 1., n_prts, 1, 1, 0, &vgrid_);
+  init(sp);
+
+  Sort sort;
+  sort.sort_p(sp);
+  for (int every : {1000, 100, 31}) {
+    vgrid_.step++;
+    perturb(sp, every);
+    auto ref = stable_sorted(sp);
+    sort.sort_p(sp);
+    check_sorted(sp, ref);
+  }
+}
+
+// ----------------------------------------------------------------------
+// InPlaceFallback
+//
+// too many particles out of order to be worth it, so the in-place path
+// gives up and the counting sort takes over
+
+TEST_F(SortVpicTest, InPlaceFallback)
+{
+  Species sp("electron", -1., 1., n_prts, 1, 1, 0, &vgrid_);
+  init(sp);
+
+  Sort sort;
+  sort.sort_p(sp);
+  vgrid_.step++;
+  perturb(sp, 2);
+  auto ref = stable_sorted(sp);
+  sort.sort_p(sp);
+  check_sorted(sp, ref);
+}
+
+// ----------------------------------------------------------------------
+// Empty
+
+TEST_F(SortVpicTest, Empty)
+{
+  Species sp("electron", -1., 1., n_prts, 1, 1, 0, &vgrid_);
+
+  Sort sort;
+  sort.sort_p(sp);
+  vgrid_.step++;
+  sort.sort_p(sp);
+  check_sorted(sp, {});
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
+  MPI_Comm_rank(psc_comm_world, &psc_world_rank);
+  MPI_Comm_size(psc_comm_world, &psc_world_size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
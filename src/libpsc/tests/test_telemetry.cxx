@@ -0,0 +1,182 @@
+
+#include <gtest/gtest.h>
+
+#include "psc_telemetry.h"
+
+#include <mpi.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* filename = "test_telemetry.csv";
+static int rank, size;
+
+// ----------------------------------------------------------------------
+// read_csv
+//
+// returns the lines of a CSV file, split into fields
+
+static std::vector<std::vector<std::string>> read_csv(const std::string& name)
+{
+  std::vector<std::vector<std::string>> lines;
+  std::ifstream file(name);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields;
+    std::istringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+      fields.push_back(field);
+    }
+    if (!line.empty() && line.back() == ',') {
+      fields.push_back("");
+    }
+    lines.push_back(fields);
+  }
+  return lines;
+}
+
+static std::string rank_filename()
+{
+  char s[20];
+  sprintf(s, ".%06d", rank);
+  return filename + std::string(s);
+}
+
+// ----------------------------------------------------------------------
+// add_step
+//
+// what a rank would record during a step: quantities that depend on the
+// rank, and particles sent to its right neighbor (in two batches), to a
+// far away rank, and an empty send that shouldn't count as a neighbor
+
+static void add_step(int timestep)
+{
+  int r = rank;
+  psc_telemetry_add(TELEMETRY_PRTS, 100 * (r + 1));
+  psc_telemetry_add(TELEMETRY_PRTS_PUSHED, 50 * (r + 1));
+  psc_telemetry_add(TELEMETRY_TIME_PUSH, .5);
+  psc_telemetry_neighbor_send((r + 1) % size, 3, 30);
+  psc_telemetry_neighbor_send((r + 1) % size, 3, 30);
+  psc_telemetry_neighbor_send(1000, 10, 100);
+  psc_telemetry_neighbor_send(2000, 0, 0);
+  psc_telemetry_step(timestep);
+}
+
+// ----------------------------------------------------------------------
+// Disabled
+//
+// without psc_telemetry_open(), nothing is recorded or written
+
+TEST(Telemetry, Disabled)
+{
+  EXPECT_FALSE(psc_telemetry_enabled());
+  if (rank == 0) {
+    remove(filename);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  add_step(0);
+  EXPECT_FALSE(std::ifstream(filename).good());
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+// ----------------------------------------------------------------------
+// Steps
+
+TEST(Telemetry, Steps)
+{
+  // counters added while disabled don't show up later
+  psc_telemetry_add(TELEMETRY_PRTS, 1e6);
+
+  psc_telemetry_open(filename, true);
+  EXPECT_TRUE(psc_telemetry_enabled());
+  add_step(10);
+  // nothing added, so all counters need to have been reset
+  psc_telemetry_step(11);
+  psc_telemetry_close();
+  EXPECT_FALSE(psc_telemetry_enabled());
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  int r = rank;
+
+  // per rank: step,rank,<values>,bndp_sent_by_nei
+  auto lines = read_csv(rank_filename());
+  ASSERT_EQ(lines.size(), 3);
+  auto& header = lines[0];
+  ASSERT_EQ(header.size(), 2 + NR_TELEMETRY + 1);
+  EXPECT_EQ(header[0], "step");
+  EXPECT_EQ(header[1], "rank");
+  EXPECT_EQ(header[2 + TELEMETRY_PRTS], "prts");
+  EXPECT_EQ(header[2 + TELEMETRY_PEAK_RSS], "peak_rss_mib");
+  EXPECT_EQ(header.back(), "bndp_sent_by_nei");
+
+  auto& line = lines[1];
+  ASSERT_EQ(line.size(), header.size());
+  auto val = [&](int n) { return std::stod(line[2 + n]); };
+  EXPECT_EQ(line[0], "10");
+  EXPECT_EQ(std::stoi(line[1]), r);
+  EXPECT_EQ(val(TELEMETRY_PRTS), 100 * (r + 1));
+  EXPECT_EQ(val(TELEMETRY_PRTS_PUSHED), 50 * (r + 1));
+  EXPECT_EQ(val(TELEMETRY_PUSH_RATE), 100 * (r + 1));
+  EXPECT_EQ(val(TELEMETRY_BNDP_PRTS_SENT), 16);
+  EXPECT_EQ(val(TELEMETRY_BNDP_BYTES_SENT), 160);
+  EXPECT_EQ(val(TELEMETRY_BNDP_NEIGHBORS), 2);
+  EXPECT_EQ(val(TELEMETRY_BNDP_MAX_PRTS_NEI), 10);
+  EXPECT_GT(val(TELEMETRY_PEAK_RSS), 0.);
+  std::string nei = std::to_string((r + 1) % size) + ":6:60";
+  EXPECT_EQ(line.back(), nei + " 1000:10:100 2000:0:0");
+
+  auto& line2 = lines[2];
+  EXPECT_EQ(line2[0], "11");
+  for (int n = 0; n < NR_TELEMETRY; n++) {
+    if (n != TELEMETRY_PEAK_RSS) {
+      EXPECT_EQ(std::stod(line2[2 + n]), 0.) << header[2 + n];
+    }
+  }
+  EXPECT_EQ(line2.back(), "");
+
+  // aggregate, on rank 0: step,<name>_min,<name>_avg,<name>_max,...
+  if (r == 0) {
+    auto lines = read_csv(filename);
+    ASSERT_EQ(lines.size(), 3);
+    auto& header = lines[0];
+    ASSERT_EQ(header.size(), 1 + 3 * NR_TELEMETRY);
+    EXPECT_EQ(header[1 + 3 * TELEMETRY_PRTS], "prts_min");
+    EXPECT_EQ(header[2 + 3 * TELEMETRY_PRTS], "prts_avg");
+    EXPECT_EQ(header[3 + 3 * TELEMETRY_PRTS], "prts_max");
+
+    auto& line = lines[1];
+    ASSERT_EQ(line.size(), header.size());
+    auto val = [&](int n, int i) { return std::stod(line[1 + 3 * n + i]); };
+    EXPECT_EQ(line[0], "10");
+    EXPECT_EQ(val(TELEMETRY_PRTS, 0), 100);
+    EXPECT_EQ(val(TELEMETRY_PRTS, 1), 50 * (size + 1));
+    EXPECT_EQ(val(TELEMETRY_PRTS, 2), 100 * size);
+    EXPECT_EQ(val(TELEMETRY_PUSH_RATE, 0), 100);
+    EXPECT_EQ(val(TELEMETRY_PUSH_RATE, 2), 100 * size);
+    EXPECT_EQ(val(TELEMETRY_BNDP_NEIGHBORS, 0), 2);
+    EXPECT_EQ(val(TELEMETRY_BNDP_NEIGHBORS, 1), 2);
+    EXPECT_EQ(val(TELEMETRY_BNDP_NEIGHBORS, 2), 2);
+
+    EXPECT_EQ(lines[2][0], "11");
+    EXPECT_EQ(std::stod(lines[2][1 + 3 * TELEMETRY_PRTS + 2]), 0.);
+    remove(filename);
+  }
+  remove(rank_filename().c_str());
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+
+  MPI_Finalize();
+  return rc;
+}
@@ -2,12 +2,38 @@
 #ifndef GRID_LOOP_H
 #define GRID_LOOP_H
 
+#include "psc_vpic_bits.h"
+
+#include <algorithm>
+#include <cassert>
+#include <typeinfo>
+
+// ======================================================================
+// GridBox
+//
+// index box [lo, hi], which the foreach_* loops below can optionally be
+// clipped to
+
+struct GridBox
+{
+  int lo[3], hi[3];
+};
+
 // ======================================================================
 // foreach
 
 template <class F>
-static void foreach (F f, int ib, int ie, int jb, int je, int kb, int ke)
+static void foreach (F f, int ib, int ie, int jb, int je, int kb, int ke,
+                     const GridBox* clip = nullptr)
 {
+  if (clip) {
+    ib = std::max(ib, clip->lo[0]);
+    ie = std::min(ie, clip->hi[0]);
+    jb = std::max(jb, clip->lo[1]);
+    je = std::min(je, clip->hi[1]);
+    kb = std::max(kb, clip->lo[2]);
+    ke = std::min(ke, clip->hi[2]);
+  }
   for (int k = kb; k <= ke; k++) {
     for (int j = jb; j <= je; j++) {
       for (int i = ib; i <= ie; i++) {
@@ -18,25 +44,26 @@ static void foreach (F f, int ib, int ie, int jb, int je, int kb, int ke)
 };
 
 template <class Grid, class F>
-static void foreach_edge(const Grid& g, int Y, int Z, int face, F f)
+static void foreach_edge(const Grid& g, int Y, int Z, int face, F f,
+                         const GridBox* clip = nullptr)
 {
   if (Y == 1 && Z == 2) {
-    foreach (f, face, face, 1, g.ny, 1, g.nz + 1)
+    foreach (f, face, face, 1, g.ny, 1, g.nz + 1, clip)
       ;
   } else if (Y == 2 && Z == 1) {
-    foreach (f, face, face, 1, g.ny + 1, 1, g.nz)
+    foreach (f, face, face, 1, g.ny + 1, 1, g.nz, clip)
       ;
   } else if (Y == 2 && Z == 0) {
-    foreach (f, 1, g.nx + 1, face, face, 1, g.nz)
+    foreach (f, 1, g.nx + 1, face, face, 1, g.nz, clip)
       ;
   } else if (Y == 0 && Z == 2) {
-    foreach (f, 1, g.nx, face, face, 1, g.nz + 1)
+    foreach (f, 1, g.nx, face, face, 1, g.nz + 1, clip)
       ;
   } else if (Y == 0 && Z == 1) {
-    foreach (f, 1, g.nx, 1, g.ny + 1, face, face)
+    foreach (f, 1, g.nx, 1, g.ny + 1, face, face, clip)
       ;
   } else if (Y == 1 && Z == 0) {
-    foreach (f, 1, g.nx + 1, 1, g.ny, face, face)
+    foreach (f, 1, g.nx + 1, 1, g.ny, face, face, clip)
       ;
   } else {
     assert(0);
@@ -44,16 +71,17 @@ static void foreach_edge(const Grid& g, int Y, int Z, int face, F f)
 }
 
 template <class Grid, class F>
-static void foreach_node(const Grid& g, int X, int face, F f)
+static void foreach_node(const Grid& g, int X, int face, F f,
+                         const GridBox* clip = nullptr)
 {
   if (X == 0) {
-    foreach (f, face, face, 1, g.ny + 1, 1, g.nz + 1)
+    foreach (f, face, face, 1, g.ny + 1, 1, g.nz + 1, clip)
       ;
   } else if (X == 1) {
-    foreach (f, 1, g.nx + 1, face, face, 1, g.nz + 1)
+    foreach (f, 1, g.nx + 1, face, face, 1, g.nz + 1, clip)
       ;
   } else if (X == 2) {
-    foreach (f, 1, g.nx + 1, 1, g.ny + 1, face, face)
+    foreach (f, 1, g.nx + 1, 1, g.ny + 1, face, face, clip)
       ;
   } else {
     assert(0);
@@ -61,22 +89,52 @@ static void foreach_node(const Grid& g, int X, int face, F f)
 }
 
 template <class Grid, class F>
-static void foreach_face(const Grid& g, int X, int face, F f)
+static void foreach_face(const Grid& g, int X, int face, F f,
+                         const GridBox* clip = nullptr)
 {
   if (X == 0) {
-    foreach (f, face, face, 1, g.ny, 1, g.nz)
+    foreach (f, face, face, 1, g.ny, 1, g.nz, clip)
       ;
   } else if (X == 1) {
-    foreach (f, 1, g.nx, face, face, 1, g.nz)
+    foreach (f, 1, g.nx, face, face, 1, g.nz, clip)
       ;
   } else if (X == 2) {
-    foreach (f, 1, g.nx, 1, g.ny, face, face)
+    foreach (f, 1, g.nx, 1, g.ny, face, face, clip)
       ;
   } else {
     assert(0);
   }
 }
 
+// ----------------------------------------------------------------------
+// foreach_except
+//
+// loops over box, leaving out the points in skip, which has to be inside
+// box (or empty)
+
+template <class F>
+static void foreach_except(F f, const GridBox& box, const GridBox& skip)
+{
+  bool empty = false;
+  for (int d = 0; d < 3; d++) {
+    empty = empty || skip.lo[d] > skip.hi[d];
+  }
+
+  for (int k = box.lo[2]; k <= box.hi[2]; k++) {
+    for (int j = box.lo[1]; j <= box.hi[1]; j++) {
+      bool skip_row = !empty && k >= skip.lo[2] && k <= skip.hi[2] &&
+                      j >= skip.lo[1] && j <= skip.hi[1];
+      for (int i = box.lo[0]; i <= box.hi[0]; i++) {
+        if (skip_row && i == skip.lo[0]) {
+          i = skip.hi[0];
+          continue;
+        }
+        f(i, j, k);
+      }
+    }
+  }
+}
+
 template <class Grid, class F>
 static void foreach_nc_interior(F f, Grid& g)
 {
@@ -281,7 +339,9 @@ struct Comm
 
   // ----------------------------------------------------------------------
 
-  virtual void begin_send(int dir, int side, float* p, F3D& F) = 0;
+  // pack the data to be sent to the neighbor in direction (dir, side),
+  // returning the end of the packed data
+  virtual float* begin_send(int dir, int side, float* p, F3D& F) = 0;
   virtual void end_recv(int dir, int side, float* p, F3D& F) = 0;
 
   void begin_recv(int dir, int side)
@@ -359,10 +419,127 @@ struct Comm
     }
   }
 
+  // ----------------------------------------------------------------------
+  // reduce_begin / reduce_end
+  //
+  // For exchanges where begin_send() packs the shared nodes / edges on face
+  // nx + 1 (side 1) or 1 (side 0), and end_recv() adds the received values
+  // on the opposite face, this gives the same result as calling
+  // begin(dir) / end(dir) for one dir after the other, but with a single
+  // round trip rather than three: Rather than having the edge and corner
+  // contributions passed along from one dir to the next, they are exchanged
+  // directly with all 26 face, edge and corner neighbors at once. For an
+  // edge or corner neighbor, begin_send() / end_recv() are called for one of
+  // the faces involved, with clip_ restricting them to the shared edge or
+  // corner, so derived classes need to pass clip_ to the foreach_* loops.
+  //
+  // This uses persistent requests on the grid's Cartesian communicator,
+  // which are set up on first use. reduce_begin() returns a handle to be
+  // passed to reduce_end(); work that doesn't involve the shared boundary
+  // can be done in between.
+
+  struct ReduceHandle
+  {
+    typename Grid::Exchange* ex;
+  };
+
+  ReduceHandle reduce_begin(F3D& F)
+  {
+    auto& ex = g_.mp_exchange(typeid(*this).name());
+    if (!ex.is_setup()) {
+      reduce_setup(ex, F);
+    }
+
+    ex.start_recv();
+    for (int port = 0; port < 27; port++) {
+      if (ex.send_active(port)) {
+        GridBox box;
+        int X, side;
+        clip_ = reduce_clip(port, false, box, X, side);
+        float* p = ex.send_buf(port);
+        float* p_end = begin_send(X, side, p, F);
+        assert(p_end - p == ex.size(port));
+      }
+    }
+    clip_ = nullptr;
+    ex.start_send();
+
+    return {&ex};
+  }
+
+  void reduce_end(ReduceHandle handle, F3D& F)
+  {
+    auto& ex = *handle.ex;
+
+    ex.wait_recv();
+    for (int port = 0; port < 27; port++) {
+      if (ex.recv_active(port)) {
+        GridBox box;
+        int X, side;
+        clip_ = reduce_clip(port, true, box, X, side);
+        end_recv(X, side, ex.recv_buf(port), F);
+      }
+    }
+    clip_ = nullptr;
+    ex.wait_send();
+  }
+
+private:
+  // For the message going to the neighbor in the direction given by port
+  // (or, if recv, coming from the opposite one), find the face (X, side) to
+  // pack / unpack, and the clip box restricting it to the part shared with
+  // that neighbor. Returns nullptr for face neighbors, which don't need
+  // clipping.
+
+  const GridBox* reduce_clip(int port, bool recv, GridBox& box, int& X,
+                             int& side) const
+  {
+    int d[3] = {port % 3 - 1, (port / 3) % 3 - 1, port / 9 - 1};
+    assert(port == BOUNDARY(d[0], d[1], d[2]));
+
+    X = d[0] ? 0 : (d[1] ? 1 : 2);
+    side = d[X] > 0;
+    bool clipped = false;
+    for (int a = 0; a < 3; a++) {
+      if (a != X && d[a]) {
+        int plane = (d[a] > 0) != recv ? nx_[a] + 1 : 1;
+        box.lo[a] = box.hi[a] = plane;
+        clipped = true;
+      } else {
+        box.lo[a] = 0;
+        box.hi[a] = nx_[a] + 1;
+      }
+    }
+    return clipped ? &box : nullptr;
+  }
+
+  void reduce_setup(typename Grid::Exchange& ex, F3D& F)
+  {
+    // sizes of the messages by direction, given by packing them once.
+    // This assumes the neighbors' local domains are the same size, so that
+    // what we receive from direction -d is the same size as what we send
+    // in direction d.
+    int size[27] = {};
+    std::vector<float> buf;
+    for (int port = 0; port < 27; port++) {
+      if (port != BOUNDARY(0, 0, 0)) {
+        GridBox box;
+        int X, side;
+        clip_ = reduce_clip(port, false, box, X, side);
+        buf.resize(buf_size_[X]);
+        size[port] = begin_send(X, side, buf.data(), F) - buf.data();
+        assert(size[port] <= buf_size_[X]);
+      }
+    }
+    clip_ = nullptr;
+    g_.setup_exchange(ex, size);
+  }
+
 protected:
   int nx_[3];
   int buf_size_[3];
   Grid& g_;
+  const GridBox* clip_ = nullptr;
 };
 
 #endif
@@ -9,7 +9,7 @@ template <typename Mparticles, typename MfieldsState,
           typename MfieldsInterpolator, typename MfieldsHydro>
 struct NoneDiagMixin
 {
-  void diagnostics_init(int interval_) {}
+  void diagnostics_init(int interval_, int io_group_size = 0) {}
   void diagnostics_setup() {}
   void diagnostics_run(Mparticles& mprts, MfieldsState& mflds,
                        MfieldsInterpolator& interpolator,
@@ -47,9 +47,9 @@ struct PscAccumulatorOps
     float* RESTRICT a = reinterpret_cast<float*>(a_begin);
     const float* RESTRICT ALIGNED(16) b = a + sr;
 
-    float f[si];
-
+#pragma omp parallel for
     for (int i = 0; i < n; i++) {
+      float f[si];
       int j = i * si;
       for (int m = 0; m < si; m++) {
         f[m] = a[j + m];
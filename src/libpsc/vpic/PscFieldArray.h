@@ -42,6 +42,7 @@ struct PscAccumulateOps
     using Base::end;
 
     using Base::buf_size_;
+    using Base::clip_;
     using Base::g_;
     using Base::nx_;
 
@@ -53,24 +54,29 @@ struct PscAccumulateOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int Y = (X + 1) % 3, Z = (X + 2) % 3;
       int face = side ? nx_[X] + 1 : 1;
-      foreach_edge(g_, Y, Z, face,
-                   [&](int x, int y, int z) { *p++ = (&F(x, y, z).jfx)[Y]; });
-      foreach_edge(g_, Z, Y, face,
-                   [&](int x, int y, int z) { *p++ = (&F(x, y, z).jfx)[Z]; });
+      foreach_edge(
+        g_, Y, Z, face,
+        [&](int x, int y, int z) { *p++ = (&F(x, y, z).jfx)[Y]; }, clip_);
+      foreach_edge(
+        g_, Z, Y, face,
+        [&](int x, int y, int z) { *p++ = (&F(x, y, z).jfx)[Z]; }, clip_);
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
     {
       int Y = (X + 1) % 3, Z = (X + 2) % 3;
       int face = side ? 1 : nx_[X] + 1;
-      foreach_edge(g_, Y, Z, face,
-                   [&](int x, int y, int z) { (&F(x, y, z).jfx)[Y] += *p++; });
-      foreach_edge(g_, Z, Y, face,
-                   [&](int x, int y, int z) { (&F(x, y, z).jfx)[Z] += *p++; });
+      foreach_edge(
+        g_, Y, Z, face,
+        [&](int x, int y, int z) { (&F(x, y, z).jfx)[Y] += *p++; }, clip_);
+      foreach_edge(
+        g_, Z, Y, face,
+        [&](int x, int y, int z) { (&F(x, y, z).jfx)[Z] += *p++; }, clip_);
     }
   };
 
@@ -85,10 +91,8 @@ struct PscAccumulateOps
 
     LocalOps::local_adjust_jf(mflds);
 
-    for (int dir = 0; dir < 3; dir++) {
-      comm.begin(dir, F);
-      comm.end(dir, F);
-    }
+    auto handle = comm.reduce_begin(F);
+    comm.reduce_end(handle, F);
   }
 
   // ----------------------------------------------------------------------
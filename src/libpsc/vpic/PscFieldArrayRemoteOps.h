@@ -36,7 +36,7 @@ struct PscFieldArrayRemoteOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int Y = (X + 1) % 3, Z = (X + 2) % 3;
       int face = side ? nx_[X] : 1;
@@ -44,6 +44,7 @@ struct PscFieldArrayRemoteOps
                    [&](int x, int y, int z) { *p++ = (&F(x, y, z).cbx)[Y]; });
       foreach_edge(g_, Y, Z, face,
                    [&](int x, int y, int z) { *p++ = (&F(x, y, z).cbx)[Z]; });
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -98,11 +99,12 @@ struct PscFieldArrayRemoteOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int face = side ? nx_[X] : 1;
       foreach_node(g_, X, face,
                    [&](int x, int y, int z) { *p++ = (&F(x, y, z).ex)[X]; });
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -154,11 +156,12 @@ struct PscFieldArrayRemoteOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int face = side ? nx_[X] : 1;
       foreach_face(g_, X, face,
                    [&](int x, int y, int z) { *p++ = F(x, y, z).div_b_err; });
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -6,11 +6,94 @@
 #include "kg/Vec3.h"
 
 #include <array>
+#include <map>
+#include <string>
 #include <vector>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <mrc_common.h>
 
+// ======================================================================
+// PscMpExchange
+//
+// Persistent requests for exchanging messages with all 26 face, edge and
+// corner neighbors at once (see Comm::reduce_begin). Buffers and requests
+// are indexed by the direction (port) the message is going in.
+
+struct PscMpExchange
+{
+  PscMpExchange() = default;
+  PscMpExchange(const PscMpExchange&) = delete;
+  PscMpExchange& operator=(const PscMpExchange&) = delete;
+
+  ~PscMpExchange()
+  {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (finalized) {
+      return;
+    }
+    for (auto& req : recv_req_) {
+      MPI_Request_free(&req);
+    }
+    for (auto& req : send_req_) {
+      MPI_Request_free(&req);
+    }
+  }
+
+  bool is_setup() const { return is_setup_; }
+
+  void setup(MPI_Comm comm, const int size[27], const int dst[27],
+             const int src[27])
+  {
+    assert(!is_setup_);
+    for (int port = 0; port < 27; port++) {
+      size_[port] = size[port];
+      if (src[port] >= 0) {
+        recv_buf_[port].resize(size[port]);
+        recv_req_.emplace_back();
+        MPI_Recv_init(recv_buf_[port].data(), size[port], MPI_FLOAT,
+                      src[port], port, comm, &recv_req_.back());
+      }
+      if (dst[port] >= 0) {
+        send_buf_[port].resize(size[port]);
+        send_req_.emplace_back();
+        MPI_Send_init(send_buf_[port].data(), size[port], MPI_FLOAT,
+                      dst[port], port, comm, &send_req_.back());
+      }
+    }
+    is_setup_ = true;
+  }
+
+  int size(int port) const { return size_[port]; }
+  bool recv_active(int port) const { return !recv_buf_[port].empty(); }
+  bool send_active(int port) const { return !send_buf_[port].empty(); }
+  float* recv_buf(int port) { return recv_buf_[port].data(); }
+  float* send_buf(int port) { return send_buf_[port].data(); }
+
+  void start_recv() { MPI_Startall(recv_req_.size(), recv_req_.data()); }
+  void start_send() { MPI_Startall(send_req_.size(), send_req_.data()); }
+
+  void wait_recv()
+  {
+    MPI_Waitall(recv_req_.size(), recv_req_.data(), MPI_STATUSES_IGNORE);
+  }
+
+  void wait_send()
+  {
+    MPI_Waitall(send_req_.size(), send_req_.data(), MPI_STATUSES_IGNORE);
+  }
+
+private:
+  bool is_setup_ = false;
+  int size_[27] = {};
+  std::array<std::vector<float>, 27> recv_buf_;
+  std::array<std::vector<float>, 27> send_buf_;
+  std::vector<MPI_Request> recv_req_;
+  std::vector<MPI_Request> send_req_;
+};
+
 // ======================================================================
 // PscMp
 
@@ -51,6 +134,7 @@ struct PscMp
   std::vector<std::vector<char>> send_buf_;
   std::vector<MPI_Request> recv_req_;
   std::vector<MPI_Request> send_req_;
+  std::map<std::string, PscMpExchange> exchanges_;
 };
 
 // ======================================================================
@@ -58,6 +142,8 @@ struct PscMp
 
 struct PscGridBase
 {
+  using Exchange = PscMpExchange;
+
   enum
   {
     anti_symmetric_fields = -1, // E_tang = 0
@@ -82,10 +168,12 @@ struct PscGridBase
     }
     bc[BOUNDARY(0, 0, 0)] = psc_world_rank;
     mp = new PscMp(27);
+    cart_comm = MPI_COMM_NULL;
   }
 
   ~PscGridBase()
   {
+    free_cart_comm();
     delete[] neighbor;
     delete[] range;
     delete mp;
@@ -323,6 +411,42 @@ struct PscGridBase
     join_grid(BOUNDARY(1, 0, 0), idx_to_rank(np, {px + 1, py, pz}));
     join_grid(BOUNDARY(0, 1, 0), idx_to_rank(np, {px, py + 1, pz}));
     join_grid(BOUNDARY(0, 0, 1), idx_to_rank(np, {px, py, pz + 1}));
+
+    // Cartesian communicator, and the edge and corner neighbors from it,
+    // for exchanging with all 26 neighbors at once. MPI orders ranks with
+    // the last dimension varying fastest, so dims / coords are z, y, x.
+    free_cart_comm();
+    int dims[3] = {np[2], np[1], np[0]}, periods[3] = {1, 1, 1};
+    MPI_Cart_create(psc_comm_world, 3, dims, periods, 0, &cart_comm);
+    for (int k = -1; k <= 1; k++) {
+      for (int j = -1; j <= 1; j++) {
+        for (int i = -1; i <= 1; i++) {
+          if (std::abs(i) + std::abs(j) + std::abs(k) >= 2) {
+            int coords[3] = {pz + k, py + j, px + i};
+            MPI_Cart_rank(cart_comm, coords, &bc[BOUNDARY(i, j, k)]);
+          }
+        }
+      }
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // neighbor_rank
+  //
+  // rank of the face, edge or corner neighbor at offset (i, j, k), or -1 if
+  // there isn't one, ie., if in any of the directions involved, the domain
+  // boundary is not a comm boundary
+
+  int neighbor_rank(int i, int j, int k) const
+  {
+    auto is_rank = [](int bc) { return bc >= 0 && bc < psc_world_size; };
+    if ((i && !is_rank(bc[BOUNDARY(i, 0, 0)])) ||
+        (j && !is_rank(bc[BOUNDARY(0, j, 0)])) ||
+        (k && !is_rank(bc[BOUNDARY(0, 0, k)]))) {
+      return -1;
+    }
+    assert(is_rank(bc[BOUNDARY(i, j, k)]));
+    return bc[BOUNDARY(i, j, k)];
   }
 
   void set_fbc(int boundary, int fbc)
@@ -392,6 +516,37 @@ struct PscGridBase
 
   void mp_end_send(int port) { mp->end_send(port); }
 
+  // ----------------------------------------------------------------------
+  // for exchanging with all 26 neighbors at once
+
+  Exchange& mp_exchange(const std::string& key) { return mp->exchanges_[key]; }
+
+  // set up ex for messages of size[port] floats going in direction port,
+  // both to our neighbor in that direction and from the opposite one
+  void setup_exchange(Exchange& ex, const int size[27])
+  {
+    assert(cart_comm != MPI_COMM_NULL);
+    int dst[27], src[27];
+    for (int port = 0; port < 27; port++) {
+      int i = port % 3 - 1, j = (port / 3) % 3 - 1, k = port / 9 - 1;
+      bool self = port == BOUNDARY(0, 0, 0);
+      dst[port] = self ? -1 : neighbor_rank(i, j, k);
+      src[port] = self ? -1 : neighbor_rank(-i, -j, -k);
+    }
+    ex.setup(cart_comm, size, dst, src);
+  }
+
+  void free_cart_comm()
+  {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (cart_comm != MPI_COMM_NULL && !finalized) {
+      // requests on cart_comm need to go first
+      mp->exchanges_.clear();
+      MPI_Comm_free(&cart_comm);
+    }
+  }
+
   // ----------------------------------------------------------------------
   // for field communications
 
@@ -498,6 +653,7 @@ struct PscGridBase
 
   // Nearest neighbor communications ports
   PscMp* mp;
+  MPI_Comm cart_comm; // Cartesian communicator over the domain decomposition
 };
 
 #endif
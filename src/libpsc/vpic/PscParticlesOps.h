@@ -2,6 +2,12 @@
 #pragma once
 
 #include "psc_vpic_bits.h"
+#include "particles_simd.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
 
 #ifdef USE_VPIC
 #define HAS_V4_PIPELINE
@@ -425,6 +431,77 @@ struct PscParticlesOps
     int n_ignored; // Number of movers ignored
   } particle_mover_seg_t;
 
+  // ----------------------------------------------------------------------
+  // advance_p_move
+  //
+  // Second half of the particle advance, given the normalized displacement:
+  // If the particle stays inside its voxel, update its position and deposit
+  // its current, otherwise, hand it off to move_p.
+
+  static void advance_p_move(Particle* ALIGNED(128) p0, Particle* p, float ux,
+                             float uy, float uz, AccumulatorBlock& acc_block,
+                             const Grid& g, float qsp,
+                             ParticleMover* ALIGNED(16) pm, int max_nm,
+                             int& nm, int& n_ignored)
+  {
+    const float one = 1.;
+    const float one_third = 1. / 3.;
+
+    float dx = p->dx, dy = p->dy, dz = p->dz, q = p->w;
+    float v0, v1, v2, v3, v4, v5;
+    float* ALIGNED(16) a;
+
+    v0 = dx + ux; // Streak midpoint (inbnds)
+    v1 = dy + uy;
+    v2 = dz + uz;
+    v3 = v0 + ux; // New position
+    v4 = v1 + uy;
+    v5 = v2 + uz;
+
+    // FIXME-KJB: COULD SHORT CIRCUIT ACCUMULATION IN THE CASE WHERE QSP==0!
+    if (v3 <= one && v4 <= one && v5 <= one && // Check if inbnds
+        -v3 <= one && -v4 <= one && -v5 <= one) {
+
+      // Common case (inbnds).  Note: accumulator values are 4 times
+      // the total physical charge that passed through the appropriate
+      // current quadrant in a time-step
+
+      q *= qsp;
+      p->dx = v3; // Store new position
+      p->dy = v4;
+      p->dz = v5;
+      dx = v0; // Streak midpoint
+      dy = v1;
+      dz = v2;
+      v5 = q * ux * uy * uz * one_third; // Compute correction
+      a = (float*)&acc_block[p->i];      // Get accumulator
+
+      ACCUMULATE_J(u, d, x, y, z, 0);
+      ACCUMULATE_J(u, d, y, z, x, 4);
+      ACCUMULATE_J(u, d, z, x, y, 8);
+
+    } else { // Unlikely
+      DECLARE_ALIGNED_ARRAY(ParticleMover, 16, local_pm, 1);
+      local_pm->dispx = ux;
+      local_pm->dispy = uy;
+      local_pm->dispz = uz;
+      local_pm->i = p - p0;
+
+      if (move_p(p0, local_pm, acc_block, g, qsp)) { // Unlikely
+        if (nm < max_nm) {
+          pm[nm++] = local_pm[0];
+        } else {
+          n_ignored++; // Unlikely
+        }              // if
+      }                // if
+    }
+  }
+
+#undef ACCUMULATE_J
+
+  // ----------------------------------------------------------------------
+  // advance_p_pipeline
+
   static void advance_p_pipeline(typename Mparticles::Species& sp,
                                  AccumulatorBlock acc_block,
                                  MfieldsInterpolator& interpolator,
@@ -437,7 +514,6 @@ struct PscParticlesOps
     auto& ip = interpolator.getPatch(0);
 
     const typename MfieldsInterpolator::Element* ALIGNED(16) f;
-    float* ALIGNED(16) a;
 
     const float qdt_2mc = (sp.q * g.dt) / (2 * sp.m * g.cvac);
     const float cdt_dx = g.cvac * g.dt * g.rdx;
@@ -449,14 +525,12 @@ struct PscParticlesOps
     const float one_third = 1. / 3.;
     const float two_fifteenths = 2. / 15.;
 
-    float dx, dy, dz, ux, uy, uz, q;
+    float dx, dy, dz, ux, uy, uz;
     float hax, hay, haz, cbx, cby, cbz;
-    float v0, v1, v2, v3, v4, v5;
+    float v0, v1, v2, v3, v4;
 
     int ii;
 
-    DECLARE_ALIGNED_ARRAY(ParticleMover, 16, local_pm, 1);
-
     int nm = 0;
     int n_ignored = 0;
 
@@ -480,7 +554,6 @@ struct PscParticlesOps
       ux = p->ux; // Load momentum
       uy = p->uy;
       uz = p->uz;
-      q = p->w;
       ux += hax; // Half advance E
       uy += hay;
       uz += haz;
@@ -511,50 +584,67 @@ struct PscParticlesOps
       ux *= v0;
       uy *= v0;
       uz *= v0;
-      v0 = dx + ux; // Streak midpoint (inbnds)
-      v1 = dy + uy;
-      v2 = dz + uz;
-      v3 = v0 + ux; // New position
-      v4 = v1 + uy;
-      v5 = v2 + uz;
-
-      // FIXME-KJB: COULD SHORT CIRCUIT ACCUMULATION IN THE CASE WHERE QSP==0!
-      if (v3 <= one && v4 <= one && v5 <= one && // Check if inbnds
-          -v3 <= one && -v4 <= one && -v5 <= one) {
-
-        // Common case (inbnds).  Note: accumulator values are 4 times
-        // the total physical charge that passed through the appropriate
-        // current quadrant in a time-step
-
-        q *= qsp;
-        p->dx = v3; // Store new position
-        p->dy = v4;
-        p->dz = v5;
-        dx = v0; // Streak midpoint
-        dy = v1;
-        dz = v2;
-        v5 = q * ux * uy * uz * one_third; // Compute correction
-        a = (float*)&acc_block[ii];        // Get accumulator
-
-        ACCUMULATE_J(u, d, x, y, z, 0);
-        ACCUMULATE_J(u, d, y, z, x, 4);
-        ACCUMULATE_J(u, d, z, x, y, 8);
 
-#undef ACCUMULATE_J
+      advance_p_move(p0, p, ux, uy, uz, acc_block, g, qsp, pm, max_nm, nm,
+                     n_ignored);
+    }
+
+    seg->nm = nm;
+    seg->n_ignored = n_ignored;
+  }
+
+  // ----------------------------------------------------------------------
+  // advance_p_pipeline_simd
+  //
+  // Same as advance_p_pipeline, but with the momentum update done by the
+  // 8- or 16-wide kernels from particles_simd.h. Particles are then moved /
+  // deposited one by one in the original order, so the results are bit-for-bit
+  // the same as the scalar pipeline, as long as that is compiled with
+  // -ffp-contract=off like the kernels. n needs to be a multiple of the width.
+
+  static void advance_p_pipeline_simd(typename Mparticles::Species& sp,
+                                      AccumulatorBlock acc_block,
+                                      MfieldsInterpolator& interpolator,
+                                      particle_mover_seg_t* seg,
+                                      Particle* ALIGNED(128) p, int n,
+                                      ParticleMover* ALIGNED(16) pm,
+                                      int max_nm, int width)
+  {
+    static_assert(sizeof(Particle) == 8 * sizeof(float),
+                  "particles_simd.h expects PscParticle layout");
+    static_assert(sizeof(typename MfieldsInterpolator::Element) %
+                      sizeof(float) ==
+                    0,
+                  "particles_simd.h expects PscInterpolatorT layout");
+
+    const int chunk = 256;
+    Particle* ALIGNED(128) p0 = sp.p;
+    const auto& g = sp.vgrid();
+    auto& ip = interpolator.getPatch(0);
+    const int ip_stride =
+      sizeof(typename MfieldsInterpolator::Element) / sizeof(float);
+
+    const float qdt_2mc = (sp.q * g.dt) / (2 * sp.m * g.cvac);
+    const float cdt_dx = g.cvac * g.dt * g.rdx;
+    const float cdt_dy = g.cvac * g.dt * g.rdy;
+    const float cdt_dz = g.cvac * g.dt * g.rdz;
+    const float qsp = sp.q;
 
-      } else { // Unlikely
-        local_pm->dispx = ux;
-        local_pm->dispy = uy;
-        local_pm->dispz = uz;
-        local_pm->i = p - p0;
-
-        if (move_p(p0, local_pm, acc_block, g, qsp)) { // Unlikely
-          if (nm < max_nm) {
-            pm[nm++] = local_pm[0];
-          } else {
-            n_ignored++; // Unlikely
-          }              // if
-        }                // if
+    float dispx[chunk], dispy[chunk], dispz[chunk];
+
+    int nm = 0;
+    int n_ignored = 0;
+
+    assert(n % width == 0);
+    for (int n_done = 0; n_done < n; n_done += chunk) {
+      int cnt = std::min(chunk, n - n_done);
+      auto push = width == 16 ? advance_p_push_v16 : advance_p_push_v8;
+      push(reinterpret_cast<float*>(p), cnt,
+           reinterpret_cast<const float*>(ip.data()), ip_stride, qdt_2mc,
+           cdt_dx, cdt_dy, cdt_dz, dispx, dispy, dispz);
+      for (int i = 0; i < cnt; i++, p++) {
+        advance_p_move(p0, p, dispx[i], dispy[i], dispz[i], acc_block, g, qsp,
+                       pm, max_nm, nm, n_ignored);
       }
     }
 
@@ -752,38 +842,75 @@ struct PscParticlesOps
 
 #endif
 
+  static void advance_p_pipeline_(typename Mparticles::Species& sp,
+                                  AccumulatorBlock acc_block,
+                                  MfieldsInterpolator& interpolator,
+                                  particle_mover_seg_t* seg,
+                                  Particle* ALIGNED(128) p, int n,
+                                  ParticleMover* ALIGNED(16) pm, int max_nm)
+  {
+    int width = psc_vpic_simd_width();
+    if (width > 1) {
+      advance_p_pipeline_simd(sp, acc_block, interpolator, seg, p, n, pm,
+                              max_nm, width);
+      return;
+    }
+#if defined(V4_ACCELERATION) && defined(HAS_V4_PIPELINE)
+    advance_p_pipeline_v4(sp, acc_block, interpolator, seg, p, n, pm, max_nm);
+#else
+    advance_p_pipeline(sp, acc_block, interpolator, seg, p, n, pm, max_nm);
+#endif
+  }
+
+  // The bulk of the particles (in blocks of 16) is split across
+  // accumulator.n_pipeline() pipelines, which run concurrently, each one
+  // depositing into its own accumulator block and keeping its movers in its
+  // own segment of sp.pm. The remaining particles are then done by one more
+  // pipeline, using the last accumulator block. Summing up the blocks is left
+  // to AccumulatorOps::reduce().
+
   static void advance_p(typename Mparticles::Species& sp,
                         MfieldsAccumulator& accumulator,
                         MfieldsInterpolator& interpolator)
   {
-    DECLARE_ALIGNED_ARRAY(particle_mover_seg_t, 128, seg, 1);
+    const int n_pipeline = accumulator.n_pipeline();
+    std::vector<particle_mover_seg_t> seg(n_pipeline + 1);
+
+    int n_blocks = sp.np / 16;
+    int max_nm = sp.max_nm / n_pipeline;
+
+#pragma omp parallel for
+    for (int r = 0; r < n_pipeline; r++) {
+      int ib = n_blocks * r / n_pipeline, ie = n_blocks * (r + 1) / n_pipeline;
+      advance_p_pipeline_(sp, accumulator[r], interpolator, &seg[r],
+                          sp.p + 16 * ib, 16 * (ie - ib), sp.pm + r * max_nm,
+                          max_nm);
+    }
 
+    // compact the movers
     sp.nm = 0;
+    for (int r = 0; r < n_pipeline; r++) {
+      if (seg[r].n_ignored) {
+        LOG_WARN("Pipeline %i ran out of storage for %i movers", r,
+                 seg[r].n_ignored);
+      }
+      if (sp.nm != r * max_nm) {
+        memmove(sp.pm + sp.nm, sp.pm + r * max_nm,
+                seg[r].nm * sizeof(*sp.pm));
+      }
+      sp.nm += seg[r].nm;
+    }
 
-    Particle* p = sp.p;
-    int n = sp.np & ~15;
-#if defined(V4_ACCELERATION) && defined(HAS_V4_PIPELINE)
-    advance_p_pipeline_v4(sp, accumulator[1], interpolator, seg, p, n,
-                          sp.pm + sp.nm, sp.max_nm - sp.nm);
-#else
-    advance_p_pipeline(sp, accumulator[1], interpolator, seg, p, n,
-                       sp.pm + sp.nm, sp.max_nm - sp.nm);
-#endif
-    sp.nm += seg->nm;
-
-    if (seg->n_ignored)
-      LOG_WARN("Pipeline %i ran out of storage for %i movers", 0,
-               seg->n_ignored);
-
-    p += n;
-    n = sp.np - n;
-    advance_p_pipeline(sp, accumulator[0], interpolator, seg, p, n,
-                       sp.pm + sp.nm, sp.max_nm - sp.nm);
-    sp.nm += seg->nm;
+    int n = 16 * n_blocks;
+    advance_p_pipeline(sp, accumulator[n_pipeline], interpolator,
+                       &seg[n_pipeline], sp.p + n, sp.np - n, sp.pm + sp.nm,
+                       sp.max_nm - sp.nm);
+    sp.nm += seg[n_pipeline].nm;
 
-    if (seg->n_ignored)
-      LOG_WARN("Pipeline %i ran out of storage for %i movers", 1,
-               seg->n_ignored);
+    if (seg[n_pipeline].n_ignored) {
+      LOG_WARN("Pipeline %i ran out of storage for %i movers", n_pipeline,
+               seg[n_pipeline].n_ignored);
+    }
   }
 
   static void advance_p(Mparticles& mprts, MfieldsAccumulator& accumulator,
@@ -1413,14 +1540,38 @@ struct PscParticlesOps
 
 #endif
 
+  // same as uncenter_p_pipeline, using the 8- or 16-wide kernel
+  static void uncenter_p_pipeline_simd(Species* sp,
+                                       MfieldsInterpolator& interpolator,
+                                       int off, int cnt, int width)
+  {
+    const auto& g = sp->vgrid();
+    auto& ip = interpolator.getPatch(0);
+    const int ip_stride =
+      sizeof(typename MfieldsInterpolator::Element) / sizeof(float);
+    const float qdt_2mc = -(sp->q * g.dt) / (2 * sp->m * g.cvac);
+    const float qdt_4mc = 0.5 * qdt_2mc;
+
+    assert(cnt % width == 0);
+    auto push = width == 16 ? uncenter_p_push_v16 : uncenter_p_push_v8;
+    push(reinterpret_cast<float*>(sp->p + off), cnt,
+         reinterpret_cast<const float*>(ip.data()), ip_stride, qdt_2mc,
+         qdt_4mc);
+  }
+
   static void uncenter_p(Species* sp, MfieldsInterpolator& interpolator)
   {
     int cnt = sp->np & ~15;
+    int width = psc_vpic_simd_width();
+    if (width > 1) {
+      uncenter_p_pipeline_simd(sp, interpolator, 0, cnt, width);
+    } else {
 #if defined(V4_ACCELERATION) && defined(HAS_V4_PIPELINE)
-    uncenter_p_pipeline_v4(sp, interpolator, 0, cnt);
+      uncenter_p_pipeline_v4(sp, interpolator, 0, cnt);
 #else
-    uncenter_p_pipeline(sp, interpolator, 0, cnt);
+      uncenter_p_pipeline(sp, interpolator, 0, cnt);
 #endif
+    }
     uncenter_p_pipeline(sp, interpolator, cnt, sp->np - cnt);
   }
 
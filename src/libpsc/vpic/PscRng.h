@@ -2,43 +2,57 @@
 #ifndef PSC_RNG_H
 #define PSC_RNG_H
 
-#include <random>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include "mrc_common.h"
 #include "psc_vpic_bits.h"
+#include "rng_philox.hxx"
 
 // ======================================================================
 // PscRng
+//
+// draws from the RNG_PSC_RNG stream, keyed by the seed, which PscRngPool
+// makes unique per rank
 
 struct PscRng
 {
-  typedef std::mt19937 Urng;
-  typedef std::uniform_real_distribution<double> Uniform;
-  typedef std::normal_distribution<double> Normal;
-
   static PscRng* create() { return new PscRng; }
 
-  void seed(unsigned int seed) { urng_.seed(seed); }
-  unsigned int operator()() { return urng_(); }
-  static constexpr unsigned int min() { return Urng::min(); }
-  static constexpr unsigned int max() { return Urng::max(); }
+  void seed(unsigned int seed)
+  {
+    stream_ = RngStream{RNG_PSC_RNG, seed};
+    has_normal_ = false;
+  }
+  unsigned int operator()() { return stream_.bits(); }
+  static constexpr unsigned int min() { return 0; }
+  static constexpr unsigned int max() { return UINT32_MAX; }
 
+  // in [lo, hi)
   double uniform(double lo, double hi)
   {
-    Uniform::param_type prm(lo, hi);
-    return uniform_(urng_, prm);
+    return lo + (hi - lo) * (1. - stream_.uniform_double());
   }
 
+  // Box-Muller in double precision, keeping the second deviate for the next
+  // call
   double normal(double mu, double sigma)
   {
-    Normal::param_type prm(mu, sigma);
-    return normal_(urng_, prm);
+    if (has_normal_) {
+      has_normal_ = false;
+      return mu + sigma * normal_;
+    }
+    double rad = std::sqrt(-2. * std::log(stream_.uniform_double()));
+    double phi = 2. * M_PI * stream_.uniform_double();
+    normal_ = rad * std::sin(phi);
+    has_normal_ = true;
+    return mu + sigma * rad * std::cos(phi);
   }
 
 private:
-  Urng urng_;
-  Uniform uniform_;
-  Normal normal_;
+  RngStream stream_{RNG_PSC_RNG, 0};
+  double normal_;
+  bool has_normal_ = false;
 };
 
 // ======================================================================
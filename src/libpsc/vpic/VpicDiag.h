@@ -6,6 +6,14 @@
 #include "util/io/FileUtils.h"
 #include "vpic/dumpmacros.h"
 
+#include "dump_aggregated.hxx"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 // ----------------------------------------------------------------------
 // VpicDiag
 
@@ -20,6 +28,12 @@ struct VpicDiag
   int Hparticle_interval;
   int restart_interval;
 
+  // aggregated output: if > 0, ranks are grouped io_group_size at a time,
+  // and each group writes a single file per dump, rather than one file per
+  // rank
+  int io_group_size = 0;
+  MPI_Comm io_comm = MPI_COMM_NULL;
+
   // state
   int rtoggle; // enables save of last 2 restart dumps for safety
   // Output variables
@@ -122,9 +136,19 @@ struct VpicDiagMixin
 {
   using Grid = typename Mparticles::Grid;
 
-  void diagnostics_init(int interval_)
+  ~VpicDiagMixin()
+  {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (diag_.io_comm != MPI_COMM_NULL && !finalized) {
+      MPI_Comm_free(&diag_.io_comm);
+    }
+  }
+
+  void diagnostics_init(int interval_, int io_group_size = 0)
   {
     diag_.rtoggle = 0;
+    diag_.io_group_size = io_group_size;
 
     diag_.interval = interval_;
     diag_.fields_interval = interval_;
@@ -139,10 +163,17 @@ struct VpicDiagMixin
     MPI_Comm comm = MPI_COMM_WORLD;
     mpi_printf(comm, "interval = %d\n", diag_.interval);
     mpi_printf(comm, "energies_interval: %d\n", diag_.energies_interval);
+    mpi_printf(comm, "io_group_size: %d\n", diag_.io_group_size);
   }
 
   void diagnostics_setup()
   {
+    if (diag_.io_group_size > 0) {
+      MPI_Comm_split(psc_comm_world, psc_world_rank / diag_.io_group_size,
+                     psc_world_rank, &diag_.io_comm);
+      sim_log("Aggregated output, ranks per file = " << diag_.io_group_size);
+    }
+
     diag_.fdParams.format = band;
     sim_log("Fields output format = band");
 
@@ -230,7 +261,7 @@ struct VpicDiagMixin
   {
     TIC
     {
-      const Grid* g = mflds.vgrid();
+      const Grid* g = &mflds.vgrid();
       int64_t step = g->step;
 
       // Normal rundata dump
@@ -262,11 +293,40 @@ struct VpicDiagMixin
 
       // Species moment output
 
-      if (should_dump(ehydro))
-        hydro_dump(mprts, interpolator, mflds_hydro, "electron",
-                   diag_.hedParams);
-      if (should_dump(Hhydro))
-        hydro_dump(mprts, interpolator, mflds_hydro, "ion", diag_.hHdParams);
+      // electron and ion moments are accumulated in a single pass, into
+      // mflds_hydro and ion_hydro_, respectively
+
+      bool dump_ehydro = should_dump(ehydro);
+      bool dump_Hhydro = should_dump(Hhydro);
+      if (dump_ehydro || dump_Hhydro) {
+        if (!ion_hydro_) {
+          ion_hydro_.reset(
+            new MfieldsHydro{mprts.grid(), mflds_hydro.vgrid()});
+        }
+        std::vector<MfieldsHydro*> hydros;
+        std::vector<const typename Mparticles::Species*> species;
+        if (dump_ehydro) {
+          hydros.push_back(&mflds_hydro);
+          species.push_back(&find_species(mprts, "electron"));
+        }
+        if (dump_Hhydro) {
+          hydros.push_back(ion_hydro_.get());
+          species.push_back(&find_species(mprts, "ion"));
+        }
+
+        for (auto hydro : hydros) {
+          HydroArrayOps::clear(*hydro);
+        }
+        hydro_ops_.accumulate_hydro_p(hydros, species, interpolator);
+        for (auto hydro : hydros) {
+          HydroArrayOps::synchronize(*hydro);
+        }
+
+        if (dump_ehydro)
+          hydro_dump(mflds_hydro, *species.front(), diag_.hedParams);
+        if (dump_Hhydro)
+          hydro_dump(*ion_hydro_, *species.back(), diag_.hHdParams);
+      }
 
 #if 0
       if(step && !(step % diag->restart_interval)) {
@@ -281,25 +341,17 @@ struct VpicDiagMixin
       } // if
 #endif
 
-        // Dump particle data
+      // Dump particle data
 
-#if 0
-      char subdir[36];
-      if ( should_dump(eparticle) && step !=0
-	   && step > 56*(diag->fields_interval)  ) {
-	// if ( should_dump(eparticle) && step !=0 ) {
-	sprintf(subdir,"particle/T.%lld",step);
-	dump_mkdir(subdir);
-	sprintf(subdir,"particle/T.%lld/eparticle",step);
-	simulation->dump_particles("electron", subdir);
+      if (should_dump(eparticle) && step != 0 &&
+          step > 56 * (diag_.fields_interval)) {
+        particle_dump(find_species(mprts, "electron"), "eparticle", step);
       }
 
-      if ( should_dump(Hparticle) && step !=0
-	   && step > 56*(diag->fields_interval)  ) {
-	sprintf(subdir,"particle/T.%lld/Hparticle",step);
-	simulation->dump_particles("ion", subdir);
+      if (should_dump(Hparticle) && step != 0 &&
+          step > 56 * (diag_.fields_interval)) {
+        particle_dump(find_species(mprts, "ion"), "Hparticle", step);
       }
-#endif
     }
     TOC(user_diagnostics, 1);
   }
@@ -413,6 +465,11 @@ struct VpicDiagMixin
     print_hashed_comment(fileIO, "Domain partitions in z-dimension");
     fileIO.print("GRID_TOPOLOGY_Z %d\n\n", np[2]);
 
+    if (diag_.io_group_size > 0) {
+      print_hashed_comment(fileIO, "Ranks per aggregated data file");
+      fileIO.print("DATA_AGGREGATION_GROUP_SIZE %d\n\n", diag_.io_group_size);
+    }
+
     // Global data information
     assert(dumpParams.size() >= 2);
 
@@ -488,7 +545,7 @@ struct VpicDiagMixin
                      MfieldsState& mflds, MfieldsInterpolator& interpolator)
   {
     double en_f[6], en_p;
-    const Grid* g = mflds.vgrid();
+    const Grid* g = &mflds.vgrid();
     FileIO fileIO;
     FileIOStatus status(fail);
 
@@ -504,7 +561,7 @@ struct VpicDiagMixin
       else {
         if (append == 0) {
           fileIO.print("%% Layout\n%% step ex ey ez bx by bz");
-          for (auto& sp : mprts) {
+          for (auto& sp : mprts[0]) {
             fileIO.print(" \"%s\"", sp.name);
           }
           fileIO.print("\n");
@@ -519,7 +576,7 @@ struct VpicDiagMixin
       fileIO.print(" %e %e %e %e %e %e", en_f[0], en_f[1], en_f[2], en_f[3],
                    en_f[4], en_f[5]);
 
-    for (auto& sp : mprts) {
+    for (auto& sp : mprts[0]) {
       en_p = ParticlesOps::energy_p(sp, interpolator);
       if (rank == 0 && status != fail)
         fileIO.print(" %e", en_p);
@@ -537,30 +594,34 @@ struct VpicDiagMixin
 
   void field_dump(MfieldsState& mflds, DumpParameters& dumpParams)
   {
-    const Grid* grid = mflds.vgrid();
+    const Grid* grid = &mflds.vgrid();
+
+    if (diag_.io_group_size > 0) {
+      DumpBuffer buf;
+      write_field_dump(buf, mflds, dumpParams);
+      write_aggregated(buf, dumpParams.baseDir, dumpParams.baseFileName,
+                       grid->step);
+    } else {
+      FileIO fileIO;
+      open_rank_file(fileIO, dumpParams.baseDir, dumpParams.baseFileName,
+                     grid->step);
+      write_field_dump(fileIO, mflds, dumpParams);
+      if (fileIO.close())
+        LOG_ERROR("File close failed on field dump!!!");
+    }
+  }
+
+  template <typename IO>
+  void write_field_dump(IO& fileIO, MfieldsState& mflds,
+                        DumpParameters& dumpParams)
+  {
+    const Grid* grid = &mflds.vgrid();
     auto& fa = mflds.getPatch(0);
     Field3D<typename MfieldsState::Patch> F(fa);
     int64_t step = grid->step;
     int rank = psc_world_rank;
     int nproc = psc_world_size;
 
-    // Create directory for this time step
-    char timeDir[256];
-    sprintf(timeDir, "%s/T.%ld", dumpParams.baseDir, (long)step);
-    dump_mkdir(timeDir);
-
-    // Open the file for output
-    char filename[256];
-    sprintf(filename, "%s/T.%ld/%s.%ld.%d", dumpParams.baseDir, (long)step,
-            dumpParams.baseFileName, (long)step, rank);
-
-    FileIO fileIO;
-    FileIOStatus status;
-
-    status = fileIO.open(filename, io_write);
-    if (status == fail)
-      LOG_ERROR("Failed opening file: %s", filename);
-
     // convenience
     const size_t istride(dumpParams.stride_x);
     const size_t jstride(dumpParams.stride_y);
@@ -606,84 +667,153 @@ struct VpicDiagMixin
     if (numvars > 20)
       numvars = 20; // FIXME!!! materialid are 16 bit
 
-    // more efficient for standard case
-    if (istride == 1 && jstride == 1 && kstride == 1)
-      for (size_t v(0); v < numvars; v++) {
+    // each variable is collected into a band first, and then written in one
+    // go
+    std::vector<uint32_t> band_buf(size_t(dim[0]) * dim[1] * dim[2]);
+
+    for (size_t v(0); v < numvars; v++) {
+      uint32_t* out = band_buf.data();
+      // more efficient for standard case
+      if (istride == 1 && jstride == 1 && kstride == 1) {
         for (size_t k(0); k < nzout + 2; k++) {
           for (size_t j(0); j < nyout + 2; j++) {
             for (size_t i(0); i < nxout + 2; i++) {
               const uint32_t* fref = reinterpret_cast<uint32_t*>(&F(i, j, k));
-              fileIO.write(&fref[varlist[v]], 1);
+              *out++ = fref[varlist[v]];
             }
           }
         }
+        fileIO.write(band_buf.data(), band_buf.size());
+        continue;
       }
 
-    else
-
-      for (size_t v(0); v < numvars; v++) {
-        for (size_t k(0); k < nzout + 2; k++) {
-          const size_t koff =
-            (k == 0) ? 0 : (k == nzout + 1) ? grid->nz + 1 : k * kstride - 1;
-          for (size_t j(0); j < nyout + 2; j++) {
-            const size_t joff =
-              (j == 0) ? 0 : (j == nyout + 1) ? grid->ny + 1 : j * jstride - 1;
-            for (size_t i(0); i < nxout + 2; i++) {
-              const size_t ioff =
-                (i == 0) ? 0
-                         : (i == nxout + 1) ? grid->nx + 1 : i * istride - 1;
-              const uint32_t* fref =
-                reinterpret_cast<uint32_t*>(&F(ioff, joff, koff));
-              fileIO.write(&fref[varlist[v]], 1);
-            }
+      for (size_t k(0); k < nzout + 2; k++) {
+        const size_t koff =
+          (k == 0) ? 0 : (k == nzout + 1) ? grid->nz + 1 : k * kstride - 1;
+        for (size_t j(0); j < nyout + 2; j++) {
+          const size_t joff =
+            (j == 0) ? 0 : (j == nyout + 1) ? grid->ny + 1 : j * jstride - 1;
+          for (size_t i(0); i < nxout + 2; i++) {
+            const size_t ioff =
+              (i == 0) ? 0 : (i == nxout + 1) ? grid->nx + 1 : i * istride - 1;
+            const uint32_t* fref =
+              reinterpret_cast<uint32_t*>(&F(ioff, joff, koff));
+            *out++ = fref[varlist[v]];
           }
         }
       }
+      fileIO.write(band_buf.data(), band_buf.size());
+    }
 
     delete[] varlist;
-
-    if (fileIO.close())
-      LOG_ERROR("File close failed on field dump!!!");
   }
 
   // ----------------------------------------------------------------------
-  // hydro_dump
+  // open_rank_file
+  //
+  // opens <baseDir>/T.<step>/<baseFileName>.<step>.<rank> for a dump with one
+  // file per rank
 
-  void hydro_dump(Mparticles& mprts, MfieldsInterpolator& interpolator,
-                  MfieldsHydro& mflds_hydro, const char* speciesname,
-                  DumpParameters& dumpParams)
+  void open_rank_file(FileIO& fileIO, const char* baseDir,
+                      const char* baseFileName, int64_t step)
   {
-    Field3D<typename MfieldsHydro::Patch> H{mflds_hydro.getPatch(0)};
-    const Grid* grid = mflds_hydro.vgrid();
-    int64_t step = grid->step;
-    int rank = psc_world_rank;
-    int nproc = psc_world_size;
-
     // Create directory for this time step
     char timeDir[256];
-    sprintf(timeDir, "%s/T.%ld", dumpParams.baseDir, (long)step);
+    sprintf(timeDir, "%s/T.%ld", baseDir, (long)step);
     dump_mkdir(timeDir);
 
     // Open the file for output
     char filename[256];
-    sprintf(filename, "%s/T.%ld/%s.%ld.%d", dumpParams.baseDir, (long)step,
-            dumpParams.baseFileName, (long)step, rank);
+    sprintf(filename, "%s/T.%ld/%s.%ld.%d", baseDir, (long)step, baseFileName,
+            (long)step, psc_world_rank);
 
-    FileIO fileIO;
-    FileIOStatus status;
-
-    status = fileIO.open(filename, io_write);
+    FileIOStatus status = fileIO.open(filename, io_write);
     if (status == fail)
       LOG_ERROR("Failed opening file: %s", filename);
+  }
+
+  // ----------------------------------------------------------------------
+  // write_aggregated
+  //
+  // Gathers the dumps of all ranks in the I/O group onto the group's first
+  // rank, which writes them into a single file
+  //
+  //   <baseDir>/T.<step>/<baseFileName>.<step>.g<group>
+  //
+  // see dump_aggregated.hxx for the format, and for reading it back.
+  // Gatherv counts are ints, so a group's dump needs to stay below 2 GiB;
+  // use a smaller io_group_size otherwise.
+
+  void write_aggregated(const DumpBuffer& buf, const char* baseDir,
+                        const char* baseFileName, int64_t step)
+  {
+    int io_rank;
+    MPI_Comm_rank(diag_.io_comm, &io_rank);
+
+    char filename[256];
+    if (io_rank == 0) {
+      // Create directory for this time step
+      char timeDir[256];
+      sprintf(timeDir, "%s/T.%ld", baseDir, (long)step);
+      dump_mkdir(timeDir);
+
+      sprintf(filename, "%s/T.%ld/%s.%ld.g%d", baseDir, (long)step,
+              baseFileName, (long)step, psc_world_rank / diag_.io_group_size);
+    }
+
+    dump_aggregated::write(buf, diag_.io_comm, psc_world_rank, filename);
+  }
+
+  // ----------------------------------------------------------------------
+  // find_species
+
+  static const typename Mparticles::Species& find_species(Mparticles& mprts,
+                                                          const char* name)
+  {
+    auto prts = mprts[0];
+    return *std::find_if(prts.begin(), prts.end(),
+                         [&](const typename Mparticles::Species& sp) {
+                           return strcmp(sp.name, name) == 0;
+                         });
+  }
 
-    auto& sp = *std::find_if(mprts.begin(), mprts.end(),
-                             [&](const typename Mparticles::Species& sp) {
-                               return strcmp(sp.name, speciesname) == 0;
-                             });
+  // ----------------------------------------------------------------------
+  // hydro_dump
+  //
+  // writes out mflds_hydro, which needs to have been accumulated for sp
+  // and synchronized already
 
-    HydroArrayOps::clear(mflds_hydro);
-    ParticlesOps::accumulate_hydro_p(mflds_hydro, sp, interpolator);
-    HydroArrayOps::synchronize(mflds_hydro);
+  void hydro_dump(MfieldsHydro& mflds_hydro,
+                  const typename Mparticles::Species& sp,
+                  DumpParameters& dumpParams)
+  {
+    const Grid* grid = mflds_hydro.vgrid();
+
+    if (diag_.io_group_size > 0) {
+      DumpBuffer buf;
+      write_hydro_dump(buf, mflds_hydro, sp, dumpParams);
+      write_aggregated(buf, dumpParams.baseDir, dumpParams.baseFileName,
+                       grid->step);
+    } else {
+      FileIO fileIO;
+      open_rank_file(fileIO, dumpParams.baseDir, dumpParams.baseFileName,
+                     grid->step);
+      write_hydro_dump(fileIO, mflds_hydro, sp, dumpParams);
+      if (fileIO.close())
+        LOG_ERROR("File close failed on hydro dump!!!");
+    }
+  }
+
+  template <typename IO>
+  void write_hydro_dump(IO& fileIO, MfieldsHydro& mflds_hydro,
+                        const typename Mparticles::Species& sp,
+                        DumpParameters& dumpParams)
+  {
+    Field3D<typename MfieldsHydro::Patch> H{mflds_hydro.getPatch(0)};
+    const Grid* grid = mflds_hydro.vgrid();
+    int64_t step = grid->step;
+    int rank = psc_world_rank;
+    int nproc = psc_world_size;
 
     // convenience
     const size_t istride(dumpParams.stride_x);
@@ -728,45 +858,96 @@ struct VpicDiagMixin
       if (dumpParams.output_vars.bitset(i))
         varlist[c++] = i;
 
-    // More efficient for standard case
-    if (istride == 1 && jstride == 1 && kstride == 1)
-
-      for (size_t v(0); v < numvars; v++)
-        for (size_t k(0); k < nzout + 2; k++)
-          for (size_t j(0); j < nyout + 2; j++)
-            for (size_t i(0); i < nxout + 2; i++) {
-              const uint32_t* href = reinterpret_cast<uint32_t*>(&H(0, 0, 0));
-              fileIO.write(&href[varlist[v]], 1);
-            }
-
-    else
+    // each variable is collected into a band first, and then written in one
+    // go
+    std::vector<uint32_t> band_buf(size_t(dim[0]) * dim[1] * dim[2]);
 
-      for (size_t v(0); v < numvars; v++)
+    for (size_t v(0); v < numvars; v++) {
+      uint32_t* out = band_buf.data();
+      // more efficient for standard case
+      if (istride == 1 && jstride == 1 && kstride == 1) {
         for (size_t k(0); k < nzout + 2; k++) {
-          const size_t koff =
-            (k == 0) ? 0 : (k == nzout + 1) ? grid->nz + 1 : k * kstride - 1;
           for (size_t j(0); j < nyout + 2; j++) {
-            const size_t joff =
-              (j == 0) ? 0 : (j == nyout + 1) ? grid->ny + 1 : j * jstride - 1;
             for (size_t i(0); i < nxout + 2; i++) {
-              const size_t ioff =
-                (i == 0) ? 0
-                         : (i == nxout + 1) ? grid->nx + 1 : i * istride - 1;
-              const uint32_t* href =
-                reinterpret_cast<uint32_t*>(&H(ioff, joff, koff));
-              fileIO.write(&href[varlist[v]], 1);
+              const uint32_t* href = reinterpret_cast<uint32_t*>(&H(i, j, k));
+              *out++ = href[varlist[v]];
             }
           }
         }
+        fileIO.write(band_buf.data(), band_buf.size());
+        continue;
+      }
+
+      for (size_t k(0); k < nzout + 2; k++) {
+        const size_t koff =
+          (k == 0) ? 0 : (k == nzout + 1) ? grid->nz + 1 : k * kstride - 1;
+        for (size_t j(0); j < nyout + 2; j++) {
+          const size_t joff =
+            (j == 0) ? 0 : (j == nyout + 1) ? grid->ny + 1 : j * jstride - 1;
+          for (size_t i(0); i < nxout + 2; i++) {
+            const size_t ioff =
+              (i == 0) ? 0 : (i == nxout + 1) ? grid->nx + 1 : i * istride - 1;
+            const uint32_t* href =
+              reinterpret_cast<uint32_t*>(&H(ioff, joff, koff));
+            *out++ = href[varlist[v]];
+          }
+        }
+      }
+      fileIO.write(band_buf.data(), band_buf.size());
+    }
 
     delete[] varlist;
+  }
 
-    if (fileIO.close())
-      LOG_ERROR("File close failed on hydro dump!!!");
+  // ----------------------------------------------------------------------
+  // particle_dump
+  //
+  // writes out the particles of sp as
+  // particle/T.<step>/<baseFileName>.<step>.<rank> (or .g<group>)
+
+  void particle_dump(const typename Mparticles::Species& sp,
+                     const char* baseFileName, int64_t step)
+  {
+    if (diag_.io_group_size > 0) {
+      DumpBuffer buf;
+      write_particle_dump(buf, sp);
+      write_aggregated(buf, "particle", baseFileName, step);
+    } else {
+      FileIO fileIO;
+      open_rank_file(fileIO, "particle", baseFileName, step);
+      write_particle_dump(fileIO, sp);
+      if (fileIO.close())
+        LOG_ERROR("File close failed on particle dump!!!");
+    }
+  }
+
+  template <typename IO>
+  void write_particle_dump(IO& fileIO, const typename Mparticles::Species& sp)
+  {
+    const Grid* grid = &sp.vgrid();
+    int64_t step = grid->step;
+    int rank = psc_world_rank;
+    int nproc = psc_world_size;
+
+    /* IMPORTANT: these values are written in WRITE_HEADER_V0 */
+    int nxout = grid->nx;
+    int nyout = grid->ny;
+    int nzout = grid->nz;
+    float dxout = grid->dx;
+    float dyout = grid->dy;
+    float dzout = grid->dz;
+
+    _WRITE_HEADER_V0(dump_type::particle_dump, sp.id, sp.q / sp.m, fileIO);
+
+    int dim[1] = {sp.np};
+    WRITE_ARRAY_HEADER(sp.p, 1, dim, fileIO);
+    fileIO.write(sp.p, sp.np);
   }
 
 private:
   VpicDiag diag_;
+  std::unique_ptr<MfieldsHydro> ion_hydro_;
+  HydroArrayOps hydro_ops_;
 };
 
 #endif
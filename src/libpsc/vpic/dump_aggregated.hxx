@@ -0,0 +1,195 @@
+
+#pragma once
+
+#include "psc_vpic_bits.h"
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// ======================================================================
+// DumpBuffer
+//
+// collects a dump in memory for the aggregated writer. It provides the
+// write() that the WRITE macros from dumpmacros.h use, so the same code can
+// write to a FileIO or into a DumpBuffer.
+
+struct DumpBuffer
+{
+  template <typename T>
+  size_t write(const T* data, size_t elements)
+  {
+    const char* p = reinterpret_cast<const char*>(data);
+    buf.insert(buf.end(), p, p + elements * sizeof(T));
+    return elements;
+  }
+
+  std::vector<char> buf;
+};
+
+// ======================================================================
+// dump_aggregated
+//
+// A file holding the dumps of several ranks starts with an index, so that a
+// reader can seek directly to one rank's data:
+//
+//   char[8]  "VPICAGG"
+//   int      index version (0)
+//   int      n, the number of ranks in the file
+//   n times: int rank, int64_t offset, int64_t size
+//
+// offset is counted from the start of the file, and what's there is
+// exactly what the rank would have written into its own file, starting
+// with the _WRITE_HEADER_V0 header.
+
+namespace dump_aggregated
+{
+
+const char magic[8] = "VPICAGG";
+const int version = 0;
+
+struct IndexEntry
+{
+  int rank;
+  int64_t offset;
+  int64_t size;
+};
+
+// ----------------------------------------------------------------------
+// write
+//
+// Writes buf from all ranks in comm into filename, tagged by their rank.
+// Collective, filename is only used on comm's first rank, which does the
+// writing. It receives the other ranks' dumps one after the other, in pieces
+// of at most chunk_size bytes, so it never holds more than its own dump and
+// one chunk, however large the group and its dumps get.
+
+const size_t default_chunk_size = size_t(64) << 20;
+
+inline void write(const DumpBuffer& buf, MPI_Comm comm, int rank,
+                  const char* filename,
+                  size_t chunk_size = default_chunk_size)
+{
+  int io_rank, io_size;
+  MPI_Comm_rank(comm, &io_rank);
+  MPI_Comm_size(comm, &io_size);
+
+  int64_t size = buf.buf.size();
+  std::vector<int64_t> sizes(io_size);
+  std::vector<int> ranks(io_size);
+  MPI_Gather(&size, 1, MPI_INT64_T, sizes.data(), 1, MPI_INT64_T, 0, comm);
+  MPI_Gather(&rank, 1, MPI_INT, ranks.data(), 1, MPI_INT, 0, comm);
+
+  const int tag = 0x4147; // "AG"
+  if (io_rank != 0) {
+    for (size_t off = 0; off < buf.buf.size(); off += chunk_size) {
+      int n = std::min(chunk_size, buf.buf.size() - off);
+      MPI_Send(buf.buf.data() + off, n, MPI_CHAR, 0, tag, comm);
+    }
+    return;
+  }
+
+  FILE* file = fopen(filename, "wb");
+  if (!file)
+    LOG_ERROR("Failed opening file: %s", filename);
+
+  std::vector<IndexEntry> index(io_size);
+  int64_t offset = sizeof(magic) + 2 * sizeof(int) +
+                   io_size * (sizeof(int) + 2 * sizeof(int64_t));
+  for (int r = 0; r < io_size; r++) {
+    index[r] = {ranks[r], offset, sizes[r]};
+    offset += sizes[r];
+  }
+
+  bool ok = fwrite(magic, sizeof(magic), 1, file) == 1 &&
+            fwrite(&version, sizeof(version), 1, file) == 1 &&
+            fwrite(&io_size, sizeof(io_size), 1, file) == 1;
+  // written field by field, so there's no padding in the file
+  for (int r = 0; ok && r < io_size; r++) {
+    ok = fwrite(&index[r].rank, sizeof(int), 1, file) == 1 &&
+         fwrite(&index[r].offset, sizeof(int64_t), 1, file) == 1 &&
+         fwrite(&index[r].size, sizeof(int64_t), 1, file) == 1;
+  }
+
+  // the blocks follow each other in rank order, so they're just appended.
+  // Even after a write error, all chunks need to be received.
+  ok = ok && fwrite(buf.buf.data(), 1, buf.buf.size(), file) == buf.buf.size();
+  std::vector<char> chunk(std::min<int64_t>(
+    chunk_size, *std::max_element(sizes.begin(), sizes.end())));
+  for (int r = 1; r < io_size; r++) {
+    for (int64_t off = 0; off < sizes[r]; off += chunk_size) {
+      int n = std::min<int64_t>(chunk_size, sizes[r] - off);
+      MPI_Recv(chunk.data(), n, MPI_CHAR, r, tag, comm, MPI_STATUS_IGNORE);
+      ok = ok && fwrite(chunk.data(), 1, n, file) == size_t(n);
+    }
+  }
+  if (fclose(file) != 0 || !ok)
+    LOG_ERROR("Failed writing aggregated dump: %s", filename);
+}
+
+// ----------------------------------------------------------------------
+// read_index
+//
+// reads the index at the start of an aggregated file. Returns false if file
+// isn't one.
+
+inline bool read_index(FILE* file, std::vector<IndexEntry>& index)
+{
+  char m[sizeof(magic)];
+  int v, n;
+  if (fseek(file, 0, SEEK_SET) != 0 ||
+      fread(m, sizeof(m), 1, file) != 1 ||
+      memcmp(m, magic, sizeof(m)) != 0 || fread(&v, sizeof(v), 1, file) != 1 ||
+      v != version || fread(&n, sizeof(n), 1, file) != 1 || n < 0) {
+    return false;
+  }
+
+  index.resize(n);
+  for (auto& e : index) {
+    if (fread(&e.rank, sizeof(int), 1, file) != 1 ||
+        fread(&e.offset, sizeof(int64_t), 1, file) != 1 ||
+        fread(&e.size, sizeof(int64_t), 1, file) != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// read_rank
+//
+// reads what rank wrote into the aggregated file filename, ie., what would
+// have been in its own per-rank file. Returns false if the file can't be
+// read or doesn't contain that rank.
+
+inline bool read_rank(const char* filename, int rank, std::vector<char>& data)
+{
+  FILE* file = fopen(filename, "rb");
+  if (!file) {
+    return false;
+  }
+
+  std::vector<IndexEntry> index;
+  bool ok = read_index(file, index);
+  const IndexEntry* entry = nullptr;
+  for (auto& e : index) {
+    if (e.rank == rank) {
+      entry = &e;
+    }
+  }
+  ok = ok && entry;
+  if (ok) {
+    data.resize(entry->size);
+    ok = fseek(file, entry->offset, SEEK_SET) == 0 &&
+         fread(data.data(), 1, data.size(), file) == data.size();
+  }
+  fclose(file);
+  return ok;
+}
+
+} // namespace dump_aggregated
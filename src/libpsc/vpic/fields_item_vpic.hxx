@@ -8,6 +8,8 @@
 #endif
 #include "psc_hydro_ops.hxx"
 
+#include <memory>
+
 // ----------------------------------------------------------------------
 // OutputFieldsVpic
 
@@ -71,24 +73,37 @@ struct OutputHydroVpic_
   {
     // This relies on load_interpolator_array() having been called earlier
 
-    std::vector<std::string> comp_names;
-    comp_names.reserve(mflds_res_.n_comps());
-
+    // accumulate all kinds in a single pass, kind 0 into mflds_hydro, the
+    // other kinds into hydros_
+    std::vector<MfieldsHydro*> hydros;
+    std::vector<const typename Mparticles::Species*> species;
+    auto prts = mprts[0];
     for (int kind = 0; kind < kinds_.size(); ++kind) {
-      HydroOps::clear(mflds_hydro);
+      if (kind > hydros_.size()) {
+        hydros_.emplace_back(
+          new MfieldsHydro{mprts.grid(), mflds_hydro.vgrid()});
+      }
+      auto& hydro = kind == 0 ? mflds_hydro : *hydros_[kind - 1];
+      HydroOps::clear(hydro);
 
-      auto prts = mprts[0];
       // FIXME, just iterate over species instead?
       auto sp = std::find_if(
         prts.cbegin(), prts.cend(),
         [&](const typename Mparticles::Species& sp) { return sp.id == kind; });
-      HydroOps::accumulate_hydro_p(mflds_hydro, sp, interpolator);
+      hydros.push_back(&hydro);
+      species.push_back(&*sp);
+    }
+    hydro_ops_.accumulate_hydro_p(hydros, species, interpolator);
 
-      HydroOps::synchronize(mflds_hydro);
+    std::vector<std::string> comp_names;
+    comp_names.reserve(mflds_res_.n_comps());
+
+    for (int kind = 0; kind < kinds_.size(); ++kind) {
+      HydroOps::synchronize(*hydros[kind]);
 
       for (int p = 0; p < mflds_res_.n_patches(); p++) {
         auto res = mflds_res_[p];
-        auto H = mflds_hydro[p];
+        auto H = (*hydros[kind])[p];
         mflds_res_.Foreach_3d(0, 0, [&](int i, int j, int k) {
           for (int m = 0; m < MfieldsHydro::N_COMP; m++) {
             res(m + kind * MfieldsHydro::N_COMP, i, j, k) = H(m, i, j, k);
@@ -107,6 +122,8 @@ struct OutputHydroVpic_
 private:
   MfieldsSingle mflds_res_;
   Grid_t::Kinds kinds_;
+  std::vector<std::unique_ptr<MfieldsHydro>> hydros_; // kinds 1, 2, ...
+  HydroOps hydro_ops_;
 };
 
 // ----------------------------------------------------------------------
@@ -147,24 +164,37 @@ struct OutputHydroQ_
   {
     // This relies on load_interpolator_array() having been called earlier
 
-    std::vector<std::string> comp_names;
-    comp_names.reserve(mflds_res_.n_comps());
-
+    // accumulate all kinds in a single pass, kind 0 into mflds_hydro, the
+    // other kinds into hydros_
+    std::vector<MfieldsHydro*> hydros;
+    std::vector<const typename Mparticles::Species*> species;
+    auto prts = mprts[0];
     for (int kind = 0; kind < kinds_.size(); ++kind) {
-      HydroOps::clear(mflds_hydro);
+      if (kind > hydros_.size()) {
+        hydros_.emplace_back(
+          new MfieldsHydro{mprts.grid(), mflds_hydro.vgrid()});
+      }
+      auto& hydro = kind == 0 ? mflds_hydro : *hydros_[kind - 1];
+      HydroOps::clear(hydro);
 
-      auto prts = mprts[0];
       // FIXME, just iterate over species instead?
       auto sp = std::find_if(
         prts.cbegin(), prts.cend(),
         [&](const typename Mparticles::Species& sp) { return sp.id == kind; });
-      HydroOps::accumulate_hydro_p(mflds_hydro, sp, interpolator);
+      hydros.push_back(&hydro);
+      species.push_back(&*sp);
+    }
+    hydro_ops_.accumulate_hydro_p(hydros, species, interpolator);
 
-      HydroOps::synchronize(mflds_hydro);
+    std::vector<std::string> comp_names;
+    comp_names.reserve(mflds_res_.n_comps());
+
+    for (int kind = 0; kind < kinds_.size(); ++kind) {
+      HydroOps::synchronize(*hydros[kind]);
 
       for (int p = 0; p < mflds_res_.n_patches(); p++) {
         auto res = mflds_res_[p];
-        auto H = mflds_hydro[p];
+        auto H = (*hydros[kind])[p];
         mflds_res_.Foreach_3d(0, 0, [&](int i, int j, int k) {
           for (int m = 0; m < MfieldsHydro::N_COMP; m++) {
             res(m + kind * MfieldsHydro::N_COMP, i, j, k) = H(m, i, j, k);
@@ -183,6 +213,8 @@ struct OutputHydroQ_
 private:
   MfieldsSingle mflds_res_;
   Grid_t::Kinds kinds_;
+  std::vector<std::unique_ptr<MfieldsHydro>> hydros_; // kinds 1, 2, ...
+  HydroOps hydro_ops_;
 };
 
 #ifdef USE_VPIC
@@ -46,6 +46,20 @@ struct MarderVpicOpsWrap
   {
     mflds.fa()->kernel->clean_div_b(mflds.fa());
   }
+  double clean_div_e_pass(MfieldsState& mflds, bool rms)
+  {
+    compute_div_e_err(mflds);
+    double err = rms ? compute_rms_div_e_err(mflds) : 0.;
+    clean_div_e(mflds);
+    return err;
+  }
+  double clean_div_b_pass(MfieldsState& mflds, bool rms)
+  {
+    compute_div_b_err(mflds);
+    double err = rms ? compute_rms_div_b_err(mflds) : 0.;
+    clean_div_b(mflds);
+    return err;
+  }
   double synchronize_tang_e_norm_b(MfieldsState& mflds)
   {
     return mflds.fa()->kernel->synchronize_tang_e_norm_b(mflds.fa());
@@ -141,13 +155,14 @@ struct MarderVpicOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int face = side ? nx_[X] + 1 : 1;
       foreach_node(g_, X, face,
                    [&](int x, int y, int z) { *p++ = F(x, y, z).rhof; });
       foreach_node(g_, X, face,
                    [&](int x, int y, int z) { *p++ = F(x, y, z).rhob; });
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -179,31 +194,31 @@ struct MarderVpicOps
   // ----------------------------------------------------------------------
   // compute_div_e_err
 
-  void compute_div_e_err(MfieldsState& mflds)
+  struct CalcDivE
   {
-    struct CalcDivE
+    CalcDivE(typename MfieldsState::Patch& fa, const MaterialCoefficient* m)
+      : F(fa),
+        nc(m->nonconductive),
+        px(fa.grid()->nx > 1 ? fa.grid()->eps0 * fa.grid()->rdx : 0),
+        py(fa.grid()->ny > 1 ? fa.grid()->eps0 * fa.grid()->rdy : 0),
+        pz(fa.grid()->nz > 1 ? fa.grid()->eps0 * fa.grid()->rdz : 0),
+        cj(1. / fa.grid()->eps0)
+    {}
+
+    void operator()(int i, int j, int k)
     {
-      CalcDivE(typename MfieldsState::Patch& fa, const MaterialCoefficient* m)
-        : F(fa),
-          nc(m->nonconductive),
-          px(fa.grid()->nx > 1 ? fa.grid()->eps0 * fa.grid()->rdx : 0),
-          py(fa.grid()->ny > 1 ? fa.grid()->eps0 * fa.grid()->rdy : 0),
-          pz(fa.grid()->nz > 1 ? fa.grid()->eps0 * fa.grid()->rdz : 0),
-          cj(1. / fa.grid()->eps0)
-      {}
-
-      void operator()(int i, int j, int k)
-      {
-        F(i, j, k).div_e_err = nc * (px * (F(i, j, k).ex - F(i - 1, j, k).ex) +
-                                     py * (F(i, j, k).ey - F(i, j - 1, k).ey) +
-                                     pz * (F(i, j, k).ez - F(i, j, k - 1).ez) -
-                                     cj * (F(i, j, k).rhof + F(i, j, k).rhob));
-      }
-
-      F3D F;
-      const float nc, px, py, pz, cj;
-    };
+      F(i, j, k).div_e_err = nc * (px * (F(i, j, k).ex - F(i - 1, j, k).ex) +
+                                   py * (F(i, j, k).ey - F(i, j - 1, k).ey) +
+                                   pz * (F(i, j, k).ez - F(i, j, k - 1).ez) -
+                                   cj * (F(i, j, k).rhof + F(i, j, k).rhob));
+    }
+
+    F3D F;
+    const float nc, px, py, pz, cj;
+  };
 
+  void compute_div_e_err(MfieldsState& mflds)
+  {
     auto& fa = mflds.getPatch(0);
     auto& prm = mflds.params();
     assert(prm.size() == 1);
@@ -227,6 +242,20 @@ struct MarderVpicOps
     LocalOps::local_adjust_div_e(mflds);
   }
 
+  // ----------------------------------------------------------------------
+  // reduce_rms
+  //
+  // turns the local sum of the squared errors into the global rms error
+
+  static double reduce_rms(const Grid& g, double err)
+  {
+    double local[2], _global[2]; // FIXME, name clash with global macro
+    local[0] = err * g.dV;
+    local[1] = (g.nx * g.ny * g.nz) * g.dV;
+    MPI_Allreduce(local, _global, 2, MPI_DOUBLE, MPI_SUM, psc_comm_world);
+    return g.eps0 * sqrt(_global[0] / _global[1]);
+  }
+
   // ----------------------------------------------------------------------
   // compute_rms_div_e_err
   //
@@ -310,11 +339,7 @@ struct MarderVpicOps
     err += 0.125 * sqr((double)(F(1, ny + 1, nz + 1).div_e_err));
     err += 0.125 * sqr((double)(F(nx + 1, ny + 1, nz + 1).div_e_err));
 
-    double local[2], _global[2]; // FIXME, name clash with global macro
-    local[0] = err * g.dV;
-    local[1] = (nx * ny * nz) * g.dV;
-    MPI_Allreduce(local, _global, 2, MPI_DOUBLE, MPI_SUM, psc_comm_world);
-    return g.eps0 * sqrt(_global[0] / _global[1]);
+    return reduce_rms(g, err);
   }
 
   // ----------------------------------------------------------------------
@@ -404,29 +429,140 @@ struct MarderVpicOps
   }
 
   // ----------------------------------------------------------------------
-  // compute_div_b_err
-
-  void compute_div_b_err(MfieldsState& mflds)
+  // clean_div_e_pass
+  //
+  // One round of E divergence cleaning, i.e., compute_div_e_err,
+  // compute_rms_div_e_err (if rms is set) and (vacuum_)clean_div_e, done as
+  // a single sweep over the interior nodes, plane by plane in z. As soon as
+  // div_e_err is known on plane k, the edges in plane k and the edges
+  // between planes k - 1 and k that connect two interior nodes get
+  // corrected. The boundary nodes need the normal E ghosts, so they, and the
+  // edges touching them, are done after the exchange, which overlaps the
+  // sweep. Gives the same fields as the separate steps. Returns the rms
+  // error before cleaning, or 0 if rms is not set.
+
+  double clean_div_e_pass(MfieldsState& mflds, bool rms)
   {
     const auto& g = mflds.vgrid();
     auto& fa = mflds.getPatch(0);
     F3D F(fa);
 
+    auto& prm = mflds.params();
+    assert(prm.size() == 1);
+    const MaterialCoefficient* m = prm[0];
+
     const int nx = g.nx, ny = g.ny, nz = g.nz;
-    const float px =
-      (nx > 1) ? g.rdx : 0; // FIXME, should be based on global dims
-    const float py = (ny > 1) ? g.rdy : 0;
-    const float pz = (nz > 1) ? g.rdz : 0;
 
-    for (int k = 1; k <= nz; k++) {
-      for (int j = 1; j <= ny; j++) {
-        for (int i = 1; i <= nx; i++) {
-          F(i, j, k).div_b_err = (px * (F(i + 1, j, k).cbx - F(i, j, k).cbx) +
-                                  py * (F(i, j + 1, k).cby - F(i, j, k).cby) +
-                                  pz * (F(i, j, k + 1).cbz - F(i, j, k).cbz));
+    const float _rdx = (nx > 1) ? g.rdx : 0;
+    const float _rdy = (ny > 1) ? g.rdy : 0;
+    const float _rdz = (nz > 1) ? g.rdz : 0;
+    const float alphadt = 0.3888889 / (_rdx * _rdx + _rdy * _rdy + _rdz * _rdz);
+    const float px = (alphadt * _rdx) * m->drivex;
+    const float py = (alphadt * _rdy) * m->drivey;
+    const float pz = (alphadt * _rdz) * m->drivez;
+
+    CalcDivE div_e(fa, m);
+    double err = 0.;
+
+    // Begin setting normal e ghosts
+    RemoteOps::begin_remote_ghost_norm_e(mflds);
+    LocalOps::local_ghost_norm_e(mflds);
+
+    // Interior nodes, and edges between them
+#pragma omp parallel reduction(+ : err)
+    for (int k = 2; k <= nz; k++) {
+#pragma omp for
+      for (int j = 2; j <= ny; j++) {
+        for (int i = 2; i <= nx; i++) {
+          div_e(i, j, k);
+          err += sqr((double)F(i, j, k).div_e_err);
+        }
+      }
+#pragma omp for
+      for (int j = 2; j <= ny; j++) {
+        for (int i = 2; i < nx; i++) {
+          MARDER_EX(i, j, k);
+        }
+        if (j < ny) {
+          for (int i = 2; i <= nx; i++) {
+            MARDER_EY(i, j, k);
+          }
+        }
+        if (k > 2) {
+          for (int i = 2; i <= nx; i++) {
+            MARDER_EZ(i, j, k - 1);
+          }
         }
       }
     }
+
+    // Finish setting normal e ghosts
+    RemoteOps::end_remote_ghost_norm_e(mflds);
+
+    // Boundary nodes
+    foreach_nc_boundary(div_e, g);
+    LocalOps::local_adjust_div_e(mflds);
+
+    // boundary nodes only count with the fraction of their cell volume
+    // that's inside the local domain
+    if (rms) {
+      auto w = [](int i, int n) { return (i == 1 || i == n + 1) ? .5 : 1.; };
+      foreach_nc_boundary(
+        [&](int i, int j, int k) {
+          err += w(i, nx) * w(j, ny) * w(k, nz) *
+                 sqr((double)F(i, j, k).div_e_err);
+        },
+        g);
+    }
+
+    // Edges touching a boundary node
+    foreach_except([&](int i, int j, int k) { MARDER_EX(i, j, k); },
+                   {{1, 1, 1}, {nx, ny + 1, nz + 1}},
+                   {{2, 2, 2}, {nx - 1, ny, nz}});
+    foreach_except([&](int i, int j, int k) { MARDER_EY(i, j, k); },
+                   {{1, 1, 1}, {nx + 1, ny, nz + 1}},
+                   {{2, 2, 2}, {nx, ny - 1, nz}});
+    foreach_except([&](int i, int j, int k) { MARDER_EZ(i, j, k); },
+                   {{1, 1, 1}, {nx + 1, ny + 1, nz}},
+                   {{2, 2, 2}, {nx, ny, nz - 1}});
+
+    LocalOps::local_adjust_tang_e(mflds);
+
+    return rms ? reduce_rms(g, err) : 0.;
+  }
+
+  // ----------------------------------------------------------------------
+  // compute_div_b_err
+
+  struct CalcDivB
+  {
+    CalcDivB(typename MfieldsState::Patch& fa)
+      : F(fa),
+        px(fa.grid()->nx > 1 ? fa.grid()->rdx
+                             : 0), // FIXME, should be based on global dims
+        py(fa.grid()->ny > 1 ? fa.grid()->rdy : 0),
+        pz(fa.grid()->nz > 1 ? fa.grid()->rdz : 0)
+    {}
+
+    void operator()(int i, int j, int k)
+    {
+      F(i, j, k).div_b_err = (px * (F(i + 1, j, k).cbx - F(i, j, k).cbx) +
+                              py * (F(i, j + 1, k).cby - F(i, j, k).cby) +
+                              pz * (F(i, j, k + 1).cbz - F(i, j, k).cbz));
+    }
+
+    F3D F;
+    const float px, py, pz;
+  };
+
+  void compute_div_b_err(MfieldsState& mflds)
+  {
+    const auto& g = mflds.vgrid();
+    auto& fa = mflds.getPatch(0);
+    CalcDivB updater(fa);
+
+    foreach (updater, 1, g.nx, 1, g.ny, 1, g.nz)
+      ;
   }
 
   // ----------------------------------------------------------------------
@@ -451,11 +587,7 @@ struct MarderVpicOps
       }
     }
 
-    double local[2], _global[2]; // FIXME, name clash with global macro
-    local[0] = err * g.dV;
-    local[1] = (nx * ny * nz) * g.dV;
-    MPI_Allreduce(local, _global, 2, MPI_DOUBLE, MPI_SUM, psc_comm_world);
-    return g.eps0 * sqrt(_global[0] / _global[1]);
+    return reduce_rms(g, err);
   }
 
   // ----------------------------------------------------------------------
@@ -584,6 +716,94 @@ struct MarderVpicOps
     LocalOps::local_adjust_norm_b(mflds);
   }
 
+  // ----------------------------------------------------------------------
+  // clean_div_b_pass
+  //
+  // One round of B divergence cleaning, i.e., compute_div_b_err,
+  // compute_rms_div_b_err (if rms is set) and clean_div_b. div_b_err is
+  // computed first in the cells next to the local domain boundary, which is
+  // what the ghost exchange needs. The interior cells then get done plane
+  // by plane in z while the exchange is in flight, correcting the faces
+  // between cells whose div_b_err is known as soon as plane k is complete.
+  // The faces that are left over are done after the exchange. Gives the
+  // same fields as the separate steps. Returns the rms error before
+  // cleaning, or 0 if rms is not set.
+
+  double clean_div_b_pass(MfieldsState& mflds, bool rms)
+  {
+    const auto& g = mflds.vgrid();
+    auto& fa = mflds.getPatch(0);
+    F3D F(fa);
+
+    const int nx = g.nx, ny = g.ny, nz = g.nz;
+    float px = (nx > 1) ? g.rdx : 0;
+    float py = (ny > 1) ? g.rdy : 0;
+    float pz = (nz > 1) ? g.rdz : 0;
+    float alphadt = 0.3888889 / (px * px + py * py + pz * pz);
+    px *= alphadt;
+    py *= alphadt;
+    pz *= alphadt;
+
+    CalcDivB div_b(fa);
+    double err = 0.;
+
+    // Cells next to the boundary
+    foreach_except(
+      [&](int i, int j, int k) {
+        div_b(i, j, k);
+        err += sqr((double)F(i, j, k).div_b_err);
+      },
+      {{1, 1, 1}, {nx, ny, nz}}, {{2, 2, 2}, {nx - 1, ny - 1, nz - 1}});
+
+    // Begin setting ghosts
+    RemoteOps::begin_remote_ghost_div_b(mflds);
+    LocalOps::local_ghost_div_b(mflds);
+
+    // Interior cells, and faces between known cells
+#pragma omp parallel reduction(+ : err)
+    for (int k = 2; k < nz; k++) {
+#pragma omp for
+      for (int j = 2; j < ny; j++) {
+        for (int i = 2; i < nx; i++) {
+          div_b(i, j, k);
+          err += sqr((double)F(i, j, k).div_b_err);
+        }
+      }
+#pragma omp for
+      for (int j = 1; j <= ny; j++) {
+        for (int i = 2; i <= nx; i++) {
+          MARDER_CBX(i, j, k);
+        }
+        if (j > 1) {
+          for (int i = 1; i <= nx; i++) {
+            MARDER_CBY(i, j, k);
+          }
+        }
+        for (int i = 1; i <= nx; i++) {
+          MARDER_CBZ(i, j, k);
+        }
+      }
+    }
+
+    // Finish setting derr ghosts
+    RemoteOps::end_remote_ghost_div_b(mflds);
+
+    // Left over faces
+    foreach_except([&](int i, int j, int k) { MARDER_CBX(i, j, k); },
+                   {{1, 1, 1}, {nx + 1, ny, nz}},
+                   {{2, 1, 2}, {nx, ny, nz - 1}});
+    foreach_except([&](int i, int j, int k) { MARDER_CBY(i, j, k); },
+                   {{1, 1, 1}, {nx, ny + 1, nz}},
+                   {{1, 2, 2}, {nx, ny, nz - 1}});
+    foreach_except([&](int i, int j, int k) { MARDER_CBZ(i, j, k); },
+                   {{1, 1, 1}, {nx, ny, nz + 1}},
+                   {{1, 1, 2}, {nx, ny, nz - 1}});
+
+    LocalOps::local_adjust_norm_b(mflds);
+
+    return rms ? reduce_rms(g, err) : 0.;
+  }
+
   // ----------------------------------------------------------------------
   // synchronize_tang_e_norm_b
 
@@ -610,7 +830,7 @@ struct MarderVpicOps
       err = 0.;
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int Y = (X + 1) % 3, Z = (X + 2) % 3;
       int face = side ? nx_[X] + 1 : 1;
@@ -624,6 +844,7 @@ struct MarderVpicOps
         *p++ = (&F(x, y, z).ex)[Z];
         *p++ = (&F(x, y, z).tcax)[Z];
       });
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -778,13 +999,12 @@ struct MarderVpic_
     this->synchronize_rho(mflds);
 
     for (int round = 0; round < num_div_e_round_; round++) {
-      this->compute_div_e_err(mflds);
-      if (round == 0 || round == num_div_e_round_ - 1) {
-        double err = this->compute_rms_div_e_err(mflds);
+      bool report = round == 0 || round == num_div_e_round_ - 1;
+      double err = this->clean_div_e_pass(mflds, report);
+      if (report) {
         mpi_printf(comm_, "%s rms error = %e (charge/volume)\n",
                    round == 0 ? "Initial" : "Cleaned", err);
       }
-      this->clean_div_e(mflds);
     }
   }
 
@@ -796,13 +1016,12 @@ struct MarderVpic_
     mpi_printf(comm_, "Divergence cleaning magnetic field\n");
 
     for (int round = 0; round < num_div_b_round_; round++) {
-      this->compute_div_b_err(mflds);
-      if (round == 0 || round == num_div_b_round_ - 1) {
-        double err = this->compute_rms_div_b_err(mflds);
+      bool report = round == 0 || round == num_div_b_round_ - 1;
+      double err = this->clean_div_b_pass(mflds, report);
+      if (report) {
         mpi_printf(comm_, "%s rms error = %e (charge/volume)\n",
                    round == 0 ? "Initial" : "Cleaned", err);
       }
-      this->clean_div_b(mflds);
     }
   }
 
@@ -884,6 +1103,14 @@ struct MarderVpic_
     TOC(clean_div_e, 1);
   }
 
+  double clean_div_e_pass(MfieldsState& mflds, bool rms)
+  {
+    double err;
+    TIC err = Ops::clean_div_e_pass(mflds, rms);
+    TOC(clean_div_e_pass, 1);
+    return err;
+  }
+
   void compute_div_b_err(MfieldsState& mflds)
   {
     TIC Ops::compute_div_b_err(mflds);
@@ -904,6 +1131,14 @@ struct MarderVpic_
     TOC(clean_div_e, 1);
   }
 
+  double clean_div_b_pass(MfieldsState& mflds, bool rms)
+  {
+    double err;
+    TIC err = Ops::clean_div_b_pass(mflds, rms);
+    TOC(clean_div_b_pass, 1);
+    return err;
+  }
+
   double synchronize_tang_e_norm_b(MfieldsState& mflds)
   {
     double err;
@@ -3,6 +3,11 @@
 
 #include "PscFieldBase.h"
 
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // ======================================================================
 // MfieldsAccumulatorPsc
 
@@ -31,24 +36,27 @@ struct MfieldsAccumulatorPsc
     using Base::Base;
   };
 
-  MfieldsAccumulatorPsc(Grid* grid) : g_(grid)
+  // n_pipeline defaults to one pipeline per thread
+  MfieldsAccumulatorPsc(Grid* grid, int n_pipeline = aa_n_pipeline())
+    : g_(grid)
   {
-    n_pipeline_ = aa_n_pipeline();
+    assert(n_pipeline >= 1);
+    n_pipeline_ = n_pipeline;
     stride_ = POW2_CEIL(g_->nv, 2);
     arr_ = new Element[(n_pipeline_ + 1) * stride_]();
   }
 
   ~MfieldsAccumulatorPsc() { delete[] arr_; }
 
+  // one block per thread for the concurrent pipelines; there is one
+  // additional block (index n_pipeline) for the pipeline handling the
+  // remainder
   static int aa_n_pipeline(void)
   {
-    return 2;
-#if 0
-    int n = serial.n_pipeline;
-    if (n < thread.n_pipeline) {
-      n = thread.n_pipeline;
-    }
-    return n;
+#ifdef _OPENMP
+    return std::max(omp_get_max_threads(), 1);
+#else
+    return 1;
 #endif
   }
 
@@ -65,7 +73,7 @@ struct MfieldsAccumulatorPsc
 
   Block operator[](int c)
   {
-    assert(c >= 0 && c < n_pipeline_);
+    assert(c >= 0 && c <= n_pipeline_);
     return Block(grid(), arr_ + c * stride_);
   }
 
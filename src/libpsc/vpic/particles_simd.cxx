@@ -0,0 +1,45 @@
+
+#include "particles_simd.h"
+
+#include <cstdlib>
+
+// ----------------------------------------------------------------------
+// detect_simd_width
+
+static int detect_simd_width()
+{
+  int width = 1;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#ifdef PSC_HAVE_SIMD_V8
+  if (__builtin_cpu_supports("avx2")) {
+    width = 8;
+  }
+#endif
+#ifdef PSC_HAVE_SIMD_V16
+  if (__builtin_cpu_supports("avx512f")) {
+    width = 16;
+  }
+#endif
+#endif
+
+  const char* s = getenv("PSC_VPIC_SIMD_WIDTH");
+  if (s) {
+    int max_width = atoi(s);
+    if (width > max_width) {
+      width = max_width >= 8 ? 8 : 1;
+    }
+  }
+  return width;
+}
+
+// ----------------------------------------------------------------------
+// psc_vpic_simd_width
+//
+// detected once, the initialization of a function-local static is
+// thread-safe
+
+int psc_vpic_simd_width()
+{
+  static const int width = detect_simd_width();
+  return width;
+}
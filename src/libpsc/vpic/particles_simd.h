@@ -0,0 +1,37 @@
+
+#pragma once
+
+// ======================================================================
+// Wide-vector (8 / 16 lane) kernels for the momentum update part of
+// PscParticlesOps::advance_p and ::uncenter_p
+//
+// The kernels work on plain arrays: p points to n particles laid out like
+// PscParticle (dx, dy, dz, i, ux, uy, uz, w), ip to the interpolator array
+// with ip_stride floats per voxel, laid out like PscInterpolatorT. n must be
+// a multiple of the vector width.
+//
+// Each vector width is compiled in its own translation unit with the
+// corresponding -m flags, so the kernels must only be called if
+// psc_vpic_simd_width() says so.
+
+// interpolate E, B, update momenta in place, and return the normalized
+// displacement of each particle in dispx, dispy, dispz
+void advance_p_push_v8(float* p, int n, const float* ip, int ip_stride,
+                       float qdt_2mc, float cdt_dx, float cdt_dy,
+                       float cdt_dz, float* dispx, float* dispy,
+                       float* dispz);
+void advance_p_push_v16(float* p, int n, const float* ip, int ip_stride,
+                        float qdt_2mc, float cdt_dx, float cdt_dy,
+                        float cdt_dz, float* dispx, float* dispy,
+                        float* dispz);
+
+// backward half advance / half rotate of the momenta
+void uncenter_p_push_v8(float* p, int n, const float* ip, int ip_stride,
+                        float qdt_2mc, float qdt_4mc);
+void uncenter_p_push_v16(float* p, int n, const float* ip, int ip_stride,
+                         float qdt_2mc, float qdt_4mc);
+
+// vector width to use: 16 or 8 if the kernels were built for, and the CPU
+// supports, AVX-512F or AVX2, respectively, 1 otherwise (scalar pipelines).
+// Can be overridden (lowered) by setting PSC_VPIC_SIMD_WIDTH.
+int psc_vpic_simd_width();
@@ -0,0 +1,158 @@
+
+// ======================================================================
+// particles_simd_kernels.inl
+//
+// N-wide versions of the momentum update in advance_p_pipeline /
+// uncenter_p_pipeline (PscParticlesOps.h). The arithmetic is written in the
+// same order as the scalar code, so results are bit-for-bit the same.
+// Included by particles_simd_v{8,16}.cxx inside an anonymous namespace.
+
+enum
+{
+  PRT_DX,
+  PRT_DY,
+  PRT_DZ,
+  PRT_I,
+  PRT_UX,
+  PRT_UY,
+  PRT_UZ,
+  PRT_W,
+  PRT_STRIDE,
+};
+
+enum
+{
+  IP_EX,
+  IP_DEXDY,
+  IP_DEXDZ,
+  IP_D2EXDYDZ,
+  IP_EY,
+  IP_DEYDZ,
+  IP_DEYDX,
+  IP_D2EYDZDX,
+  IP_EZ,
+  IP_DEZDX,
+  IP_DEZDY,
+  IP_D2EZDXDY,
+  IP_CBX,
+  IP_DCBXDX,
+  IP_CBY,
+  IP_DCBYDY,
+  IP_CBZ,
+  IP_DCBZDZ,
+};
+
+// ----------------------------------------------------------------------
+// push_momentum
+//
+// interpolate fields, then half E advance, Boris rotation, half E advance
+
+template <int N>
+static void push_momentum(float* p, const float* ip, int ip_stride,
+                          float _qdt_2mc, float _qdt_rot,
+                          typename SimdFloat<N>::type& ux,
+                          typename SimdFloat<N>::type& uy,
+                          typename SimdFloat<N>::type& uz, bool advance)
+{
+  using V = SimdFloat<N>;
+  using vf = typename V::type;
+
+  const vf qdt_2mc = V::splat(_qdt_2mc);
+  const vf qdt_rot = V::splat(_qdt_rot);
+  const vf one = V::splat(1.f);
+  const vf one_third = V::splat(1.f / 3.f);
+  const vf two_fifteenths = V::splat(2.f / 15.f);
+
+  vf dx = V::gather(p, PRT_STRIDE, PRT_DX);
+  vf dy = V::gather(p, PRT_STRIDE, PRT_DY);
+  vf dz = V::gather(p, PRT_STRIDE, PRT_DZ);
+  auto ii = V::gather_int(p, PRT_STRIDE, PRT_I);
+
+#define F(m) V::gather(ip, ii, ip_stride, IP_##m)
+  vf hax = qdt_2mc * ((F(EX) + dy * F(DEXDY)) +
+                      dz * (F(DEXDZ) + dy * F(D2EXDYDZ)));
+  vf hay = qdt_2mc * ((F(EY) + dz * F(DEYDZ)) +
+                      dx * (F(DEYDX) + dz * F(D2EYDZDX)));
+  vf haz = qdt_2mc * ((F(EZ) + dx * F(DEZDX)) +
+                      dy * (F(DEZDY) + dx * F(D2EZDXDY)));
+  vf cbx = F(CBX) + dx * F(DCBXDX);
+  vf cby = F(CBY) + dy * F(DCBYDY);
+  vf cbz = F(CBZ) + dz * F(DCBZDZ);
+#undef F
+
+  ux = V::gather(p, PRT_STRIDE, PRT_UX);
+  uy = V::gather(p, PRT_STRIDE, PRT_UY);
+  uz = V::gather(p, PRT_STRIDE, PRT_UZ);
+  if (advance) {
+    ux += hax;
+    uy += hay;
+    uz += haz;
+  }
+  vf v0 = qdt_rot / V::sqrt(one + (ux * ux + (uy * uy + uz * uz)));
+  vf v1 = cbx * cbx + (cby * cby + cbz * cbz);
+  vf v2 = (v0 * v0) * v1;
+  vf v3 = v0 * (one + v2 * (one_third + v2 * two_fifteenths));
+  vf v4 = v3 / (one + v1 * (v3 * v3));
+  v4 += v4;
+  v0 = ux + v3 * (uy * cbz - uz * cby);
+  v1 = uy + v3 * (uz * cbx - ux * cbz);
+  v2 = uz + v3 * (ux * cby - uy * cbx);
+  ux += v4 * (v1 * cbz - v2 * cby);
+  uy += v4 * (v2 * cbx - v0 * cbz);
+  uz += v4 * (v0 * cby - v1 * cbx);
+  ux += hax;
+  uy += hay;
+  uz += haz;
+
+  V::scatter(p, PRT_STRIDE, PRT_UX, ux);
+  V::scatter(p, PRT_STRIDE, PRT_UY, uy);
+  V::scatter(p, PRT_STRIDE, PRT_UZ, uz);
+}
+
+// ----------------------------------------------------------------------
+// advance_p_push
+
+template <int N>
+static void advance_p_push(float* p, int n, const float* ip, int ip_stride,
+                           float qdt_2mc, float _cdt_dx, float _cdt_dy,
+                           float _cdt_dz, float* dispx, float* dispy,
+                           float* dispz)
+{
+  using V = SimdFloat<N>;
+  using vf = typename V::type;
+
+  const vf one = V::splat(1.f);
+  const vf cdt_dx = V::splat(_cdt_dx);
+  const vf cdt_dy = V::splat(_cdt_dy);
+  const vf cdt_dz = V::splat(_cdt_dz);
+
+  for (int i = 0; i < n; i += N, p += N * PRT_STRIDE) {
+    vf ux, uy, uz;
+    push_momentum<N>(p, ip, ip_stride, qdt_2mc, qdt_2mc, ux, uy, uz, true);
+
+    // normalized displacement
+    vf v0 = one / V::sqrt(one + (ux * ux + (uy * uy + uz * uz)));
+    ux *= cdt_dx;
+    uy *= cdt_dy;
+    uz *= cdt_dz;
+    ux *= v0;
+    uy *= v0;
+    uz *= v0;
+    V::store(dispx + i, ux);
+    V::store(dispy + i, uy);
+    V::store(dispz + i, uz);
+  }
+}
+
+// ----------------------------------------------------------------------
+// uncenter_p_push
+
+template <int N>
+static void uncenter_p_push(float* p, int n, const float* ip, int ip_stride,
+                            float qdt_2mc, float qdt_4mc)
+{
+  for (int i = 0; i < n; i += N, p += N * PRT_STRIDE) {
+    typename SimdFloat<N>::type ux, uy, uz;
+    push_momentum<N>(p, ip, ip_stride, qdt_2mc, qdt_4mc, ux, uy, uz, false);
+  }
+}
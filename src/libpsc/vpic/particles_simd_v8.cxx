@@ -0,0 +1,32 @@
+
+// 8-wide particle kernels, compiled with AVX2 enabled if the compiler
+// supports it (see src/libpsc/CMakeLists.txt)
+
+#include "particles_simd.h"
+
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+#include "simd_float.h"
+#include "particles_simd_kernels.inl"
+} // namespace
+
+void advance_p_push_v8(float* p, int n, const float* ip, int ip_stride,
+                       float qdt_2mc, float cdt_dx, float cdt_dy,
+                       float cdt_dz, float* dispx, float* dispy,
+                       float* dispz)
+{
+  advance_p_push<8>(p, n, ip, ip_stride, qdt_2mc, cdt_dx, cdt_dy, cdt_dz,
+                    dispx, dispy, dispz);
+}
+
+void uncenter_p_push_v8(float* p, int n, const float* ip, int ip_stride,
+                        float qdt_2mc, float qdt_4mc)
+{
+  uncenter_p_push<8>(p, n, ip, ip_stride, qdt_2mc, qdt_4mc);
+}
@@ -4,6 +4,14 @@
 #include "GridLoop.h"
 #include "Field3D.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // Generic looping
 #define XYZ_LOOP(xl, xh, yl, yh, zl, zh)                                       \
   for (z = zl; z <= zh; z++)                                                   \
@@ -15,6 +23,116 @@
 #define y_NODE_LOOP(y) XYZ_LOOP(1, nx + 1, y, y, 1, nz + 1)
 #define z_NODE_LOOP(z) XYZ_LOOP(1, nx + 1, 1, ny + 1, z, z)
 
+// ======================================================================
+// accumulate_hydro_threaded
+//
+// Calls accumulate(ha, sp, n_begin, n_end) for each of the species, with the
+// particles split into one contiguous chunk per thread. Thread 0 deposits
+// directly into hydros[s], the others into their own partial hydro block,
+// which only covers the range of voxels their particles touch. Particles are
+// normally sorted by voxel, so that range is small. The blocks live in
+// scratch[t], which belongs to the caller so it can be reused between calls,
+// and are added into hydros[s] at the end.
+
+template <typename MfieldsHydro, typename Species, typename F>
+void accumulate_hydro_threaded(
+  const std::vector<MfieldsHydro*>& hydros,
+  const std::vector<const Species*>& species,
+  std::vector<std::vector<typename MfieldsHydro::Element>>& scratch,
+  F accumulate)
+{
+  using Element = typename MfieldsHydro::Element;
+  const int n_comp = sizeof(Element) / sizeof(float);
+
+  assert(hydros.size() == species.size());
+  int n_species = species.size();
+  if (n_species == 0) {
+    return;
+  }
+
+#ifdef _OPENMP
+  int n_thread = std::max(omp_get_max_threads(), 1);
+#else
+  int n_thread = 1;
+#endif
+
+  const auto& g = *hydros[0]->vgrid();
+  const int nv = g.nv;
+  // a particle in voxel i deposits into voxels i .. i + reach
+  const int reach =
+    VOXEL(1, 1, 1, g.nx, g.ny, g.nz) - VOXEL(0, 0, 0, g.nx, g.ny, g.nz);
+
+  if (scratch.size() < size_t(n_thread)) {
+    scratch.resize(n_thread);
+  }
+
+  // voxel range [lo, hi) and block, indexed by voxel, for species s, thread t
+  std::vector<int> lo(n_species * n_thread), hi(n_species * n_thread);
+  std::vector<Element*> block(n_species * n_thread);
+
+#pragma omp parallel for
+  for (int t = 0; t < n_thread; t++) {
+    size_t len = 0;
+    for (int s = 0; s < n_species; s++) {
+      int st = s * n_thread + t;
+      int64_t np = species[s]->np;
+      int n_begin = np * t / n_thread, n_end = np * (t + 1) / n_thread;
+      if (t == 0) {
+        lo[st] = 0;
+        hi[st] = nv;
+        continue;
+      }
+      int v_min = nv, v_max = -1;
+      const auto* p = species[s]->p;
+      for (int n = n_begin; n < n_end; n++) {
+        v_min = std::min(v_min, int(p[n].i));
+        v_max = std::max(v_max, int(p[n].i));
+      }
+      lo[st] = v_max >= v_min ? v_min : 0;
+      hi[st] = v_max >= v_min ? std::min(v_max + reach + 1, nv) : 0;
+      len += hi[st] - lo[st];
+    }
+
+    if (t > 0) {
+      auto& buf = scratch[t];
+      if (buf.size() < len) {
+        buf.resize(len);
+      }
+      std::fill(buf.begin(), buf.begin() + len, Element{});
+    }
+
+    size_t off = 0;
+    for (int s = 0; s < n_species; s++) {
+      int st = s * n_thread + t;
+      if (t == 0) {
+        block[st] = hydros[s]->getPatch(0).data();
+      } else {
+        block[st] = scratch[t].data() + off - lo[st];
+        off += hi[st] - lo[st];
+      }
+      int64_t np = species[s]->np;
+      accumulate(block[st], *species[s], int(np * t / n_thread),
+                 int(np * (t + 1) / n_thread));
+    }
+  }
+
+  // add the partial blocks in thread order, so that the result doesn't
+  // depend on the scheduling
+  for (int s = 0; s < n_species; s++) {
+    float* a = reinterpret_cast<float*>(block[s * n_thread]);
+    for (int t = 1; t < n_thread; t++) {
+      int st = s * n_thread + t;
+      const float* b = reinterpret_cast<const float*>(block[st]);
+#pragma omp parallel for
+      for (int v = lo[st]; v < hi[st]; v++) {
+        for (int m = 0; m < n_comp; m++) {
+          a[v * n_comp + m] += b[v * n_comp + m];
+        }
+      }
+    }
+  }
+}
+
 // ======================================================================
 // PscHydroOps
 
@@ -50,6 +168,7 @@ struct PscHydroOps
     using Base::end;
 
     using Base::buf_size_;
+    using Base::clip_;
     using Base::g_;
     using Base::nx_;
 
@@ -61,7 +180,7 @@ struct PscHydroOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int face = side ? nx_[X] + 1 : 1;
       foreach_node(g_, X, face, [&](int x, int y, int z) {
@@ -80,7 +199,8 @@ struct PscHydroOps
         *p++ = h->tyz;
         *p++ = h->tzx;
         *p++ = h->txy;
-      });
+      }, clip_);
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -102,7 +222,7 @@ struct PscHydroOps
         h->tyz += *p++;
         h->tzx += *p++;
         h->txy += *p++;
-      });
+      }, clip_);
     }
   };
 
@@ -159,10 +279,8 @@ struct PscHydroOps
 
     CommHydro<Grid, F3D> comm{*hydro.vgrid()};
 
-    for (int dir = 0; dir < 3; dir++) {
-      comm.begin(dir, H);
-      comm.end(dir, H);
-    }
+    auto handle = comm.reduce_begin(H);
+    comm.reduce_end(handle, H);
   }
 
   // ----------------------------------------------------------------------
@@ -176,16 +294,38 @@ struct PscHydroOps
   // hydro jx,jy,jz are for diagnostic purposes only; they are not
   // accumulated with a charge conserving algorithm.
 
-  static void accumulate_hydro_p(
+  void accumulate_hydro_p(
     MfieldsHydro& hydro,
     const typename Mparticles::ConstSpeciesIterator sp_iter,
     /*const*/ MfieldsInterpolator& interpolator)
   {
-    auto& sp = *sp_iter;
-    auto& ha = hydro.getPatch(0);
+    accumulate_hydro_p({&hydro}, {&*sp_iter}, interpolator);
+  }
+
+  // Same as above, but for several species at once, species[s] being
+  // accumulated into hydros[s], in a single threaded pass.
+
+  void accumulate_hydro_p(
+    const std::vector<MfieldsHydro*>& hydros,
+    const std::vector<const typename Mparticles::Species*>& species,
+    /*const*/ MfieldsInterpolator& interpolator)
+  {
     auto& IP = interpolator.getPatch(0);
+    accumulate_hydro_threaded(
+      hydros, species, scratch_,
+      [&](Element* ha, const typename Mparticles::Species& sp, int n_begin,
+          int n_end) { accumulate_hydro_p(ha, sp, IP, n_begin, n_end); });
+  }
+
+  // accumulate particles [n_begin, n_end) of sp into ha
+
+  static void accumulate_hydro_p(Element* ha,
+                                 const typename Mparticles::Species& sp,
+                                 typename MfieldsInterpolator::Patch& IP,
+                                 int n_begin, int n_end)
+  {
     float c, qsp, mspc, qdt_2mc, qdt_4mc2, r8V;
-    int np, stride_10, stride_21, stride_43;
+    int stride_10, stride_21, stride_43;
 
     float dx, dy, dz, ux, uy, uz, w, vx, vy, vz, ke_mc;
     float w0, w1, w2, w3, w4, w5, w6, w7, t;
@@ -201,7 +341,6 @@ struct PscHydroOps
     qdt_4mc2 = qdt_2mc / (2 * c);
     r8V = g.r8V;
 
-    np = sp.np;
     stride_10 =
       (VOXEL(1, 0, 0, g.nx, g.ny, g.nz) - VOXEL(0, 0, 0, g.nx, g.ny, g.nz));
     stride_21 =
@@ -209,7 +348,7 @@ struct PscHydroOps
     stride_43 =
       (VOXEL(0, 0, 1, g.nx, g.ny, g.nz) - VOXEL(1, 1, 0, g.nx, g.ny, g.nz));
 
-    for (n = 0; n < np; n++) {
+    for (n = n_begin; n < n_end; n++) {
 
       // Load the particle
       dx = p[n].dx;
@@ -326,6 +465,10 @@ struct PscHydroOps
 #undef ACCUM_HYDRO
     }
   }
+
+private:
+  // per-thread partial hydro blocks for accumulate_hydro_threaded()
+  std::vector<std::vector<Element>> scratch_;
 };
 
 // ======================================================================
@@ -363,6 +506,7 @@ struct PscHydroQOps
     using Base::end;
 
     using Base::buf_size_;
+    using Base::clip_;
     using Base::g_;
     using Base::nx_;
 
@@ -374,7 +518,7 @@ struct PscHydroQOps
       }
     }
 
-    void begin_send(int X, int side, float* p, F3D& F)
+    float* begin_send(int X, int side, float* p, F3D& F)
     {
       int face = side ? nx_[X] + 1 : 1;
       foreach_node(g_, X, face, [&](int x, int y, int z) {
@@ -403,7 +547,8 @@ struct PscHydroQOps
         *p++ = h->qyyx;
         *p++ = h->qzzy;
         *p++ = h->qxyz;
-      });
+      }, clip_);
+      return p;
     }
 
     void end_recv(int X, int side, float* p, F3D& F)
@@ -435,7 +580,7 @@ struct PscHydroQOps
         h->qyyx += *p++;
         h->qzzy += *p++;
         h->qxyz += *p++;
-      });
+      }, clip_);
     }
   };
 
@@ -502,10 +647,8 @@ struct PscHydroQOps
 
     CommHydro<Grid, F3D> comm{*hydro.vgrid()};
 
-    for (int dir = 0; dir < 3; dir++) {
-      comm.begin(dir, H);
-      comm.end(dir, H);
-    }
+    auto handle = comm.reduce_begin(H);
+    comm.reduce_end(handle, H);
   }
 
   // ----------------------------------------------------------------------
@@ -519,16 +662,38 @@ struct PscHydroQOps
   // hydro jx,jy,jz are for diagnostic purposes only; they are not
   // accumulated with a charge conserving algorithm.
 
-  static void accumulate_hydro_p(
+  void accumulate_hydro_p(
     MfieldsHydro& hydro,
     const typename Mparticles::ConstSpeciesIterator sp_iter,
     /*const*/ MfieldsInterpolator& interpolator)
   {
-    auto& sp = *sp_iter;
-    auto& ha = hydro.getPatch(0);
+    accumulate_hydro_p({&hydro}, {&*sp_iter}, interpolator);
+  }
+
+  // Same as above, but for several species at once, species[s] being
+  // accumulated into hydros[s], in a single threaded pass.
+
+  void accumulate_hydro_p(
+    const std::vector<MfieldsHydro*>& hydros,
+    const std::vector<const typename Mparticles::Species*>& species,
+    /*const*/ MfieldsInterpolator& interpolator)
+  {
     auto& IP = interpolator.getPatch(0);
+    accumulate_hydro_threaded(
+      hydros, species, scratch_,
+      [&](Element* ha, const typename Mparticles::Species& sp, int n_begin,
+          int n_end) { accumulate_hydro_p(ha, sp, IP, n_begin, n_end); });
+  }
+
+  // accumulate particles [n_begin, n_end) of sp into ha
+
+  static void accumulate_hydro_p(Element* ha,
+                                 const typename Mparticles::Species& sp,
+                                 typename MfieldsInterpolator::Patch& IP,
+                                 int n_begin, int n_end)
+  {
     float c, qsp, mspc, qdt_2mc, qdt_4mc2, r8V;
-    int np, stride_10, stride_21, stride_43;
+    int stride_10, stride_21, stride_43;
 
     float dx, dy, dz, ux, uy, uz, w, vx, vy, vz, ke_mc;
     float w0, w1, w2, w3, w4, w5, w6, w7, t;
@@ -544,7 +709,6 @@ struct PscHydroQOps
     qdt_4mc2 = qdt_2mc / (2 * c);
     r8V = g.r8V;
 
-    np = sp.np;
     stride_10 =
       (VOXEL(1, 0, 0, g.nx, g.ny, g.nz) - VOXEL(0, 0, 0, g.nx, g.ny, g.nz));
     stride_21 =
@@ -552,7 +716,7 @@ struct PscHydroQOps
     stride_43 =
       (VOXEL(0, 0, 1, g.nx, g.ny, g.nz) - VOXEL(1, 1, 0, g.nx, g.ny, g.nz));
 
-    for (n = 0; n < np; n++) {
+    for (n = n_begin; n < n_end; n++) {
 
       // Load the particle
       dx = p[n].dx;
@@ -679,6 +843,10 @@ struct PscHydroQOps
 #undef ACCUM_HYDRO
     }
   }
+
+private:
+  // per-thread partial hydro blocks for accumulate_hydro_threaded()
+  std::vector<std::vector<Element>> scratch_;
 };
 
 #undef XYZ_LOOP
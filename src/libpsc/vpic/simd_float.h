@@ -0,0 +1,107 @@
+
+#pragma once
+
+// ======================================================================
+// SimdFloat<N>
+//
+// Minimal portable N-wide float vector, built on the GCC / clang vector
+// extensions. The arithmetic operators come with the vector type and get
+// mapped onto whatever vector ISA the translation unit is compiled for.
+// This is meant to be included only by translation units that are compiled
+// for one specific ISA (see particles_simd_v8.cxx / particles_simd_v16.cxx),
+// and inside an anonymous namespace there, so that no inline code is shared
+// with translation units compiled for a different ISA.
+//
+// Only operations that are exactly rounded (+, -, *, /, sqrt) are provided,
+// so results are the same as scalar code, as long as no contraction to
+// fused multiply-add happens (compile with -ffp-contract=off).
+//
+// Needs <cstdint>, <cstring> and, for AVX / AVX-512, <immintrin.h> to be
+// included beforehand.
+
+// GCC drops the vector_size attribute when the size depends on a template
+// parameter, so the vector types are spelled out for each supported width
+
+template <int N>
+struct SimdFloatTypes;
+
+template <>
+struct SimdFloatTypes<8>
+{
+  typedef float type __attribute__((vector_size(32)));
+  typedef int32_t itype __attribute__((vector_size(32)));
+};
+
+template <>
+struct SimdFloatTypes<16>
+{
+  typedef float type __attribute__((vector_size(64)));
+  typedef int32_t itype __attribute__((vector_size(64)));
+};
+
+template <int N>
+struct SimdFloat
+{
+  using type = typename SimdFloatTypes<N>::type;
+  using itype = typename SimdFloatTypes<N>::itype;
+
+  static type splat(float val) { return type{} + val; }
+
+  // load member at offset `off` (in floats) of N records of `stride` floats
+  static type gather(const float* base, int stride, int off)
+  {
+    type v;
+    for (int l = 0; l < N; l++) {
+      v[l] = base[l * stride + off];
+    }
+    return v;
+  }
+
+  // load member at offset `off` of the records base + idx[l] * stride
+  static type gather(const float* base, itype idx, int stride, int off)
+  {
+    type v;
+    for (int l = 0; l < N; l++) {
+      v[l] = base[idx[l] * stride + off];
+    }
+    return v;
+  }
+
+  static itype gather_int(const float* base, int stride, int off)
+  {
+    itype v;
+    for (int l = 0; l < N; l++) {
+      memcpy(&v[l], &base[l * stride + off], sizeof(int32_t));
+    }
+    return v;
+  }
+
+  static void scatter(float* base, int stride, int off, type v)
+  {
+    for (int l = 0; l < N; l++) {
+      base[l * stride + off] = v[l];
+    }
+  }
+
+  static void store(float* p, type v) { memcpy(p, &v, sizeof(v)); }
+
+  static type sqrt(type v)
+  {
+#if defined(__AVX512F__)
+    if (N == 16) {
+      __m512 r = _mm512_sqrt_ps(reinterpret_cast<__m512&>(v));
+      return reinterpret_cast<type&>(r);
+    }
+#endif
+#if defined(__AVX__)
+    if (N == 8) {
+      __m256 r = _mm256_sqrt_ps(reinterpret_cast<__m256&>(v));
+      return reinterpret_cast<type&>(r);
+    }
+#endif
+    for (int l = 0; l < N; l++) {
+      v[l] = __builtin_sqrtf(v[l]);
+    }
+    return v;
+  }
+};
@@ -3,6 +3,14 @@
 
 #include "vpic_iface.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #ifdef USE_VPIC
 
 // ======================================================================
@@ -34,7 +42,18 @@ struct SortVpicWrap
 // ======================================================================
 // SortVpic
 //
-// sorts vpic-style particles
+// sorts vpic-style particles by voxel
+//
+// The full sort is a counting sort: each thread histograms its contiguous
+// chunk of particles, a prefix sum over (voxel, thread) gives each thread
+// its own output offsets, and the threads then scatter their chunk into the
+// aux buffer in parallel. This is stable, so it gives the same order as
+// the serial counting sort.
+//
+// When sorting often, most particles are still where the previous sort left
+// them. In that case, the particles that are out of order are picked out,
+// sorted separately and merged back in place, which avoids copying all
+// particles twice.
 
 template <typename Mparticles>
 struct SortVpic
@@ -43,6 +62,14 @@ struct SortVpic
   using Species = typename Mparticles::Species;
   using Particle = typename Mparticles::Particle;
 
+  // try the in-place path if the species was sorted at most this many
+  // steps ago
+  static const int max_in_place_interval = 8;
+
+  // give up on the in-place path once more than 1 / max_stray_frac of the
+  // particles are out of order
+  static const int max_stray_frac = 8;
+
   // ----------------------------------------------------------------------
   // operator()
 
@@ -60,72 +87,193 @@ struct SortVpic
     }
   }
 
-private:
   // ----------------------------------------------------------------------
   // sort_p
 
-  static void sort_p(Species& sp)
+  void sort_p(Species& sp)
   {
     const auto& g = sp.vgrid();
+    bool recent = sp.last_sorted != INT64_MIN &&
+                  g.step - sp.last_sorted <= max_in_place_interval;
     sp.last_sorted = g.step;
 
-    int n_prts = sp.np;
-    int vl = VOXEL(1, 1, 1, g.nx, g.ny, g.nz);
-    int vh = VOXEL(g.nx, g.ny, g.nz, g.nx, g.ny, g.nz) + 1;
+    if (recent && sort_p_in_place(sp)) {
+      find_partition(sp);
+    } else {
+      sort_p_counting(sp);
+    }
+  }
+
+private:
+  static int n_threads()
+  {
+#ifdef _OPENMP
+    return std::max(omp_get_max_threads(), 1);
+#else
+    return 1;
+#endif
+  }
+
+  // ----------------------------------------------------------------------
+  // sort_p_counting
+
+  void sort_p_counting(Species& sp)
+  {
+    const auto& g = sp.vgrid();
+    const int nv = g.nv;
+    const int n_prts = sp.np;
+    const int n_thread = n_threads();
+    Particle* RESTRICT p = sp.p;
+    int* RESTRICT partition = sp.partition;
 
-    static int* RESTRICT ALIGNED(128) next;
-    if (!next) {
-      next = new int[g.nv];
+    // scratch follows the grid / particle count
+    counts_.resize(size_t(n_thread) * nv);
+    if (p_aux_.size() < size_t(n_prts)) {
+      p_aux_.resize(n_prts);
     }
-    int* RESTRICT ALIGNED(128) partition = sp.partition;
-
-    static Particle* RESTRICT ALIGNED(128) p_aux;
-    static size_t n_alloced;
-    if (n_prts > n_alloced) {
-      delete[] p_aux;
-      p_aux = new Particle[n_prts];
-      n_alloced = n_prts;
+    Particle* RESTRICT p_aux = p_aux_.data();
+    auto chunk = [&](int t) { return int(int64_t(n_prts) * t / n_thread); };
+    auto block = [&](int b) { return int(int64_t(nv) * b / n_thread); };
+
+    // per-thread histograms
+#pragma omp parallel for
+    for (int t = 0; t < n_thread; t++) {
+      int* RESTRICT cnt = &counts_[size_t(t) * nv];
+      std::fill(cnt, cnt + nv, 0);
+      for (int i = chunk(t); i < chunk(t + 1); i++) {
+        cnt[p[i].i]++;
+      }
     }
-    Particle* RESTRICT ALIGNED(128) p = sp.p;
 
-    // zero counts
-    for (int v = vl; v < vh; v++) {
-      next[v] = 0;
+    // prefix sum over (voxel, thread), done in voxel blocks: sum up each
+    // block, scan the block totals, then turn the counts within each block
+    // into offsets
+    std::vector<int> base(n_thread + 1);
+#pragma omp parallel for
+    for (int b = 0; b < n_thread; b++) {
+      int sum = 0;
+      for (int v = block(b); v < block(b + 1); v++) {
+        for (int t = 0; t < n_thread; t++) {
+          sum += counts_[size_t(t) * nv + v];
+        }
+      }
+      base[b + 1] = sum;
+    }
+    for (int b = 0; b < n_thread; b++) {
+      base[b + 1] += base[b];
     }
+#pragma omp parallel for
+    for (int b = 0; b < n_thread; b++) {
+      int sum = base[b];
+      for (int v = block(b); v < block(b + 1); v++) {
+        partition[v] = sum;
+        for (int t = 0; t < n_thread; t++) {
+          int& cnt = counts_[size_t(t) * nv + v];
+          int count = cnt;
+          cnt = sum;
+          sum += count;
+        }
+      }
+    }
+    partition[nv] = n_prts;
 
-    // find counts
-    for (int i = 0; i < n_prts; i++) {
-      next[p[i].i]++;
+    // reorder
+#pragma omp parallel for
+    for (int t = 0; t < n_thread; t++) {
+      int* RESTRICT next = &counts_[size_t(t) * nv];
+      for (int i = chunk(t); i < chunk(t + 1); i++) {
+        p_aux[next[p[i].i]++] = p[i];
+      }
     }
 
-    // prefix sum
-    int sum = 0;
-    for (int v = vl; v < vh; v++) {
-      int count = next[v];
-      next[v] = sum;
-      partition[v] = sum;
-      sum += count;
+#pragma omp parallel for
+    for (int t = 0; t < n_thread; t++) {
+      std::copy(p_aux + chunk(t), p_aux + chunk(t + 1), p + chunk(t));
     }
-    partition[vh] = sum;
+  }
 
-    // reorder
+  // ----------------------------------------------------------------------
+  // sort_p_in_place
+  //
+  // Keeps the particles that are in order in place (compacted towards the
+  // front), collects the ones that aren't, sorts those and merges them back
+  // in from the end. A particle counts as in order if its voxel is not
+  // smaller than the last one kept and not larger than its successor's.
+  // Returns false if too many particles are out of order, in which case the
+  // particles are left unsorted (but complete) for the counting sort.
+
+  bool sort_p_in_place(Species& sp)
+  {
+    const int n_prts = sp.np;
+    const size_t max_strays = n_prts / max_stray_frac;
+    Particle* RESTRICT p = sp.p;
+
+    strays_.clear();
+    int n_kept = 0;
+    int v_last = INT_MIN;
     for (int i = 0; i < n_prts; i++) {
       int v = p[i].i;
-      int j = next[v]++;
-      p_aux[j] = p[i];
+      if (v >= v_last && (i + 1 == n_prts || v <= p[i + 1].i)) {
+        p[n_kept++] = p[i];
+        v_last = v;
+      } else {
+        if (strays_.size() == max_strays) {
+          // the gap between kept and unprocessed particles is exactly the
+          // size of strays_
+          std::copy(strays_.begin(), strays_.end(), p + n_kept);
+          return false;
+        }
+        strays_.push_back(p[i]);
+      }
     }
 
-    // fix up unused part of partition
-    for (int i = 0; i < vl; i++) {
-      partition[i] = 0;
-    }
-    for (int i = vh; i < g.nv; i++) {
-      partition[i] = n_prts;
+    std::stable_sort(
+      strays_.begin(), strays_.end(),
+      [](const Particle& a, const Particle& b) { return a.i < b.i; });
+
+    int i = n_kept - 1, k = n_prts - 1;
+    for (int j = int(strays_.size()) - 1; j >= 0; k--) {
+      if (i >= 0 && p[i].i > strays_[j].i) {
+        p[k] = p[i--];
+      } else {
+        p[k] = strays_[j--];
+      }
     }
+    return true;
+  }
 
-    // OPT: just swap pointer?
-    for (int i = 0; i < n_prts; i++) {
-      p[i] = p_aux[i];
+  // ----------------------------------------------------------------------
+  // find_partition
+  //
+  // sets up sp.partition from the sorted particles
+
+  static void find_partition(Species& sp)
+  {
+    const int nv = sp.vgrid().nv;
+    const int n_prts = sp.np;
+    const int n_thread = n_threads();
+    const Particle* RESTRICT p = sp.p;
+    int* RESTRICT partition = sp.partition;
+    auto chunk = [&](int t) { return int(int64_t(n_prts) * t / n_thread); };
+
+    // each particle that starts a new voxel fills in the partition for
+    // the (empty) voxels in between, too, so every entry is written once
+#pragma omp parallel for
+    for (int t = 0; t < n_thread; t++) {
+      for (int i = chunk(t); i < chunk(t + 1); i++) {
+        int v_prev = i > 0 ? p[i - 1].i : -1;
+        for (int v = v_prev + 1; v <= p[i].i; v++) {
+          partition[v] = i;
+        }
+      }
+    }
+    int v_end = n_prts > 0 ? p[n_prts - 1].i : -1;
+    for (int v = v_end + 1; v <= nv; v++) {
+      partition[v] = n_prts;
     }
   }
+
+  std::vector<int> counts_;
+  std::vector<Particle> p_aux_;
+  std::vector<Particle> strays_;
 };
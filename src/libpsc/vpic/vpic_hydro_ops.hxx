@@ -4,6 +4,8 @@
 #include "vpic/vpic.h"
 #include "psc_vpic_bits.h"
 
+#include <vector>
+
 template <typename _Mparticles, typename _MfieldsHydro,
           typename _MfieldsInterpolator>
 struct VpicHydroOps
@@ -23,4 +25,15 @@ struct VpicHydroOps
   {
     ::accumulate_hydro_p(hydro, &*sp, interpolator.getPatch(0).ip());
   }
+
+  static void accumulate_hydro_p(
+    const std::vector<MfieldsHydro*>& hydros,
+    const std::vector<const typename Mparticles::Species*>& species,
+    /*const*/ MfieldsInterpolator& interpolator)
+  {
+    for (int s = 0; s < species.size(); s++) {
+      ::accumulate_hydro_p(*hydros[s], species[s],
+                           interpolator.getPatch(0).ip());
+    }
+  }
 };
@@ -220,7 +220,8 @@ using Checks = PscConfig::Checks;
 using Marder = PscConfig::Marder;
 using OutputParticles = PscConfig::OutputParticles;
 using Moment_n = typename Moment_n_Selector<Mparticles, Dim>::type;
-using Heating = typename HeatingSelector<Mparticles>::Heating;
+using Heating =
+  typename HeatingSelector<Mparticles, HeatingSpotFoil<Dim>>::Heating;
 
 // ======================================================================
 // FIXME, so ugly...